@@ -0,0 +1,700 @@
+#include "../includes/Game.hpp"
+#include "../includes/Kernels.hpp"
+#include "../includes/Patterns.hpp"
+#include "../includes/Regions.hpp"
+#include "../includes/Morton.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/*
+ * Микробенчмарки шага, работы с полем и внеэкранной отрисовки.
+ * Результат выводится в JSON в формате Google Benchmark, чтобы сравнивать выпуски теми же средствами(compare.py)
+ * Ключи: --benchmark_filter=подстрока, --benchmark_min_time=секунды, --benchmark_out=файл
+ */
+
+
+struct BenchResult
+{
+	std::string name;
+	long long iterations;
+	double real_time;
+	double cpu_time;
+	int threads;
+	double items_per_second;
+};
+
+static double min_time = 0.2;
+static std::string name_filter;
+static std::vector<BenchResult> results;
+
+
+// Прогоняет body(iterations) с растущим числом итераций, пока замер не займёт min_time секунд
+template <class F>
+static void RunBenchmark(const std::string& name, int threads, double items_per_iteration, F body)
+{
+	if ( !name_filter.empty() && (name.find(name_filter) == std::string::npos) )
+		return;
+
+	long long iterations = 1;
+	double real_seconds = 0.0;
+	double cpu_seconds = 0.0;
+
+	for ( ;; )
+	{
+		std::clock_t cpu_start = std::clock();
+		auto real_start = std::chrono::steady_clock::now();
+		body(iterations);
+		real_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+		cpu_seconds = double(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+		if ( (real_seconds >= min_time) || (iterations >= 1000000000LL) )
+			break;
+
+		double multiplier = (real_seconds > 0.0) ? min_time * 1.4 / real_seconds : 100.0;
+		if ( multiplier > 100.0 )
+			multiplier = 100.0;
+		long long next = (long long)(iterations * multiplier);
+		iterations = (next > iterations) ? next : iterations + 1;
+	}
+
+	BenchResult r;
+	r.name = name;
+	r.iterations = iterations;
+	r.real_time = real_seconds * 1e9 / iterations;
+	r.cpu_time = cpu_seconds * 1e9 / iterations;
+	r.threads = threads;
+	r.items_per_second = (real_seconds > 0.0) ? items_per_iteration * iterations / real_seconds : 0.0;
+	results.push_back(r);
+
+	std::cerr << name << "\t" << r.real_time << " ns\t" << r.items_per_second << " items/s" << std::endl;
+}
+
+static std::string RuleName(const LifeRule& rule)
+{
+	std::string s = lifeRuleToString(rule);
+	size_t slash = s.find('/');
+	if ( slash != std::string::npos )
+		s.erase(slash, 1);
+	return s;
+}
+
+static std::string SizeName(int w, int h)
+{
+	return std::to_string(w) + "x" + std::to_string(h);
+}
+
+
+
+
+static void BenchStep(void)
+{
+	const int sizes[][2] = { { 256, 256 }, { 1024, 1024 }, { 4096, 4096 } };
+	const double densities[] = { 0.1, 0.5 };
+	const char* rule_names[] = { "B3/S23", "B36/S23" };
+
+	int hw_threads = std::thread::hardware_concurrency();
+	std::vector<int> thread_counts { 2, 4 };
+	if ( hw_threads > 4 )
+		thread_counts.push_back(hw_threads);
+
+	int best_kernel = detectBestStepKernel();
+
+	for ( auto& size : sizes )
+	for ( double density : densities )
+	for ( const char* rule_name : rule_names )
+	{
+		LifeRule rule;
+		parseLifeRule(rule_name, rule);
+		Grid grid(size[0], size[1], false);
+		double cells = double(size[0]) * size[1];
+
+		std::ostringstream suffix;
+		suffix << "/" << SizeName(size[0], size[1]) << "/d" << density << "/" << RuleName(rule);
+
+		for ( int kernel_id = 0; kernel_id < STEP_KERNELS_COUNT; ++kernel_id )
+		{
+			if ( !isStepKernelSupported(kernel_id) || !getStepKernel(kernel_id) )
+				continue;
+
+			grid.Randomize(density, 1);
+			StepKernel kernel = getStepKernel(kernel_id);
+			RunBenchmark(std::string("Step/") + getStepKernelName(kernel_id) + suffix.str() + "/threads:1", 1, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel); });
+		}
+
+		for ( int threads : thread_counts )
+		{
+			WorkerPool workers(threads);
+			grid.Randomize(density, 1);
+			StepKernel kernel = getStepKernel(best_kernel);
+			RunBenchmark(std::string("Step/") + getStepKernelName(best_kernel) + suffix.str() + "/threads:" + std::to_string(threads), threads, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel, &workers); });
+		}
+	}
+}
+
+
+// Шаг со слоем активности(возраст и тепло клеток): разница со Step той же конфигурации - цена слоя
+static void BenchStepActivity(void)
+{
+	const int sizes[][2] = { { 256, 256 }, { 1024, 1024 }, { 4096, 4096 } };
+	const double densities[] = { 0.1, 0.5 };
+	LifeRule rule = conwayRule();
+
+	int hw_threads = std::thread::hardware_concurrency();
+	int best_kernel = detectBestStepKernel();
+
+	for ( auto& size : sizes )
+	for ( double density : densities )
+	{
+		Grid grid(size[0], size[1], false);
+		grid.EnableActivity(true);
+		double cells = double(size[0]) * size[1];
+
+		std::ostringstream suffix;
+		suffix << "/" << SizeName(size[0], size[1]) << "/d" << density << "/" << RuleName(rule);
+
+		for ( int kernel_id = 0; kernel_id < STEP_KERNELS_COUNT; ++kernel_id )
+		{
+			if ( !isStepKernelSupported(kernel_id) || !getStepKernel(kernel_id) )
+				continue;
+
+			grid.Randomize(density, 1);
+			StepKernel kernel = getStepKernel(kernel_id);
+			RunBenchmark(std::string("StepActivity/") + getStepKernelName(kernel_id) + suffix.str() + "/threads:1", 1, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel); });
+		}
+
+		if ( hw_threads > 1 )
+		{
+			WorkerPool workers(hw_threads);
+			grid.Randomize(density, 1);
+			StepKernel kernel = getStepKernel(best_kernel);
+			RunBenchmark(std::string("StepActivity/") + getStepKernelName(best_kernel) + suffix.str() + "/threads:" + std::to_string(hw_threads), hw_threads, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel, &workers); });
+		}
+	}
+}
+
+
+// Правила Larger than Life с растущим радиусом: время на клетку не должно расти вместе с окрестностью
+static void BenchStepLargerThanLife(void)
+{
+	const int sizes[][2] = { { 256, 256 }, { 1024, 1024 } };
+	const char* rule_names[] = {
+		"R2,C0,M0,S3..8,B5..7,NM",
+		"R5,C0,M1,S34..58,B34..45,NM",
+		"R10,C0,M1,S100..200,B75..170,NM",
+		"R2,C0,M0,S2..4,B3..4,NN",
+		"R5,C0,M0,S12..30,B15..25,NN",
+		"R10,C0,M0,S40..100,B50..90,NN"
+	};
+
+	int hw_threads = std::thread::hardware_concurrency();
+
+	for ( auto& size : sizes )
+	for ( const char* rule_name : rule_names )
+	{
+		LifeRule rule;
+		parseLifeRule(rule_name, rule);
+		Grid grid(size[0], size[1], false);
+		double cells = double(size[0]) * size[1];
+
+		std::ostringstream suffix;
+		suffix << "/" << SizeName(size[0], size[1]) << "/d0.5/" << RuleName(rule);
+
+		// Ядро выбирается по правилу, переданное ядро для таких правил не используется
+		StepKernel kernel = getStepKernel(STEP_KERNEL_SCALAR_BYTE);
+		grid.Randomize(0.5, 1);
+		RunBenchmark(std::string("StepLtL") + suffix.str() + "/threads:1", 1, cells,
+			[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel); });
+
+		if ( hw_threads > 1 )
+		{
+			WorkerPool workers(hw_threads);
+			grid.Randomize(0.5, 1);
+			RunBenchmark(std::string("StepLtL") + suffix.str() + "/threads:" + std::to_string(hw_threads), hw_threads, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel, &workers); });
+		}
+	}
+}
+
+
+// Временное блокирование: depth поколений за проход по полю, сравнивать со Step той же конфигурации(depth 1 - обычный шаг)
+static void BenchStepBlocked(void)
+{
+	const int sizes[][2] = { { 1024, 1024 }, { 4096, 4096 }, { 8192, 8192 } };
+	const int depths[] = { 1, 4, 8, 16 };
+	LifeRule rule = conwayRule();
+
+	int hw_threads = std::thread::hardware_concurrency();
+	int best_kernel = detectBestStepKernel();
+	StepKernel kernel = getStepKernel(best_kernel);
+
+	for ( auto& size : sizes )
+	{
+		Grid grid(size[0], size[1], false);
+		double cells = double(size[0]) * size[1];
+
+		std::ostringstream suffix;
+		suffix << "/" << getStepKernelName(best_kernel) << "/" << SizeName(size[0], size[1]) << "/d0.3/" << RuleName(rule);
+
+		for ( int depth : depths )
+		{
+			grid.Randomize(0.3, 1);
+			RunBenchmark(std::string("StepBlocked") + suffix.str() + "/depth:" + std::to_string(depth) + "/threads:1", 1, cells * depth,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.StepBlocked(rule, kernel, depth); });
+
+			if ( hw_threads > 1 )
+			{
+				WorkerPool workers(hw_threads);
+				grid.Randomize(0.3, 1);
+				RunBenchmark(std::string("StepBlocked") + suffix.str() + "/depth:" + std::to_string(depth) + "/threads:" + std::to_string(hw_threads), hw_threads, cells * depth,
+					[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.StepBlocked(rule, kernel, depth, &workers); });
+			}
+		}
+	}
+}
+
+
+/*
+ * Раскладка поля: строки слов(SWAR64 - то же скалярное слово, что у плиток, и лучшее ядро) против плиток 8x8
+ * в порядке Мортона на широком, высоком и квадратном поле одной площади. Рамка живых клеток выключена
+ */
+static void BenchLayout(void)
+{
+	const int sizes[][2] = { { 65536, 64 }, { 64, 65536 }, { 2048, 2048 } };
+	LifeRule rule = conwayRule();
+	int best_kernel = detectBestStepKernel();
+
+	for ( auto& size : sizes )
+	{
+		Grid grid(size[0], size[1], true);
+		grid.EnableBounds(false);
+		double cells = double(size[0]) * size[1];
+		std::string suffix = "/" + SizeName(size[0], size[1]) + "/d0.3/" + RuleName(rule) + "/threads:1";
+
+		for ( int kernel_id : { int(STEP_KERNEL_SWAR64), best_kernel } )
+		{
+			StepKernel kernel = getStepKernel(kernel_id);
+			grid.Randomize(0.3, 1);
+			RunBenchmark(std::string("Layout/rows/") + getStepKernelName(kernel_id) + suffix, 1, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel); });
+			if ( kernel_id == best_kernel )
+				break;
+		}
+
+		grid.Randomize(0.3, 1);
+		MortonGrid tiles(size[0], size[1], true);
+		tiles.Load(grid);
+		RunBenchmark("Layout/morton" + suffix, 1, cells,
+			[&](long long n) { for ( long long i = 0; i < n; ++i ) tiles.Step(rule); });
+	}
+}
+
+
+/*
+ * Шаг внутри рамки живых клеток против шага всего поля на торе: одинокий глайдер, Gosper gun с растущим
+ * потоком глайдеров и плотный суп, где рамка - всё поле и виден только расход на поиск рамки
+ */
+static void BenchStepBounded(void)
+{
+	const char* pattern_names[] = { "glider", "gosper-gun", nullptr };
+	const int size = 4096;
+	LifeRule rule = conwayRule();
+
+	int best_kernel = detectBestStepKernel();
+	StepKernel kernel = getStepKernel(best_kernel);
+	Grid grid(size, size, true);
+	double cells = double(size) * size;
+
+	for ( const char* pattern_name : pattern_names )
+	{
+		Pattern pattern;
+		if ( pattern_name && !getBuiltinPattern(pattern_name, pattern) )
+			continue;
+
+		std::ostringstream suffix;
+		suffix << "/" << getStepKernelName(best_kernel) << "/" << SizeName(size, size) << "/" << (pattern_name ? pattern_name : "d0.3")
+			   << "/" << RuleName(rule);
+
+		for ( bool bounded : { true, false } )
+		{
+			grid.EnableBounds(bounded);
+			if ( pattern_name )
+			{
+				grid.Clear();
+				for ( int y = 0; y < pattern.height; ++y )
+					for ( int x = 0; x < pattern.width; ++x )
+						grid.SetCell((size - pattern.width) / 2 + x, (size - pattern.height) / 2 + y, pattern.cells[y * pattern.width + x] != 0);
+			}
+			else
+				grid.Randomize(0.3, 1);
+
+			RunBenchmark(std::string(bounded ? "StepBounded" : "StepFull") + suffix.str() + "/threads:1", 1, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel); });
+		}
+	}
+}
+
+
+/*
+ * Размещение поля: обычное выделение и заполнение из главного потока против больших страниц с первым касанием
+ * полос их исполнителями и против того же с привязкой исполнителей к процессорам. В конце печатается выигрыш
+ */
+static void BenchStepPlacement(void)
+{
+	const int sizes[][2] = { { 4096, 4096 }, { 16384, 8192 } };
+	const char* variants[] = { "default", "huge-pages", "huge-pages-pinned" };
+	LifeRule rule = conwayRule();
+
+	int threads = std::max(int(std::thread::hardware_concurrency()), 1);
+	int best_kernel = detectBestStepKernel();
+	StepKernel kernel = getStepKernel(best_kernel);
+
+	for ( auto& size : sizes )
+	{
+		double cells = double(size[0]) * size[1];
+		std::string suffix = std::string("/") + getStepKernelName(best_kernel) + "/" + SizeName(size[0], size[1]) + "/d0.3/" + RuleName(rule);
+		double base_time = 0.0;
+
+		for ( int v = 0; v < 3; ++v )
+		{
+			WorkerPool workers(threads);
+			if ( v == 2 )
+				workers.PinThreads();
+
+			Grid grid(size[0], size[1], false);
+			if ( v > 0 )
+				grid.PlaceBuffers(true, &workers);
+			grid.Randomize(0.3, 1);
+
+			std::string name = std::string("StepPlacement") + suffix + "/" + variants[v] + "/threads:" + std::to_string(threads);
+			size_t before = results.size();
+			RunBenchmark(name, threads, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) grid.Step(rule, kernel, &workers); });
+
+			if ( results.size() == before )
+				continue;
+			if ( v == 0 )
+				base_time = results.back().real_time;
+			else if ( base_time > 0.0 )
+				std::cerr << name << ": " << getPagesKindName(grid.GetPagesKind()) << ", gain over default x" << base_time / results.back().real_time << std::endl;
+		}
+	}
+}
+
+
+// Непрерывный режим: шаг Lenia через БПФ, цена не зависит от радиуса ядра; 1000x700 - путь Блюстейна
+static void BenchLenia(void)
+{
+	const int sizes[][2] = { { 256, 256 }, { 1024, 1024 }, { 1000, 700 } };
+	const char* params_list[] = { "R=13", "R=52,mu=0.26,sigma=0.036,b=1/0.5" };
+
+	int hw_threads = std::thread::hardware_concurrency();
+
+	for ( auto& size : sizes )
+	for ( const char* params_str : params_list )
+	{
+		LeniaParams params;
+		parseLeniaParams(params_str, params);
+		LeniaField field(size[0], size[1], params);
+		double cells = double(size[0]) * size[1];
+
+		std::string suffix = "/" + SizeName(size[0], size[1]) + "/R" + std::to_string(params.radius);
+
+		field.Randomize(0.3, 1);
+		RunBenchmark("Lenia" + suffix + "/threads:1", 1, cells,
+			[&](long long n) { for ( long long i = 0; i < n; ++i ) field.Step(); });
+
+		if ( hw_threads > 1 )
+		{
+			WorkerPool workers(hw_threads);
+			field.Randomize(0.3, 1);
+			RunBenchmark("Lenia" + suffix + "/threads:" + std::to_string(hw_threads), hw_threads, cells,
+				[&](long long n) { for ( long long i = 0; i < n; ++i ) field.Step(&workers); });
+		}
+	}
+}
+
+
+/*
+ * Индекс численности: обновление после каждого шага(разница с StepBounded - его цена) и запросы прямоугольников
+ * разного размера, время которых растёт с периметром, а не с площадью
+ */
+static void BenchRegions(void)
+{
+	const int size = 4096;
+	const int rect_sizes[] = { 100, 1000, 4000 };
+	LifeRule rule = conwayRule();
+	StepKernel kernel = getStepKernel(detectBestStepKernel());
+	Grid grid(size, size, true);
+	RegionIndex index(size, size);
+	double cells = double(size) * size;
+
+	Pattern pattern;
+	if ( getBuiltinPattern("gosper-gun", pattern) )
+	{
+		grid.Clear();
+		for ( int y = 0; y < pattern.height; ++y )
+			for ( int x = 0; x < pattern.width; ++x )
+				grid.SetCell((size - pattern.width) / 2 + x, (size - pattern.height) / 2 + y, pattern.cells[y * pattern.width + x] != 0);
+		RunBenchmark("RegionUpdate/" + SizeName(size, size) + "/gosper-gun/threads:1", 1, cells,
+			[&](long long n) { for ( long long i = 0; i < n; ++i ) { grid.Step(rule, kernel); index.Update(grid); } });
+	}
+
+	grid.Randomize(0.3, 1);
+	index.Update(grid);
+	RunBenchmark("RegionUpdate/" + SizeName(size, size) + "/d0.3/threads:1", 1, cells,
+		[&](long long n) { for ( long long i = 0; i < n; ++i ) { grid.Step(rule, kernel); index.Update(grid); } });
+
+	for ( int rect : rect_sizes )
+	{
+		std::mt19937 gen(1);
+		RunBenchmark("RegionCount/" + SizeName(size, size) + "/d0.3/rect:" + std::to_string(rect) + "/threads:1", 1, 1,
+			[&](long long n)
+			{
+				long long total = 0;
+				for ( long long i = 0; i < n; ++i )
+					total += index.Count(int(gen() % (size - rect)), int(gen() % (size - rect)), rect, rect);
+				if ( total < 0 )
+					std::cerr << total;
+			});
+	}
+}
+
+
+
+
+// Атлас из однотонных областей 1x1(пустая, живая, погибшая клетка), растягиваемых на клетку
+static SDL_Texture* CreateSolidAtlas(SDL_Renderer* ren, CellsAtlas& atlas)
+{
+	Uint8 pixels[CELL_STATES_COUNT * 4] = { 40, 40, 40, 255, 40, 200, 40, 255, 200, 40, 40, 255 };
+	atlas.texture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, CELL_STATES_COUNT, 1);
+	if ( atlas.texture )
+		SDL_UpdateTexture(atlas.texture, nullptr, pixels, sizeof(pixels));
+	for ( int i = 0; i < CELL_STATES_COUNT; ++i )
+		atlas.clips[i] = SDL_Rect { i, 0, 1, 1 };
+	return atlas.texture;
+}
+
+static void BenchField(void)
+{
+	// Размеры в клетках и размер клетки: окно по умолчанию, Full HD и большое поле мелкими клетками
+	const int sizes[][3] = { { 40, 30, DEFAULT_TILE_SIZE }, { 96, 54, DEFAULT_TILE_SIZE }, { 256, 256, 4 } };
+	const double densities[] = { 0.1, 0.5 };
+
+	for ( auto& size : sizes )
+	{
+		FieldParams fparams;
+		fparams.width = size[0] * size[2];
+		fparams.height = size[1] * size[2];
+		fparams.ftype = FIELD_TYPE_WITH_BORDERS;
+		fparams.cparams.tile_size = size[2];
+
+		SDL_Rect area { CTRL_PANEL_WIDTH + OFFSET_X, OFFSET_Y, fparams.width, fparams.height };
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, fparams.width + CTRL_PANEL_WIDTH + OFFSET_X * 2,
+				fparams.height + OFFSET_Y * 2, 32, SDL_PIXELFORMAT_RGBA32);
+		SDL_Renderer* ren = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+		if ( !ren )
+		{
+			logSDLError(std::cerr, "SDL_CreateSoftwareRenderer: ");
+			cleanup(surface);
+			continue;
+		}
+
+		CellsAtlas atlas;
+		CreateSolidAtlas(ren, atlas);
+		double cells = double(size[0]) * size[1];
+		std::string size_name = SizeName(size[0], size[1]);
+		std::mt19937 gen(1);
+
+		RunBenchmark("FieldConstruct/" + size_name, 1, cells, [&](long long n)
+		{
+			for ( long long i = 0; i < n; ++i )
+			{
+				Field* f = new Field(fparams, area, fparams.ftype, &atlas, ren);
+				delete f;
+			}
+		});
+
+		Field field(fparams, area, fparams.ftype, &atlas, ren);
+		field.SetStepKernel(getStepKernel(detectBestStepKernel()));
+
+		std::uniform_int_distribution<int> px(area.x, area.x + area.w - 1);
+		std::uniform_int_distribution<int> py(area.y, area.y + area.h - 1);
+		std::vector<SDL_Point> points(1024);
+		for ( auto& p : points )
+			p = SDL_Point { px(gen), py(gen) };
+
+		RunBenchmark("PointToIdx/" + size_name, 1, 1, [&](long long n)
+		{
+			int sink = 0;
+			for ( long long i = 0; i < n; ++i )
+				sink += field.PointToIdx(points[i & 1023]);
+			if ( sink == -1 )
+				std::cerr << sink;
+		});
+
+		std::uniform_int_distribution<int> idx(0, field.GetMaxCellsCount() - 1);
+		std::vector<int> indices(1024);
+		for ( auto& i : indices )
+			i = idx(gen);
+
+		RunBenchmark("SetCell/" + size_name, 1, 1, [&](long long n)
+		{
+			for ( long long i = 0; i < n; ++i )
+			{
+				if ( i & 1024 )
+					field.SetCell(indices[i & 1023], EMPTY_CELL, ren);
+				else
+					field.SetCell(indices[i & 1023], ALIVE_CELL, ren);
+			}
+		});
+
+		for ( double density : densities )
+		{
+			std::bernoulli_distribution alive(density);
+			for ( int i = 0; i < field.GetMaxCellsCount(); ++i )
+			{
+				bool a = alive(gen);
+				field.SetCell(i, a ? ALIVE_CELL : EMPTY_CELL, ren);
+			}
+
+			std::ostringstream suffix;
+			suffix << "/" << size_name << "/d" << density;
+
+			RunBenchmark("Render" + suffix.str(), 1, cells, [&](long long n)
+			{
+				for ( long long i = 0; i < n; ++i )
+				{
+					SDL_RenderClear(ren);
+					field.Render(ren);
+				}
+			});
+
+			RunBenchmark("CheckCellsStates" + suffix.str(), 1, cells, [&](long long n)
+			{
+				for ( long long i = 0; i < n; ++i )
+				{
+					SDL_RenderClear(ren);
+					field.CheckCellsStates(ren);
+				}
+			});
+		}
+
+		cleanup(atlas.texture, ren, surface);
+	}
+}
+
+
+
+
+static std::string JsonEscape(const std::string& s)
+{
+	std::string out;
+	for ( char c : s )
+	{
+		if ( (c == '"') || (c == '\\') )
+			out.push_back('\\');
+		out.push_back(c);
+	}
+	return out;
+}
+
+static void WriteJson(std::ostream& out, const char* executable)
+{
+	std::time_t now = std::time(nullptr);
+	char date[64];
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	out << "{\n  \"context\": {\n";
+	out << "    \"date\": \"" << date << "\",\n";
+	out << "    \"executable\": \"" << JsonEscape(executable) << "\",\n";
+	out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+	out << "    \"step_kernel\": \"" << getStepKernelName(detectBestStepKernel()) << "\",\n";
+#ifdef NDEBUG
+	out << "    \"library_build_type\": \"release\"\n";
+#else
+	out << "    \"library_build_type\": \"debug\"\n";
+#endif
+	out << "  },\n  \"benchmarks\": [\n";
+
+	for ( size_t i = 0; i < results.size(); ++i )
+	{
+		const BenchResult& r = results[i];
+		out << "    {\n";
+		out << "      \"name\": \"" << JsonEscape(r.name) << "\",\n";
+		out << "      \"run_name\": \"" << JsonEscape(r.name) << "\",\n";
+		out << "      \"run_type\": \"iteration\",\n";
+		out << "      \"repetitions\": 1,\n";
+		out << "      \"repetition_index\": 0,\n";
+		out << "      \"threads\": " << r.threads << ",\n";
+		out << "      \"iterations\": " << r.iterations << ",\n";
+		out << "      \"real_time\": " << r.real_time << ",\n";
+		out << "      \"cpu_time\": " << r.cpu_time << ",\n";
+		out << "      \"time_unit\": \"ns\",\n";
+		out << "      \"items_per_second\": " << r.items_per_second << "\n";
+		out << "    }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+	}
+
+	out << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	const char* out_path = nullptr;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		if ( strncmp(argv[i], "--benchmark_filter=", 19) == 0 )
+			name_filter = argv[i] + 19;
+		else if ( strncmp(argv[i], "--benchmark_min_time=", 21) == 0 )
+			min_time = atof(argv[i] + 21);
+		else if ( strncmp(argv[i], "--benchmark_out=", 16) == 0 )
+			out_path = argv[i] + 16;
+		else
+			std::cerr << "Unknown option " << argv[i] << " is ignored" << std::endl;
+	}
+
+	// Отладочный вывод модулей игры не должен попадать в JSON
+	std::streambuf* cout_buf = std::cout.rdbuf(nullptr);
+	BenchStep();
+	BenchStepActivity();
+	BenchStepLargerThanLife();
+	BenchStepBlocked();
+	BenchStepBounded();
+	BenchLayout();
+	BenchStepPlacement();
+	BenchLenia();
+	BenchRegions();
+	BenchField();
+	std::cout.rdbuf(cout_buf);
+	std::cout.clear();
+
+	if ( out_path )
+	{
+		std::ofstream out(out_path);
+		if ( !out )
+		{
+			std::cerr << "Unable to open " << out_path << std::endl;
+			return 1;
+		}
+		WriteJson(out, argv[0]);
+	}
+	else
+	{
+		WriteJson(std::cout, argv[0]);
+	}
+
+	return 0;
+}
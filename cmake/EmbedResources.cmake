@@ -0,0 +1,44 @@
+# Превращает файлы ресурсов в массивы байт C++, которые компилируются прямо в исполняемый файл.
+# Запускается в режиме скрипта(и из CMakeLists.txt, и из Makefile):
+#   cmake -DRESOURCES_DIR=resources -DRESOURCES=cell.png,sample.ttf -DOUTPUT=Resources_data.cpp -P cmake/EmbedResources.cmake
+# Для файла name.ext создаются символы embedded_name_ext и embedded_name_ext_size
+
+if (NOT RESOURCES_DIR OR NOT RESOURCES OR NOT OUTPUT)
+	message(FATAL_ERROR "RESOURCES_DIR, RESOURCES and OUTPUT must be set")
+endif()
+
+# Список приходит через запятую: точка с запятой разбила бы аргумент командной строки
+string(REPLACE "," ";" RESOURCES "${RESOURCES}")
+
+set(content "// Сгенерировано cmake/EmbedResources.cmake из каталога resources, не редактировать\n\n")
+
+foreach(name ${RESOURCES})
+	file(READ "${RESOURCES_DIR}/${name}" hex HEX)
+	string(LENGTH "${hex}" hex_length)
+	math(EXPR size "${hex_length} / 2")
+
+	# По 16 байт в строке
+	set(bytes "")
+	set(offset 0)
+	while (offset LESS hex_length)
+		string(SUBSTRING "${hex}" ${offset} 32 chunk)
+		string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," chunk "${chunk}")
+		string(APPEND bytes "\t${chunk}\n")
+		math(EXPR offset "${offset} + 32")
+	endwhile()
+
+	string(MAKE_C_IDENTIFIER "embedded_${name}" symbol)
+
+	string(APPEND content "extern const unsigned char ${symbol}[] =\n{\n${bytes}};\n")
+	string(APPEND content "extern const unsigned int ${symbol}_size = ${size};\n\n")
+endforeach()
+
+# Файл перезаписывается только при изменении, чтобы не пересобирать его без нужды
+if (EXISTS "${OUTPUT}")
+	file(READ "${OUTPUT}" old_content)
+	if ("${old_content}" STREQUAL "${content}")
+		return()
+	endif()
+endif()
+
+file(WRITE "${OUTPUT}" "${content}")
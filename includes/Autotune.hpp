@@ -0,0 +1,19 @@
+#ifndef AUTOTUNE_HPP
+#define AUTOTUNE_HPP
+
+
+#include "Grid.hpp"
+
+
+enum
+{
+			AUTOTUNE_BUDGET_MS				=								  5,
+			AUTOTUNE_VERIFY_STEPS			=								  4
+};
+
+static const char* const default_autotune_cache_path = "gol_kernels.cache";
+
+
+int autotuneStepKernel(int cells_x, int cells_y, bool toroidal, const LifeRule& rule, const char* cache_path);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+
+#include "Grid.hpp"
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+enum
+{
+			CAPTURE_FORMAT_NONE				=								  0,
+			CAPTURE_FORMAT_PNG				=								  1,		// последовательность DIR/frame_000000.png
+			CAPTURE_FORMAT_RAW				=								  2			// кадры RGBA подряд, без заголовков
+};
+
+enum
+{
+			CAPTURE_QUEUE_SIZE				=								  8,
+			CAPTURE_PNG_THREADS				=								  2,
+			CAPTURE_DEFAULT_CELL_PIXELS		=								 20,		// как клетка на экране
+			CAPTURE_MAX_CELL_PIXELS			=								 64,
+			CAPTURE_CELL_BORDER_MIN_PIXELS	=								  4			// с этого размера клетка рисуется с чёрной рамкой, как в текстурах
+};
+
+
+struct CaptureParams
+{
+	int format;
+	std::string path;			// каталог для PNG, файл или "-"(stdout) для RAW
+	int cell_pixels;
+	bool lossless;				// ждать свободный кадр вместо отбрасывания(для полных записей без окна)
+};
+
+bool parseCaptureSpec(const char* spec, CaptureParams& params);
+bool isCaptureToStdout(const CaptureParams& params);
+
+
+/*
+ * Запись кадров симуляции без участия окна.
+ * Submit вызывается из потока симуляции: состояние поля копируется в свободный кадр из заранее
+ * выделенного пула и ставится в очередь. Если свободных кадров нет, кадр отбрасывается - симуляция
+ * не ждёт кодировщик(кроме режима lossless). Растеризация и запись выполняются фоновыми потоками
+ */
+class FrameCapture
+{
+	struct CaptureFrame
+	{
+		long long number;
+		std::vector<uint64_t> alive;
+		std::vector<uint64_t> history;		// клетки, которые были живыми хотя бы раз
+	};
+
+	CaptureParams params;
+	int cells_x;
+	int cells_y;
+	int row_words;
+	int frame_width;
+	int frame_height;
+	std::vector<uint64_t> history;
+	std::vector<CaptureFrame> frames;
+	std::vector<CaptureFrame*> free_frames;
+	std::deque<CaptureFrame*> queue;
+	std::vector<std::thread> encoders;
+	std::mutex mutex;
+	std::condition_variable queue_cv;
+	std::condition_variable free_cv;
+	FILE* raw_output;
+	bool stopping;
+	bool failed;
+	long long submitted;
+	long long dropped;
+	long long written;
+public:
+	FrameCapture(const CaptureParams& cp, int cx, int cy);
+	bool Start(void);
+	void Submit(const Grid& grid);
+	void Stop(void);
+	int GetFrameWidth(void) const { return frame_width; }
+	int GetFrameHeight(void) const { return frame_height; }
+	long long GetDroppedCount(void) const { return dropped; }
+	~FrameCapture();
+private:
+	FrameCapture();
+	FrameCapture(const FrameCapture& fc);
+	FrameCapture(FrameCapture&& fc);
+	void operator=(const FrameCapture& fc) {}
+	void EncoderLoop(int encoder);
+	template <int PIXEL_BYTES>
+	void Rasterize(const CaptureFrame& frame, unsigned char* pixels, const unsigned char* colors) const;
+	bool WriteFrame(const CaptureFrame& frame, std::vector<unsigned char>& pixels);
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef CENSUS_HPP
+#define CENSUS_HPP
+
+
+#include "Grid.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+enum
+{
+			CENSUS_KIND_STILL_LIFE			=								  0,
+			CENSUS_KIND_OSCILLATOR			=								  1,
+			CENSUS_KIND_SPACESHIP			=								  2,
+			CENSUS_KIND_UNKNOWN				=								  3
+};
+
+enum
+{
+			CENSUS_RADIUS					=								  2,		// клетки ближе двух клеток(по Чебышёву) - один объект
+			CENSUS_MAX_CLASSIFY_CELLS		=								 96,		// большие компоненты не нормализуются и сразу неизвестны
+			CENSUS_STABLE_GENERATIONS		=								 16,		// столько поколений без неизвестных объектов - "суп" устоялся
+			CENSUS_CELL_WORDS				=								 64,		// залитая клетка стоит примерно столько слов шага поля
+			CENSUS_MAX_DEFER				=								1024			// больше стольких поколений перепись не откладывается
+};
+
+
+// Известный объект: одна запись на все его фазы и ориентации
+struct CensusObject
+{
+	const char* name;
+	int kind;
+	int period;
+};
+
+const char* censusKindName(int kind);
+
+
+/*
+ * Перепись объектов поля. Живые клетки разбиваются на компоненты связности(соседи - клетки на расстоянии
+ * не больше CENSUS_RADIUS), форма каждой компоненты(сдвиг в начало координат) ищется в таблице известных
+ * натюрмортов, осцилляторов и кораблей. Таблица строится при создании прогоном каждого объекта на его период
+ * и хранит все восемь поворотов и отражений каждой фазы.
+ * Update инкрементален: пересматриваются только компоненты в радиусе CENSUS_RADIUS от клеток, изменившихся
+ * с позапрошлого поколения, остальные остаются. Для этого ведутся две переписи - чётных и нечётных поколений,
+ * и натюрморты с осцилляторами периода 2, которых в устоявшемся "супе" большинство, не заливаются заново.
+ * Заливка останавливается на CENSUS_MAX_CLASSIFY_CELLS + 1 клетке, такая часть большой области хранится
+ * одной неизвестной записью и не заливается целиком.
+ * Пока поле кипит, пересчёт дороже шага во много раз, поэтому после Update, залившего много клеток,
+ * следующие Update пропускаются(по CENSUS_CELL_WORDS слов шага на клетку). Отстающая перепись
+ * не считается устоявшейся, в спокойном поле заливок мало и Update работает каждое поколение.
+ * Точное поколение, с которого "суп" устоялся, прогон без окна находит повтором пропущенных поколений
+ */
+class Census
+{
+	struct Component
+	{
+		int type;						// индекс в objects, -1 - неизвестный объект, -2 - часть большой области
+		int size;
+	};
+
+	// Перепись одной чётности поколений, поля как у Census
+	struct Lane
+	{
+		std::vector<uint64_t> previous;
+		std::vector<uint64_t> owned;
+		std::vector<int> labels;
+		std::vector<Component> components;
+		std::vector<int> free_components;
+		std::vector<long long> counts;
+		long long unknown_count;
+		long long components_count;
+		long long oversized_count;
+		long long covered;
+		long long population;
+	};
+
+	int width;
+	int height;
+	int row_words;
+	bool toroidal;
+	uint64_t tail;									// маска последнего слова строки
+	std::vector<CensusObject> objects;
+	std::unordered_map<std::string, int> known;		// ключ формы в любой ориентации -> индекс в objects
+	Lane other;										// перепись поколений другой чётности
+	std::vector<uint64_t> previous;					// живые клетки позапрошлого поколения, строки по row_words слов
+	std::vector<uint64_t> changes;					// изменившиеся клетки, расширенные по строке на CENSUS_RADIUS
+	std::vector<uint64_t> dirty;					// окрестность изменений радиуса CENSUS_RADIUS
+	std::vector<uint64_t> owned;					// клетки записанных компонент, записи не касаются друг друга
+	std::vector<uint64_t> touched;					// клетки незаписанных заливок этого Update
+	std::vector<std::pair<int, int>> touched_cells;
+	std::vector<char> rows_changed;
+	std::vector<char> rows_dirty;
+	std::vector<int> labels;						// номер компоненты + 1 в её клетке с наименьшим индексом
+	std::vector<Component> components;
+	std::vector<int> free_components;
+	std::vector<long long> counts;					// число компонент каждого известного типа
+	long long unknown_count;
+	long long components_count;
+	long long oversized_count;						// записей частей больших областей
+	long long covered;								// клеток в целиком залитых компонентах
+	long long population;							// живых клеток в previous
+	long long examined;								// заливок последним Update
+	long long work;									// клеток залито и снято последним Update
+	int deferred;									// столько Update ещё пропускается
+	bool stale;										// последний Update пропущен, перепись отстаёт от поля
+	std::vector<std::pair<int, int>> flood;			// клетки текущей заливки с переносом через край тора
+	std::vector<int> stack;
+	std::vector<std::pair<int, int>> coords;
+public:
+	Census(int w, int h, bool tor);
+	void Update(const Grid& grid, bool force = false);
+	void Reset(int w, int h);
+	int GetObjectsCount(void) const { return int(objects.size()); }
+	const CensusObject& GetObject(int idx) const { return objects[idx]; }
+	long long GetCount(int idx) const { return counts[idx]; }
+	long long GetUnknownCount(void) const { return unknown_count; }
+	long long GetComponentsCount(void) const { return components_count; }
+	long long GetExaminedCount(void) const { return examined; }
+	int GetDeferredCount(void) const { return deferred; }
+	bool IsStale(void) const { return stale; }
+	bool IsSettled(void) const { return !stale && (unknown_count == 0) && (covered == population); }
+	long long CountKind(int kind) const;
+	int Classify(const std::vector<std::pair<int, int>>& cells) const;
+	void Print(std::ostream& out) const;
+private:
+	Census();
+	Census(const Census& c);
+	Census(Census&& c);
+	void operator=(const Census& c) {}
+	void BuildTable(void);
+	void SwapLane(void);
+	void AddObject(const char* name, int kind, int period, const char* rle);
+	size_t WordOf(int x, int y) const { return size_t(y) * row_words + x / GRID_WORD_BITS; }
+	static uint64_t BitOf(int x) { return uint64_t(1) << (x % GRID_WORD_BITS); }
+	static int Wrap(int v, int size);
+	void Spread(uint64_t* row) const;
+	uint32_t Window(const uint64_t* row, int x) const;
+	uint32_t EdgeWindow(const uint64_t* row, int x) const;
+	bool IsTouching(int x, int y) const;
+	void RemoveComponent(int x, int y);
+	void AddComponent(int x, int y);
+};
+
+std::string shapeKey(const std::vector<std::pair<int, int>>& cells, int orientation);
+std::string canonicalShape(const std::vector<std::pair<int, int>>& cells);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef EDITQUEUE_HPP
+#define EDITQUEUE_HPP
+
+
+#include "Stamps.hpp"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+enum
+{
+			EDIT_SET_CELL			=								  0,
+			EDIT_CLEAR_CELL			=								  1,
+			EDIT_STAMP				=								  2,		// упакованный шаблон объединяется с полем, левый верхний угол в (x, y)
+			EDIT_FILL				=								  3,		// прямоугольник (x, y, w, h) заполняется состоянием alive
+			EDIT_RANDOMIZE			=								  4			// всё поле - случайный "суп" из seed и density
+};
+
+enum
+{
+			EDIT_QUEUE_SIZE			=							   4096,		// степень двойки
+			EDIT_CACHE_LINE			=								 64
+};
+
+
+// Команда правки поля. stamp должен жить, пока команда не применена(шаблоны хранит библиотека Game)
+struct EditCommand
+{
+	int type;
+	int x;
+	int y;
+	int w;
+	int h;
+	bool alive;
+	const Stamp* stamp;
+	unsigned int seed;
+	double density;
+};
+
+
+/*
+ * Очередь правок без блокировок для одного писателя(обработка событий окна) и одного читателя(шаг симуляции).
+ * Читатель забирает правки на границе поколений, поэтому поле можно рисовать, не останавливая симуляцию,
+ * а цикл симуляции никогда не берёт мьютекс. Индексы разнесены по разным кэш-линиям отступами, каждая сторона
+ * держит копию чужого индекса и перечитывает его только когда очередь кажется полной(пустой)
+ */
+class EditQueue
+{
+	std::vector<EditCommand> ring;
+	size_t mask;
+	char pad_reader[EDIT_CACHE_LINE];
+	std::atomic<size_t> head;		// следующая команда для читателя
+	size_t cached_tail;
+	char pad_writer[EDIT_CACHE_LINE];
+	std::atomic<size_t> tail;		// следующий свободный слот для писателя
+	size_t cached_head;
+	char pad_end[EDIT_CACHE_LINE];
+public:
+	EditQueue(size_t capacity);
+	bool Push(const EditCommand& cmd);
+	bool Pop(EditCommand& cmd);
+	bool IsEmpty(void) const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+	size_t GetCapacity(void) const { return ring.size(); }
+private:
+	EditQueue();
+	EditQueue(const EditQueue& eq);
+	EditQueue(EditQueue&& eq);
+	void operator=(const EditQueue& eq) {}
+};
+
+#endif
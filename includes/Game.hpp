@@ -4,9 +4,21 @@
 
 #include "services.hpp"
 #include "SDL_ext.hpp"
+#include "Grid.hpp"
+#include "Kernels.hpp"
+#include "Workers.hpp"
+#include "Capture.hpp"
+#include "SharedFrames.hpp"
+#include "Stream.hpp"
+#include "EditQueue.hpp"
+#include "Stamps.hpp"
+#include "Timeline.hpp"
+#include "Replay.hpp"
+#include "Minimap.hpp"
+#include "Lenia.hpp"
 #include <string>
 #include <array>
-#include <list>
+#include <vector>
 
 
 enum
@@ -32,43 +44,44 @@ enum
 			MAX_SIMULATION_SPEED_MULTIPLIER				=								200
 };
 
+enum
+{
+			STAMP_PREVIEW_ALPHA				=								110,
+			TIMELINE_SCRUBBER_MARGIN		=								 20,
+			TIMELINE_SCRUBBER_HEIGHT		=								 16,
+			TIMELINE_SCRUBBER_MARK_WIDTH	=								  4,
+			MINIMAP_MARGIN					=								 20,
+			MINIMAP_MAX_HEIGHT				=								240
+};
+
+static const double default_soup_density = 0.3;
+
 enum
 {
 			EMPTY_CELL				=								  0,
 			ALIVE_CELL				=								  1,
-			DEAD_CELL				=								  2
+			DEAD_CELL				=								  2,
+			CELL_STATES_COUNT		=								  3
 };
 
 enum
 {
-			TEXTURES_COUNT					=								  6,
+			TEXTURES_COUNT					=								  4,
 			BACKGROUND_FRAME_TEXTURE		=								  0,
 			CONTROL_PANEL_FRAME_TEXTURE		=								  1,
 			CONTROL_PANEL_TEXTURE			=								  2,
-			CELL_TEXTURE					=								  3,
-			ALIVE_CELL_TEXTURE				=								  4,
-			DEAD_CELL_TEXTURE				=								  5
+			CELLS_ATLAS_TEXTURE				=								  3
 };
 
+// Что показывает поле: клетки текстурами атласа или слой активности через палитру
 enum
 {
-			MAX_CELL_NEIGHBOURS				=								  8
+			FIELD_LAYER_CELLS		=								  0,
+			FIELD_LAYER_AGE			=								  1,
+			FIELD_LAYER_HEAT		=								  2,
+			FIELD_LAYERS_COUNT		=								  3
 };
 
-enum
-{
-			CELL_POS_LEFT_TOP_CORNER		=								  0,
-			CELL_POS_RIGHT_TOP_CORNER		=								  1,
-			CELL_POS_LEFT_BOTTOM_CORNER		=								  2,
-			CELL_POS_RIGHT_BOTTOM_CORNER	=								  3,
-			CELL_POS_TOP_EDGE			    =								  4,
-			CELL_POS_BOTTOM_EDGE			=								  5,
-			CELL_POS_LEFT_EDGE				=								  6,
-			CELL_POS_RIGHT_EDGE			    =								  7,
-			CELL_POS_INNER					=								  8
-};
-
-
 enum field_type
 {
 	FIELD_TYPE_WITH_BORDERS			=			1,
@@ -84,10 +97,19 @@ struct FieldParams
 {
 	int width;
 	int height;
+	int cells_x;					// размер поля в клетках, 0 - сколько клеток помещается в width x height
+	int cells_y;
 	field_type ftype;
 	CellParams cparams;
 };
 
+// Текстуры клеток(cell.png, alive_cell.png, dead_cell.png) в одном атласе, области выбираются по состоянию клетки
+struct CellsAtlas
+{
+	SDL_Texture* texture;
+	SDL_Rect clips[CELL_STATES_COUNT];
+};
+
 struct GameParams
 {
 	bool paused;
@@ -95,94 +117,51 @@ struct GameParams
 	int base_simulation_delay;
 	int simulation_speed_multiplier;
 	FieldParams fparams;
+	EngineParams eparams;
+	int resize_anchor;
 	long long unsigned int density;
+	long long generation;			// показанное поколение
 };
 
 
 
-class Cell
-{
-	CellParams params;
-	SDL_Rect size;
-	int state;
-	int index;
-	SDL_Texture* texture;
-	SDL_Renderer* renderer;
-	std::list<Cell**> neighbours_addrs;
-public:
-	Cell(CellParams cparams, const std::list<Cell**>& na_list, SDL_Rect area, int cell_state = EMPTY_CELL, int idx = -1, SDL_Texture* tex = nullptr, SDL_Renderer* ren = nullptr);
-	int GetState(void) const { return this->state; }
-	int GetIndex(void) const { return this->index; }
-	int GetX(void) const { return this->size.x; }
-	int GetY(void) const { return this->size.y; }
-	SDL_Point GetPos(void) const { SDL_Point p { this->size.x, this->size.y }; return p; }
-	int GetWidth(void) const { return this->size.w; }
-	int GetHeight(void) const { return this->size.h; }
-	SDL_Rect GetArea(void) const { return this->size; }
-	SDL_Texture* GetTextureObject(void) const { return texture; }
-	void SetState(int state) { ( (state >= EMPTY_CELL) && (state <= DEAD_CELL) ) ? this->state = state : this->state = EMPTY_CELL; }
-	void SetIndex(int idx) { (idx < 0) ? 0 : this->index = idx; }
-	void SetX(int x_val) { this->size.x = x_val; }
-	void SetY(int y_val) { this->size.y = y_val; }
-	void SetPos(SDL_Point p) { this->size.x = p.x; this->size.y = p.y; }
-	void SetWidth(int w_val) { this->size.w = w_val; }
-	void SetHeight(int h_val) { this->size.h = h_val; }
-	void SetArea(SDL_Rect r) { this->size.x = r.x; this->size.y = r.y; this->size.w = r.w; this->size.h = r.h; }
-	void SetTextureObject(const SDL_Texture* new_texture) { this->texture = const_cast<SDL_Texture*>(new_texture); }
-	void Render(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, int w, int h) const;
-	int GetAliveNeighbours(void) const;
-	bool IsPointInCell(SDL_Point p);
-	virtual bool DoLifeCycle(void);
-	virtual ~Cell() {}
-private:
-	Cell() {}
-	Cell(const Cell& old_cell) {}
-	Cell(Cell&& old_cell) {}
-	void operator=(const Cell& old_cell) {}
-	SDL_Renderer* GetRendererObject(void) const { return renderer; }
-	void SetRenderer(const SDL_Renderer* new_renderer) { this->renderer = const_cast<SDL_Renderer*>(new_renderer); }
-};
-
-
-class AliveCell : public Cell
-{
-public:
-	AliveCell(CellParams cparams, const std::list<Cell**>& na_arr, SDL_Rect area, int cell_state = EMPTY_CELL, int idx = -1, SDL_Texture* tex = nullptr, SDL_Renderer* ren = nullptr)
-		: Cell(cparams, na_arr, area, cell_state, idx, tex, ren) {}
-	virtual bool DoLifeCycle(void);
-	virtual ~AliveCell() {}
-private:
-	void operator=(const AliveCell& old_cell) {}
-};
-
-
-class DeadCell : public Cell
-{
-public:
-	DeadCell(CellParams cparams, const std::list<Cell**>& na_arr, SDL_Rect area, int cell_state = EMPTY_CELL, int idx = -1, SDL_Texture* tex = nullptr, SDL_Renderer* ren = nullptr)
-		: Cell(cparams, na_arr, area, cell_state, idx, tex, ren) {}
-	virtual bool DoLifeCycle(void);
-	virtual ~DeadCell() {}
-private:
-	void operator=(const DeadCell& old_cell) {}
-};
-
-
-
-
-
+/*
+ * Игровое поле. Клетки не хранятся отдельными объектами: живые клетки - упакованное поле grid,
+ * а погибшие(красные) - клетки, которые хотя бы раз были живыми, отмечены в битовой плоскости history
+ * той же раскладки. Вся память поля выделяется несколькими выровненными блоками, обнуляемыми лениво.
+ * Отрисовка обходит клетки только внутри рамок живых и погибших клеток, остальная видимая часть - одна
+ * закэшированная текстура пустых клеток
+ */
 class Field
 {
 	FieldParams params;
 	SDL_Rect size;
-	const int cell_x_count;
-	const int cell_y_count;
+	SDL_Rect view;					// видимая часть поля в клетках
+	int cell_x_count;
+	int cell_y_count;
 	int max_cells_count;
-	int* cells_states;
-	Cell** cells_arr;
 	int field_type;
+	const CellsAtlas* atlas;
+	Grid* grid;
+	uint64_t* history;
+	GridBox seen_box;				// все погибшие клетки history внутри
+	LifeRule rule;
+	StepKernel step_kernel;
+	WorkerPool* workers;
+	bool grid_placed;				// буферы поля размещены PlaceGrid, после изменения размера размещаются снова
+	bool grid_huge;
+	int layer;
+	uint32_t palette[ACTIVITY_MAX + 1];
+	mutable SDL_Texture* layer_texture;		// потоковая текстура под видимую часть поля, пиксель - клетка
+	mutable SDL_Rect layer_texture_size;
+	mutable std::vector<uint32_t> layer_pixels;
+	mutable SDL_Texture* empty_texture;		// пустые клетки видимой части: поверх рисуются только клетки рамок
+	mutable SDL_Rect empty_texture_size;	// w, h - видимая часть в клетках, x - размер клетки
+	mutable bool empty_texture_failed;		// текстуры-цели не поддерживаются, все клетки рисуются по одной
+	LeniaField* lenia;				// непрерывный режим: поле Lenia вместо клеток, рисуется через палитру
+	int lenia_brush;
 public:
-	Field(FieldParams fparams, SDL_Rect size, int f_type, SDL_Texture* tex, SDL_Renderer* ren);
+	Field(FieldParams fparams, SDL_Rect size, int f_type, const CellsAtlas* cells_atlas, SDL_Renderer* ren);
 	SDL_Rect GetArea(void) const { return size; }
 	SDL_Point GetPos(void) const { SDL_Point p; p.x = size.x; p.y = size.y; return p; }
 	int GetX(void) const { return size.x; }
@@ -192,18 +171,41 @@ public:
 	int GetCellsCount_X(void) const { return cell_x_count; }
 	int GetCellsCount_Y(void) const { return cell_y_count; }
 	int GetMaxCellsCount(void) const { return max_cells_count; }
+	SDL_Rect GetView(void) const { return view; }
+	void SetView(int x, int y);
+	const Grid* GetGrid(void) const { return grid; }
+	int GetCellState(int x, int y) const;
+	void SetRule(const LifeRule& new_rule) { rule = new_rule; }
+	void SetStepKernel(StepKernel kernel) { step_kernel = kernel; }
+	void SetWorkers(WorkerPool* pool) { workers = pool; }
+	bool PlaceGrid(bool huge);
+	void EnableActivity(bool enable) { grid->EnableActivity(enable); }
+	void EnableBounds(bool enable) { grid->EnableBounds(enable); }
+	bool EnableContinuous(const LeniaParams& lparams);
+	bool IsContinuous(void) const { return lenia != nullptr; }
+	int GetLayer(void) const { return layer; }
+	bool SetLayer(int new_layer);
 	int PointToIdx(SDL_Point p) const;
-	void SetCell(int idx, int cell_state, SDL_Texture* cell_tex, SDL_Renderer* ren);
-	bool CheckCellsStates(SDL_Texture* alive_cell_tex, SDL_Texture* dead_cell_tex, SDL_Renderer* ren);
+	void SetCell(int idx, int cell_state, SDL_Renderer* ren);
+	int ApplyEdits(EditQueue& queue, SDL_Renderer* ren, ReplayRecorder* recorder = nullptr, long long generation = 0);
+	bool CheckCellsStates(SDL_Renderer* ren);
+	void Render(SDL_Renderer* ren) const;
+	void RenderArea(SDL_Renderer* ren, int x, int y, int w, int h) const;
+	void RenderStamp(SDL_Renderer* ren, const Stamp* stamp, int x, int y, unsigned char alpha) const;
+	bool ShowGeneration(const Timeline& timeline, long long generation, SDL_Renderer* ren);
+	bool Resize(FieldParams fparams, SDL_Rect new_size, int anchor);
 	~Field();
 private:
 	Field();
 	Field(const Field& f);
 	Field(Field&& f);
 	void operator=(const Field& f) {}
-	std::list<Cell**> GetNeighboursAddrs(int cell_idx);
-	std::list<Cell**> GetNeighboursAddrs2(int cell_idx);
-	int GetCellPosByIdx(int cell_idx);
+	void RenderCell(SDL_Renderer* ren, int x, int y, int cell_state) const;
+	void RenderLayer(SDL_Renderer* ren) const;
+	bool PrepareEmptyTexture(SDL_Renderer* ren) const;
+	void UpdateView(void);
+	void ApplyEdit(const EditCommand& cmd, SDL_Renderer* ren);
+	void ApplyContinuousEdit(const EditCommand& cmd, SDL_Renderer* ren);
 };
 
 
@@ -218,15 +220,64 @@ class Game
 	SDL_Renderer* renderer;
 	const SDL_Texture** textures_list;
 	int textures_list_size;
+	CellsAtlas cells_atlas;
 	Field* field;
+	WorkerPool* workers;
+	CaptureParams capture_params;
+	FrameCapture* capture;
+	FramePublisher* publisher;
+	StreamServer* server;
+	EditQueue* edits;
+	StampLibrary stamps;
+	int stamp_index;
+	int stamp_orientation;
+	bool stamp_preview;
+	SDL_Point stamp_cursor;				// клетка под курсором
+	SDL_Rect preview_area;				// клетки под нарисованным предпросмотром, w == 0 - предпросмотра нет
+	SDL_Point paint_cell;				// последняя клетка, нарисованная мышью, и правка для неё
+	int paint_type;
+	TimelineParams timeline_params;
+	Timeline* timeline;
+	bool timeline_dirty;				// показанное поколение отличается от записанного(перемотка или правка)
+	std::string record_path;
+	ReplayRecorder* recorder;
+	Minimap* minimap;
 public:
 	Game();
 	int InitLibraries(void);
 	SDL_Window* CreateWindow(const char* window_name, int screen_width, int screen_height);
 	SDL_Renderer* CreateRenderer(void);
 	const SDL_Texture** LoadTextures(const char* textures_path, int textures_list_size);
+	SDL_Texture* LoadCellsAtlas(const char* textures_path);
 	Field* CreateField(void);
-	int InitGameState(int field_width, int field_height, int sim_speed_mul);
+	int SelectStepKernel(void);
+	int InitGameState(int field_width, int field_height, int sim_speed_mul, const EngineParams& eparams);
+	void SetCaptureParams(const CaptureParams& cp) { capture_params = cp; }
+	void SetResizeAnchor(int anchor) { state.resize_anchor = anchor; }
+	void SetBoardSize(int cells_x, int cells_y) { state.fparams.cells_x = cells_x; state.fparams.cells_y = cells_y; }
+	void SetTimelineParams(const TimelineParams& tp) { timeline_params = tp; }
+	void SetRecordPath(const char* path) { record_path = path ? path : ""; }
+	ReplayRecorder* StartRecording(void);
+	void SetSimulationSpeed(int multiplier);
+	void DrawScene(void);
+	bool ResizeField(int field_width, int field_height);
+	FrameCapture* StartCapture(void);
+	FramePublisher* StartPublishing(void);
+	StreamServer* StartServing(void);
+	int ApplyEdits(void);
+	bool PushEdit(int type, int x, int y, int w, int h, bool alive);
+	int LoadStamps(const char* patterns_path);
+	void SelectStamp(int idx);
+	void PlaceStamp(void);
+	void DrawStampPreview(void);
+	void EraseStampPreview(void);
+	SDL_Rect GetScrubberArea(void) const;
+	bool IsPointInScrubber(SDL_Point p) const;
+	long long ScrubberPointToGeneration(SDL_Point p) const;
+	void DrawTimeline(void);
+	bool SeekGeneration(long long generation);
+	void DrawMinimap(void);
+	void CenterView(SDL_Point cell);
 	int Run(void);
 	bool IsPointInField(SDL_Point p);
 	bool IsPointInControlPanel(SDL_Point p);
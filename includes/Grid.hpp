@@ -0,0 +1,249 @@
+#ifndef GRID_HPP
+#define GRID_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+enum
+{
+			GRID_WORD_BITS			=								 64,
+			GRID_VECTOR_WORDS		=								  8,		// ширина самого широкого вектора(AVX-512) в словах
+			GRID_GUARD_WORDS		=								  8,
+			GRID_ALIGNMENT			=								 64
+};
+
+// Биты слова поля: встроенные функции GCC/Clang, иначе простые циклы. ctz64 и clz64 - только для ненулевого слова
+inline int popcount64(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(word);
+#else
+	int count = 0;
+	for ( ; word; word &= word - 1 )
+		++count;
+	return count;
+#endif
+}
+
+inline int ctz64(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	int count = 0;
+	for ( ; !(word & 1); word >>= 1 )
+		++count;
+	return count;
+#endif
+}
+
+inline int clz64(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_clzll(word);
+#else
+	int count = 0;
+	for ( ; !(word >> (GRID_WORD_BITS - 1)); word <<= 1 )
+		++count;
+	return count;
+#endif
+}
+
+// Временное блокирование: полоса поля вместе с перекрытиями считается несколько поколений, пока лежит в кэше
+enum
+{
+			GRID_TEMPORAL_TILE_BYTES		=							 262144,		// оба буфера полосы, под L2
+			GRID_TEMPORAL_MAX_DEPTH			=								 64
+};
+
+
+// Шаг внутри рамки живых клеток: строки считаются кусками, рамка результата ищется, пока кусок в кэше
+enum
+{
+			GRID_BOUNDS_CHUNK_ROWS			=								 16
+};
+
+
+// Слой активности: возраст клетки(поколений подряд живая, с насыщением) и тепло(максимум при изменении клетки, затем затухает)
+enum
+{
+			ACTIVITY_MAX					=							    255,
+			ACTIVITY_HEAT_DECAY_SHIFT		=								  3		// за поколение без изменений тепло теряет 1/8
+};
+
+
+// Какая точка поля остаётся на месте при изменении его размера
+enum
+{
+			GRID_ANCHOR_TOP_LEFT		=								  0,
+			GRID_ANCHOR_TOP_RIGHT		=								  1,
+			GRID_ANCHOR_BOTTOM_LEFT		=								  2,
+			GRID_ANCHOR_BOTTOM_RIGHT	=								  3,
+			GRID_ANCHOR_CENTER			=								  4
+};
+
+
+enum
+{
+			LIFE_NEIGHBOURHOOD_MOORE		=								  0,		// квадрат (2R+1)x(2R+1)
+			LIFE_NEIGHBOURHOOD_VON_NEUMANN	=								  1,		// ромб |dx| + |dy| <= R
+			LIFE_MAX_RADIUS					=								 10
+};
+
+
+/*
+ * Правило клетки. Для окрестности Мура радиуса 1 - нотация B/S: бит n установлен, если при n живых соседях
+ * клетка рождается(выживает). Иначе - правило Larger than Life: окрестность радиуса radius
+ * и диапазоны [min, max] числа живых клеток окрестности(сама клетка считается, если middle)
+ */
+struct LifeRule
+{
+	unsigned short birth;
+	unsigned short survive;
+	int radius;
+	int neighbourhood;
+	bool middle;
+	int birth_min;
+	int birth_max;
+	int survive_min;
+	int survive_max;
+};
+
+LifeRule conwayRule(void);
+bool isConwayRule(const LifeRule& rule);
+bool isLargerThanLife(const LifeRule& rule);
+bool parseLifeRule(const char* str, LifeRule& rule);
+std::string lifeRuleToString(const LifeRule& rule);
+
+
+// Параметры одного вызова ядра: обрабатываются строки [row_begin, row_end) поколения src,
+// результат записывается в dst. Указатели src и dst смотрят на нулевое слово нулевой строки
+struct StepArgs
+{
+	const uint64_t* src;
+	uint64_t* dst;
+	const uint64_t* mask;
+	int stride;
+	int vec_words;
+	int row_begin;
+	int row_end;
+	LifeRule rule;
+	unsigned char* age;				// слой активности(строки по activity_stride байт) или nullptr, если он выключен
+	unsigned char* heat;
+	int activity_stride;
+	int width;						// размер поля в клетках и замкнутость нужны ядрам с радиусом больше ореола
+	int height;
+	bool toroidal;
+};
+
+class WorkerPool;
+
+// Прямоугольник клеток [x0, x1) x [y0, y1), пустой, если x0 >= x1 или y0 >= y1
+struct GridBox
+{
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+};
+
+inline bool isBoxEmpty(const GridBox& box) { return (box.x0 >= box.x1) || (box.y0 >= box.y1); }
+GridBox uniteBoxes(const GridBox& a, const GridBox& b);
+
+void copyBitBlock(const uint64_t* src, size_t src_stride, int src_width, int src_x, int src_y,
+		uint64_t* dst, size_t dst_stride, int dst_x, int dst_y, int w, int h);
+void orBitBlock(const uint64_t* src, size_t src_stride, int src_width, int src_x, int src_y,
+		uint64_t* dst, size_t dst_stride, int dst_x, int dst_y, int w, int h);
+void getAnchorOffset(int anchor, int old_w, int old_h, int new_w, int new_h, int& dx, int& dy);
+int findAnchorByName(const char* name);
+
+// Ядро шага симуляции. Возвращает true, если хотя бы одна клетка в обработанных строках изменилась
+typedef bool (*StepKernel)(const StepArgs& args);
+
+
+/*
+ * Поле клеток, упакованное по одному биту на клетку.
+ * Каждая строка хранится в stride словах: GRID_GUARD_WORDS слов слева(последнее из них - левый ореол),
+ * затем vec_words слов данных, кратных GRID_VECTOR_WORDS. Сверху и снизу есть по одной строке-ореолу.
+ * Для тороидального поля ореол перед каждым шагом заполняется копиями противоположных краёв,
+ * для поля с границами он всегда нулевой.
+ * Поле помнит рамку живых клеток: шаг считает только её с запасом в клетку на рождения,
+ * остальное поле известно пустым. Запись в строки мимо методов поля требует InvalidateBounds
+ */
+class Grid
+{
+	int width;
+	int height;
+	int row_words;
+	int vec_words;
+	int stride;
+	bool toroidal;
+	uint64_t* buffers[2];
+	int pages_kind[2];				// откуда взяты страницы буферов(PAGES_*)
+	size_t buffer_bytes;
+	bool huge_pages;
+	uint64_t* tail_mask;
+	int current;
+	unsigned char* age;
+	unsigned char* heat;
+	bool bounded;					// шаг только внутри рамки живых клеток
+	bool bounds_valid;				// рамки ниже соответствуют буферам; после внешних изменений ищутся заново
+	GridBox live_box;				// все живые клетки текущего поколения внутри
+	GridBox dirty_box[2];			// вне этой области слова буфера нулевые(кроме ореолов)
+	std::vector<uint64_t*> tile_buffers;	// StepBlocked: по два буфера полосы на исполнителя, выделяются исполнителем при первом шаге
+	size_t tile_buffer_bytes;
+	int tile_buffer_stride;
+public:
+	Grid(int w, int h, bool tor);
+	int GetWidth(void) const { return width; }
+	int GetHeight(void) const { return height; }
+	int GetRowWords(void) const { return row_words; }
+	int GetVectorWords(void) const { return vec_words; }
+	int GetStride(void) const { return stride; }
+	bool IsToroidal(void) const { return toroidal; }
+	const uint64_t* GetTailMask(void) const { return tail_mask; }
+	uint64_t* GetRow(int y) { return buffers[current] + (y + 1) * stride + GRID_GUARD_WORDS; }
+	const uint64_t* GetRow(int y) const { return buffers[current] + (y + 1) * stride + GRID_GUARD_WORDS; }
+	uint64_t* GetNextRow(int y) { return buffers[current ^ 1] + (y + 1) * stride + GRID_GUARD_WORDS; }
+	bool GetCell(int x, int y) const { return (GetRow(y)[x / GRID_WORD_BITS] >> (x % GRID_WORD_BITS)) & 1; }
+	int GetPagesKind(void) const { return pages_kind[0]; }
+	bool HasActivity(void) const { return age != nullptr; }
+	int GetActivityStride(void) const { return vec_words * GRID_WORD_BITS; }
+	const unsigned char* GetAgeRow(int y) const { return age + size_t(y) * GetActivityStride(); }
+	const unsigned char* GetHeatRow(int y) const { return heat + size_t(y) * GetActivityStride(); }
+	void EnableActivity(bool enable);
+	void EnableBounds(bool enable) { bounded = enable; bounds_valid = false; }
+	bool IsBounded(void) const { return bounded; }
+	GridBox GetLiveBox(void) const;
+	void InvalidateBounds(void) { bounds_valid = false; }
+	bool PlaceBuffers(bool huge, WorkerPool* workers);
+	void SetCell(int x, int y, bool alive);
+	void Clear(void);
+	void Randomize(double density, unsigned int seed);
+	void CopyFrom(const Grid& other);
+	bool IsEqual(const Grid& other) const;
+	long long CountPopulation(void) const;
+	void PrepareHalo(void);
+	void Swap(void) { current ^= 1; }
+	bool Step(const LifeRule& rule, StepKernel kernel, WorkerPool* workers = nullptr);
+	bool StepBlocked(const LifeRule& rule, StepKernel kernel, int generations, WorkerPool* workers = nullptr, int tile_rows = 0);
+	bool Resize(int w, int h, int anchor);
+	void Stamp(const uint64_t* bits, int src_row_words, int w, int h, int x, int y);
+	~Grid();
+private:
+	Grid();
+	Grid(const Grid& g);
+	Grid(Grid&& g);
+	void operator=(const Grid& g) {}
+	void Allocate(int w, int h);
+	void Release(void);
+	void ReleaseTileBuffers(void);
+	bool StepBounded(const LifeRule& rule, StepKernel kernel, WorkerPool* workers);
+	void ClearOutside(int buffer, const GridBox& region, int word_begin, int word_end);
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+
+#include "Kernels.hpp"
+#include "Capture.hpp"
+#include <string>
+#include <vector>
+
+
+enum
+{
+			HEADLESS_DEFAULT_CELLS_X		=								256,
+			HEADLESS_DEFAULT_CELLS_Y		=								256,
+			HEADLESS_DEFAULT_GENERATIONS	=							   1000,
+			HEADLESS_DEFAULT_SEED			=								  1
+};
+
+static const double headless_default_density = 0.3;
+
+
+// Прямоугольник запроса численности(--region=x,y,w,h)
+struct HeadlessRegion
+{
+	int x;
+	int y;
+	int w;
+	int h;
+};
+
+// Прогон без окна: начальное состояние - шаблон(встроенный или RLE-файл) по центру или случайная "суп"-заливка
+struct HeadlessParams
+{
+	int cells_x;
+	int cells_y;
+	bool board_set;					// размер поля в клетках задан ключом --board
+	long long generations;
+	std::string pattern;
+	double density;
+	unsigned int seed;
+	bool census;					// перепись объектов каждое поколение, остановка когда "суп" устоялся
+	std::vector<HeadlessRegion> regions;	// прямоугольники, численность которых печатается
+	long long region_interval;		// печатать прямоугольники раз в столько поколений(0 - только в конце)
+	bool block_stats;				// сводка плотности по блокам 64x64 вместе с прямоугольниками
+	int temporal_depth;				// поколений за один проход по полосе поля(1 - обычный шаг)
+	CaptureParams capture;
+};
+
+int runHeadless(const HeadlessParams& hparams, const EngineParams& eparams);
+
+#endif
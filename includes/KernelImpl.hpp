@@ -0,0 +1,210 @@
+#ifndef KERNEL_IMPL_HPP
+#define KERNEL_IMPL_HPP
+
+
+/*
+ * Общая часть битово-параллельных ядер шага.
+ * Подключается только в единицы трансляции ядер, каждая из которых собирается со своим набором
+ * инструкций и передаёт сюда свой тип V с операциями над вектором слов:
+ * load/loadu/store, and_/or_/xor_/andnot(~a & b), shl1/shr1/shl63/shr63(сдвиги в каждом 64-битном слове),
+ * zero и any. V должен объявляться во внутреннем пространстве имён, чтобы экземпляры шаблонов
+ * из разных единиц трансляции не склеивались компоновщиком.
+ */
+
+
+#include "Grid.hpp"
+#include <cstring>
+
+
+template <class V>
+inline void fullAdder(typename V::type a, typename V::type b, typename V::type c, typename V::type& sum, typename V::type& carry)
+{
+	typename V::type t = V::xor_(a, b);
+	sum = V::xor_(t, c);
+	carry = V::or_(V::and_(a, b), V::and_(t, c));
+}
+
+// Загружает слова строки вместе с соседями слева и справа, сдвинутыми на одну клетку
+template <class V>
+inline void loadNeighbours(const uint64_t* p, typename V::type& west, typename V::type& centre, typename V::type& east)
+{
+	centre = V::load(p);
+	west = V::or_(V::shl1(centre), V::shr63(V::loadu(p - 1)));
+	east = V::or_(V::shr1(centre), V::shl63(V::loadu(p + 1)));
+}
+
+template <class V>
+inline typename V::type countMatch(int n, typename V::type s0, typename V::type s1, typename V::type s2, typename V::type s3)
+{
+	typename V::type m = (n & 1) ? s0 : V::andnot(s0, V::ones());
+	m = (n & 2) ? V::and_(m, s1) : V::andnot(s1, m);
+	m = (n & 4) ? V::and_(m, s2) : V::andnot(s2, m);
+	m = (n & 8) ? V::and_(m, s3) : V::andnot(s3, m);
+	return m;
+}
+
+/*
+ * Функции слоя активности не зависят от V, поэтому тоже лежат во внутреннем пространстве имён:
+ * иначе компоновщик мог бы оставить копию, собранную с AVX-512, для всех ядер
+ */
+namespace
+{
+
+// 1 в каждом ненулевом байте v, 0 в нулевом
+inline uint64_t nonZeroBytes(uint64_t v)
+{
+	return ((((v & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | v) & 0x8080808080808080ULL) >> 7;
+}
+
+// Байт клетки -> восемь байт 0x00/0xFF, младший бит - в младший байт
+struct ByteMaskTable
+{
+	uint64_t masks[256];
+	ByteMaskTable()
+	{
+		for ( int v = 0; v < 256; ++v )
+		{
+			masks[v] = 0;
+			for ( int b = 0; b < 8; ++b )
+				if ( (v >> b) & 1 )
+					masks[v] |= 0xFFULL << (b * 8);
+		}
+	}
+};
+
+static const ByteMaskTable byte_mask_table;
+
+/*
+ * Обновляет слой активности для words слов строки по новому(next) и старому(prev) состоянию.
+ * Байты обрабатываются по восемь в 64-битном слове: возраст живой клетки растёт на 1 до ACTIVITY_MAX,
+ * мёртвой - сбрасывается; тепло изменившейся клетки становится ACTIVITY_MAX, остальных теряет
+ * 1/2^ACTIVITY_HEAT_DECAY_SHIFT(с округлением вверх, чтобы дойти до нуля).
+ * Пустые и остывшие участки поля не записываются
+ */
+inline void updateActivity(const uint64_t* next, const uint64_t* prev, const uint64_t* mask, int words, unsigned char* age, unsigned char* heat)
+{
+	const uint64_t low_bits = 0xFFULL >> ACTIVITY_HEAT_DECAY_SHIFT;
+	const uint64_t low_mask = low_bits * 0x0101010101010101ULL;
+	const uint64_t rest_mask = ((1ULL << ACTIVITY_HEAT_DECAY_SHIFT) - 1) * 0x0101010101010101ULL;
+
+	for ( int w = 0; w < words; ++w )
+	{
+		uint64_t alive = next[w];
+		uint64_t changed = alive ^ (prev[w] & mask[w]);
+
+		for ( int k = 0; k < GRID_WORD_BITS / 8; ++k, age += 8, heat += 8 )
+		{
+			uint64_t a = byte_mask_table.masks[(alive >> (k * 8)) & 0xFF];
+			uint64_t c = byte_mask_table.masks[(changed >> (k * 8)) & 0xFF];
+
+			uint64_t ages, heats;
+			memcpy(&ages, age, 8);
+			memcpy(&heats, heat, 8);
+			if ( (a | c | ages | heats) == 0 )
+				continue;
+
+			ages = (ages + nonZeroBytes(~ages)) & a;
+			uint64_t decay = ((heats >> ACTIVITY_HEAT_DECAY_SHIFT) & low_mask) + nonZeroBytes(heats & rest_mask);
+			heats = (heats - decay) | c;
+
+			memcpy(age, &ages, 8);
+			memcpy(heat, &heats, 8);
+		}
+	}
+}
+
+}
+
+template <class V, bool Conway, bool Activity>
+bool stepRowsBitsliced(const StepArgs& args)
+{
+	typedef typename V::type vec;
+
+	vec diff = V::zero();
+
+	for ( int y = args.row_begin; y < args.row_end; ++y )
+	{
+		const uint64_t* up = args.src + (y - 1) * args.stride;
+		const uint64_t* mid = args.src + y * args.stride;
+		const uint64_t* down = args.src + (y + 1) * args.stride;
+		uint64_t* out = args.dst + y * args.stride;
+		unsigned char* age = Activity ? args.age + size_t(y) * args.activity_stride : nullptr;
+		unsigned char* heat = Activity ? args.heat + size_t(y) * args.activity_stride : nullptr;
+
+		for ( int i = 0; i < args.vec_words; i += V::WORDS )
+		{
+			vec uw, uc, ue, mw, mc, me, dw, dc, de;
+			loadNeighbours<V>(up + i, uw, uc, ue);
+			loadNeighbours<V>(mid + i, mw, mc, me);
+			loadNeighbours<V>(down + i, dw, dc, de);
+
+			// Суммы соседей по строкам(2 бита), затем их сложение в 4-битный счётчик s3s2s1s0
+			vec u0, u1, d0, d1;
+			fullAdder<V>(uw, uc, ue, u0, u1);
+			fullAdder<V>(dw, dc, de, d0, d1);
+			vec m0 = V::xor_(mw, me);
+			vec m1 = V::and_(mw, me);
+
+			vec s0, c0, t, tc;
+			fullAdder<V>(u0, m0, d0, s0, c0);
+			fullAdder<V>(u1, m1, d1, t, tc);
+			vec s1 = V::xor_(t, c0);
+			vec tc2 = V::and_(t, c0);
+			vec s2 = V::xor_(tc, tc2);
+			vec s3 = V::and_(tc, tc2);
+
+			vec next;
+			if ( Conway )
+			{
+				next = V::andnot(s3, V::andnot(s2, V::and_(s1, V::or_(s0, mc))));
+			}
+			else
+			{
+				next = V::zero();
+				for ( int n = 0; n <= 8; ++n )
+				{
+					bool birth = (args.rule.birth >> n) & 1;
+					bool survive = (args.rule.survive >> n) & 1;
+					if ( !birth && !survive )
+						continue;
+
+					vec m = countMatch<V>(n, s0, s1, s2, s3);
+					if ( !birth )
+						m = V::and_(m, mc);
+					else if ( !survive )
+						m = V::andnot(mc, m);
+					next = V::or_(next, m);
+				}
+			}
+
+			next = V::and_(next, V::load(args.mask + i));
+			diff = V::or_(diff, V::xor_(next, V::and_(mc, V::load(args.mask + i))));
+			V::store(out + i, next);
+
+			// Слой активности обновляется по только что посчитанным словам, пока они в кэше
+			if ( Activity )
+				updateActivity(out + i, mid + i, args.mask + i, V::WORDS, age + i * GRID_WORD_BITS, heat + i * GRID_WORD_BITS);
+		}
+	}
+
+	return V::any(diff);
+}
+
+template <class V>
+bool stepKernelBitsliced(const StepArgs& args)
+{
+	if ( args.age )
+	{
+		if ( isConwayRule(args.rule) )
+			return stepRowsBitsliced<V, true, true>(args);
+
+		return stepRowsBitsliced<V, false, true>(args);
+	}
+
+	if ( isConwayRule(args.rule) )
+		return stepRowsBitsliced<V, true, false>(args);
+
+	return stepRowsBitsliced<V, false, false>(args);
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+
+#include "Grid.hpp"
+#include "Lenia.hpp"
+#include <string>
+
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define GOL_X86 1
+#endif
+
+
+enum
+{
+			STEP_KERNELS_COUNT				=								  5,
+			STEP_KERNEL_SCALAR_BYTE			=								  0,
+			STEP_KERNEL_SWAR64				=								  1,
+			STEP_KERNEL_SSE2				=								  2,
+			STEP_KERNEL_AVX2				=								  3,
+			STEP_KERNEL_AVX512				=								  4
+};
+
+
+// Настройки движка, общие для игры и режимов без окна
+struct EngineParams
+{
+	LifeRule rule;
+	int step_kernel;			// -1 - выбрать по CPUID
+	int threads;
+	bool toroidal;
+	bool activity;				// слой возраста и тепла клеток, обновляемый ядрами
+	bool bounded;				// шагать только по рамке живых клеток
+	int layout;					// раскладка поля прогона без окна: GRID_LAYOUT_* из Morton.hpp
+	LeniaParams lenia;			// непрерывный режим вместо клеточного правила, если lenia.enabled
+	bool huge_pages;			// буферы поля на страницах по 2 МБ, если они доступны
+	bool pin_threads;			// привязать исполнителей шага к процессорам по сокетам
+	bool autotune;
+	std::string autotune_cache;
+	std::string publish_name;	// сегмент разделяемой памяти для кадров(пусто - не публиковать)
+	std::string serve_spec;		// адрес сервера потока поколений: unix:путь или tcp:порт(пусто - без сервера)
+};
+
+
+bool stepKernelScalarByte(const StepArgs& args);
+bool stepKernelSwar64(const StepArgs& args);
+#ifdef GOL_X86
+bool stepKernelSSE2(const StepArgs& args);
+bool stepKernelAVX2(const StepArgs& args);
+bool stepKernelAVX512(const StepArgs& args);
+#endif
+bool stepKernelLargerThanLife(const StepArgs& args);
+
+StepKernel getStepKernel(int kernel_id);
+const char* getStepKernelName(int kernel_id);
+int findStepKernelByName(const char* name);
+bool isStepKernelSupported(int kernel_id);
+int detectBestStepKernel(void);
+int selectStepKernel(const EngineParams& eparams, int cells_x, int cells_y);
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef LENIA_HPP
+#define LENIA_HPP
+
+
+#include "Workers.hpp"
+#include <complex>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+enum
+{
+			LENIA_DEFAULT_RADIUS			=								 13,
+			LENIA_MAX_RADIUS				=								128,
+			LENIA_MAX_RINGS					=								  4,
+			LENIA_COLUMN_BLOCK				=								  8			// столбцов спектра за один проход по строкам
+};
+
+// Орбиум - известное "существо" Lenia, параметры по умолчанию
+static const double lenia_default_mu = 0.15;
+static const double lenia_default_sigma = 0.015;
+static const double lenia_default_dt = 0.1;
+
+
+/*
+ * Параметры непрерывного режима. Ядро - кольца радиуса radius клеток с высотами rings(сглаженный
+ * горб exp(4 - 1 / (r(1 - r))) на каждое кольцо), рост - гауссиана с центром mu и шириной sigma,
+ * отображённая в [-1, 1]. За шаг состояние меняется на dt * рост и обрезается в [0, 1]
+ */
+struct LeniaParams
+{
+	bool enabled;
+	int radius;
+	double mu;
+	double sigma;
+	double dt;
+	int rings_count;
+	double rings[LENIA_MAX_RINGS];
+};
+
+LeniaParams defaultLeniaParams(void);
+bool parseLeniaParams(const char* str, LeniaParams& params);
+std::string leniaParamsToString(const LeniaParams& params);
+
+
+typedef std::complex<float> FFTComplex;
+
+/*
+ * План одномерного комплексного БПФ длины n. Для степеней двойки - итеративная схема radix-2,
+ * для остальных длин - алгоритм Блюстейна через БПФ степени двойки не короче 2n - 1.
+ * План неизменяем после создания, поэтому один план используют все потоки
+ */
+class FFTPlan
+{
+	int n;
+	std::vector<int> bit_reverse;
+	std::vector<FFTComplex> twiddles;
+	std::vector<FFTComplex> chirp;					// Блюстейн: exp(-i pi k^2 / n)
+	std::vector<FFTComplex> chirp_spectrum;			// БПФ сопряжённого чирпа, дополненного до длины вложенного плана
+	std::shared_ptr<const FFTPlan> inner;
+public:
+	FFTPlan(int size);
+	int GetSize(void) const { return n; }
+	int GetScratchSize(void) const { return inner ? inner->GetSize() + inner->GetScratchSize() : 0; }
+	void Forward(FFTComplex* data, FFTComplex* scratch) const;
+	void Inverse(FFTComplex* data, FFTComplex* scratch) const;
+private:
+	FFTPlan();
+	FFTPlan(const FFTPlan& p);
+	FFTPlan(FFTPlan&& p);
+	void operator=(const FFTPlan& p) {}
+	void Radix2(FFTComplex* data) const;
+};
+
+std::shared_ptr<const FFTPlan> getFFTPlan(int n);
+
+
+/*
+ * Непрерывное поле Lenia на торе: float-состояние в [0, 1] на клетку. Свёртка с ядром считается
+ * через БПФ: строки вещественные, поэтому две строки упаковываются в одно комплексное БПФ и хранится
+ * только половина спектра(W / 2 + 1 столбцов). Столбцы проходят прямое БПФ, умножение на спектр ядра
+ * и обратное БПФ за один проход, рост применяется сразу при обратном проходе по строкам.
+ * Фазы делятся между исполнителями пула по строкам и столбцам
+ */
+class LeniaField
+{
+	int width;
+	int height;
+	int spectrum_width;
+	LeniaParams params;
+	std::vector<float> cells;
+	std::vector<FFTComplex> spectrum;				// height строк по spectrum_width
+	std::vector<FFTComplex> kernel_spectrum;		// спектр ядра, уже делённый на width * height
+	std::shared_ptr<const FFTPlan> row_plan;
+	std::shared_ptr<const FFTPlan> column_plan;
+	std::vector<std::vector<FFTComplex>> scratch;	// буферы каждого исполнителя
+	double mass;
+public:
+	LeniaField(int w, int h, const LeniaParams& lparams);
+	int GetWidth(void) const { return width; }
+	int GetHeight(void) const { return height; }
+	const LeniaParams& GetParams(void) const { return params; }
+	const float* GetRow(int y) const { return cells.data() + size_t(y) * width; }
+	float GetCell(int x, int y) const { return cells[size_t(y) * width + x]; }
+	void SetCell(int x, int y, float value);
+	void Paint(int x, int y, int brush, float value);
+	void Fill(int x, int y, int w, int h, float value);
+	void Clear(void);
+	void Randomize(double density, unsigned int seed);
+	bool Resize(int new_width, int new_height, int anchor);
+	void Convolve(std::vector<float>& potential, WorkerPool* workers = nullptr);
+	bool Step(WorkerPool* workers = nullptr);
+	double GetMass(void) const { return mass; }
+	void UpdateMass(void);
+private:
+	LeniaField();
+	LeniaField(const LeniaField& lf);
+	LeniaField(LeniaField&& lf);
+	void operator=(const LeniaField& lf) {}
+	void BuildKernel(void);
+	void ForwardRows(const float* src, int begin, int end, FFTComplex* buffer);
+	void FilterColumns(int begin, int end, FFTComplex* buffer);
+	template <typename F>
+	void InverseRows(int begin, int end, FFTComplex* buffer, F store);
+	template <typename F>
+	void RunConvolution(WorkerPool* workers, F store);
+};
+
+float leniaKernelValue(const LeniaParams& params, double distance);
+float leniaGrowth(const LeniaParams& params, float potential);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef MINIMAP_HPP
+#define MINIMAP_HPP
+
+
+#include "SDL_ext.hpp"
+#include "Grid.hpp"
+#include <cstdint>
+#include <vector>
+
+
+enum
+{
+			MINIMAP_MIN_BRIGHTNESS			=								 96		// яркость квадрата с одной живой клеткой
+};
+
+static const uint32_t minimap_background_color = 0xFF202020;		// ARGB8888
+
+
+/*
+ * Уменьшенное изображение всего поля. Один пиксель текстуры - квадрат scale x scale клеток,
+ * его яркость - доля живых клеток в квадрате. Число живых клеток каждого квадрата хранится
+ * и меняется только по клеткам, изменившимся с прошлого Update(XOR упакованных строк);
+ * в потоковую текстуру загружается только прямоугольник изменившихся пикселей
+ */
+class Minimap
+{
+	SDL_Texture* texture;
+	SDL_Rect bounds;						// наибольшая область на экране под миникарту
+	SDL_Rect area;							// область, которую миникарта занимает на самом деле
+	int cells_x;
+	int cells_y;
+	int scale;								// клеток на пиксель текстуры по каждой оси
+	int width;								// размер текстуры в пикселях
+	int height;
+	int row_words;
+	std::vector<uint64_t> previous;			// живые клетки, уже учтённые в counts
+	std::vector<int> counts;				// живых клеток в каждом квадрате
+	std::vector<uint32_t> pixels;
+	SDL_Rect dirty;							// изменившиеся пиксели, w == 0 - текстура актуальна
+public:
+	Minimap(SDL_Rect max_area);
+	bool Reset(int w, int h, SDL_Renderer* ren);
+	SDL_Rect GetArea(void) const { return area; }
+	bool IsPointInside(SDL_Point p) const;
+	SDL_Point PointToCell(SDL_Point p) const;
+	void Update(const Grid& grid);
+	void Draw(SDL_Renderer* ren, SDL_Rect view);
+	~Minimap();
+private:
+	Minimap();
+	Minimap(const Minimap& m);
+	Minimap(Minimap&& m);
+	void operator=(const Minimap& m) {}
+	void MarkDirty(int px, int py);
+};
+
+#endif
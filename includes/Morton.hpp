@@ -0,0 +1,73 @@
+#ifndef MORTON_HPP
+#define MORTON_HPP
+
+
+#include "Grid.hpp"
+#include <algorithm>
+#include <vector>
+
+
+enum
+{
+			GRID_LAYOUT_ROWS				=								  0,		// строки слов(Grid)
+			GRID_LAYOUT_MORTON				=								  1,		// плитки 8x8 в порядке Мортона(MortonGrid)
+			GRID_LAYOUTS_COUNT				=								  2
+};
+
+enum
+{
+			MORTON_TILE_SIZE				=								  8			// плитка - 8 строк по 8 клеток в одном слове
+};
+
+int findGridLayoutByName(const char* name);
+const char* getGridLayoutName(int layout);
+bool isMortonLayoutSupported(int w, int h, bool tor, const LifeRule& rule);
+
+
+class WorkerPool;
+
+/*
+ * Поле плитками 8x8 клеток: бит r * 8 + c слова плитки - клетка строки r и столбца c. Плитки лежат в порядке Мортона
+ * (Z-кривая: биты координат плитки чередуются), поэтому соседи по вертикали обычно рядом в памяти, а не через строку поля.
+ * Для неквадратного поля чередуются младшие биты координат, старшие биты длинной стороны идут выше:
+ * код плитки раскладывается на независимые части по x и по y, и сосед находится двумя обращениями к таблицам.
+ * Шаг считает каждую плитку по ней и восьми соседним плиткам теми же битово-параллельными сумматорами, что и ядра Grid.
+ * Только правила B/S с окрестностью Мура; на торе стороны поля кратны MORTON_TILE_SIZE
+ */
+class MortonGrid
+{
+	int width;
+	int height;
+	bool toroidal;
+	int tiles_x;
+	int tiles_y;
+	int bits_x;								// сторона кривой по x - 2^bits_x плиток
+	int bits_y;
+	size_t codes_count;						// 2^(bits_x + bits_y), последняя плитка буфера(codes_count) всегда пустая
+	std::vector<uint32_t> code_x;			// часть кода по x для плиток -1..tiles_x(за краем - пустая или с другого края тора)
+	std::vector<uint32_t> code_y;
+	std::vector<uint64_t> buffers[2];
+	int current;
+	uint64_t last_column_mask;				// клетки последнего столбца плиток внутри поля
+	uint64_t last_row_mask;
+public:
+	MortonGrid(int w, int h, bool tor);
+	int GetWidth(void) const { return width; }
+	int GetHeight(void) const { return height; }
+	size_t GetTilesCount(void) const { return size_t(tiles_x) * tiles_y; }
+	bool GetCell(int x, int y) const;
+	void SetCell(int x, int y, bool alive);
+	void Load(const Grid& grid);
+	void Store(Grid& grid) const;
+	bool Step(const LifeRule& rule, WorkerPool* workers = nullptr);
+	long long CountPopulation(void) const;
+private:
+	MortonGrid();
+	MortonGrid(const MortonGrid& mg);
+	MortonGrid(MortonGrid&& mg);
+	void operator=(const MortonGrid& mg) {}
+	size_t GetIndex(int tx, int ty) const { return std::min(size_t(code_x[tx + 1] | code_y[ty + 1]), codes_count); }
+	bool StepCodes(const LifeRule& rule, size_t code_begin, size_t code_end);
+};
+
+#endif
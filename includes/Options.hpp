@@ -0,0 +1,17 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+
+#include "Kernels.hpp"
+#include "Headless.hpp"
+
+
+/*
+ * Ключи движка и прогона без окна(правило, ядро, потоки, поле, начальное состояние, запись кадров),
+ * общие для программы с окном и для программ без SDL
+ */
+void initEngineParams(EngineParams& eparams);
+void initHeadlessParams(HeadlessParams& hparams);
+bool parseEngineOption(const char* arg, EngineParams& eparams, HeadlessParams& hparams);
+
+#endif
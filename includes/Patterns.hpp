@@ -0,0 +1,24 @@
+#ifndef PATTERNS_HPP
+#define PATTERNS_HPP
+
+
+#include <string>
+#include <vector>
+
+
+// Шаблон клеток: cells[y * width + x] равен 1 для живой клетки
+struct Pattern
+{
+	std::string name;
+	int width;
+	int height;
+	std::vector<unsigned char> cells;
+};
+
+bool parseRle(const std::string& text, Pattern& pattern);
+bool getBuiltinPattern(const char* name, Pattern& pattern);
+bool loadPatternFile(const char* path, Pattern& pattern);
+int getBuiltinPatternsCount(void);
+const char* getBuiltinPatternName(int idx);
+
+#endif
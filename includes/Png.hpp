@@ -0,0 +1,26 @@
+#ifndef PNG_HPP
+#define PNG_HPP
+
+
+#include <cstdint>
+#include <vector>
+
+
+enum
+{
+			PNG_MAX_COLORS					=								256,
+			PNG_MAX_MATCH					=								258,
+			PNG_MAX_DISTANCE				=							  32768
+};
+
+
+/*
+ * Кодирует изображение с палитрой(байт индекса на пиксель, палитра - colors цветов RGBA) в PNG
+ * без сторонних библиотек. Сжатие - deflate с фиксированными кодами Хаффмана, повторы ищутся только
+ * на расстоянии одного байта и одной строки: кадры поля состоят из одноцветных клеток и повторяющихся
+ * строк, поэтому этого хватает. Возвращает false при неверных размерах или палитре
+ */
+bool encodePngIndexed(const unsigned char* indices, int width, int height, const unsigned char* palette, int colors,
+		std::vector<unsigned char>& png);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef REGIONS_HPP
+#define REGIONS_HPP
+
+
+#include "Grid.hpp"
+#include <ostream>
+#include <vector>
+
+
+enum
+{
+			REGION_BLOCK_SIZE				=								 64		// блок - одно слово строки на 64 строки
+};
+
+static_assert(int(REGION_BLOCK_SIZE) == int(GRID_WORD_BITS), "A region block must be one grid word wide");
+
+
+/*
+ * Индекс численности для запросов по прямоугольникам. Поле делится на блоки REGION_BLOCK_SIZE x REGION_BLOCK_SIZE
+ * клеток, для каждого хранится число живых клеток. Update сравнивает поле со своей копией прошлого состояния
+ * только внутри рамок живых клеток(старой и новой) и поправляет счётчики блоков изменившихся слов.
+ * Двумерные префиксные суммы по блокам пересчитываются лениво, при первом запросе после изменений.
+ * Count считает целые блоки прямоугольника по суммам, а клетки неполных блоков у его краёв - по копии поля,
+ * поэтому цена запроса - O(блоков на периметре). Запросы отвечают о поле на момент последнего Update
+ */
+class RegionIndex
+{
+	int width;
+	int height;
+	int row_words;
+	int blocks_x;
+	int blocks_y;
+	std::vector<uint64_t> previous;				// поле на момент Update, строки по row_words слов
+	GridBox previous_box;						// живые клетки previous внутри
+	std::vector<int> blocks;					// живых клеток в блоке, строки по blocks_x
+	mutable std::vector<long long> sums;		// (blocks_y + 1) x (blocks_x + 1): живых клеток в блоках выше и левее
+	mutable bool sums_valid;
+	long long population;
+	long long changed_words;					// слов изменилось при последнем Update
+public:
+	RegionIndex(int w, int h);
+	void Update(const Grid& grid);
+	void Reset(int w, int h);
+	long long Count(int x, int y, int w, int h) const;
+	double GetDensity(int x, int y, int w, int h) const;
+	long long GetPopulation(void) const { return population; }
+	long long GetChangedWords(void) const { return changed_words; }
+	int GetBlocksX(void) const { return blocks_x; }
+	int GetBlocksY(void) const { return blocks_y; }
+	int GetBlockCount(int bx, int by) const { return blocks[size_t(by) * blocks_x + bx]; }
+	int GetBlockArea(int bx, int by) const;
+	void PrintBlockStats(std::ostream& out) const;
+private:
+	RegionIndex();
+	RegionIndex(const RegionIndex& ri);
+	RegionIndex(RegionIndex&& ri);
+	void operator=(const RegionIndex& ri) {}
+	void PrepareSums(void) const;
+	long long SumBlocks(int bx0, int by0, int bx1, int by1) const;
+	long long CountCells(int x0, int y0, int x1, int y1) const;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+
+#include "Grid.hpp"
+#include "Kernels.hpp"
+#include "EditQueue.hpp"
+#include "Timeline.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+enum
+{
+			REPLAY_EVENT_EDIT			=								  1,
+			REPLAY_EVENT_START			=								  2,
+			REPLAY_EVENT_PAUSE			=								  3,
+			REPLAY_EVENT_SPEED			=								  4,
+			REPLAY_EVENT_SEEK			=								  5,
+			REPLAY_EVENT_RESIZE			=								  6,
+			REPLAY_EVENT_END			=								  7
+};
+
+enum
+{
+			REPLAY_VERSION				=								  2,		// 2: параметры правил Larger than Life
+			REPLAY_FLUSH_BYTES			=							  65536
+};
+
+
+// Состояние, с которого начинается записанная сессия: пустое поле и параметры, влияющие на поколения
+struct ReplayHeader
+{
+	int cells_x;
+	int cells_y;
+	bool toroidal;
+	LifeRule rule;
+	TimelineParams timeline;
+};
+
+uint64_t hashGrid(const Grid& grid);
+void applyEditToGrid(const EditCommand& cmd, Grid& grid);
+
+
+/*
+ * Запись сессии для воспроизведения: каждое действие, меняющее поле или ход симуляции, пишется
+ * с номером поколения, на границе которого оно применено. Формат двоичный: заголовок, затем события
+ * [тип, приращение поколения(varint), данные]. Целые кодируются varint(знаковые - zigzag),
+ * шаблоны пишутся упакованными строками, чтобы запись не зависела от библиотеки шаблонов
+ */
+class ReplayRecorder
+{
+	FILE* output;
+	std::vector<unsigned char> buffer;
+	long long last_generation;
+	long long events;
+public:
+	ReplayRecorder();
+	bool Open(const char* path, const ReplayHeader& header);
+	void RecordEdit(long long generation, const EditCommand& cmd);
+	void RecordEvent(long long generation, int type, long long value = 0);
+	void RecordResize(long long generation, int w, int h, int anchor);
+	void Close(long long generation, const Grid& grid);
+	~ReplayRecorder();
+private:
+	ReplayRecorder(const ReplayRecorder& rr);
+	ReplayRecorder(ReplayRecorder&& rr);
+	void operator=(const ReplayRecorder& rr) {}
+	void BeginEvent(long long generation, int type);
+	void Flush(void);
+};
+
+int runReplay(const char* path, const EngineParams& eparams);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef RESOURCES_HPP
+#define RESOURCES_HPP
+
+
+#include <SDL2/SDL.h>
+
+
+// Файл из каталога resources, вкомпилированный в программу(см. cmake/EmbedResources.cmake)
+struct EmbeddedResource
+{
+	const char* name;
+	const unsigned char* data;
+	unsigned int size;
+};
+
+const EmbeddedResource* findEmbeddedResource(const char* name);
+SDL_RWops* openResource(const char* override_path, const char* name);
+
+#endif
@@ -10,10 +10,14 @@
 
 void logSDLError(std::ostream& out, const char* err_msg);
 SDL_Texture* loadTexture(const std::string& file, SDL_Renderer* ren);
+SDL_Texture* loadTexture(SDL_RWops* src, SDL_Renderer* ren);
+SDL_Texture* packTextureAtlas(SDL_Surface** surfaces, int count, SDL_Renderer* ren, SDL_Rect* clips);
 void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, int w, int h);
 void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, SDL_Rect dst, SDL_Rect* clip = nullptr);
 void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, SDL_Rect* clip = nullptr);
 SDL_Texture* renderText(const std::string& message, const std::string& fontFile,
 		SDL_Color color, int fontSize, SDL_Renderer* renderer);
+SDL_Texture* renderText(const std::string& message, SDL_RWops* fontSrc,
+		SDL_Color color, int fontSize, SDL_Renderer* renderer);
 
 #endif
@@ -0,0 +1,121 @@
+#ifndef SHARED_FRAMES_HPP
+#define SHARED_FRAMES_HPP
+
+
+#include "Grid.hpp"
+#include <atomic>
+#include <string>
+#include <vector>
+
+
+enum
+{
+			SHARED_FRAMES_MAGIC				=						 0x464C4F47,		// "GOLF"
+			SHARED_FRAMES_VERSION			=								  1,
+			SHARED_FRAMES_SLOTS				=								  8,
+			SHARED_FRAMES_READ_RETRIES		=								  4
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared frames need address-free 64-bit atomics");
+
+
+/*
+ * Сегмент разделяемой памяти POSIX: заголовок и кольцо из slots_count слотов. Слот - заголовок
+ * и кадр поля(height строк по row_words слов, бит на клетку, как в Grid без ореолов).
+ * Каждый слот защищён счётчиком-seqlock: нечётное значение - слот переписывается. Писатель никогда
+ * не ждёт читателей, читатель проверяет, что счётчик не изменился, пока он читал кадр
+ */
+struct SharedFramesHeader
+{
+	std::atomic<uint32_t> magic;				// пишется последним, когда остальной заголовок готов
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t row_words;
+	uint32_t slots_count;
+	uint64_t slot_bytes;						// вместе с заголовком слота, кратно 64
+	std::atomic<uint64_t> published;			// сколько кадров опубликовано, последний - в слоте (published - 1) % slots_count
+	std::atomic<uint32_t> closed;				// писатель закрыл сегмент(завершился или сменил размер поля)
+};
+
+struct SharedFrameSlot
+{
+	std::atomic<uint64_t> sequence;
+	int64_t generation;
+	int64_t population;
+	uint64_t reserved[5];
+};
+
+
+/*
+ * Публикует каждое посчитанное поколение в сегмент /name. Публикация - копия поля в очередной слот,
+ * без блокировок и ожиданий. При смене размера поля старый сегмент помечается закрытым
+ * и создаётся новый с тем же именем, читатели открывают его заново
+ */
+class FramePublisher
+{
+	std::string name;
+	int width;
+	int height;
+	int row_words;
+	size_t segment_bytes;
+	unsigned char* segment;
+	SharedFramesHeader* header;
+public:
+	FramePublisher(const char* shm_name);
+	bool Publish(const Grid& grid, long long generation);
+	const std::string& GetName(void) const { return name; }
+	~FramePublisher();
+private:
+	FramePublisher();
+	FramePublisher(const FramePublisher& fp);
+	FramePublisher(FramePublisher&& fp);
+	void operator=(const FramePublisher& fp) {}
+	bool Create(int w, int h);
+	void Close(void);
+};
+
+
+// Кадр в сегменте без копирования: действителен, пока Validate возвращает true
+struct SharedFrameView
+{
+	const uint64_t* bits;
+	long long generation;
+	long long population;
+	int slot;
+	uint64_t sequence;
+};
+
+/*
+ * Читатель сегмента, отображённого только для чтения. Acquire даёт последний целый кадр,
+ * Read копирует его и проверяет, что писатель не успел его переписать
+ */
+class FrameSubscriber
+{
+	std::string name;
+	size_t segment_bytes;
+	const unsigned char* segment;
+	const SharedFramesHeader* header;
+public:
+	FrameSubscriber(const char* shm_name);
+	bool Open(void);
+	bool IsOpen(void) const { return header != nullptr; }
+	bool IsClosed(void) const { return header && header->closed.load(std::memory_order_acquire); }
+	int GetWidth(void) const { return header ? int(header->width) : 0; }
+	int GetHeight(void) const { return header ? int(header->height) : 0; }
+	int GetRowWords(void) const { return header ? int(header->row_words) : 0; }
+	unsigned long long GetPublished(void) const { return header ? header->published.load(std::memory_order_acquire) : 0; }
+	bool Acquire(SharedFrameView& view) const;
+	bool Validate(const SharedFrameView& view) const;
+	bool Read(std::vector<uint64_t>& bits, SharedFrameView& view) const;
+	~FrameSubscriber();
+private:
+	FrameSubscriber();
+	FrameSubscriber(const FrameSubscriber& fs);
+	FrameSubscriber(FrameSubscriber&& fs);
+	void operator=(const FrameSubscriber& fs) {}
+	void Unmap(void);
+	const SharedFrameSlot* GetSlot(int slot) const;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef STAMPS_HPP
+#define STAMPS_HPP
+
+
+#include "Patterns.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Ориентация: младшие два бита - поворот на 90 градусов по часовой стрелке, бит STAMP_FLIP - зеркало по горизонтали
+enum
+{
+			STAMP_ORIENTATIONS		=								  8,
+			STAMP_ROTATIONS			=								  4,
+			STAMP_FLIP				=								  4
+};
+
+
+// Шаблон в раскладке поля: строки по row_words слов, младший бит слова - левая клетка
+struct Stamp
+{
+	int width;
+	int height;
+	int row_words;
+	std::vector<uint64_t> bits;
+	std::vector<unsigned char> cells;		// те же клетки по байту, для рисования предпросмотра
+};
+
+struct StampPattern
+{
+	std::string name;
+	Stamp orientations[STAMP_ORIENTATIONS];
+};
+
+void buildStamp(const Pattern& pattern, int orientation, Stamp& stamp);
+int rotateOrientation(int orientation);
+int flipOrientation(int orientation);
+
+
+/*
+ * Библиотека шаблонов для расстановки мышью: встроенные шаблоны и RLE-файлы из каталога.
+ * Все ориентации шаблона упаковываются при загрузке, поэтому расстановка лишь объединяет
+ * готовые строки с полем. После загрузки библиотека не меняется, указатели на Stamp остаются верными
+ */
+class StampLibrary
+{
+	std::vector<StampPattern> patterns;
+public:
+	StampLibrary() {}
+	int LoadBuiltins(void);
+	int LoadDirectory(const char* path);
+	int GetCount(void) const { return int(patterns.size()); }
+	const StampPattern& Get(int idx) const { return patterns[idx]; }
+	const Stamp* GetStamp(int idx, int orientation) const;
+private:
+	StampLibrary(const StampLibrary& sl);
+	StampLibrary(StampLibrary&& sl);
+	void operator=(const StampLibrary& sl) {}
+	void Add(const std::string& name, const Pattern& pattern);
+};
+
+#endif
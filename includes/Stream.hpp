@@ -0,0 +1,195 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+
+#include "EditQueue.hpp"
+#include "Grid.hpp"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+enum
+{
+			STREAM_MESSAGE_KEYFRAME			=								  1,		// поле целиком
+			STREAM_MESSAGE_DELTA			=								  2,		// изменившиеся клетки с поколения base
+			STREAM_MESSAGE_EDITS			=								 16			// правки от клиента
+};
+
+enum
+{
+			STREAM_HEADER_BYTES				=								 16,
+			STREAM_EDIT_BYTES				=								 32,
+			STREAM_MAX_CLIENTS				=								 64,
+			STREAM_MAX_INPUT_BYTES			=							  65536,		// больше правок за раз клиент не присылает
+			STREAM_CLIENT_BUFFER_BYTES		=							4194304,		// очередь клиента, после которой он получает только ключевые кадры
+			STREAM_EDIT_QUEUE_SIZE			=							   4096,
+			STREAM_LISTEN_BACKLOG			=								 16,
+			STREAM_READ_CHUNK				=							  16384
+};
+
+
+// Куда слушает сервер: сокет Unix по пути или TCP на 127.0.0.1
+struct StreamAddress
+{
+	bool unix_socket;
+	std::string path;
+	int port;
+};
+
+bool parseStreamSpec(const char* spec, StreamAddress& address);
+std::string getStreamAddressName(const StreamAddress& address);
+
+
+/*
+ * Сообщение потока: заголовок из трёх чисел little-endian - тип(uint32), длина данных(uint32), поколение(int64).
+ * Ключевой кадр: ширина и высота(uint32), затем длины чередующихся серий мёртвых и живых клеток поля,
+ * прочитанного построчно, начиная с мёртвых. Дельта: поколение base(int64), от которого она отсчитана, затем так же
+ * серии неизменившихся и изменившихся клеток. Длины серий - varint(по 7 бит, младшие первыми), их сумма - число клеток.
+ * Правки от клиента: записи по 32 байта - тип, x, y, w, h, alive, seed(int32) и density в миллионных(int32),
+ * типы как в EditQueue.hpp, кроме шаблонов
+ */
+struct StreamHeader
+{
+	uint32_t type;
+	uint32_t length;
+	long long generation;
+};
+
+void readStreamHeader(const unsigned char* data, StreamHeader& header);
+void encodeStreamKeyframe(const uint64_t* bits, int row_words, int width, int height, long long generation, std::vector<unsigned char>& out);
+void encodeStreamDelta(const uint64_t* base, const uint64_t* bits, int row_words, int width, int height, long long base_generation,
+		long long generation, std::vector<unsigned char>& out);
+void encodeStreamEdits(const EditCommand* cmds, int count, std::vector<unsigned char>& out);
+
+
+// Восстанавливает поле на стороне клиента из ключевых кадров и дельт
+class StreamDecoder
+{
+	int width;
+	int height;
+	int row_words;
+	long long generation;
+	bool synced;
+	std::vector<uint64_t> bits;			// строки по row_words слов, как в кадрах SharedFrames
+public:
+	StreamDecoder(void);
+	bool Apply(const StreamHeader& header, const unsigned char* payload);
+	bool IsSynced(void) const { return synced; }
+	int GetWidth(void) const { return width; }
+	int GetHeight(void) const { return height; }
+	int GetRowWords(void) const { return row_words; }
+	long long GetGeneration(void) const { return generation; }
+	const std::vector<uint64_t>& GetBits(void) const { return bits; }
+	long long CountPopulation(void) const;
+private:
+	StreamDecoder(const StreamDecoder& sd);
+	StreamDecoder(StreamDecoder&& sd);
+	void operator=(const StreamDecoder& sd) {}
+};
+
+
+/*
+ * Сервер потока поколений. Submit вызывается из потока симуляции и только копирует поле в буфер под коротким
+ * мьютексом; всё остальное - в своём потоке на неблокирующих сокетах и poll. Поток сервера берёт последний
+ * переданный кадр(промежуточные пропускаются), кодирует дельту от предыдущего один раз для всех клиентов и ставит её
+ * в очереди. Новый клиент сначала получает ключевой кадр. Если очередь клиента переросла STREAM_CLIENT_BUFFER_BYTES,
+ * неотправленные дельты выбрасываются, и клиент получает только ключевые кадры, когда его очередь опустеет.
+ * Правки клиентов складываются в очередь GetEdits, которую поток симуляции разбирает на границе поколений
+ */
+class StreamServer
+{
+	typedef std::shared_ptr<const std::vector<unsigned char>> StreamMessage;
+
+	struct StreamPeer
+	{
+		int fd;
+		std::deque<StreamMessage> queue;
+		size_t sent;						// отправлено байт первого сообщения очереди
+		size_t queued_bytes;
+		bool synced;						// получил ключевой кадр и все дельты после него
+		std::vector<unsigned char> input;
+	};
+
+	StreamAddress address;
+	int listen_fd;
+	int wake_pipe[2];
+	std::thread thread;
+	EditQueue* edits;
+
+	// Кадр от потока симуляции
+	std::mutex mutex;
+	std::vector<uint64_t> staging;			// только поток симуляции
+	std::vector<uint64_t> pending;
+	int pending_width;
+	int pending_height;
+	long long pending_generation;
+	bool has_pending;
+	bool stopping;
+
+	// Состояние потока сервера
+	std::vector<uint64_t> frame;
+	std::vector<uint64_t> previous;
+	int frame_width;
+	int frame_height;
+	long long frame_generation;
+	bool has_frame;
+	StreamMessage keyframe;					// ключевой кадр текущего frame, кодируется по требованию
+	std::vector<StreamPeer> peers;
+	std::atomic<int> clients_count;
+	std::atomic<bool> frame_wanted;			// новому клиенту нужен свежий кадр, даже если клиентов не было
+	long long deltas_sent;
+	long long keyframes_sent;
+	long long fallbacks;
+public:
+	StreamServer(const StreamAddress& sa);
+	bool Start(void);
+	void Submit(const Grid& grid, long long generation);
+	void Stop(void);
+	EditQueue* GetEdits(void) { return edits; }
+	int GetClientsCount(void) const { return clients_count.load(std::memory_order_relaxed); }
+	bool IsFrameWanted(void) const { return frame_wanted.load(std::memory_order_relaxed); }
+	~StreamServer();
+private:
+	StreamServer();
+	StreamServer(const StreamServer& ss);
+	StreamServer(StreamServer&& ss);
+	void operator=(const StreamServer& ss) {}
+	void ServerLoop(void);
+	void AcceptClients(void);
+	bool TakeFrame(void);
+	void BroadcastFrame(bool resized, long long base_generation);
+	StreamMessage GetKeyframe(void);
+	void Enqueue(StreamPeer& peer, const StreamMessage& message);
+	bool ReadClient(StreamPeer& peer);
+	bool WriteClient(StreamPeer& peer);
+	void CloseSockets(void);
+};
+
+
+// Блокирующий клиент сервера потока: читает сообщения в StreamDecoder и отправляет правки
+class StreamClient
+{
+	int fd;
+	std::vector<unsigned char> input;
+	StreamDecoder decoder;
+public:
+	StreamClient(void);
+	bool Connect(const StreamAddress& address);
+	int Receive(int timeout_ms);
+	bool SendEdits(const EditCommand* cmds, int count);
+	void Disconnect(void);
+	bool IsConnected(void) const { return fd >= 0; }
+	const StreamDecoder& GetDecoder(void) const { return decoder; }
+	~StreamClient();
+private:
+	StreamClient(const StreamClient& sc);
+	StreamClient(StreamClient&& sc);
+	void operator=(const StreamClient& sc) {}
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef TIMELINE_HPP
+#define TIMELINE_HPP
+
+
+#include "Grid.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+
+enum
+{
+			TIMELINE_DEFAULT_KEYFRAME_INTERVAL		=								 64,
+			TIMELINE_DEFAULT_BUDGET_MB				=								 64,
+			TIMELINE_MAX_LITERAL_GAP				=								  2
+};
+
+
+struct TimelineParams
+{
+	int keyframe_interval;			// полный снимок каждые keyframe_interval поколений
+	size_t budget;					// байт на всю историю, 0 - история отключена
+};
+
+
+/*
+ * История поколений для перемотки. Каждые keyframe_interval поколений хранится полный снимок
+ * упакованных строк, между ними - XOR с предыдущим поколением, сжатый по сериям нулевых слов:
+ * [число нулевых слов, число слов данных, слова данных...]. Поиск поколения декодирует дельты
+ * от ближайшего снимка. Когда история превышает бюджет, отбрасывается самый старый отрезок
+ * от снимка до снимка
+ */
+class Timeline
+{
+	struct TimelineEntry
+	{
+		bool keyframe;
+		std::vector<uint64_t> data;
+	};
+
+	TimelineParams params;
+	int width;
+	int height;
+	int row_words;
+	long long first_generation;
+	std::deque<TimelineEntry> entries;			// поколения first_generation, first_generation + 1, ...
+	std::vector<uint64_t> last_state;			// упакованные строки последнего записанного поколения
+	std::vector<uint64_t> scratch;
+	int since_keyframe;
+	size_t bytes;
+public:
+	Timeline(const TimelineParams& tp, int w, int h);
+	bool IsEnabled(void) const { return params.budget > 0; }
+	bool IsEmpty(void) const { return entries.empty(); }
+	long long GetFirstGeneration(void) const { return first_generation; }
+	long long GetLastGeneration(void) const { return first_generation + (long long)(entries.size()) - 1; }
+	size_t GetMemoryUsage(void) const { return bytes; }
+	void Record(const Grid& grid, long long generation);
+	bool Seek(long long generation, Grid& grid) const;
+	void Reset(int w, int h);
+private:
+	Timeline();
+	Timeline(const Timeline& t);
+	Timeline(Timeline&& t);
+	void operator=(const Timeline& t) {}
+	void Truncate(long long generation);
+	bool Decode(long long generation, std::vector<uint64_t>& state) const;
+	void EnforceBudget(void);
+	void DropFront(void);
+	static size_t EntryBytes(const TimelineEntry& entry) { return sizeof(TimelineEntry) + entry.data.capacity() * sizeof(uint64_t); }
+};
+
+#endif
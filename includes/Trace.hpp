@@ -0,0 +1,48 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+
+/*
+ * Замер фаз кадра и шага в формате Chrome Trace Event(открывается в chrome://tracing и ui.perfetto.dev).
+ * Зоны собираются, только если проект собран с GOL_TRACE и запись включена ключом --trace.
+ * Без GOL_TRACE макросы TRACE_ZONE и TRACE_THREAD_NAME не порождают никакого кода
+ */
+
+
+#ifdef GOL_TRACE
+
+#include <atomic>
+
+extern std::atomic<bool> trace_enabled;
+
+class TraceZone
+{
+	const char* name;
+	double start;
+public:
+	TraceZone(const char* zone_name);
+	~TraceZone();
+private:
+	TraceZone(const TraceZone& tz);
+	void operator=(const TraceZone& tz) {}
+};
+
+void traceSetThreadName(const char* name, int index = -1);
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name, index) traceSetThreadName(name, index)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_THREAD_NAME(name, index)
+
+#endif
+
+
+bool traceStart(const char* path);
+void traceStop(void);
+
+#endif
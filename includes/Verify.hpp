@@ -0,0 +1,19 @@
+#ifndef VERIFY_HPP
+#define VERIFY_HPP
+
+
+#include <iostream>
+
+
+enum
+{
+			VERIFY_THREADS					=								  3,
+			VERIFY_STREAM_GENERATIONS		=								100,
+			VERIFY_REGION_GENERATIONS		=								 60,
+			VERIFY_REGION_QUERIES			=								200
+};
+
+
+int runStepVerification(std::ostream& out);
+
+#endif
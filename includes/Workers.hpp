@@ -0,0 +1,42 @@
+#ifndef WORKERS_HPP
+#define WORKERS_HPP
+
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/*
+ * Пул постоянных потоков для параллельного шага.
+ * Run вызывает задачу на каждом исполнителе(вызывающий поток - исполнитель номер 0)
+ * и возвращает управление, когда все исполнители закончили
+ */
+class WorkerPool
+{
+	int workers_count;
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+	const std::function<void(int)>* task;
+	unsigned long long generation;
+	int pending;
+	bool stopping;
+public:
+	WorkerPool(int count);
+	int GetWorkersCount(void) const { return workers_count; }
+	void Run(const std::function<void(int)>& fn);
+	bool PinThreads(void);
+	~WorkerPool();
+private:
+	WorkerPool();
+	WorkerPool(const WorkerPool& wp);
+	WorkerPool(WorkerPool&& wp);
+	void operator=(const WorkerPool& wp) {}
+	void WorkerLoop(int worker);
+};
+
+#endif
@@ -2,9 +2,29 @@
 #define SERVICES_HPP
 
 #include <iostream>
+#include <cstddef>
+#include <string>
+#include <vector>
 
 
+// Откуда взяты страницы большого буфера
+enum
+{
+			PAGES_HEAP				=								  0,		// allocAligned
+			PAGES_NORMAL			=								  1,
+			PAGES_TRANSPARENT_HUGE	=								  2,		// обычные страницы, ядро может собрать их в большие
+			PAGES_HUGE				=								  3,		// страницы по 2 МБ из резерва hugetlbfs
+			HUGE_PAGE_SIZE			=							2097152
+};
+
 const std::string getResourcePath(const char* str);
+void* allocAligned(size_t size, size_t alignment);
+void freeAligned(void* ptr);
+void* allocPages(size_t size, bool huge, int& kind);
+void freePages(void* ptr, size_t size, int kind);
+const char* getPagesKindName(int kind);
+bool makeDirectory(const char* path);
+bool listDirectory(const char* path, const char* suffix, std::vector<std::string>& names);
 
 
 #endif
@@ -1,6 +1,119 @@
 #include "includes/Game.hpp"
+#include "includes/Kernels.hpp"
+#include "includes/Verify.hpp"
+#include "includes/Trace.hpp"
+#include "includes/Headless.hpp"
+#include "includes/Capture.hpp"
+#include "includes/Replay.hpp"
+#include "includes/Options.hpp"
+#include <cstdio>
+#include <cstring>
 
-static const char* default_textures_path = "resources";
+enum
+{
+			RUN_MODE_GAME					=								  0,
+			RUN_MODE_VERIFY					=								  1,
+			RUN_MODE_HEADLESS				=								  2,
+			RUN_MODE_REPLAY					=								  3
+};
+
+struct ProgramOptions
+{
+	EngineParams eparams;
+	HeadlessParams hparams;
+	int run_mode;
+	int resize_anchor;
+	const char* patterns_path;
+	TimelineParams timeline;
+	const char* record_path;
+	const char* replay_path;
+	const char* trace_path;
+};
+
+/*
+ * Разбирает необязательные ключи вида --name[=value] и убирает их из argv,
+ * чтобы позиционные параметры остались на своих местах. Возвращает новое значение argc
+ */
+static int ExtractOptions(int argc, char* argv[], ProgramOptions& options)
+{
+	int positional_count = 1;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const char* arg = argv[i];
+
+		if ( strncmp(arg, "--", 2) != 0 )
+		{
+			argv[positional_count++] = argv[i];
+			continue;
+		}
+
+		if ( parseEngineOption(arg, options.eparams, options.hparams) )
+			continue;
+
+		if ( strcmp(arg, "--verify") == 0 )
+		{
+			options.run_mode = RUN_MODE_VERIFY;
+		}
+		else if ( strcmp(arg, "--headless") == 0 )
+		{
+			options.run_mode = RUN_MODE_HEADLESS;
+		}
+		else if ( strncmp(arg, "--record=", 9) == 0 )
+		{
+			options.record_path = arg + 9;
+		}
+		else if ( strncmp(arg, "--replay=", 9) == 0 )
+		{
+			options.run_mode = RUN_MODE_REPLAY;
+			options.replay_path = arg + 9;
+		}
+		else if ( strncmp(arg, "--resize-anchor=", 16) == 0 )
+		{
+			options.resize_anchor = findAnchorByName(arg + 16);
+			if ( options.resize_anchor < 0 )
+			{
+				std::cout << "Resize anchor " << arg + 16 << " is invalid! Set default value!" << std::endl;
+				options.resize_anchor = GRID_ANCHOR_TOP_LEFT;
+			}
+		}
+		else if ( strncmp(arg, "--history=", 10) == 0 )
+		{
+			long long mb = atoll(arg + 10);
+			if ( mb < 0 )
+			{
+				std::cout << "History budget " << arg + 10 << " is invalid! Set default value!" << std::endl;
+				mb = TIMELINE_DEFAULT_BUDGET_MB;
+			}
+			options.timeline.budget = size_t(mb) << 20;
+		}
+		else if ( strncmp(arg, "--keyframe-interval=", 20) == 0 )
+		{
+			options.timeline.keyframe_interval = atoi(arg + 20);
+			if ( options.timeline.keyframe_interval < 1 )
+			{
+				std::cout << "Keyframe interval " << arg + 20 << " is invalid! Set default value!" << std::endl;
+				options.timeline.keyframe_interval = TIMELINE_DEFAULT_KEYFRAME_INTERVAL;
+			}
+		}
+		else if ( strncmp(arg, "--patterns=", 11) == 0 )
+		{
+			options.patterns_path = arg + 11;
+		}
+		else if ( strncmp(arg, "--trace=", 8) == 0 )
+		{
+			options.trace_path = arg + 8;
+		}
+		else
+		{
+			std::cout << "Unknown option " << arg << " is ignored" << std::endl;
+		}
+	}
+
+	argv[positional_count] = nullptr;
+
+	return positional_count;
+}
 
 static int CheckFieldWidthParam(const char* field_width_str, int display_width, int display_height)
 {
@@ -50,6 +163,50 @@ static int CheckSimSpeedMultiplierParam(const char* sim_speed_mul_str)
 
 int main(int argc, char* argv[])
 {
+	ProgramOptions options;
+	initEngineParams(options.eparams);
+	initHeadlessParams(options.hparams);
+	options.run_mode = RUN_MODE_GAME;
+	options.resize_anchor = GRID_ANCHOR_TOP_LEFT;
+	options.patterns_path = nullptr;
+	options.timeline.keyframe_interval = TIMELINE_DEFAULT_KEYFRAME_INTERVAL;
+	options.timeline.budget = size_t(TIMELINE_DEFAULT_BUDGET_MB) << 20;
+	options.record_path = nullptr;
+	options.replay_path = nullptr;
+	options.trace_path = nullptr;
+	argc = ExtractOptions(argc, argv, options);
+
+	// Стандартный вывод занят кадрами, поэтому сообщения уходят в поток ошибок
+	if ( isCaptureToStdout(options.hparams.capture) )
+		std::cout.rdbuf(std::cerr.rdbuf());
+
+	// Сверка всех ядер с эталоном не требует окна и библиотек SDL
+	if ( options.run_mode == RUN_MODE_VERIFY )
+		return runStepVerification(std::cout) ? 1 : 0;
+
+	if ( options.run_mode == RUN_MODE_HEADLESS )
+	{
+		if ( options.trace_path )
+			traceStart(options.trace_path);
+
+		int headless_result = runHeadless(options.hparams, options.eparams);
+		traceStop();
+
+		return headless_result;
+	}
+
+	// Воспроизведение записи всегда идёт с замером фаз: без --trace трасса пишется рядом с записью
+	if ( options.run_mode == RUN_MODE_REPLAY )
+	{
+		std::string trace_path = options.trace_path ? options.trace_path : std::string(options.replay_path) + ".trace.json";
+		traceStart(trace_path.c_str());
+
+		int replay_result = runReplay(options.replay_path, options.eparams);
+		traceStop();
+
+		return replay_result;
+	}
+
 	Game game;
 
 
@@ -76,14 +233,12 @@ int main(int argc, char* argv[])
 			field_width = MIN_FIELD_WIDTH;
 			field_height = MIN_WORKSPACE_HEIGHT;
 			sim_speed_multiplier = MIN_SIMULATION_SPEED_MULTIPLIER;
-			textures_path = const_cast<char*>(default_textures_path);
 			break;
 		case 2:
 			if ( (field_width = CheckFieldWidthParam(argv[1], display_width, display_height)) == 0 )
 				field_width = MIN_FIELD_WIDTH;
 			field_height = MIN_WORKSPACE_HEIGHT;
 			sim_speed_multiplier = MIN_SIMULATION_SPEED_MULTIPLIER;
-			textures_path = const_cast<char*>(default_textures_path);
 			break;
 		case 3:
 			if ( (field_width = CheckFieldWidthParam(argv[1], display_width, display_height)) == 0 )
@@ -91,7 +246,6 @@ int main(int argc, char* argv[])
 			if ( (field_height = CheckFieldHeightParam(argv[2], display_width, display_height)) == 0 )
 				field_height = MIN_WORKSPACE_HEIGHT;
 			sim_speed_multiplier = MIN_SIMULATION_SPEED_MULTIPLIER;
-			textures_path = const_cast<char*>(default_textures_path);
 			break;
 		case 4:
 			if ( (field_width = CheckFieldWidthParam(argv[1], display_width, display_height)) == 0 )
@@ -100,7 +254,6 @@ int main(int argc, char* argv[])
 				field_height = MIN_WORKSPACE_HEIGHT;
 			if ( (sim_speed_multiplier = CheckSimSpeedMultiplierParam(argv[3])) == 0 )
 				sim_speed_multiplier = MIN_SIMULATION_SPEED_MULTIPLIER;
-			textures_path = const_cast<char*>(default_textures_path);
 			break;
 		default:
 			if ( (field_width = CheckFieldWidthParam(argv[1], display_width, display_height)) == 0 )
@@ -134,12 +287,25 @@ int main(int argc, char* argv[])
 		return 1;
 	}
 
-	if ( !game.InitGameState(field_width, field_height, sim_speed_multiplier) )
+	if ( !game.InitGameState(field_width, field_height, sim_speed_multiplier, options.eparams) )
 	{
 		return 1;
 	}
+	game.SetCaptureParams(options.hparams.capture);
+	game.SetResizeAnchor(options.resize_anchor);
+	if ( options.hparams.board_set )
+		game.SetBoardSize(options.hparams.cells_x, options.hparams.cells_y);
+	game.LoadStamps(options.patterns_path);
+	game.SetTimelineParams(options.timeline);
+	game.SetRecordPath(options.record_path);
+
+	if ( options.trace_path )
+		traceStart(options.trace_path);
+
+	int run_result = game.Run();
+	traceStop();
 
-	if ( !game.Run() )
+	if ( !run_result )
 	{
 		return 1;
 	}
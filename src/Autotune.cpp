@@ -0,0 +1,138 @@
+#ifndef AUTOTUNE_CPP
+#define AUTOTUNE_CPP
+
+
+#include "../includes/Autotune.hpp"
+#include "../includes/Kernels.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+// Строка кэша: "<ширина> <высота> <правило> <ядро>"
+int readCachedKernel(const char* cache_path, int cells_x, int cells_y, const std::string& rule_str)
+{
+	std::ifstream in(cache_path);
+	std::string line;
+
+	while ( std::getline(in, line) )
+	{
+		std::istringstream fields(line);
+		int w = 0, h = 0;
+		std::string rule, kernel;
+		if ( !(fields >> w >> h >> rule >> kernel) )
+			continue;
+
+		if ( (w == cells_x) && (h == cells_y) && (rule == rule_str) )
+		{
+			int kernel_id = findStepKernelByName(kernel.c_str());
+			if ( (kernel_id >= 0) && isStepKernelSupported(kernel_id) )
+				return kernel_id;
+		}
+	}
+
+	return -1;
+}
+
+void writeCachedKernel(const char* cache_path, int cells_x, int cells_y, const std::string& rule_str, int kernel_id)
+{
+	std::vector<std::string> lines;
+	{
+		std::ifstream in(cache_path);
+		std::string line;
+		while ( std::getline(in, line) )
+		{
+			std::istringstream fields(line);
+			int w = 0, h = 0;
+			std::string rule;
+			if ( (fields >> w >> h >> rule) && (w == cells_x) && (h == cells_y) && (rule == rule_str) )
+				continue;
+			lines.push_back(line);
+		}
+	}
+
+	std::ofstream out(cache_path, std::ios::trunc);
+	if ( !out )
+	{
+		std::cout << "[autotuneStepKernel]: " << "Unable to write kernel cache " << cache_path << std::endl;
+		return;
+	}
+
+	for ( auto& line : lines )
+		out << line << "\n";
+	out << cells_x << " " << cells_y << " " << rule_str << " " << getStepKernelName(kernel_id) << "\n";
+}
+
+}
+
+
+/*
+ * Выбирает самое быстрое ядро для поля заданного размера: каждое поддерживаемое ядро
+ * сначала сверяется со скалярным на нескольких шагах, затем гоняется AUTOTUNE_BUDGET_MS миллисекунд.
+ * Победитель запоминается в файле cache_path, при повторном запуске замер не выполняется
+ */
+int autotuneStepKernel(int cells_x, int cells_y, bool toroidal, const LifeRule& rule, const char* cache_path)
+{
+	std::string rule_str = lifeRuleToString(rule);
+
+	int cached = readCachedKernel(cache_path, cells_x, cells_y, rule_str);
+	if ( cached >= 0 )
+		return cached;
+
+	Grid reference(cells_x, cells_y, toroidal);
+	reference.Randomize(0.3, 1);
+	for ( int i = 0; i < AUTOTUNE_VERIFY_STEPS; ++i )
+		reference.Step(rule, getStepKernel(STEP_KERNEL_SCALAR_BYTE));
+
+	Grid grid(cells_x, cells_y, toroidal);
+	int best_kernel = STEP_KERNEL_SWAR64;
+	double best_time = 0.0;
+
+	for ( int kernel_id = 0; kernel_id < STEP_KERNELS_COUNT; ++kernel_id )
+	{
+		StepKernel kernel = getStepKernel(kernel_id);
+		if ( !kernel || !isStepKernelSupported(kernel_id) )
+			continue;
+
+		grid.Randomize(0.3, 1);
+		for ( int i = 0; i < AUTOTUNE_VERIFY_STEPS; ++i )
+			grid.Step(rule, kernel);
+
+		if ( !grid.IsEqual(reference) )
+		{
+			std::cout << "[autotuneStepKernel]: " << "Kernel " << getStepKernelName(kernel_id) << " gives wrong result, skipped" << std::endl;
+			continue;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		auto deadline = start + std::chrono::milliseconds(AUTOTUNE_BUDGET_MS);
+		int steps = 0;
+		do
+		{
+			grid.Step(rule, kernel);
+			++steps;
+		}
+		while ( std::chrono::steady_clock::now() < deadline );
+
+		double step_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / steps;
+		std::cout << "Kernel " << getStepKernelName(kernel_id) << ": " << step_time * 1e6 << " us/step" << std::endl;
+
+		if ( (best_time == 0.0) || (step_time < best_time) )
+		{
+			best_time = step_time;
+			best_kernel = kernel_id;
+		}
+	}
+
+	writeCachedKernel(cache_path, cells_x, cells_y, rule_str, best_kernel);
+
+	return best_kernel;
+}
+
+#endif
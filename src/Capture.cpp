@@ -0,0 +1,362 @@
+#ifndef CAPTURE_CPP
+#define CAPTURE_CPP
+
+
+#include "../includes/Capture.hpp"
+#include "../includes/services.hpp"
+#include "../includes/Trace.hpp"
+#include "../includes/Png.hpp"
+#include <cstring>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+
+namespace
+{
+
+// Цвета совпадают с серединой текстур cell.png, alive_cell.png и dead_cell.png; индекс - номер цвета в палитре PNG
+enum
+{
+			CAPTURE_COLOR_EMPTY				=								  0,
+			CAPTURE_COLOR_ALIVE				=								  1,
+			CAPTURE_COLOR_DEAD				=								  2,
+			CAPTURE_COLOR_BORDER			=								  3,
+			CAPTURE_COLORS_COUNT			=								  4
+};
+
+const unsigned char capture_palette[CAPTURE_COLORS_COUNT][4] =
+{
+	{ 195, 195, 195, 255 },		// пустая
+	{ 105, 209,   1, 255 },		// живая
+	{ 252,  20,  14, 255 },		// погибшая
+	{   0,   0,   0, 255 }		// рамка клетки
+};
+
+const unsigned char capture_indices[CAPTURE_COLORS_COUNT] = { CAPTURE_COLOR_EMPTY, CAPTURE_COLOR_ALIVE, CAPTURE_COLOR_DEAD, CAPTURE_COLOR_BORDER };
+
+}
+
+
+// Разбирает значение ключа --capture: "png:DIR", "raw" или "raw:FILE"("-" - стандартный вывод)
+bool parseCaptureSpec(const char* spec, CaptureParams& params)
+{
+	if ( strncmp(spec, "png:", 4) == 0 )
+	{
+		if ( spec[4] == '\0' )
+			return false;
+
+		params.format = CAPTURE_FORMAT_PNG;
+		params.path = spec + 4;
+		return true;
+	}
+
+	if ( strcmp(spec, "raw") == 0 )
+	{
+		params.format = CAPTURE_FORMAT_RAW;
+		params.path = "-";
+		return true;
+	}
+
+	if ( strncmp(spec, "raw:", 4) == 0 )
+	{
+		params.format = CAPTURE_FORMAT_RAW;
+		params.path = (spec[4] == '\0') ? "-" : spec + 4;
+		return true;
+	}
+
+	return false;
+}
+
+bool isCaptureToStdout(const CaptureParams& params)
+{
+	return (params.format == CAPTURE_FORMAT_RAW) && (params.path == "-");
+}
+
+
+FrameCapture::FrameCapture(const CaptureParams& cp, int cx, int cy)
+{
+	params = cp;
+	if ( params.cell_pixels < 1 )
+		params.cell_pixels = 1;
+	if ( params.cell_pixels > CAPTURE_MAX_CELL_PIXELS )
+		params.cell_pixels = CAPTURE_MAX_CELL_PIXELS;
+
+	cells_x = cx;
+	cells_y = cy;
+	row_words = (cells_x + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	frame_width = cells_x * params.cell_pixels;
+	frame_height = cells_y * params.cell_pixels;
+
+	raw_output = nullptr;
+	stopping = false;
+	failed = false;
+	submitted = 0;
+	dropped = 0;
+	written = 0;
+
+	// Вся память под кадры выделяется заранее, в Submit нет ни одного выделения
+	size_t plane_words = size_t(row_words) * cells_y;
+	history.assign(plane_words, 0);
+	frames.resize(CAPTURE_QUEUE_SIZE);
+	for ( auto& frame : frames )
+	{
+		frame.number = 0;
+		frame.alive.assign(plane_words, 0);
+		frame.history.assign(plane_words, 0);
+		free_frames.push_back(&frame);
+	}
+}
+
+FrameCapture::FrameCapture(const FrameCapture& fc)
+{
+}
+
+FrameCapture::FrameCapture(FrameCapture&& fc)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+	Stop();
+}
+
+bool FrameCapture::Start(void)
+{
+	if ( params.format == CAPTURE_FORMAT_PNG )
+	{
+		if ( !makeDirectory(params.path.c_str()) )
+		{
+			std::cout << "[FrameCapture::Start](" << this << "): " << "Unable to create directory " << params.path << std::endl;
+			return false;
+		}
+	}
+	else if ( params.format == CAPTURE_FORMAT_RAW )
+	{
+		if ( isCaptureToStdout(params) )
+		{
+#ifdef _WIN32
+			_setmode(_fileno(stdout), _O_BINARY);
+#endif
+			raw_output = stdout;
+		}
+		else
+		{
+			raw_output = fopen(params.path.c_str(), "wb");
+		}
+
+		if ( raw_output == nullptr )
+		{
+			std::cout << "[FrameCapture::Start](" << this << "): " << "Unable to open " << params.path << " for writing" << std::endl;
+			return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	// Сырой поток пишется строго по порядку, поэтому для него кодировщик один
+	int encoders_count = (params.format == CAPTURE_FORMAT_PNG) ? CAPTURE_PNG_THREADS : 1;
+	for ( int i = 0; i < encoders_count; ++i )
+		encoders.emplace_back(&FrameCapture::EncoderLoop, this, i);
+
+	std::cout << "Capture: " << ((params.format == CAPTURE_FORMAT_PNG) ? "png" : "raw rgba") << " " << frame_width << "x" << frame_height
+			  << " to " << params.path << std::endl;
+
+	return true;
+}
+
+void FrameCapture::Submit(const Grid& grid)
+{
+	TRACE_ZONE("CaptureSubmit");
+
+	if ( (grid.GetWidth() != cells_x) || (grid.GetHeight() != cells_y) )
+		return;
+
+	const uint64_t* mask = grid.GetTailMask();
+	for ( int y = 0; y < cells_y; ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		uint64_t* seen = history.data() + size_t(y) * row_words;
+		for ( int i = 0; i < row_words; ++i )
+			seen[i] |= row[i] & mask[i];
+	}
+
+	CaptureFrame* frame = nullptr;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		++submitted;
+		if ( params.lossless )
+			free_cv.wait(lock, [this] { return !free_frames.empty() || failed; });
+		if ( free_frames.empty() || failed )
+		{
+			++dropped;
+			return;
+		}
+		frame = free_frames.back();
+		free_frames.pop_back();
+	}
+
+	for ( int y = 0; y < cells_y; ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		uint64_t* alive = frame->alive.data() + size_t(y) * row_words;
+		for ( int i = 0; i < row_words; ++i )
+			alive[i] = row[i] & mask[i];
+	}
+	memcpy(frame->history.data(), history.data(), history.size() * sizeof(uint64_t));
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		frame->number = submitted - dropped - 1;
+		queue.push_back(frame);
+	}
+	queue_cv.notify_one();
+}
+
+void FrameCapture::Stop(void)
+{
+	if ( encoders.empty() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	queue_cv.notify_all();
+
+	for ( auto& t : encoders )
+		t.join();
+	encoders.clear();
+
+	if ( raw_output )
+	{
+		fflush(raw_output);
+		if ( raw_output != stdout )
+			fclose(raw_output);
+		raw_output = nullptr;
+	}
+
+	std::cout << "Captured " << written << " frames, dropped " << dropped << std::endl;
+}
+
+void FrameCapture::EncoderLoop(int encoder)
+{
+	TRACE_THREAD_NAME("capture", encoder);
+	// PNG растеризуется сразу индексами палитры, сырой поток - цветами RGBA
+	int pixel_bytes = (params.format == CAPTURE_FORMAT_RAW) ? 4 : 1;
+	std::vector<unsigned char> pixels(size_t(frame_width) * frame_height * pixel_bytes);
+
+	for ( ;; )
+	{
+		CaptureFrame* frame = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+			if ( queue.empty() )
+				return;
+			frame = queue.front();
+			queue.pop_front();
+		}
+
+		bool ok = false;
+		{
+			TRACE_ZONE("CaptureEncode");
+			if ( pixel_bytes == 4 )
+				Rasterize<4>(*frame, pixels.data(), &capture_palette[0][0]);
+			else
+				Rasterize<1>(*frame, pixels.data(), capture_indices);
+			ok = WriteFrame(*frame, pixels);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if ( ok )
+				++written;
+			else
+				failed = true;
+			free_frames.push_back(frame);
+		}
+		free_cv.notify_one();
+	}
+}
+
+/*
+ * Каждая клетка превращается в квадрат cell_pixels x cell_pixels, крупные клетки получают рамку.
+ * Пиксель - PIXEL_BYTES байт, colors - CAPTURE_COLORS_COUNT цветов по PIXEL_BYTES байт
+ */
+template <int PIXEL_BYTES>
+void FrameCapture::Rasterize(const CaptureFrame& frame, unsigned char* pixels, const unsigned char* colors) const
+{
+	int scale = params.cell_pixels;
+	bool border = scale >= CAPTURE_CELL_BORDER_MIN_PIXELS;
+	size_t line_bytes = size_t(frame_width) * PIXEL_BYTES;
+	const unsigned char* border_color = colors + CAPTURE_COLOR_BORDER * PIXEL_BYTES;
+
+	for ( int y = 0; y < cells_y; ++y )
+	{
+		const uint64_t* alive = frame.alive.data() + size_t(y) * row_words;
+		const uint64_t* seen = frame.history.data() + size_t(y) * row_words;
+		unsigned char* line = pixels + size_t(y) * scale * line_bytes;
+		unsigned char* out = line;
+
+		for ( int x = 0; x < cells_x; ++x )
+		{
+			uint64_t bit = uint64_t(1) << (x % GRID_WORD_BITS);
+			int state = (alive[x / GRID_WORD_BITS] & bit) ? CAPTURE_COLOR_ALIVE : ((seen[x / GRID_WORD_BITS] & bit) ? CAPTURE_COLOR_DEAD : CAPTURE_COLOR_EMPTY);
+			const unsigned char* color = colors + state * PIXEL_BYTES;
+
+			for ( int sx = 0; sx < scale; ++sx, out += PIXEL_BYTES )
+			{
+				bool edge = border && ((sx == 0) || (sx == scale - 1));
+				memcpy(out, edge ? border_color : color, PIXEL_BYTES);
+			}
+		}
+
+		// Остальные строки клетки повторяют первую, у клеток с рамкой крайние строки чёрные
+		for ( int sy = 1; sy < scale; ++sy )
+		{
+			unsigned char* dst = line + sy * line_bytes;
+			if ( border && (sy == scale - 1) )
+			{
+				for ( int px = 0; px < frame_width; ++px )
+					memcpy(dst + px * PIXEL_BYTES, border_color, PIXEL_BYTES);
+			}
+			else
+			{
+				memcpy(dst, line, line_bytes);
+			}
+		}
+
+		if ( border )
+			for ( int px = 0; px < frame_width; ++px )
+				memcpy(line + px * PIXEL_BYTES, border_color, PIXEL_BYTES);
+	}
+}
+
+bool FrameCapture::WriteFrame(const CaptureFrame& frame, std::vector<unsigned char>& pixels)
+{
+	if ( params.format == CAPTURE_FORMAT_RAW )
+		return fwrite(pixels.data(), 1, pixels.size(), raw_output) == pixels.size();
+
+	char name[32];
+	snprintf(name, sizeof(name), "frame_%06lld.png", frame.number);
+	std::string path = params.path + "/" + name;
+
+	// В кадре только цвета состояний и рамки, поэтому PNG пишется с палитрой, pixels - уже индексы
+	std::vector<unsigned char> png;
+	encodePngIndexed(pixels.data(), frame_width, frame_height, &capture_palette[0][0], CAPTURE_COLORS_COUNT, png);
+
+	FILE* f = fopen(path.c_str(), "wb");
+	bool ok = (f != nullptr) && (fwrite(png.data(), 1, png.size(), f) == png.size());
+	if ( f && (fclose(f) != 0) )
+		ok = false;
+	if ( !ok )
+		std::cout << "[FrameCapture::WriteFrame](" << this << "): " << "Unable to save " << path << "!" << std::endl;
+
+	return ok;
+}
+
+#endif
@@ -0,0 +1,698 @@
+#ifndef CENSUS_CPP
+#define CENSUS_CPP
+
+
+#include "../includes/Census.hpp"
+#include "../includes/Kernels.hpp"
+#include "../includes/Patterns.hpp"
+#include <algorithm>
+#include <iostream>
+
+
+const char* censusKindName(int kind)
+{
+	switch ( kind )
+	{
+		case CENSUS_KIND_STILL_LIFE:	return "still life";
+		case CENSUS_KIND_OSCILLATOR:	return "oscillator";
+		case CENSUS_KIND_SPACESHIP:		return "spaceship";
+	}
+
+	return "unknown";
+}
+
+/*
+ * Ключ формы в одном из восьми поворотов и отражений(orientation 0 - как есть): клетки сдвигаются
+ * в начало координат и упаковываются построчно в битовую карту с размерами в начале
+ */
+std::string shapeKey(const std::vector<std::pair<int, int>>& cells, int orientation)
+{
+	auto orient = [orientation](const std::pair<int, int>& c)
+	{
+		int x = (orientation & 4) ? -c.first : c.first;
+		int y = c.second;
+		for ( int r = 0; r < (orientation & 3); ++r )
+		{
+			int tmp = x;
+			x = -y;
+			y = tmp;
+		}
+		return std::make_pair(x, y);
+	};
+
+	int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+	for ( size_t i = 0; i < cells.size(); ++i )
+	{
+		std::pair<int, int> c = orient(cells[i]);
+		if ( i == 0 )
+		{
+			min_x = max_x = c.first;
+			min_y = max_y = c.second;
+		}
+		min_x = std::min(min_x, c.first);
+		min_y = std::min(min_y, c.second);
+		max_x = std::max(max_x, c.first);
+		max_y = std::max(max_y, c.second);
+	}
+
+	int w = max_x - min_x + 1;
+	int h = max_y - min_y + 1;
+	std::string key(4 + (size_t(w) * h + 7) / 8, '\0');
+	key[0] = char(w >> 8);
+	key[1] = char(w & 0xff);
+	key[2] = char(h >> 8);
+	key[3] = char(h & 0xff);
+	for ( auto& cell : cells )
+	{
+		std::pair<int, int> c = orient(cell);
+		size_t bit = size_t(c.second - min_y) * w + (c.first - min_x);
+		key[4 + bit / 8] |= char(1 << (bit % 8));
+	}
+
+	return key;
+}
+
+// Канонический вид набора клеток - наименьший из ключей восьми поворотов и отражений
+std::string canonicalShape(const std::vector<std::pair<int, int>>& cells)
+{
+	std::string best;
+
+	for ( int o = 0; o < 8; ++o )
+	{
+		std::string key = shapeKey(cells, o);
+		if ( (o == 0) || (key < best) )
+			best.swap(key);
+	}
+
+	return best;
+}
+
+
+Census::Census(int w, int h, bool tor)
+{
+	toroidal = tor;
+	BuildTable();
+	Reset(w, h);
+}
+
+Census::Census(const Census& c)
+{
+}
+
+Census::Census(Census&& c)
+{
+}
+
+void Census::Reset(int w, int h)
+{
+	width = w;
+	height = h;
+	row_words = (w + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	tail = (w % GRID_WORD_BITS) ? (uint64_t(1) << (w % GRID_WORD_BITS)) - 1 : ~uint64_t(0);
+	previous.assign(size_t(row_words) * h, 0);
+	changes.assign(size_t(row_words) * h, 0);
+	dirty.assign(size_t(row_words) * h, 0);
+	owned.assign(size_t(row_words) * h, 0);
+	touched.assign(size_t(row_words) * h, 0);
+	touched_cells.clear();
+	rows_changed.assign(h, 0);
+	rows_dirty.assign(h, 0);
+	labels.assign(size_t(w) * h, 0);
+	components.clear();
+	free_components.clear();
+	counts.assign(objects.size(), 0);
+	unknown_count = 0;
+	components_count = 0;
+	oversized_count = 0;
+	covered = 0;
+	population = 0;
+	examined = 0;
+	work = 0;
+	deferred = 0;
+	stale = false;
+
+	other.previous = previous;
+	other.owned = owned;
+	other.labels = labels;
+	other.components.clear();
+	other.free_components.clear();
+	other.counts = counts;
+	other.unknown_count = 0;
+	other.components_count = 0;
+	other.oversized_count = 0;
+	other.covered = 0;
+	other.population = 0;
+}
+
+// Меняет местами переписи чётных и нечётных поколений. Векторы меняются без копирования
+void Census::SwapLane(void)
+{
+	previous.swap(other.previous);
+	owned.swap(other.owned);
+	labels.swap(other.labels);
+	components.swap(other.components);
+	free_components.swap(other.free_components);
+	counts.swap(other.counts);
+	std::swap(unknown_count, other.unknown_count);
+	std::swap(components_count, other.components_count);
+	std::swap(oversized_count, other.oversized_count);
+	std::swap(covered, other.covered);
+	std::swap(population, other.population);
+}
+
+// Таблица известных объектов. Все фазы получаются прогоном объекта на его период
+void Census::BuildTable(void)
+{
+	AddObject("block",			CENSUS_KIND_STILL_LIFE,		1,	"2o$2o!");
+	AddObject("beehive",		CENSUS_KIND_STILL_LIFE,		1,	"b2o$o2bo$b2o!");
+	AddObject("loaf",			CENSUS_KIND_STILL_LIFE,		1,	"b2o$o2bo$bobo$2bo!");
+	AddObject("boat",			CENSUS_KIND_STILL_LIFE,		1,	"2o$obo$bo!");
+	AddObject("tub",			CENSUS_KIND_STILL_LIFE,		1,	"bo$obo$bo!");
+	AddObject("ship",			CENSUS_KIND_STILL_LIFE,		1,	"2o$obo$b2o!");
+	AddObject("pond",			CENSUS_KIND_STILL_LIFE,		1,	"b2o$o2bo$o2bo$b2o!");
+	AddObject("barge",			CENSUS_KIND_STILL_LIFE,		1,	"bo$obo$bobo$2bo!");
+	AddObject("long boat",		CENSUS_KIND_STILL_LIFE,		1,	"2o$obo$bobo$2bo!");
+	AddObject("mango",			CENSUS_KIND_STILL_LIFE,		1,	"b2o$o2bo$bo2bo$2b2o!");
+	AddObject("eater",			CENSUS_KIND_STILL_LIFE,		1,	"2o$obo$2bo$2b2o!");
+	AddObject("blinker",		CENSUS_KIND_OSCILLATOR,		2,	"3o!");
+	AddObject("toad",			CENSUS_KIND_OSCILLATOR,		2,	"b3o$3o!");
+	AddObject("beacon",			CENSUS_KIND_OSCILLATOR,		2,	"2o$o$3bo$2b2o!");
+	AddObject("pulsar",			CENSUS_KIND_OSCILLATOR,		3,	"2b3o3b3o2b2$o4bobo4bo$o4bobo4bo$o4bobo4bo$2b3o3b3o2b2$2b3o3b3o2b$o4bobo4bo$o4bobo4bo$o4bobo4bo2$2b3o3b3o!");
+	AddObject("pentadecathlon",	CENSUS_KIND_OSCILLATOR,		15,	"2bo4bo$2ob4ob2o$2bo4bo!");
+	AddObject("glider",			CENSUS_KIND_SPACESHIP,		4,	"bo$2bo$3o!");
+	AddObject("lwss",			CENSUS_KIND_SPACESHIP,		4,	"bo2bo$o4b$o3bo$4o!");
+	AddObject("mwss",			CENSUS_KIND_SPACESHIP,		4,	"3bo2b$bo3bo$o5b$o4bo$5o!");
+	AddObject("hwss",			CENSUS_KIND_SPACESHIP,		4,	"3b2o2b$bo4bo$o6b$o5bo$6o!");
+}
+
+void Census::AddObject(const char* name, int kind, int period, const char* rle)
+{
+	Pattern pattern;
+	if ( !parseRle(rle, pattern) )
+	{
+		std::cout << "[Census::AddObject](" << this << "): " << "Unable to parse object " << name << std::endl;
+		return;
+	}
+
+	int idx = int(objects.size());
+	objects.push_back(CensusObject { name, kind, period });
+
+	// Поле с запасом на движение корабля за период
+	int margin = CENSUS_RADIUS + period;
+	Grid grid(pattern.width + margin * 2, pattern.height + margin * 2, false);
+	for ( int y = 0; y < pattern.height; ++y )
+		for ( int x = 0; x < pattern.width; ++x )
+			if ( pattern.cells[size_t(y) * pattern.width + x] )
+				grid.SetCell(margin + x, margin + y, true);
+
+	StepKernel kernel = getStepKernel(STEP_KERNEL_SWAR64);
+	LifeRule rule = conwayRule();
+	std::string first;
+	std::vector<std::pair<int, int>> cells;
+
+	for ( int phase = 0; phase <= period; ++phase )
+	{
+		cells.clear();
+		for ( int y = 0; y < grid.GetHeight(); ++y )
+			for ( int x = 0; x < grid.GetWidth(); ++x )
+				if ( grid.GetCell(x, y) )
+					cells.push_back(std::make_pair(x, y));
+
+		std::string key = canonicalShape(cells);
+		if ( phase == 0 )
+			first = key;
+		else if ( phase == period )
+		{
+			if ( key != first )
+				std::cout << "[Census::AddObject](" << this << "): " << "Object " << name << " does not repeat after " << period << " generations" << std::endl;
+			break;
+		}
+
+		// В таблицу идут все повороты и отражения, чтобы Classify строил один ключ
+		for ( int o = 0; o < 8; ++o )
+			known.insert(std::make_pair(shapeKey(cells, o), idx));
+		grid.Step(rule, kernel);
+	}
+}
+
+int Census::Classify(const std::vector<std::pair<int, int>>& cells) const
+{
+	auto it = known.find(shapeKey(cells, 0));
+
+	return (it == known.end()) ? -1 : it->second;
+}
+
+long long Census::CountKind(int kind) const
+{
+	if ( kind == CENSUS_KIND_UNKNOWN )
+		return unknown_count;
+
+	long long total = 0;
+	for ( size_t i = 0; i < objects.size(); ++i )
+		if ( objects[i].kind == kind )
+			total += counts[i];
+
+	return total;
+}
+
+// Перенос координаты через край тора. Сдвиги не больше CENSUS_RADIUS, поэтому хватает сложений вместо деления
+inline int Census::Wrap(int v, int size)
+{
+	while ( v < 0 )
+		v += size;
+	while ( v >= size )
+		v -= size;
+
+	return v;
+}
+
+// Расширяет строку изменений на CENSUS_RADIUS клеток в обе стороны сдвигами слов. На торе края строки переносятся
+void Census::Spread(uint64_t* row) const
+{
+	uint64_t edges[4] = { 0, 0, 0, 0 };
+	int columns[4] = { 0, 1, width - 2, width - 1 };
+	if ( toroidal )
+		for ( int c = 0; c < 4; ++c )
+			if ( columns[c] >= 0 )
+				edges[c] = (row[columns[c] / GRID_WORD_BITS] >> (columns[c] % GRID_WORD_BITS)) & 1;
+
+	uint64_t before = 0;
+	uint64_t word = row[0];
+	for ( int i = 0; i < row_words; ++i )
+	{
+		uint64_t after = (i + 1 < row_words) ? row[i + 1] : 0;
+		row[i] = word | (word << 1) | (word << 2) | (word >> 1) | (word >> 2) |
+					(before >> 63) | (before >> 62) | (after << 63) | (after << 62);
+		before = word;
+		word = after;
+	}
+	row[row_words - 1] &= tail;
+
+	for ( int c = 0; c < 4; ++c )
+	{
+		if ( !edges[c] )
+			continue;
+		for ( int d = -CENSUS_RADIUS; d <= CENSUS_RADIUS; ++d )
+		{
+			int x = Wrap(columns[c] + d, width);
+			row[x / GRID_WORD_BITS] |= uint64_t(1) << (x % GRID_WORD_BITS);
+		}
+	}
+}
+
+// Клетки x - CENSUS_RADIUS .. x + CENSUS_RADIUS строки битами младшего к старшему. Вдали от краёв - одно-два слова
+inline uint32_t Census::Window(const uint64_t* row, int x) const
+{
+	const int size = CENSUS_RADIUS * 2 + 1;
+
+	if ( (x >= CENSUS_RADIUS) && (x + CENSUS_RADIUS < width) )
+	{
+		int s = x - CENSUS_RADIUS;
+		int shift = s % GRID_WORD_BITS;
+		uint64_t bits = row[s / GRID_WORD_BITS] >> shift;
+		if ( shift > GRID_WORD_BITS - size )
+			bits |= row[s / GRID_WORD_BITS + 1] << (GRID_WORD_BITS - shift);
+
+		return uint32_t(bits & ((uint64_t(1) << size) - 1));
+	}
+
+	return EdgeWindow(row, x);
+}
+
+// Окно у края строки: на торе клетки берутся с другого края, на поле с границами за краем клеток нет
+uint32_t Census::EdgeWindow(const uint64_t* row, int x) const
+{
+	uint32_t bits = 0;
+	for ( int d = -CENSUS_RADIUS; d <= CENSUS_RADIUS; ++d )
+	{
+		int nx = x + d;
+		if ( toroidal )
+			nx = Wrap(nx, width);
+		else if ( (nx < 0) || (nx >= width) )
+			continue;
+
+		if ( (row[nx / GRID_WORD_BITS] >> (nx % GRID_WORD_BITS)) & 1 )
+			bits |= uint32_t(1) << (d + CENSUS_RADIUS);
+	}
+
+	return bits;
+}
+
+// Есть ли записанная клетка в окрестности(x, y). Записанные клетки живые, поэтому смотрятся только строки с живыми окнами
+bool Census::IsTouching(int x, int y) const
+{
+	for ( int dy = -CENSUS_RADIUS; dy <= CENSUS_RADIUS; ++dy )
+	{
+		int ny = y + dy;
+		if ( toroidal )
+			ny = Wrap(ny, height);
+		else if ( (ny < 0) || (ny >= height) )
+			continue;
+
+		if ( Window(owned.data() + size_t(ny) * row_words, x) )
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Снимает запись, которой принадлежит клетка(x, y). Записи не касаются друг друга, поэтому клетки записи -
+ * это связная часть owned, она заливается по битам и снимается. Номер записи лежит в её клетке
+ * с наименьшим индексом, так что labels трогается один раз на запись
+ */
+void Census::RemoveComponent(int x, int y)
+{
+	int first = y * width + x;
+
+	flood.clear();
+	owned[WordOf(x, y)] &= ~BitOf(x);
+	flood.push_back(std::make_pair(x, y));
+
+	for ( size_t i = 0; i < flood.size(); ++i )
+	{
+		int cx = flood[i].first;
+		int cy = flood[i].second;
+
+		for ( int dy = -CENSUS_RADIUS; dy <= CENSUS_RADIUS; ++dy )
+		{
+			int ny = cy + dy;
+			if ( toroidal )
+				ny = Wrap(ny, height);
+			else if ( (ny < 0) || (ny >= height) )
+				continue;
+
+			size_t row = size_t(ny) * row_words;
+			uint32_t bits = Window(owned.data() + row, cx);
+			while ( bits )
+			{
+				int dx = ctz64(bits) - CENSUS_RADIUS;
+				bits &= bits - 1;
+
+				int nx = toroidal ? Wrap(cx + dx, width) : cx + dx;
+				uint64_t& word = owned[row + nx / GRID_WORD_BITS];
+				uint64_t bit = BitOf(nx);
+				if ( !(word & bit) )
+					continue;
+
+				word &= ~bit;
+				flood.push_back(std::make_pair(nx, ny));
+				first = std::min(first, ny * width + nx);
+			}
+		}
+	}
+
+	work += (long long)flood.size();
+	int label = labels[first];
+	labels[first] = 0;
+	if ( label == 0 )
+		return;
+
+	Component& comp = components[label - 1];
+	if ( comp.type >= 0 )
+		--counts[comp.type];
+	else
+		--unknown_count;
+	if ( comp.type == -2 )
+		--oversized_count;
+	else
+		covered -= comp.size;
+	--components_count;
+
+	free_components.push_back(label - 1);
+}
+
+/*
+ * Заливка компоненты от клетки(x, y) по упакованным строкам. Залитые клетки на время заливки снимаются
+ * в previous, так что на строку окрестности читается одно окно. Координаты копятся без переноса через
+ * край тора, чтобы форма не рвалась. Заливка больше CENSUS_MAX_CLASSIFY_CELLS клеток обрывается
+ * и записывается как часть большой области. Заливка, задевшая такую часть, тоже принадлежит большой
+ * области(целые компоненты других не касаются), она не записывается, а её клетки попадают в touched,
+ * чтобы не заливать их снова в этом Update
+ */
+void Census::AddComponent(int x, int y)
+{
+	bool touching = false;
+
+	flood.clear();
+	coords.clear();
+	stack.clear();
+	previous[WordOf(x, y)] &= ~BitOf(x);
+	flood.push_back(std::make_pair(x, y));
+	coords.push_back(std::make_pair(x, y));
+	stack.push_back(0);
+
+	while ( !stack.empty() && !touching && (flood.size() <= CENSUS_MAX_CLASSIFY_CELLS) )
+	{
+		int i = stack.back();
+		stack.pop_back();
+
+		int cx = flood[i].first;
+		int cy = flood[i].second;
+		int ux = coords[i].first;
+		int uy = coords[i].second;
+
+		for ( int dy = -CENSUS_RADIUS; dy <= CENSUS_RADIUS; ++dy )
+		{
+			int ny = cy + dy;
+			if ( toroidal )
+				ny = Wrap(ny, height);
+			else if ( (ny < 0) || (ny >= height) )
+				continue;
+
+			size_t row = size_t(ny) * row_words;
+			uint32_t fresh = Window(previous.data() + row, cx);
+			if ( fresh == 0 )
+				continue;
+			if ( (oversized_count > 0) && (fresh & Window(owned.data() + row, cx)) )
+			{
+				touching = true;
+				break;
+			}
+
+			while ( fresh )
+			{
+				int dx = ctz64(fresh) - CENSUS_RADIUS;
+				fresh &= fresh - 1;
+
+				int nx = toroidal ? Wrap(cx + dx, width) : cx + dx;
+				uint64_t& word = previous[row + nx / GRID_WORD_BITS];
+				uint64_t bit = BitOf(nx);
+				if ( !(word & bit) )
+					continue;
+
+				word &= ~bit;
+				stack.push_back(int(flood.size()));
+				flood.push_back(std::make_pair(nx, ny));
+				coords.push_back(std::make_pair(ux + dx, uy + dy));
+			}
+		}
+	}
+
+	// У оборванной заливки ещё не просмотренные клетки тоже не должны касаться других записей
+	if ( !touching && (oversized_count > 0) )
+		for ( int i : stack )
+			if ( IsTouching(flood[i].first, flood[i].second) )
+			{
+				touching = true;
+				break;
+			}
+
+	for ( auto& c : flood )
+		previous[WordOf(c.first, c.second)] |= BitOf(c.first);
+	work += (long long)flood.size();
+
+	if ( touching )
+	{
+		for ( auto& c : flood )
+		{
+			touched[WordOf(c.first, c.second)] |= BitOf(c.first);
+			touched_cells.push_back(c);
+		}
+		return;
+	}
+
+	int slot;
+	if ( free_components.empty() )
+	{
+		slot = int(components.size());
+		components.emplace_back();
+	}
+	else
+	{
+		slot = free_components.back();
+		free_components.pop_back();
+	}
+	Component& comp = components[slot];
+
+	int first = y * width + x;
+	for ( auto& c : flood )
+	{
+		owned[WordOf(c.first, c.second)] |= BitOf(c.first);
+		first = std::min(first, c.second * width + c.first);
+	}
+	labels[first] = slot + 1;
+	comp.size = int(flood.size());
+
+	if ( flood.size() > CENSUS_MAX_CLASSIFY_CELLS )
+	{
+		comp.type = -2;
+		++oversized_count;
+	}
+	else
+	{
+		comp.type = Classify(coords);
+		covered += comp.size;
+	}
+
+	if ( comp.type >= 0 )
+		++counts[comp.type];
+	else
+		++unknown_count;
+	++components_count;
+}
+
+/*
+ * Пересчитывает перепись для нового поколения. Изменившиеся клетки находятся XOR с позапрошлым поколением
+ * по словам и расширяются на CENSUS_RADIUS сдвигами слов и OR соседних строк; записи, задевающие
+ * эту окрестность, снимаются, живые клетки окрестности без записи заливаются заново.
+ * Компонента не может разорваться или слиться с другой вдали от изменившихся клеток,
+ * поэтому остальные компоненты остаются верными. force пересчитывает и отложенную перепись
+ */
+void Census::Update(const Grid& grid, bool force)
+{
+	if ( (grid.GetWidth() != width) || (grid.GetHeight() != height) || (grid.IsToroidal() != toroidal) )
+	{
+		toroidal = grid.IsToroidal();
+		Reset(grid.GetWidth(), grid.GetHeight());
+	}
+
+	if ( (deferred > 0) && !force )
+	{
+		--deferred;
+		stale = true;
+		return;
+	}
+	deferred = 0;
+	stale = false;
+
+	SwapLane();
+	for ( auto& c : touched_cells )
+		touched[WordOf(c.first, c.second)] &= ~BitOf(c.first);
+	touched_cells.clear();
+
+	examined = 0;
+	work = 0;
+	bool changed = false;
+	const uint64_t* mask = grid.GetTailMask();
+	for ( int y = 0; y < height; ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		uint64_t* prev = previous.data() + size_t(y) * row_words;
+		uint64_t any = 0;
+
+		// Большинство строк устоявшегося поля не меняется, их слова только читаются
+		for ( int i = 0; i < row_words; ++i )
+			any |= (row[i] & mask[i]) ^ prev[i];
+
+		rows_changed[y] = (any != 0);
+		if ( !any )
+			continue;
+
+		uint64_t* diff = changes.data() + size_t(y) * row_words;
+		for ( int i = 0; i < row_words; ++i )
+		{
+			uint64_t cur = row[i] & mask[i];
+			diff[i] = cur ^ prev[i];
+			if ( diff[i] )
+				population += popcount64(diff[i] & cur) - popcount64(diff[i] & prev[i]);
+			prev[i] = cur;
+		}
+
+		Spread(diff);
+		changed = true;
+	}
+
+	if ( !changed )
+		return;
+
+	// Окрестность по вертикали - OR строк y - CENSUS_RADIUS .. y + CENSUS_RADIUS, сразу снимаются задетые записи
+	for ( int y = 0; y < height; ++y )
+	{
+		size_t row = size_t(y) * row_words;
+		uint64_t* out = dirty.data() + row;
+		bool any = false;
+
+		for ( int dy = -CENSUS_RADIUS; dy <= CENSUS_RADIUS; ++dy )
+		{
+			int ny = y + dy;
+			if ( toroidal )
+				ny = Wrap(ny, height);
+			else if ( (ny < 0) || (ny >= height) )
+				continue;
+			if ( !rows_changed[ny] )
+				continue;
+
+			const uint64_t* diff = changes.data() + size_t(ny) * row_words;
+			if ( !any )
+				std::copy(diff, diff + row_words, out);
+			else
+				for ( int i = 0; i < row_words; ++i )
+					out[i] |= diff[i];
+			any = true;
+		}
+
+		rows_dirty[y] = any;
+		if ( !any )
+			continue;
+
+		for ( int i = 0; i < row_words; ++i )
+		{
+			uint64_t bits = out[i] & owned[row + i];
+			while ( bits )
+			{
+				RemoveComponent(i * GRID_WORD_BITS + ctz64(bits), y);
+				bits &= owned[row + i];
+			}
+		}
+	}
+
+	for ( int y = 0; y < height; ++y )
+	{
+		if ( !rows_dirty[y] )
+			continue;
+
+		size_t row = size_t(y) * row_words;
+		for ( int i = 0; i < row_words; ++i )
+		{
+			uint64_t bits = dirty[row + i] & previous[row + i];
+			while ( bits )
+			{
+				int b = ctz64(bits);
+				bits &= bits - 1;
+				if ( ((owned[row + i] | touched[row + i]) >> b) & 1 )
+					continue;
+
+				AddComponent(i * GRID_WORD_BITS + b, y);
+				++examined;
+			}
+		}
+	}
+
+	long long words = (long long)row_words * height;
+	deferred = int(std::min<long long>(CENSUS_MAX_DEFER, work * CENSUS_CELL_WORDS / words));
+}
+
+void Census::Print(std::ostream& out) const
+{
+	out << "Census: " << components_count << " objects";
+	for ( int kind = CENSUS_KIND_STILL_LIFE; kind <= CENSUS_KIND_UNKNOWN; ++kind )
+		out << ", " << censusKindName(kind) << ": " << CountKind(kind);
+	out << std::endl;
+
+	for ( size_t i = 0; i < objects.size(); ++i )
+		if ( counts[i] > 0 )
+			out << "  " << objects[i].name << ": " << counts[i] << std::endl;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef EDITQUEUE_CPP
+#define EDITQUEUE_CPP
+
+
+#include "../includes/EditQueue.hpp"
+
+
+EditQueue::EditQueue(size_t capacity)
+{
+	// Ёмкость округляется до степени двойки, чтобы индекс слота считался маской
+	size_t size = 2;
+	while ( size < capacity )
+		size <<= 1;
+
+	ring.resize(size);
+	mask = size - 1;
+	head.store(0, std::memory_order_relaxed);
+	tail.store(0, std::memory_order_relaxed);
+	cached_head = 0;
+	cached_tail = 0;
+}
+
+EditQueue::EditQueue(const EditQueue& eq)
+{
+}
+
+EditQueue::EditQueue(EditQueue&& eq)
+{
+}
+
+// Вызывается только писателем. Возвращает false, если очередь заполнена
+bool EditQueue::Push(const EditCommand& cmd)
+{
+	size_t t = tail.load(std::memory_order_relaxed);
+	if ( t - cached_head == ring.size() )
+	{
+		cached_head = head.load(std::memory_order_acquire);
+		if ( t - cached_head == ring.size() )
+			return false;
+	}
+
+	ring[t & mask] = cmd;
+	tail.store(t + 1, std::memory_order_release);
+
+	return true;
+}
+
+// Вызывается только читателем. Возвращает false, если очередь пуста
+bool EditQueue::Pop(EditCommand& cmd)
+{
+	size_t h = head.load(std::memory_order_relaxed);
+	if ( h == cached_tail )
+	{
+		cached_tail = tail.load(std::memory_order_acquire);
+		if ( h == cached_tail )
+			return false;
+	}
+
+	cmd = ring[h & mask];
+	head.store(h + 1, std::memory_order_release);
+
+	return true;
+}
+
+#endif
@@ -3,515 +3,647 @@
 
 
 #include "../includes/Game.hpp"
+#include "../includes/Resources.hpp"
+#include "../includes/Kernels.hpp"
+#include "../includes/Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
 
 
-int Cell::GetAliveNeighbours(void) const
+Field::Field() : cell_x_count(ceil(float(0) / 1)), cell_y_count(ceil(float(0) / 1))
 {
-	int alive_counter = 0;
+}
 
-	for ( auto& neighbour_addr : neighbours_addrs )
-	{
-		Cell* neighbour_cell = *neighbour_addr;
-		if ( neighbour_cell->GetState() == ALIVE_CELL )
-			alive_counter++;
-	}
+Field::Field(FieldParams fparams, SDL_Rect size, int f_type, const CellsAtlas* cells_atlas, SDL_Renderer* ren)
+	: cell_x_count((fparams.cells_x > 0) ? fparams.cells_x : int(ceil(float(fparams.width) / fparams.cparams.tile_size))),
+	  cell_y_count((fparams.cells_y > 0) ? fparams.cells_y : int(ceil(float(fparams.height) / fparams.cparams.tile_size)))
+{
+	params = fparams;
+
+	this->size.x = size.x;
+	this->size.y = size.y;
+	this->size.w = size.w;
+	this->size.h = size.h;
+	view.x = view.y = 0;
+
+	field_type = f_type;
+	atlas = cells_atlas;
+
+	max_cells_count = cell_x_count * cell_y_count;
+	UpdateView();
+
+	// Страницы поля и истории обнуляются системой при первом обращении, а не в конструкторе
+	grid = new Grid(cell_x_count, cell_y_count, field_type == FIELD_TYPE_TOR);
+	history = static_cast<uint64_t*>(allocAligned(size_t(grid->GetRowWords()) * cell_y_count * sizeof(uint64_t), GRID_ALIGNMENT));
+	seen_box = GridBox { 0, 0, 0, 0 };
+	rule = conwayRule();
+	step_kernel = getStepKernel(STEP_KERNEL_SWAR64);
+	workers = nullptr;
+	grid_placed = false;
+	grid_huge = false;
+	layer = FIELD_LAYER_CELLS;
+	layer_texture = nullptr;
+	layer_texture_size.x = layer_texture_size.y = layer_texture_size.w = layer_texture_size.h = 0;
+	empty_texture = nullptr;
+	empty_texture_size.x = empty_texture_size.y = empty_texture_size.w = empty_texture_size.h = 0;
+	empty_texture_failed = false;
+	lenia = nullptr;
+	lenia_brush = 1;
+
+	std::cout << "\nmax_cells_count   =   " << max_cells_count << std::endl;
+	std::cout << "cell_x_count      =   " << cell_x_count << std::endl;
+	std::cout << "cell_y_count      =   " << cell_y_count << "\n" << std::endl;
 
-	return alive_counter;
 }
 
-bool Cell::DoLifeCycle(void)
+Field::Field(const Field& f) : cell_x_count(ceil(float(0) / 1)), cell_y_count(ceil(float(0) / 1))
 {
-	int alives_count = GetAliveNeighbours();
-
-	if ( alives_count != 3 )
-	{
-		return true;
-	}
+}
 
-	return false;
+Field::Field(Field&& f) : cell_x_count(ceil(float(0) / 1)), cell_y_count(ceil(float(0) / 1))
+{
 }
 
-bool AliveCell::DoLifeCycle(void)
+Field::~Field()
 {
-	int alives_count = GetAliveNeighbours();
+	if ( grid )
+		delete grid;
 
-	if ( (alives_count < 2) || (alives_count > 3) )
-	{
-		return false;
-	}
+	if ( layer_texture )
+		cleanup(layer_texture);
 
-	return true;
+	if ( empty_texture )
+		cleanup(empty_texture);
+
+	if ( lenia )
+		delete lenia;
+
+	freeAligned(history);
 }
 
-bool DeadCell::DoLifeCycle(void)
+int Field::GetCellState(int x, int y) const
 {
-	int alives_count = GetAliveNeighbours();
+	if ( grid->GetCell(x, y) )
+		return ALIVE_CELL;
 
-	if ( alives_count != 3 )
-	{
-		return true;
-	}
+	uint64_t seen = history[size_t(y) * grid->GetRowWords() + x / GRID_WORD_BITS];
 
-	return false;
+	return ((seen >> (x % GRID_WORD_BITS)) & 1) ? DEAD_CELL : EMPTY_CELL;
 }
 
-Cell::Cell(CellParams cparams, const std::list<Cell**>& na_list, SDL_Rect area, int cell_state, int idx, SDL_Texture* tex, SDL_Renderer* ren)
+// Клетки лежат сеткой, поэтому индекс считается по координатам, без перебора клеток
+int Field::PointToIdx(SDL_Point p) const
 {
-	size.x = area.x;
-	size.y = area.y;
-	size.w = area.w;
-	size.h = area.h;
+	int tile_size = params.cparams.tile_size;
+	int dx = p.x - (CTRL_PANEL_WIDTH + OFFSET_X);
+	int dy = p.y - OFFSET_Y;
 
-	SetState(cell_state);
-	SetIndex(idx);
-	SetTextureObject(tex);
-	SetRenderer(ren);
+	if ( (dx < 0) || (dy < 0) )
+		return -1;
 
-	neighbours_addrs = na_list;
-	params = cparams;
+	int x = dx / tile_size;
+	int y = dy / tile_size;
+	if ( (x >= view.w) || (y >= view.h) )
+		return -1;
+
+	return (view.y + y) * cell_x_count + view.x + x;
 }
 
-void Cell::Render(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, int w, int h) const
+/*
+ * Выбирает, что показывает поле. Слои возраста и тепла требуют включённого слоя активности(--activity)
+ * и рисуются через палитру: возраст - от светло-зелёного(молодые клетки) к синему(старые),
+ * тепло - от чёрного через красный и жёлтый к белому(клетка только что изменилась)
+ */
+bool Field::SetLayer(int new_layer)
 {
-	if ( tex == nullptr || ren == nullptr )
+	if ( lenia )
 	{
-		std::cout << "[Cell::Render]" << "(" << this << "): " << "Unable to render cause texture or renderer objects have null pointer!" << std::endl;
-		return;
+		std::cout << "[Field::SetLayer](" << this << "): " << "Layers are not available in the continuous mode" << std::endl;
+		return false;
 	}
 
-	if ( (w < 1) || (h < 1) || (x < 0) || (y < 0) )
+	if ( (new_layer != FIELD_LAYER_CELLS) && !grid->HasActivity() )
 	{
-		std::cout << "[Cell::Render]" << "(" << this << "): " << "Params passed to render function have invalid values!" << std::endl;
-		return;
+		std::cout << "[Field::SetLayer](" << this << "): " << "The activity layer is disabled, run the game with --activity" << std::endl;
+		return false;
 	}
 
-	renderTexture(texture, renderer, x, y, w, h);
-}
-
-bool Cell::IsPointInCell(SDL_Point p)
-{
-	int a = size.x + size.w - 1;
-	int b = size.y + size.h - 1;
-
-	if	(
-			(p.x >= size.x) && (p.x <= a) &&
-			(p.y >= size.y) && (p.y <= b)
-		)
+	layer = new_layer;
+	for ( int v = 0; v <= ACTIVITY_MAX; ++v )
 	{
-		return true;
+		int r, g, b;
+		if ( layer == FIELD_LAYER_AGE )
+		{
+			int t = (v > 0) ? v - 1 : 0;
+			r = (v > 0) ? 160 - t * 160 / (ACTIVITY_MAX - 1) : 40;
+			g = (v > 0) ? 255 - t * 200 / (ACTIVITY_MAX - 1) : 40;
+			b = (v > 0) ? 80 + t * 175 / (ACTIVITY_MAX - 1) : 40;
+		}
+		else
+		{
+			r = std::min(v * 3, 255);
+			g = std::min(std::max(v * 3 - 255, 0), 255);
+			b = std::max(v * 3 - 510, 0);
+		}
+		palette[v] = 0xFF000000u | uint32_t(r) << 16 | uint32_t(g) << 8 | uint32_t(b);
 	}
 
-	return false;
+	return true;
 }
 
+bool Field::PlaceGrid(bool huge)
+{
+	grid_placed = true;
+	grid_huge = huge;
 
+	return grid->PlaceBuffers(huge, workers);
+}
 
+/*
+ * Включает непрерывный режим: поле Lenia того же размера в клетках(всегда замкнутое в тор) заменяет клетки.
+ * Значения рисуются палитрой от тёмно-синего через бирюзовый к жёлтому, правки мышью - круглой кистью
+ * в четверть радиуса ядра, чтобы нарисованное пятно было заметно для ядра
+ */
+bool Field::EnableContinuous(const LeniaParams& lparams)
+{
+	if ( lenia )
+		delete lenia;
 
+	lenia = new LeniaField(cell_x_count, cell_y_count, lparams);
+	lenia_brush = std::max(lparams.radius / 4, 1);
 
+	for ( int v = 0; v <= ACTIVITY_MAX; ++v )
+	{
+		double t = double(v) / ACTIVITY_MAX;
+		int r = int(255 * std::min(std::max(t * 2.0 - 1.0, 0.0), 1.0));
+		int g = int(40 + 215 * std::min(t * 1.5, 1.0));
+		int b = int(60 + 140 * (1.0 - std::abs(t * 2.0 - 1.0)));
+		palette[v] = 0xFF000000u | uint32_t(r) << 16 | uint32_t(g) << 8 | uint32_t(b);
+	}
 
+	std::cout << "Continuous mode: " << leniaParamsToString(lparams) << std::endl;
 
+	return true;
+}
 
-Field::Field() : cell_x_count(ceil(float(0) / 1)), cell_y_count(ceil(float(0) / 1))
+// Поле может быть больше области на экране: видна её часть с началом в клетке(x, y)
+void Field::SetView(int x, int y)
 {
+	view.x = x;
+	view.y = y;
+	UpdateView();
 }
 
-Field::Field(FieldParams fparams, SDL_Rect size, int f_type, SDL_Texture* tex, SDL_Renderer* ren)
-	: cell_x_count(ceil(float(fparams.width) / fparams.cparams.tile_size)), cell_y_count(ceil(float(fparams.height) / fparams.cparams.tile_size))
+void Field::UpdateView(void)
 {
-	params = fparams;
+	int tile_size = params.cparams.tile_size;
+	view.w = std::min(int(ceil(float(size.w) / tile_size)), cell_x_count);
+	view.h = std::min(int(ceil(float(size.h) / tile_size)), cell_y_count);
+	view.x = std::max(std::min(view.x, cell_x_count - view.w), 0);
+	view.y = std::max(std::min(view.y, cell_y_count - view.h), 0);
+}
 
-	this->size.x = size.x;
-	this->size.y = size.y;
-	this->size.w = size.w;
-	this->size.h = size.h;
+void Field::SetCell(int idx, int cell_state, SDL_Renderer* ren)
+{
+	if ( (idx < 0) || (idx >= max_cells_count) )
+		return;
 
-	field_type = f_type;
+	int x = idx % cell_x_count;
+	int y = idx / cell_x_count;
+	if ( GetCellState(x, y) == cell_state )
+	{
+		//std::cout << "Cell is already set!" << std::endl;
+		return;
+	}
 
-	max_cells_count = cell_x_count * cell_y_count;
-	cells_states = new int[max_cells_count];
-	cells_arr = new Cell*[max_cells_count];
+	uint64_t bit = uint64_t(1) << (x % GRID_WORD_BITS);
+	uint64_t& seen = history[size_t(y) * grid->GetRowWords() + x / GRID_WORD_BITS];
+	seen = (cell_state == DEAD_CELL) ? (seen | bit) : (seen & ~bit);
+	if ( cell_state == DEAD_CELL )
+		seen_box = uniteBoxes(seen_box, GridBox { x, y, x + 1, y + 1 });
+	grid->SetCell(x, y, cell_state == ALIVE_CELL);
 
-	int tile_size = fparams.cparams.tile_size;
+	RenderCell(ren, x, y, cell_state);
+}
 
-	for ( int i = 0; i < max_cells_count; ++i )
+// Живые клетки меняются так же, как при воспроизведении записи, затем поправляется история погибших клеток
+void Field::ApplyEdit(const EditCommand& cmd, SDL_Renderer* ren)
+{
+	if ( lenia )
 	{
-		SDL_Rect cell_area;
-		cell_area.x = i % cell_x_count * tile_size + CTRL_PANEL_WIDTH + OFFSET_X;
-		cell_area.y = i / cell_x_count * tile_size + OFFSET_Y;
-		cell_area.w = tile_size;
-		cell_area.h = tile_size;
+		ApplyContinuousEdit(cmd, ren);
+		return;
+	}
 
-		std::list<Cell**> neighbours_list = (field_type == FIELD_TYPE_WITH_BORDERS) ? GetNeighboursAddrs(i) : GetNeighboursAddrs2(i);
+	applyEditToGrid(cmd, *grid);
 
-		cells_arr[i] = new Cell(params.cparams, neighbours_list, cell_area, EMPTY_CELL, i, tex, ren);
-		cells_states[i] = EMPTY_CELL;
-		cells_arr[i]->Render(tex, ren, cell_area.x, cell_area.y, tile_size, tile_size);
+	switch ( cmd.type )
+	{
+		case EDIT_SET_CELL:
+		case EDIT_CLEAR_CELL:
+		case EDIT_FILL:
+		{
+			int w = (cmd.type == EDIT_FILL) ? cmd.w : 1;
+			int h = (cmd.type == EDIT_FILL) ? cmd.h : 1;
+			int x0 = std::max(cmd.x, 0);
+			int y0 = std::max(cmd.y, 0);
+			int x1 = int(std::min((long long)cmd.x + w, (long long)cell_x_count));
+			int y1 = int(std::min((long long)cmd.y + h, (long long)cell_y_count));
+			for ( int y = y0; y < y1; ++y )
+				for ( int x = x0; x < x1; ++x )
+					history[size_t(y) * grid->GetRowWords() + x / GRID_WORD_BITS] &= ~(uint64_t(1) << (x % GRID_WORD_BITS));
+			RenderArea(ren, x0, y0, x1 - x0, y1 - y0);
+			break;
+		}
+		case EDIT_STAMP:
+			if ( cmd.stamp )
+				RenderArea(ren, cmd.x, cmd.y, cmd.stamp->width, cmd.stamp->height);
+			break;
+		case EDIT_RANDOMIZE:
+			memset(history, 0, size_t(grid->GetRowWords()) * cell_y_count * sizeof(uint64_t));
+			seen_box = GridBox { 0, 0, 0, 0 };
+			Render(ren);
+			break;
 	}
+}
 
-	/*
-	for ( int i = 0; i < max_cells_count; ++i )
+// В непрерывном режиме живая клетка правки - значение 1, мёртвая - 0
+void Field::ApplyContinuousEdit(const EditCommand& cmd, SDL_Renderer* ren)
+{
+	switch ( cmd.type )
 	{
-		std::cout << "\n==============" << std::endl;
-		std::cout << "Cell #" << (i+1) << ":" << std::endl;
-		std::cout << "=============="<< std::endl;
-		std::cout << "(X,Y) = " << "(" << cells_arr[i]->GetX() << "," << cells_arr[i]->GetY() << ")" << std::endl;
-		std::cout << "State: " << cells_arr[i]->GetState() << std::endl;
-		std::cout << "Index: " << cells_arr[i]->GetIndex() << "\n" << std::endl;
+		case EDIT_SET_CELL:
+		case EDIT_CLEAR_CELL:
+			lenia->Paint(cmd.x, cmd.y, lenia_brush, (cmd.type == EDIT_SET_CELL) ? 1.0f : 0.0f);
+			break;
+		case EDIT_FILL:
+			lenia->Fill(cmd.x, cmd.y, cmd.w, cmd.h, cmd.alive ? 1.0f : 0.0f);
+			break;
+		case EDIT_STAMP:
+			if ( cmd.stamp )
+				for ( int y = 0; y < cmd.stamp->height; ++y )
+					for ( int x = 0; x < cmd.stamp->width; ++x )
+						if ( cmd.stamp->cells[size_t(y) * cmd.stamp->width + x] )
+							lenia->SetCell((cmd.x + x + cell_x_count) % cell_x_count, (cmd.y + y + cell_y_count) % cell_y_count, 1.0f);
+			break;
+		case EDIT_RANDOMIZE:
+			lenia->Randomize(cmd.density, cmd.seed);
+			break;
 	}
-	*/
-
-	std::cout << "\nmax_cells_count   =   " << max_cells_count << std::endl;
-	std::cout << "cell_x_count      =   " << cell_x_count << std::endl;
-	std::cout << "cell_y_count      =   " << cell_y_count << "\n" << std::endl;
 
+	lenia->UpdateMass();
+	Render(ren);
 }
 
-Field::Field(const Field& f) : cell_x_count(ceil(float(0) / 1)), cell_y_count(ceil(float(0) / 1))
+/*
+ * Применяет все накопленные правки. Вызывается на границе поколений generation,
+ * каждая применённая правка попадает в запись сессии. Возвращает число применённых команд
+ */
+int Field::ApplyEdits(EditQueue& queue, SDL_Renderer* ren, ReplayRecorder* recorder, long long generation)
 {
-}
+	int applied = 0;
+	EditCommand cmd;
+	while ( queue.Pop(cmd) )
+	{
+		ApplyEdit(cmd, ren);
+		if ( recorder )
+			recorder->RecordEdit(generation, cmd);
+		++applied;
+	}
 
-Field::Field(Field&& f) : cell_x_count(ceil(float(0) / 1)), cell_y_count(ceil(float(0) / 1))
-{
+	return applied;
 }
 
-Field::~Field()
+// Показывает записанное поколение: поле восстанавливается из истории, история погибших клеток не меняется
+bool Field::ShowGeneration(const Timeline& timeline, long long generation, SDL_Renderer* ren)
 {
-	if ( cells_states )
-		delete[] cells_states;
+	if ( !timeline.Seek(generation, *grid) )
+		return false;
 
-	for ( int i = 0; i < max_cells_count; ++i )
-		if ( cells_arr[i] )
-			delete cells_arr[i];
+	Render(ren);
 
-	if ( cells_arr )
-		delete[] cells_arr;
+	return true;
 }
 
-int Field::PointToIdx(SDL_Point p) const
+bool Field::CheckCellsStates(SDL_Renderer* ren)
 {
-	for ( int i = 0; i < max_cells_count; ++i )
+	if ( lenia )
+	{
+		bool changed = false;
+		{
+			TRACE_ZONE("Step");
+			changed = lenia->Step(workers);
+		}
+		{
+			TRACE_ZONE("RenderCells");
+			Render(ren);
+		}
+
+		return (lenia->GetMass() == 0) || !changed;
+	}
+
+	// Клетки текущего поколения попадают в историю до шага: те из них, что погибнут, станут красными.
+	// Вне рамки живых клеток слова поля нулевые, их можно не читать
+	GridBox live = grid->GetLiveBox();
+	int row_words = grid->GetRowWords();
+	const uint64_t* mask = grid->GetTailMask();
+	int word_begin = live.x0 / GRID_WORD_BITS;
+	int word_end = isBoxEmpty(live) ? word_begin : (live.x1 + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	for ( int y = live.y0; y < live.y1; ++y )
 	{
-		if ( cells_arr[i]->IsPointInCell(p) )
-			return i;
+		const uint64_t* row = grid->GetRow(y);
+		uint64_t* seen = history + size_t(y) * row_words;
+		for ( int i = word_begin; i < word_end; ++i )
+			seen[i] |= row[i] & mask[i];
 	}
+	seen_box = uniteBoxes(seen_box, live);
 
-	return -1;
+	bool field_changed_state = false;
+	{
+		TRACE_ZONE("Step");
+		field_changed_state = grid->Step(rule, step_kernel, workers);
+	}
+
+	{
+		TRACE_ZONE("RenderCells");
+		Render(ren);
+	}
+
+	return (grid->CountPopulation() == 0) || (!field_changed_state);
 }
 
-void Field::SetCell(int idx, int cell_state, SDL_Texture* cell_tex, SDL_Renderer* ren)
+/*
+ * Меняет размер поля на ходу: упакованные строки поля и истории переносятся блоками,
+ * точка anchor остаётся на месте, клетки за новыми границами теряются
+ */
+bool Field::Resize(FieldParams fparams, SDL_Rect new_size, int anchor)
 {
-	for ( int i = 0; i < max_cells_count; ++i )
+	// Размер поля задан в клетках: меняется только видимая часть
+	if ( fparams.cells_x > 0 )
 	{
-		if ( i == idx )
-		{
-			if ( cells_arr[i]->GetState() == cell_state )
-			{
-				//std::cout << "Cell is already set!" << std::endl;
-				return;
-			}
+		params = fparams;
+		size = new_size;
+		UpdateView();
+		std::cout << "View resized to " << view.w << "x" << view.h << " cells" << std::endl;
 
-			SDL_Rect cell_area = cells_arr[i]->GetArea();
-			std::list<Cell**> neighbours_list = (field_type == FIELD_TYPE_WITH_BORDERS) ? GetNeighboursAddrs(i) : GetNeighboursAddrs2(idx);
+		return true;
+	}
 
-			Cell* new_cell = nullptr;
-			if ( cell_state == ALIVE_CELL )
-				new_cell = new AliveCell(params.cparams, neighbours_list, cell_area, cell_state, idx, cell_tex, ren);
-			else if ( cell_state == DEAD_CELL )
-				new_cell = new DeadCell(params.cparams, neighbours_list, cell_area, cell_state, idx, cell_tex, ren);
-			else
-				new_cell = new Cell(params.cparams, neighbours_list, cell_area, cell_state, idx, cell_tex, ren);
+	int tile_size = fparams.cparams.tile_size;
+	int new_x_count = ceil(float(fparams.width) / tile_size);
+	int new_y_count = ceil(float(fparams.height) / tile_size);
 
-			Cell* tmp = cells_arr[i];
-			delete tmp;
+	int old_row_words = grid->GetRowWords();
+	if ( !grid->Resize(new_x_count, new_y_count, anchor) )
+		return false;
 
-			cells_arr[i] = new_cell;
-			cells_states[i] = cell_state;
-			int tile_size = params.cparams.tile_size;
-			cells_arr[i]->Render(cell_tex, ren, cell_area.x, cell_area.y, tile_size, tile_size);
-			return;
-		}
+	// Resize выделяет буферы в вызывающем потоке: полосы снова переносятся к своим исполнителям
+	if ( grid_placed )
+		grid->PlaceBuffers(grid_huge, workers);
+
+	int dx, dy;
+	getAnchorOffset(anchor, cell_x_count, cell_y_count, new_x_count, new_y_count, dx, dy);
+
+	int row_words = grid->GetRowWords();
+	uint64_t* new_history = static_cast<uint64_t*>(allocAligned(size_t(row_words) * new_y_count * sizeof(uint64_t), GRID_ALIGNMENT));
+	int src_x = (dx < 0) ? -dx : 0;
+	int src_y = (dy < 0) ? -dy : 0;
+	int dst_x = (dx > 0) ? dx : 0;
+	int dst_y = (dy > 0) ? dy : 0;
+	copyBitBlock(history, old_row_words, cell_x_count, src_x, src_y, new_history, row_words, dst_x, dst_y,
+			std::min(cell_x_count - src_x, new_x_count - dst_x), std::min(cell_y_count - src_y, new_y_count - dst_y));
+	freeAligned(history);
+	history = new_history;
+
+	// Рамка погибших клеток сдвигается вместе с историей и обрезается новыми границами
+	if ( !isBoxEmpty(seen_box) )
+	{
+		seen_box.x0 = std::max(seen_box.x0 + dx, 0);
+		seen_box.y0 = std::max(seen_box.y0 + dy, 0);
+		seen_box.x1 = std::min(seen_box.x1 + dx, new_x_count);
+		seen_box.y1 = std::min(seen_box.y1 + dy, new_y_count);
 	}
+
+	params = fparams;
+	size = new_size;
+	cell_x_count = new_x_count;
+	cell_y_count = new_y_count;
+	max_cells_count = cell_x_count * cell_y_count;
+	UpdateView();
+
+	if ( lenia )
+		lenia->Resize(new_x_count, new_y_count, anchor);
+
+	std::cout << "Field resized to " << cell_x_count << "x" << cell_y_count << " cells" << std::endl;
+
+	return true;
 }
 
-bool Field::CheckCellsStates(SDL_Texture* alive_cell_tex, SDL_Texture* dead_cell_tex, SDL_Renderer* ren)
+void Field::RenderCell(SDL_Renderer* ren, int x, int y, int cell_state) const
 {
-	int dead_cells_count = 0;
-	bool field_changed_state = false;
-	bool finish_simulation = false;
+	if ( (x < view.x) || (x >= view.x + view.w) || (y < view.y) || (y >= view.y + view.h) )
+		return;
 
+	int tile_size = params.cparams.tile_size;
+	SDL_Rect dst { (x - view.x) * tile_size + CTRL_PANEL_WIDTH + OFFSET_X, (y - view.y) * tile_size + OFFSET_Y, tile_size, tile_size };
 
-	for ( int i = 0; i < max_cells_count; ++i )
+	SDL_RenderCopy(ren, atlas->texture, &atlas->clips[cell_state], &dst);
+}
+
+/*
+ * Видимые клетки рисуются за один проход по упакованным строкам: живые и история читаются целыми словами.
+ * Вне рамок живых и погибших клеток поле пустое, эта часть рисуется одной текстурой пустых клеток
+ */
+void Field::Render(SDL_Renderer* ren) const
+{
+	if ( (atlas == nullptr) || (ren == nullptr) )
 	{
-		int state = cells_arr[i]->GetState();
-		bool dlc = cells_arr[i]->DoLifeCycle();
-		SDL_Rect cell_area = cells_arr[i]->GetArea();
-		std::list<Cell**> neighbours_list = (field_type == FIELD_TYPE_WITH_BORDERS) ? GetNeighboursAddrs(i) : GetNeighboursAddrs2(i);
-		int tile_size = params.cparams.tile_size;
+		std::cout << "[Field::Render]" << "(" << this << "): " << "Unable to render cause atlas or renderer objects have null pointer!" << std::endl;
+		return;
+	}
 
+	if ( lenia || (layer != FIELD_LAYER_CELLS) )
+	{
+		RenderLayer(ren);
+		return;
+	}
 
-		if ( state == ALIVE_CELL )
-		{
-			if ( !dlc )
-			{
-				DeadCell* new_cell = new DeadCell(params.cparams, neighbours_list, cell_area, DEAD_CELL, i, dead_cell_tex, ren);
+	int tile_size = params.cparams.tile_size;
+	int row_words = grid->GetRowWords();
 
-				AliveCell* tmp = dynamic_cast<AliveCell*>(cells_arr[i]);
-				delete tmp;
+	GridBox area { view.x, view.y, view.x + view.w, view.y + view.h };
+	if ( PrepareEmptyTexture(ren) )
+	{
+		SDL_Rect view_dst { CTRL_PANEL_WIDTH + OFFSET_X, OFFSET_Y, view.w * tile_size, view.h * tile_size };
+		SDL_RenderCopy(ren, empty_texture, nullptr, &view_dst);
+
+		GridBox cells = uniteBoxes(seen_box, grid->GetLiveBox());
+		area.x0 = std::max(area.x0, cells.x0);
+		area.y0 = std::max(area.y0, cells.y0);
+		area.x1 = std::min(area.x1, cells.x1);
+		area.y1 = std::min(area.y1, cells.y1);
+		if ( isBoxEmpty(area) )
+			return;
+	}
 
-				cells_arr[i] = new_cell;
-				cells_states[i] = DEAD_CELL;
-				cells_arr[i]->Render(dead_cell_tex, ren, cell_area.x, cell_area.y, tile_size, tile_size);
-				field_changed_state = true;
-				++dead_cells_count;
-			}
-			else
-			{
-				cells_arr[i]->Render(alive_cell_tex, ren, cell_area.x, cell_area.y, tile_size, tile_size);
-			}
+	SDL_Rect dst { 0, OFFSET_Y + (area.y0 - view.y) * tile_size, tile_size, tile_size };
+	int x_end = area.x1;
 
-			continue;
-		}
+	for ( int y = area.y0; y < area.y1; ++y, dst.y += tile_size )
+	{
+		const uint64_t* row = grid->GetRow(y);
+		const uint64_t* seen = history + size_t(y) * row_words;
+		dst.x = CTRL_PANEL_WIDTH + OFFSET_X + (area.x0 - view.x) * tile_size;
 
-		if ( (state == DEAD_CELL) || (state == EMPTY_CELL) )
+		for ( int i = area.x0 / GRID_WORD_BITS; i * GRID_WORD_BITS < x_end; ++i )
 		{
-			if ( !dlc )
-			{
-				AliveCell* new_cell = new AliveCell(params.cparams, neighbours_list, cell_area, ALIVE_CELL, i, alive_cell_tex, ren);
+			uint64_t alive = row[i];
+			uint64_t dead = seen[i] & ~alive;
+			int b_begin = std::max(area.x0 - i * GRID_WORD_BITS, 0);
+			int b_end = std::min(x_end - i * GRID_WORD_BITS, int(GRID_WORD_BITS));
 
-				if ( state == DEAD_CELL )
-				{
-					DeadCell* tmp = dynamic_cast<DeadCell*>(cells_arr[i]);
-					delete tmp;
-				}
-				else
-				{
-					Cell* tmp = cells_arr[i];
-					delete tmp;
-				}
-
-				cells_arr[i] = new_cell;
-				cells_states[i] = ALIVE_CELL;
-				cells_arr[i]->Render(alive_cell_tex, ren, cell_area.x, cell_area.y, tile_size, tile_size);
-				field_changed_state = true;
-			}
-			else
+			for ( int b = b_begin; b < b_end; ++b, dst.x += tile_size )
 			{
-				cells_arr[i]->Render(dead_cell_tex, ren, cell_area.x, cell_area.y, tile_size, tile_size);
-				++dead_cells_count;
+				int state = ((alive >> b) & 1) ? ALIVE_CELL : (((dead >> b) & 1) ? DEAD_CELL : EMPTY_CELL);
+				SDL_RenderCopy(ren, atlas->texture, &atlas->clips[state], &dst);
 			}
 		}
 	}
-
-	if ( (dead_cells_count >= max_cells_count) || (!field_changed_state) )
-		finish_simulation = true;
-
-	return finish_simulation;
 }
 
-std::list<Cell**> Field::GetNeighboursAddrs(int cell_idx)
+// Текстура-цель с пустыми клетками видимой части, пересоздаётся при смене видимой части или размера клетки
+bool Field::PrepareEmptyTexture(SDL_Renderer* ren) const
 {
-	std::list<Cell**> addresses;
+	int tile_size = params.cparams.tile_size;
+	if ( empty_texture_failed )
+		return false;
+	if ( empty_texture && (empty_texture_size.w == view.w) && (empty_texture_size.h == view.h) && (empty_texture_size.x == tile_size) )
+		return true;
 
-	switch ( GetCellPosByIdx(cell_idx) )
+	if ( empty_texture )
+		cleanup(empty_texture);
+
+	empty_texture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, view.w * tile_size, view.h * tile_size);
+	if ( (empty_texture == nullptr) || (SDL_SetRenderTarget(ren, empty_texture) != 0) )
 	{
-		case CELL_POS_LEFT_TOP_CORNER:
-			addresses.push_back(cells_arr + 1);
-			addresses.push_back(cells_arr + cell_x_count);
-			addresses.push_back(cells_arr + cell_x_count + 1);
-			break;
-		case CELL_POS_RIGHT_TOP_CORNER:
-			addresses.push_back(cells_arr + cell_x_count - 1 - 1);
-			addresses.push_back(cells_arr + cell_x_count - 1 + cell_x_count);
-			addresses.push_back(cells_arr + cell_x_count - 1 + cell_x_count - 1);
-			break;
-		case CELL_POS_LEFT_BOTTOM_CORNER:
-			{
-				Cell** lbc = cells_arr + max_cells_count - cell_x_count;
-				addresses.push_back(lbc + 1);
-				addresses.push_back(lbc - cell_x_count);
-				addresses.push_back(lbc - cell_x_count + 1);
-			}
-			break;
-		case CELL_POS_RIGHT_BOTTOM_CORNER:
-			addresses.push_back(cells_arr + max_cells_count - 1 - 1);
-			addresses.push_back(cells_arr + max_cells_count - 1 - cell_x_count);
-			addresses.push_back(cells_arr + max_cells_count - 1 - cell_x_count - 1);
-			break;
-		case CELL_POS_TOP_EDGE:
-			addresses.push_back(cells_arr + cell_idx - 1);
-			addresses.push_back(cells_arr + cell_idx + 1);
-			addresses.push_back(cells_arr + cell_idx - 1 + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + 1 + cell_x_count);
-			break;
-		case CELL_POS_BOTTOM_EDGE:
-			addresses.push_back(cells_arr + cell_idx - 1);
-			addresses.push_back(cells_arr + cell_idx + 1);
-			addresses.push_back(cells_arr + cell_idx - 1 - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + 1 - cell_x_count);
-			break;
-		case CELL_POS_LEFT_EDGE:
-			addresses.push_back(cells_arr + cell_idx - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count + 1);
-			addresses.push_back(cells_arr + cell_idx + 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count + 1);
-			break;
-		case CELL_POS_RIGHT_EDGE:
-			addresses.push_back(cells_arr + cell_idx - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_idx - 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count - 1);
-			break;
-		case CELL_POS_INNER:
-			addresses.push_back(cells_arr + cell_idx - 1);
-			addresses.push_back(cells_arr + cell_idx + 1);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count + 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count + 1);
+		logSDLError(std::cout, "[Field::PrepareEmptyTexture] Render target: ");
+		if ( empty_texture )
+			cleanup(empty_texture);
+		empty_texture = nullptr;
+		empty_texture_failed = true;
+		return false;
 	}
 
-	return addresses;
+	// Под клетками - цвет очистки экрана, как при рисовании клеток прямо на экран
+	SDL_RenderClear(ren);
+	SDL_Rect dst { 0, 0, tile_size, tile_size };
+	for ( dst.y = 0; dst.y < view.h * tile_size; dst.y += tile_size )
+		for ( dst.x = 0; dst.x < view.w * tile_size; dst.x += tile_size )
+			SDL_RenderCopy(ren, atlas->texture, &atlas->clips[EMPTY_CELL], &dst);
+	SDL_SetRenderTarget(ren, nullptr);
+
+	empty_texture_size.x = tile_size;
+	empty_texture_size.w = view.w;
+	empty_texture_size.h = view.h;
+
+	return true;
 }
 
-std::list<Cell**> Field::GetNeighboursAddrs2(int cell_idx)
+// Видимая часть слоя активности(или непрерывного поля): байты слоя переводятся через палитру в потоковую текстуру, растягиваемую на поле
+void Field::RenderLayer(SDL_Renderer* ren) const
 {
-	std::list<Cell**> addresses;
+	if ( (layer_texture == nullptr) || (layer_texture_size.w != view.w) || (layer_texture_size.h != view.h) )
+	{
+		if ( layer_texture )
+			cleanup(layer_texture);
 
-	switch ( GetCellPosByIdx(cell_idx) )
+		layer_texture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, view.w, view.h);
+		if ( layer_texture == nullptr )
+		{
+			logSDLError(std::cout, "[Field::RenderLayer] SDL_CreateTexture: ");
+			return;
+		}
+		layer_texture_size.w = view.w;
+		layer_texture_size.h = view.h;
+		layer_pixels.resize(size_t(view.w) * view.h);
+	}
+
+	for ( int y = 0; lenia && (y < view.h); ++y )
 	{
-		case CELL_POS_LEFT_TOP_CORNER:
-			addresses.push_back(cells_arr + 1);
-			addresses.push_back(cells_arr + cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_x_count - 1 + cell_x_count);
-			addresses.push_back(cells_arr + max_cells_count - 1);
-			addresses.push_back(cells_arr + max_cells_count - cell_x_count);
-			addresses.push_back(cells_arr + max_cells_count - cell_x_count + 1);
-			addresses.push_back(cells_arr + cell_x_count);
-			addresses.push_back(cells_arr + cell_x_count + 1);
-			break;
-		case CELL_POS_RIGHT_TOP_CORNER:
-			addresses.push_back(cells_arr + cell_x_count - 1 - 1);
-			addresses.push_back(cells_arr + cell_x_count - 1 + cell_x_count);
-			addresses.push_back(cells_arr + cell_x_count - 1 + cell_x_count - 1);
-			addresses.push_back(cells_arr);
-			addresses.push_back(cells_arr + cell_x_count);
-			addresses.push_back(cells_arr + max_cells_count - cell_x_count);
-			addresses.push_back(cells_arr + max_cells_count - 1);
-			addresses.push_back(cells_arr + max_cells_count - 1 - 1);
-			break;
-		case CELL_POS_LEFT_BOTTOM_CORNER:
-			{
-				Cell** lbc = cells_arr + max_cells_count - cell_x_count;
-				addresses.push_back(lbc + 1);
-				addresses.push_back(lbc - cell_x_count);
-				addresses.push_back(lbc - cell_x_count + 1);
-				addresses.push_back(cells_arr);
-				addresses.push_back(cells_arr + 1);
-				addresses.push_back(cells_arr + cell_x_count - 1);
-				addresses.push_back(cells_arr + max_cells_count - 1);
-				addresses.push_back(cells_arr + max_cells_count - 1 - cell_x_count);
-			}
-			break;
-		case CELL_POS_RIGHT_BOTTOM_CORNER:
-			{
-				Cell** rbc = cells_arr + max_cells_count - 1;
-				addresses.push_back(rbc - 1);
-				addresses.push_back(rbc - cell_x_count);
-				addresses.push_back(rbc - cell_x_count - 1);
-				addresses.push_back(rbc + 1 - cell_x_count - cell_x_count);
-				addresses.push_back(rbc + 1 - cell_x_count);
-				addresses.push_back(cells_arr);
-				addresses.push_back(cells_arr + cell_x_count - 1);
-				addresses.push_back(cells_arr + cell_x_count - 1 - 1);
-			}
-			break;
-		case CELL_POS_TOP_EDGE:
-			addresses.push_back(cells_arr + cell_idx - 1);
-			addresses.push_back(cells_arr + cell_idx + 1);
-			addresses.push_back(cells_arr + cell_idx - 1 + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + 1 + cell_x_count);
-			addresses.push_back(cells_arr + max_cells_count - cell_x_count + cell_idx - 1);
-			addresses.push_back(cells_arr + max_cells_count - cell_x_count + cell_idx);
-			addresses.push_back(cells_arr + max_cells_count - cell_x_count + cell_idx + 1);
-			break;
-		case CELL_POS_BOTTOM_EDGE:
-			addresses.push_back(cells_arr + cell_idx - 1);
-			addresses.push_back(cells_arr + cell_idx + 1);
-			addresses.push_back(cells_arr + cell_idx - 1 - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + 1 - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - (max_cells_count - cell_x_count));
-			addresses.push_back(cells_arr + cell_idx - (max_cells_count - cell_x_count) - 1);
-			addresses.push_back(cells_arr + cell_idx - (max_cells_count - cell_x_count) + 1);
-			break;
-		case CELL_POS_LEFT_EDGE:
-			addresses.push_back(cells_arr + cell_idx - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count + 1);
-			addresses.push_back(cells_arr + cell_idx + 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count + 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count - 1 + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count - 1 - cell_x_count);
-			break;
-		case CELL_POS_RIGHT_EDGE:
-			addresses.push_back(cells_arr + cell_idx - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_idx - 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count + 1);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count + 1 - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count + 1 + cell_x_count);
-			break;
-		case CELL_POS_INNER:
-			addresses.push_back(cells_arr + cell_idx - 1);
-			addresses.push_back(cells_arr + cell_idx + 1);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_idx - cell_x_count + 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count - 1);
-			addresses.push_back(cells_arr + cell_idx + cell_x_count + 1);
+		const float* values = lenia->GetRow(view.y + y) + view.x;
+		uint32_t* pixels = layer_pixels.data() + size_t(y) * view.w;
+		for ( int x = 0; x < view.w; ++x )
+			pixels[x] = palette[int(values[x] * ACTIVITY_MAX + 0.5f)];
+	}
+
+	for ( int y = 0; !lenia && (y < view.h); ++y )
+	{
+		const unsigned char* values = ((layer == FIELD_LAYER_AGE) ? grid->GetAgeRow(view.y + y) : grid->GetHeatRow(view.y + y)) + view.x;
+		uint32_t* pixels = layer_pixels.data() + size_t(y) * view.w;
+		for ( int x = 0; x < view.w; ++x )
+			pixels[x] = palette[values[x]];
 	}
+	SDL_UpdateTexture(layer_texture, nullptr, layer_pixels.data(), view.w * int(sizeof(uint32_t)));
 
-	return addresses;
+	int tile_size = params.cparams.tile_size;
+	SDL_Rect dst { CTRL_PANEL_WIDTH + OFFSET_X, OFFSET_Y, view.w * tile_size, view.h * tile_size };
+	SDL_RenderCopy(ren, layer_texture, nullptr, &dst);
 }
 
-int Field::GetCellPosByIdx(int cell_idx)
+// Перерисовывает клетки прямоугольника(на торе с переносом через край), цена - O(площади прямоугольника)
+void Field::RenderArea(SDL_Renderer* ren, int x, int y, int w, int h) const
 {
-	if ( cell_idx == 0 )
-		return CELL_POS_LEFT_TOP_CORNER;
-
-	if ( cell_idx == (cell_x_count-1) )
-		return CELL_POS_RIGHT_TOP_CORNER;
-
-	if ( cell_idx == (max_cells_count-1) )
-		return CELL_POS_RIGHT_BOTTOM_CORNER;
+	// Слой активности и непрерывное поле перерисовываются целиком одной текстурой
+	if ( lenia || (layer != FIELD_LAYER_CELLS) )
+	{
+		Render(ren);
+		return;
+	}
 
-	if ( cell_idx == (max_cells_count-cell_x_count) )
-		return CELL_POS_LEFT_BOTTOM_CORNER;
+	for ( int j = 0; j < h; ++j )
+		for ( int i = 0; i < w; ++i )
+		{
+			int cx = x + i;
+			int cy = y + j;
+			if ( field_type == FIELD_TYPE_TOR )
+			{
+				cx = ((cx % cell_x_count) + cell_x_count) % cell_x_count;
+				cy = ((cy % cell_y_count) + cell_y_count) % cell_y_count;
+			}
+			else if ( (cx < 0) || (cx >= cell_x_count) || (cy < 0) || (cy >= cell_y_count) )
+				continue;
 
-	if ( (cell_idx % cell_x_count) == 0 )
-		return CELL_POS_LEFT_EDGE;
+			RenderCell(ren, cx, cy, GetCellState(cx, cy));
+		}
+}
 
-	if ( ((cell_idx+1) % cell_x_count) == 0 )
-		return CELL_POS_RIGHT_EDGE;
+// Рисует живые клетки шаблона полупрозрачными поверх поля, само поле не перерисовывается
+void Field::RenderStamp(SDL_Renderer* ren, const Stamp* stamp, int x, int y, unsigned char alpha) const
+{
+	if ( (stamp == nullptr) || (atlas == nullptr) )
+		return;
 
-	if ( (cell_idx > 0) && (cell_idx < cell_x_count-1) )
-		return CELL_POS_TOP_EDGE;
+	SDL_SetTextureAlphaMod(atlas->texture, alpha);
+	for ( int j = 0; j < stamp->height; ++j )
+		for ( int i = 0; i < stamp->width; ++i )
+		{
+			if ( !stamp->cells[size_t(j) * stamp->width + i] )
+				continue;
 
-	if ( (cell_idx > max_cells_count-cell_x_count) && (cell_idx < max_cells_count-1) )
-		return CELL_POS_BOTTOM_EDGE;
+			int cx = x + i;
+			int cy = y + j;
+			if ( field_type == FIELD_TYPE_TOR )
+			{
+				cx = ((cx % cell_x_count) + cell_x_count) % cell_x_count;
+				cy = ((cy % cell_y_count) + cell_y_count) % cell_y_count;
+			}
+			else if ( (cx < 0) || (cx >= cell_x_count) || (cy < 0) || (cy >= cell_y_count) )
+				continue;
 
-	return CELL_POS_INNER;
+			RenderCell(ren, cx, cy, ALIVE_CELL);
+		}
+	SDL_SetTextureAlphaMod(atlas->texture, 255);
 }
 
 
@@ -529,7 +661,29 @@ Game::Game()
 	renderer = nullptr;
 	textures_list = nullptr;
 	textures_list_size = 0;
+	cells_atlas.texture = nullptr;
 	field = nullptr;
+	workers = nullptr;
+	capture_params.format = CAPTURE_FORMAT_NONE;
+	capture_params.cell_pixels = DEFAULT_TILE_SIZE;
+	capture_params.lossless = false;
+	capture = nullptr;
+	publisher = nullptr;
+	server = nullptr;
+	edits = new EditQueue(EDIT_QUEUE_SIZE);
+	stamp_index = 0;
+	stamp_orientation = 0;
+	stamp_preview = false;
+	stamp_cursor.x = stamp_cursor.y = 0;
+	preview_area.x = preview_area.y = preview_area.w = preview_area.h = 0;
+	paint_cell.x = paint_cell.y = -1;
+	paint_type = EDIT_SET_CELL;
+	timeline_params.keyframe_interval = TIMELINE_DEFAULT_KEYFRAME_INTERVAL;
+	timeline_params.budget = size_t(TIMELINE_DEFAULT_BUDGET_MB) << 20;
+	timeline = nullptr;
+	timeline_dirty = false;
+	recorder = nullptr;
+	minimap = nullptr;
 }
 
 Game::Game(const Game& g)
@@ -542,15 +696,41 @@ Game::Game(Game&& g)
 
 Game::~Game()
 {
-	for ( int i = 0; i < TEXTURES_COUNT; ++i )
-		cleanup(const_cast<SDL_Texture*>(textures_list[i]));
+	if ( capture )
+		delete capture;
+
+	if ( publisher )
+		delete publisher;
+
+	if ( server )
+		delete server;
+
+	if ( edits )
+		delete edits;
+
+	if ( timeline )
+		delete timeline;
+
+	if ( recorder )
+		delete recorder;
 
 	if ( textures_list )
+	{
+		for ( int i = 0; i < TEXTURES_COUNT; ++i )
+			cleanup(const_cast<SDL_Texture*>(textures_list[i]));
+
 		delete[] textures_list;
+	}
 
 	if ( field )
 		delete field;
 
+	if ( minimap )
+		delete minimap;
+
+	if ( workers )
+		delete workers;
+
 	cleanup(renderer, window);
 
 	TTF_Quit();
@@ -591,7 +771,7 @@ SDL_Window* Game::CreateWindow(const char* window_name, int screen_width, int sc
 {
 	// Создаём окно рабочей области
 	window = SDL_CreateWindow(window_name, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-			screen_width, screen_height, SDL_WINDOW_SHOWN);
+			screen_width, screen_height, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
 	if ( window == nullptr )
 	{
 		logSDLError(std::cout, "SDL_CreateWindow Error: ");
@@ -600,6 +780,7 @@ SDL_Window* Game::CreateWindow(const char* window_name, int screen_width, int sc
 		SDL_Quit();
 		return nullptr;
 	}
+	SDL_SetWindowMinimumSize(window, MIN_FIELD_WIDTH + CTRL_PANEL_WIDTH + OFFSET_X * 2, MIN_WORKSPACE_HEIGHT + OFFSET_Y * 2);
 
 	return window;
 }
@@ -629,15 +810,13 @@ const SDL_Texture** Game::LoadTextures(const char* textures_path, int textures_l
 		return nullptr;
 	}
 
-	std::string res_path = getResourcePath(textures_path);
+	// Без textures_path текстуры берутся только из встроенных ресурсов, файлы не читаются
 	textures_list = new const SDL_Texture*[textures_list_size]
 	{
-			loadTexture(res_path + "background_frame.png", renderer),
-			loadTexture(res_path + "control_panel_frame.png", renderer),
-			loadTexture(res_path + "control_panel.png", renderer),
-			loadTexture(res_path + "cell.png", renderer),
-			loadTexture(res_path + "alive_cell.png", renderer),
-			loadTexture(res_path + "dead_cell.png", renderer)
+			loadTexture(openResource(textures_path, "background_frame.png"), renderer),
+			loadTexture(openResource(textures_path, "control_panel_frame.png"), renderer),
+			loadTexture(openResource(textures_path, "control_panel.png"), renderer),
+			LoadCellsAtlas(textures_path)
 	};
 	this->textures_list_size = textures_list_size;
 
@@ -666,6 +845,35 @@ const SDL_Texture** Game::LoadTextures(const char* textures_path, int textures_l
 	return textures_list;
 }
 
+// Текстуры клеток всех состояний собираются в один атлас, клетки рисуются его областями
+SDL_Texture* Game::LoadCellsAtlas(const char* textures_path)
+{
+	const char* names[CELL_STATES_COUNT];
+	names[EMPTY_CELL] = "cell.png";
+	names[ALIVE_CELL] = "alive_cell.png";
+	names[DEAD_CELL] = "dead_cell.png";
+
+	SDL_Surface* surfaces[CELL_STATES_COUNT];
+	for ( int i = 0; i < CELL_STATES_COUNT; ++i )
+	{
+		SDL_RWops* src = openResource(textures_path, names[i]);
+		surfaces[i] = src ? IMG_Load_RW(src, 1) : nullptr;
+		if ( surfaces[i] == nullptr )
+			std::cout << "[Game::LoadCellsAtlas]" << "(" << this << "): " << "Unable to load " << names[i] << ": " << IMG_GetError() << std::endl;
+	}
+
+	cells_atlas.texture = packTextureAtlas(surfaces, CELL_STATES_COUNT, renderer, cells_atlas.clips);
+	// Предпросмотр шаблонов рисуется теми же областями атласа с прозрачностью
+	if ( cells_atlas.texture )
+		SDL_SetTextureBlendMode(cells_atlas.texture, SDL_BLENDMODE_BLEND);
+
+	for ( int i = 0; i < CELL_STATES_COUNT; ++i )
+		if ( surfaces[i] )
+			cleanup(surfaces[i]);
+
+	return cells_atlas.texture;
+}
+
 Field* Game::CreateField(void)
 {
 	SDL_Rect field_size;
@@ -674,40 +882,220 @@ Field* Game::CreateField(void)
 	field_size.w = state.fparams.width;
 	field_size.h = state.fparams.height;
 
-	field = new Field(state.fparams, field_size, state.fparams.ftype, const_cast<SDL_Texture*>(textures_list[CELL_TEXTURE]), renderer);
+	field = new Field(state.fparams, field_size, state.fparams.ftype, &cells_atlas, renderer);
+	field->SetRule(state.eparams.rule);
+	field->SetStepKernel(getStepKernel(SelectStepKernel()));
+	field->EnableActivity(state.eparams.activity);
+	field->EnableBounds(state.eparams.bounded);
+	if ( state.eparams.lenia.enabled )
+		field->EnableContinuous(state.eparams.lenia);
+
+	if ( state.eparams.threads > 1 )
+	{
+		workers = new WorkerPool(state.eparams.threads);
+		if ( state.eparams.pin_threads )
+			workers->PinThreads();
+		field->SetWorkers(workers);
+		std::cout << "Step threads: " << state.eparams.threads << std::endl;
+	}
+
+	if ( !field->IsContinuous() && (state.eparams.huge_pages || workers) )
+	{
+		field->PlaceGrid(state.eparams.huge_pages);
+		std::cout << "Grid buffers: " << getPagesKindName(field->GetGrid()->GetPagesKind()) << std::endl;
+	}
+
+	// Миникарта, история и запись сессии хранят упакованные клетки, в непрерывном режиме их нет
+	if ( field->IsContinuous() )
+	{
+		std::cout << "Minimap, history, capture and session recording are disabled in the continuous mode" << std::endl;
+		return field;
+	}
+
+	SDL_Rect minimap_area { OFFSET_X + MINIMAP_MARGIN, OFFSET_Y + MINIMAP_MARGIN, CTRL_PANEL_WIDTH - MINIMAP_MARGIN * 2, MINIMAP_MAX_HEIGHT };
+	minimap = new Minimap(minimap_area);
+	if ( !minimap->Reset(field->GetCellsCount_X(), field->GetCellsCount_Y(), renderer) )
+	{
+		std::cout << "[Game::CreateField](" << this << "): " << "Unable to create the minimap, the game will run without it" << std::endl;
+		delete minimap;
+		minimap = nullptr;
+	}
+
+	if ( timeline_params.budget > 0 )
+	{
+		timeline = new Timeline(timeline_params, field->GetCellsCount_X(), field->GetCellsCount_Y());
+		timeline->Record(*field->GetGrid(), state.generation);
+	}
 
 	return field;
 }
 
-int Game::InitGameState(int field_width, int field_height, int sim_speed_mul)
+// Запись кадров идёт из упакованного поля, поэтому не зависит от окна и его текстур
+FrameCapture* Game::StartCapture(void)
+{
+	if ( (capture_params.format == CAPTURE_FORMAT_NONE) || field->IsContinuous() )
+		return nullptr;
+
+	capture = new FrameCapture(capture_params, field->GetCellsCount_X(), field->GetCellsCount_Y());
+	if ( !capture->Start() )
+	{
+		std::cout << "[Game::StartCapture](" << this << "): " << "Unable to start frame capture, the game will run without it" << std::endl;
+		delete capture;
+		capture = nullptr;
+	}
+
+	return capture;
+}
+
+// Кадры для внешних программ берутся из упакованного поля, как и запись
+FramePublisher* Game::StartPublishing(void)
+{
+	if ( state.eparams.publish_name.empty() || field->IsContinuous() )
+		return nullptr;
+
+	publisher = new FramePublisher(state.eparams.publish_name.c_str());
+	if ( !publisher->Publish(*field->GetGrid(), state.generation) )
+	{
+		std::cout << "[Game::StartPublishing](" << this << "): " << "Unable to publish frames, the game will run without it" << std::endl;
+		delete publisher;
+		publisher = nullptr;
+	}
+
+	return publisher;
+}
+
+// Клиенты потока получают то же упакованное поле; их правки идут через свою очередь
+StreamServer* Game::StartServing(void)
+{
+	if ( state.eparams.serve_spec.empty() || field->IsContinuous() )
+		return nullptr;
+
+	StreamAddress address;
+	parseStreamSpec(state.eparams.serve_spec.c_str(), address);
+	server = new StreamServer(address);
+	if ( !server->Start() )
+	{
+		std::cout << "[Game::StartServing](" << this << "): " << "Unable to start the stream server, the game will run without it" << std::endl;
+		delete server;
+		server = nullptr;
+		return nullptr;
+	}
+	server->Submit(*field->GetGrid(), state.generation);
+
+	return server;
+}
+
+// Правки окна и клиентов потока. Возвращает число применённых команд
+int Game::ApplyEdits(void)
+{
+	int applied = field->ApplyEdits(*edits, renderer, recorder, state.generation);
+	if ( server )
+		applied += field->ApplyEdits(*server->GetEdits(), renderer, recorder, state.generation);
+
+	return applied;
+}
+
+int Game::SelectStepKernel(void)
+{
+	return selectStepKernel(state.eparams, field->GetCellsCount_X(), field->GetCellsCount_Y());
+}
+
+int Game::InitGameState(int field_width, int field_height, int sim_speed_mul, const EngineParams& eparams)
 {
 	state.started = false;
 	state.paused = true;
 	state.base_simulation_delay = DEFAULT_BASE_SIMULATION_DELAY;
 	state.simulation_speed_multiplier = sim_speed_mul;
-	state.fparams.ftype = FIELD_TYPE_WITH_BORDERS;
+	state.fparams.ftype = eparams.toroidal ? FIELD_TYPE_TOR : FIELD_TYPE_WITH_BORDERS;
 	state.fparams.width = field_width;
 	state.fparams.height = field_height;
+	state.fparams.cells_x = 0;
+	state.fparams.cells_y = 0;
 	state.fparams.cparams.tile_size = DEFAULT_TILE_SIZE;
+	state.eparams = eparams;
+	state.resize_anchor = GRID_ANCHOR_TOP_LEFT;
 	state.density = 0;
+	state.generation = 0;
 
 	return 1;
 }
 
-int Game::Run(void)
+// Полная перерисовка окна: панель управления, рамки и все клетки
+void Game::DrawScene(void)
 {
-	// Отображение сцены
 	SDL_RenderClear(renderer);
 	renderTexture(const_cast<SDL_Texture*>(textures_list[CONTROL_PANEL_TEXTURE]), renderer, OFFSET_X, OFFSET_Y, CTRL_PANEL_WIDTH, state.fparams.height);
 	renderTexture(const_cast<SDL_Texture*>(textures_list[BACKGROUND_FRAME_TEXTURE]), renderer, CTRL_PANEL_WIDTH, 0, state.fparams.width + OFFSET_X * 2, state.fparams.height + OFFSET_Y * 2);
 	renderTexture(const_cast<SDL_Texture*>(textures_list[CONTROL_PANEL_FRAME_TEXTURE]), renderer, 0, 0, CTRL_PANEL_WIDTH + OFFSET_X * 2, state.fparams.height + OFFSET_Y * 2);
+	DrawTimeline();
+	DrawMinimap();
+	field->Render(renderer);
+	preview_area.w = 0;
+	DrawStampPreview();
+	SDL_RenderPresent(renderer);
+}
+
+// Поле подстраивается под новый размер окна, не останавливая симуляцию
+bool Game::ResizeField(int field_width, int field_height)
+{
+	if ( field_width < MIN_FIELD_WIDTH )
+		field_width = MIN_FIELD_WIDTH;
+	if ( field_height < MIN_WORKSPACE_HEIGHT )
+		field_height = MIN_WORKSPACE_HEIGHT;
 
+	if ( (field_width == state.fparams.width) && (field_height == state.fparams.height) )
+		return true;
+
+	FieldParams fparams = state.fparams;
+	fparams.width = field_width;
+	fparams.height = field_height;
+	SDL_Rect field_size { CTRL_PANEL_WIDTH + OFFSET_X, OFFSET_Y, field_width, field_height };
+	int old_x_count = field->GetCellsCount_X();
+	int old_y_count = field->GetCellsCount_Y();
+
+	if ( !field->Resize(fparams, field_size, state.resize_anchor) )
+	{
+		std::cout << "[Game::ResizeField](" << this << "): " << "Unable to resize the field" << std::endl;
+		return false;
+	}
+	state.fparams = fparams;
+
+	// Поле, заданное в клетках, не меняется: меняется только видимая часть
+	if ( (field->GetCellsCount_X() != old_x_count) || (field->GetCellsCount_Y() != old_y_count) )
+	{
+		if ( recorder )
+			recorder->RecordResize(state.generation, field->GetCellsCount_X(), field->GetCellsCount_Y(), state.resize_anchor);
+
+		if ( capture )
+			std::cout << "Frame capture keeps the original board size, frames of the resized board are skipped" << std::endl;
+
+		// Дельты описывают поле одного размера, история начинается заново
+		if ( timeline )
+			timeline->Record(*field->GetGrid(), state.generation);
+
+		if ( minimap )
+			minimap->Reset(field->GetCellsCount_X(), field->GetCellsCount_Y(), renderer);
+	}
+
+	DrawScene();
+
+	return true;
+}
+
+int Game::Run(void)
+{
 	if ( !CreateField() )
 	{
 		std::cout << "[Game::Run](" << this << "): " << "Unable to create a game field" << std::endl;
 		return 0;
 	}
-	SDL_RenderPresent(renderer);
+
+	// Отображение сцены
+	DrawScene();
+	StartCapture();
+	StartRecording();
+	StartPublishing();
+	StartServing();
 
 
 	bool quit = false;
@@ -715,84 +1103,508 @@ int Game::Run(void)
 
 	while ( !quit )
 	{
+		TRACE_ZONE("Frame");
+
 		if ( state.started && !state.paused )
 		{
-			SDL_RenderClear(renderer);
-			renderTexture(const_cast<SDL_Texture*>(textures_list[CONTROL_PANEL_TEXTURE]), renderer, OFFSET_X, OFFSET_Y, CTRL_PANEL_WIDTH, state.fparams.height);
-			renderTexture(const_cast<SDL_Texture*>(textures_list[BACKGROUND_FRAME_TEXTURE]), renderer, CTRL_PANEL_WIDTH, 0, state.fparams.width + OFFSET_X * 2, state.fparams.height + OFFSET_Y * 2);
-			renderTexture(const_cast<SDL_Texture*>(textures_list[CONTROL_PANEL_FRAME_TEXTURE]), renderer, 0, 0, CTRL_PANEL_WIDTH + OFFSET_X * 2, state.fparams.height + OFFSET_Y * 2);
+			{
+				TRACE_ZONE("RenderClear");
+				SDL_RenderClear(renderer);
+			}
+			{
+				TRACE_ZONE("DrawBackground");
+				renderTexture(const_cast<SDL_Texture*>(textures_list[CONTROL_PANEL_TEXTURE]), renderer, OFFSET_X, OFFSET_Y, CTRL_PANEL_WIDTH, state.fparams.height);
+				renderTexture(const_cast<SDL_Texture*>(textures_list[BACKGROUND_FRAME_TEXTURE]), renderer, CTRL_PANEL_WIDTH, 0, state.fparams.width + OFFSET_X * 2, state.fparams.height + OFFSET_Y * 2);
+				renderTexture(const_cast<SDL_Texture*>(textures_list[CONTROL_PANEL_FRAME_TEXTURE]), renderer, 0, 0, CTRL_PANEL_WIDTH + OFFSET_X * 2, state.fparams.height + OFFSET_Y * 2);
+			}
 
-			quit = field->CheckCellsStates(const_cast<SDL_Texture*>(textures_list[ALIVE_CELL_TEXTURE]), const_cast<SDL_Texture*>(textures_list[DEAD_CELL_TEXTURE]), renderer);
+			{
+				// Правки, нарисованные во время симуляции, попадают в поле перед следующим шагом
+				TRACE_ZONE("ApplyEdits");
+				if ( ApplyEdits() > 0 )
+					timeline_dirty = true;
+			}
+			// После перемотки или правки текущее поколение записывается заново, история после него отбрасывается
+			if ( timeline && timeline_dirty )
+				timeline->Record(*field->GetGrid(), state.generation);
+			timeline_dirty = false;
+
+			quit = field->CheckCellsStates(renderer);
+			++state.generation;
+			if ( timeline )
+			{
+				TRACE_ZONE("RecordTimeline");
+				timeline->Record(*field->GetGrid(), state.generation);
+			}
+			DrawTimeline();
+			{
+				TRACE_ZONE("DrawMinimap");
+				DrawMinimap();
+			}
+			if ( capture )
+				capture->Submit(*field->GetGrid());
+			if ( publisher )
+				publisher->Publish(*field->GetGrid(), state.generation);
+			if ( server )
+				server->Submit(*field->GetGrid(), state.generation);
+			preview_area.w = 0;
+			DrawStampPreview();
+			{
+				TRACE_ZONE("RenderPresent");
+				SDL_RenderPresent(renderer);
+			}
+			{
+				TRACE_ZONE("SimulationDelay");
+				SDL_Delay(state.base_simulation_delay / state.simulation_speed_multiplier);
+			}
+		}
+		else if ( ApplyEdits() > 0 )
+		{
+			timeline_dirty = true;
+			if ( server )
+				server->Submit(*field->GetGrid(), state.generation);
+
+			// Правка могла затереть часть предпросмотра
+			EraseStampPreview();
+			DrawStampPreview();
+			DrawMinimap();
 			SDL_RenderPresent(renderer);
-			SDL_Delay(state.base_simulation_delay / state.simulation_speed_multiplier);
 		}
+		else if ( server && server->IsFrameWanted() )
+			server->Submit(*field->GetGrid(), state.generation);
 
-		while( SDL_PollEvent(&event) )
 		{
-			if ( event.type == SDL_QUIT )
-				quit = true;
-
-			if ( event.type == SDL_KEYDOWN )
+			TRACE_ZONE("PollEvents");
+			while( SDL_PollEvent(&event) )
 			{
-				switch ( event.key.keysym.sym )
+				if ( event.type == SDL_QUIT )
+					quit = true;
+
+				if ( (event.type == SDL_WINDOWEVENT) && (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) )
+					ResizeField(event.window.data1 - CTRL_PANEL_WIDTH - OFFSET_X * 2, event.window.data2 - OFFSET_Y * 2);
+
+				if ( event.type == SDL_KEYDOWN )
 				{
-					case SDLK_ESCAPE:
-						quit = true;
+					switch ( event.key.keysym.sym )
+					{
+						case SDLK_ESCAPE:
+							quit = true;
+							break;
+						case SDLK_DELETE:
+							// Очистка всего поля
+							PushEdit(EDIT_FILL, 0, 0, field->GetCellsCount_X(), field->GetCellsCount_Y(), false);
+							break;
+						case SDLK_TAB:
+							SelectStamp(stamp_preview ? stamp_index + 1 : stamp_index);
+							break;
+						case SDLK_r:
+							stamp_orientation = rotateOrientation(stamp_orientation);
+							SelectStamp(stamp_index);
+							break;
+						case SDLK_f:
+							stamp_orientation = flipOrientation(stamp_orientation);
+							SelectStamp(stamp_index);
+							break;
+						case SDLK_BACKSPACE:
+							EraseStampPreview();
+							stamp_preview = false;
+							SDL_RenderPresent(renderer);
+							break;
+						case SDLK_h:
+							// Слой поля по кругу: клетки, возраст, тепло
+							if ( field->SetLayer((field->GetLayer() + 1) % FIELD_LAYERS_COUNT) )
+							{
+								const char* names[FIELD_LAYERS_COUNT] = { "cells", "age", "heat" };
+								std::cout << "Field layer: " << names[field->GetLayer()] << std::endl;
+								DrawScene();
+							}
+							break;
+						case SDLK_n:
+							// Случайный "суп" на всё поле, зерно попадает в запись сессии
+							PushEdit(EDIT_RANDOMIZE, 0, 0, field->GetCellsCount_X(), field->GetCellsCount_Y(), true);
+							break;
+						case SDLK_PLUS:
+						case SDLK_EQUALS:
+							SetSimulationSpeed(state.simulation_speed_multiplier + 1);
+							break;
+						case SDLK_MINUS:
+							SetSimulationSpeed(state.simulation_speed_multiplier - 1);
+							break;
+						case SDLK_LEFT:
+						case SDLK_RIGHT:
+							// Шаг по истории назад/вперёд, только на паузе
+							if ( state.paused )
+								SeekGeneration(state.generation + ((event.key.keysym.sym == SDLK_LEFT) ? -1 : 1));
+							break;
+					}
 				}
-			}
 
-			if ( event.type == SDL_MOUSEBUTTONDOWN )
-			{
-				int x, y;
-				SDL_GetMouseState(&x, &y);
-				SDL_Point p {x, y};
-				//std::cout << "( " << x << ", " << y << " )" << std::endl;
+				if ( event.type == SDL_MOUSEMOTION )
+				{
+					SDL_Point p {event.motion.x, event.motion.y};
+
+					// Перетаскивание ползунка истории
+					if ( state.paused && (event.motion.state & SDL_BUTTON_LMASK) && IsPointInScrubber(p) )
+						SeekGeneration(ScrubberPointToGeneration(p));
+
+					// Перетаскивание рамки по миникарте
+					if ( (event.motion.state & SDL_BUTTON_LMASK) && minimap && minimap->IsPointInside(p) )
+						CenterView(minimap->PointToCell(p));
+
+					int cell_idx = IsPointInField(p) ? field->PointToIdx(p) : -1;
+					if ( cell_idx > -1 )
+					{
+						int cx = cell_idx % field->GetCellsCount_X();
+						int cy = cell_idx / field->GetCellsCount_X();
+
+						// Рисование с зажатой кнопкой мыши: правка - только когда курсор перешёл в другую клетку
+						if ( event.motion.state & (SDL_BUTTON_LMASK | SDL_BUTTON_RMASK) )
+						{
+							int type = (event.motion.state & SDL_BUTTON_LMASK) ? EDIT_SET_CELL : EDIT_CLEAR_CELL;
+							if ( (cx != paint_cell.x) || (cy != paint_cell.y) || (type != paint_type) )
+							{
+								paint_cell.x = cx;
+								paint_cell.y = cy;
+								paint_type = type;
+								PushEdit(type, cx, cy, 1, 1, true);
+							}
+						}
 
-				if ( state.paused )
+						// Предпросмотр следует за курсором: стирается только область старого предпросмотра
+						if ( stamp_preview && ((cx != stamp_cursor.x) || (cy != stamp_cursor.y)) )
+						{
+							stamp_cursor.x = cx;
+							stamp_cursor.y = cy;
+							if ( !state.started || state.paused )
+							{
+								EraseStampPreview();
+								DrawStampPreview();
+								SDL_RenderPresent(renderer);
+							}
+						}
+					}
+				}
+
+				if ( event.type == SDL_MOUSEBUTTONDOWN )
 				{
+					int x, y;
+					SDL_GetMouseState(&x, &y);
+					SDL_Point p {x, y};
+					//std::cout << "( " << x << ", " << y << " )" << std::endl;
+
+					// Поле можно править и во время симуляции: правки идут через очередь
 					if ( IsPointInField(p) )
 					{
 						int cell_idx = field->PointToIdx(p);
 						if ( cell_idx > -1 )
 						{
-							if ( event.button.button == SDL_BUTTON_LEFT )
-								field->SetCell(cell_idx, ALIVE_CELL, const_cast<SDL_Texture*>(textures_list[ALIVE_CELL_TEXTURE]), renderer);
-							else if (event.button.button == SDL_BUTTON_RIGHT )
-								field->SetCell(cell_idx, EMPTY_CELL, const_cast<SDL_Texture*>(textures_list[CELL_TEXTURE]),renderer);
-							SDL_RenderPresent(renderer);
+							int cx = cell_idx % field->GetCellsCount_X();
+							int cy = cell_idx / field->GetCellsCount_X();
+							if ( (event.button.button == SDL_BUTTON_LEFT) || (event.button.button == SDL_BUTTON_RIGHT) )
+							{
+								paint_cell.x = cx;
+								paint_cell.y = cy;
+								paint_type = (event.button.button == SDL_BUTTON_LEFT) ? EDIT_SET_CELL : EDIT_CLEAR_CELL;
+								PushEdit(paint_type, cx, cy, 1, 1, paint_type == EDIT_SET_CELL);
+							}
+							else if ( event.button.button == SDL_BUTTON_MIDDLE )
+							{
+								stamp_cursor.x = cx;
+								stamp_cursor.y = cy;
+								PlaceStamp();
+							}
 						}
 					}
-					else if ( IsPointInControlPanel(p))
+					else if ( minimap && minimap->IsPointInside(p) )
 					{
+						// Клик по миникарте переносит туда видимую часть поля
+						if ( event.button.button == SDL_BUTTON_LEFT )
+							CenterView(minimap->PointToCell(p));
+					}
+					else if ( IsPointInScrubber(p) )
+					{
+						// Клик по ползунку останавливает симуляцию и показывает выбранное поколение
 						if ( event.button.button == SDL_BUTTON_LEFT )
 						{
+							if ( state.started && !state.paused )
+							{
+								state.paused = true;
+								if ( recorder )
+									recorder->RecordEvent(state.generation, REPLAY_EVENT_PAUSE);
+								std::cout << "The simulation has been paused." << std::endl;
+							}
+							SeekGeneration(ScrubberPointToGeneration(p));
+						}
+					}
+					else if ( state.paused )
+					{
+						if ( event.button.button == SDL_BUTTON_LEFT )
+						{
+							// Правки, сделанные до старта, должны попасть в первый кадр записи
+							if ( ApplyEdits() > 0 )
+								timeline_dirty = true;
+							if ( capture && !state.started )
+								capture->Submit(*field->GetGrid());
 							state.started = true;
 							state.paused = false;
+							if ( recorder )
+								recorder->RecordEvent(state.generation, REPLAY_EVENT_START);
 							std::cout << "The simulation has been started!" << std::endl;
 						}
 					}
-				}
-				else
-				{
-					if ( IsPointInControlPanel(p))
+					else
 					{
 						if ( event.button.button == SDL_BUTTON_RIGHT )
 						{
 							state.paused = true;
+							if ( recorder )
+								recorder->RecordEvent(state.generation, REPLAY_EVENT_PAUSE);
 							std::cout << "The simulation has been paused." << std::endl;
 						}
 					}
 				}
 			}
 		}
+
+		TRACE_ZONE("IdleDelay");
 		SDL_Delay(5);
 	}
 
 	std::cout << "The simulation has been finished." << std::endl;
+	if ( timeline && !timeline->IsEmpty() )
+		std::cout << "Timeline: generations " << timeline->GetFirstGeneration() << ".." << timeline->GetLastGeneration()
+				  << ", " << timeline->GetMemoryUsage() / 1024 << " KB" << std::endl;
+
+	if ( capture )
+		capture->Stop();
+
+	if ( recorder )
+		recorder->Close(state.generation, *field->GetGrid());
 
 	return 1;
 }
 
+// Ставит правку в очередь. Вызывается только из цикла событий(единственный писатель очереди)
+bool Game::PushEdit(int type, int x, int y, int w, int h, bool alive)
+{
+	EditCommand cmd;
+	cmd.type = type;
+	cmd.x = x;
+	cmd.y = y;
+	cmd.w = w;
+	cmd.h = h;
+	cmd.alive = alive;
+	cmd.stamp = (type == EDIT_STAMP) ? stamps.GetStamp(stamp_index, stamp_orientation) : nullptr;
+	cmd.seed = (type == EDIT_RANDOMIZE) ? std::random_device()() : 0;
+	cmd.density = default_soup_density;
+
+	if ( !edits->Push(cmd) )
+	{
+		std::cout << "[Game::PushEdit](" << this << "): " << "Edit queue is full, the edit has been dropped" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Библиотека шаблонов: встроенные и, если задан каталог, RLE-файлы из него
+int Game::LoadStamps(const char* patterns_path)
+{
+	int loaded = stamps.LoadBuiltins();
+	if ( patterns_path )
+		loaded += stamps.LoadDirectory(patterns_path);
+
+	std::cout << "Stamp library: " << loaded << " patterns" << std::endl;
+
+	return loaded;
+}
+
+// Выбирает шаблон(по кругу) и включает его предпросмотр
+void Game::SelectStamp(int idx)
+{
+	if ( stamps.GetCount() == 0 )
+		return;
+
+	stamp_index = ((idx % stamps.GetCount()) + stamps.GetCount()) % stamps.GetCount();
+	stamp_preview = true;
+
+	const Stamp* stamp = stamps.GetStamp(stamp_index, stamp_orientation);
+	std::cout << "Stamp: " << stamps.Get(stamp_index).name << " " << stamp->width << "x" << stamp->height
+			  << ", orientation " << stamp_orientation << std::endl;
+
+	if ( !state.started || state.paused )
+	{
+		EraseStampPreview();
+		DrawStampPreview();
+		SDL_RenderPresent(renderer);
+	}
+}
+
+// Ставит выбранный шаблон по центру вокруг клетки под курсором
+void Game::PlaceStamp(void)
+{
+	const Stamp* stamp = stamps.GetStamp(stamp_index, stamp_orientation);
+	if ( stamp == nullptr )
+		return;
+
+	PushEdit(EDIT_STAMP, stamp_cursor.x - stamp->width / 2, stamp_cursor.y - stamp->height / 2, stamp->width, stamp->height, true);
+}
+
+void Game::DrawStampPreview(void)
+{
+	const Stamp* stamp = stamps.GetStamp(stamp_index, stamp_orientation);
+	if ( !stamp_preview || (stamp == nullptr) )
+		return;
+
+	preview_area.x = stamp_cursor.x - stamp->width / 2;
+	preview_area.y = stamp_cursor.y - stamp->height / 2;
+	preview_area.w = stamp->width;
+	preview_area.h = stamp->height;
+	field->RenderStamp(renderer, stamp, preview_area.x, preview_area.y, STAMP_PREVIEW_ALPHA);
+}
+
+// Восстанавливает клетки под предпросмотром, остальное поле не трогается
+void Game::EraseStampPreview(void)
+{
+	if ( preview_area.w == 0 )
+		return;
+
+	field->RenderArea(renderer, preview_area.x, preview_area.y, preview_area.w, preview_area.h);
+	preview_area.w = 0;
+}
+
+// Запись сессии начинается с пустого поля: все правки, даже сделанные до старта, попадают в неё событиями
+ReplayRecorder* Game::StartRecording(void)
+{
+	if ( record_path.empty() || field->IsContinuous() )
+		return nullptr;
+
+	ReplayHeader header;
+	header.cells_x = field->GetCellsCount_X();
+	header.cells_y = field->GetCellsCount_Y();
+	header.toroidal = state.fparams.ftype == FIELD_TYPE_TOR;
+	header.rule = state.eparams.rule;
+	header.timeline = timeline_params;
+
+	recorder = new ReplayRecorder();
+	if ( !recorder->Open(record_path.c_str(), header) )
+	{
+		std::cout << "[Game::StartRecording](" << this << "): " << "Unable to start session recording, the game will run without it" << std::endl;
+		delete recorder;
+		recorder = nullptr;
+	}
+
+	return recorder;
+}
+
+void Game::SetSimulationSpeed(int multiplier)
+{
+	if ( (multiplier < MIN_SIMULATION_SPEED_MULTIPLIER) || (multiplier > MAX_SIMULATION_SPEED_MULTIPLIER) )
+		return;
+
+	state.simulation_speed_multiplier = multiplier;
+	if ( recorder )
+		recorder->RecordEvent(state.generation, REPLAY_EVENT_SPEED, multiplier);
+	std::cout << "Simulation speed multiplier: " << multiplier << std::endl;
+}
+
+// Ползунок истории внизу панели управления
+SDL_Rect Game::GetScrubberArea(void) const
+{
+	SDL_Rect area;
+	area.x = OFFSET_X + TIMELINE_SCRUBBER_MARGIN;
+	area.y = OFFSET_Y + state.fparams.height - TIMELINE_SCRUBBER_MARGIN - TIMELINE_SCRUBBER_HEIGHT;
+	area.w = CTRL_PANEL_WIDTH - TIMELINE_SCRUBBER_MARGIN * 2;
+	area.h = TIMELINE_SCRUBBER_HEIGHT;
+
+	return area;
+}
+
+bool Game::IsPointInScrubber(SDL_Point p) const
+{
+	if ( !timeline )
+		return false;
+
+	SDL_Rect area = GetScrubberArea();
+
+	return (p.x >= area.x) && (p.x < area.x + area.w) && (p.y >= area.y) && (p.y < area.y + area.h);
+}
+
+long long Game::ScrubberPointToGeneration(SDL_Point p) const
+{
+	SDL_Rect area = GetScrubberArea();
+	long long first = timeline->GetFirstGeneration();
+	long long span = timeline->GetLastGeneration() - first;
+
+	return first + (span * (p.x - area.x) + (area.w - 1) / 2) / std::max(area.w - 1, 1);
+}
+
+// Полоса - записанный диапазон поколений, метка - показанное поколение
+void Game::DrawTimeline(void)
+{
+	if ( !timeline || timeline->IsEmpty() )
+		return;
+
+	SDL_Rect area = GetScrubberArea();
+	SDL_SetRenderDrawColor(renderer, 60, 60, 60, 255);
+	SDL_RenderFillRect(renderer, &area);
+
+	long long first = timeline->GetFirstGeneration();
+	long long span = timeline->GetLastGeneration() - first;
+	SDL_Rect mark = area;
+	mark.w = TIMELINE_SCRUBBER_MARK_WIDTH;
+	mark.x = area.x + int((span > 0) ? (state.generation - first) * (area.w - mark.w) / span : area.w - mark.w);
+	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+	SDL_RenderFillRect(renderer, &mark);
+
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+}
+
+// Показывает записанное поколение. Продолжение симуляции с него отбрасывает более поздние поколения
+bool Game::SeekGeneration(long long generation)
+{
+	if ( !timeline || (generation == state.generation) )
+		return false;
+
+	if ( !field->ShowGeneration(*timeline, generation, renderer) )
+		return false;
+
+	if ( recorder )
+		recorder->RecordEvent(state.generation, REPLAY_EVENT_SEEK, generation);
+	state.generation = generation;
+	timeline_dirty = true;
+	std::cout << "Generation " << generation << " of " << timeline->GetFirstGeneration() << ".." << timeline->GetLastGeneration() << std::endl;
+
+	preview_area.w = 0;
+	DrawStampPreview();
+	DrawTimeline();
+	DrawMinimap();
+	SDL_RenderPresent(renderer);
+
+	return true;
+}
+
+// Миникарта догоняет поле по изменившимся клеткам и рисуется поверх панели управления
+void Game::DrawMinimap(void)
+{
+	if ( !minimap )
+		return;
+
+	minimap->Update(*field->GetGrid());
+	minimap->Draw(renderer, field->GetView());
+}
+
+// Переносит видимую часть поля так, чтобы клетка cell оказалась в её центре
+void Game::CenterView(SDL_Point cell)
+{
+	SDL_Rect view = field->GetView();
+	field->SetView(cell.x - view.w / 2, cell.y - view.h / 2);
+
+	SDL_Rect moved = field->GetView();
+	if ( (moved.x != view.x) || (moved.y != view.y) )
+		DrawScene();
+}
+
 bool Game::IsPointInField(SDL_Point p)
 {
 	int a = field->GetX() + field->GetWidth() - 1;
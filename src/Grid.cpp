@@ -0,0 +1,1054 @@
+#ifndef GRID_CPP
+#define GRID_CPP
+
+
+#include "../includes/Grid.hpp"
+#include "../includes/Kernels.hpp"
+#include "../includes/services.hpp"
+#include "../includes/Workers.hpp"
+#include "../includes/Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+LifeRule conwayRule(void)
+{
+	LifeRule rule { 0, 0, 1, LIFE_NEIGHBOURHOOD_MOORE, false, 0, 0, 0, 0 };
+	rule.birth = 1 << 3;
+	rule.survive = (1 << 2) | (1 << 3);
+
+	return rule;
+}
+
+bool isConwayRule(const LifeRule& rule)
+{
+	LifeRule conway = conwayRule();
+
+	return !isLargerThanLife(rule) && (rule.birth == conway.birth) && (rule.survive == conway.survive);
+}
+
+bool isLargerThanLife(const LifeRule& rule)
+{
+	return (rule.radius > 1) || (rule.neighbourhood != LIFE_NEIGHBOURHOOD_MOORE);
+}
+
+namespace
+{
+
+// Читает число из str, сдвигая указатель. false, если цифр нет
+bool readNumber(const char*& str, int& value)
+{
+	if ( (*str < '0') || (*str > '9') )
+		return false;
+
+	value = 0;
+	for ( ; (*str >= '0') && (*str <= '9'); ++str )
+		value = std::min(value * 10 + (*str - '0'), 1000000);
+
+	return true;
+}
+
+// Диапазон вида "34..58" или одно число
+bool readRange(const char*& str, int& lo, int& hi)
+{
+	if ( !readNumber(str, lo) )
+		return false;
+
+	hi = lo;
+	if ( (str[0] == '.') && (str[1] == '.') )
+	{
+		str += 2;
+		if ( !readNumber(str, hi) || (hi < lo) )
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Правило Larger than Life в нотации Golly: "R5,C0,M1,S34..58,B34..45,NM"(R - радиус, C - число состояний,
+ * поддерживаются только два, M1 - клетка считается в своей окрестности, N - окрестность: M - Мура, N - фон Неймана).
+ * Правило радиуса 1 с окрестностью Мура переводится в маски B/S, чтобы шаг шёл обычными ядрами
+ */
+bool parseLargerThanLife(const char* str, LifeRule& rule)
+{
+	LifeRule result { 0, 0, 0, LIFE_NEIGHBOURHOOD_MOORE, false, 0, 0, 0, 0 };
+	bool has_birth = false;
+	bool has_survive = false;
+
+	const char* p = str;
+	while ( *p )
+	{
+		char key = char(toupper(*p++));
+		int value = 0;
+		switch ( key )
+		{
+			case 'R':
+				if ( !readNumber(p, result.radius) || (result.radius < 1) || (result.radius > LIFE_MAX_RADIUS) )
+					return false;
+				break;
+			case 'C':
+				if ( !readNumber(p, value) || (value > 2) )
+					return false;
+				break;
+			case 'M':
+				if ( !readNumber(p, value) || (value > 1) )
+					return false;
+				result.middle = value == 1;
+				break;
+			case 'S':
+				if ( !readRange(p, result.survive_min, result.survive_max) )
+					return false;
+				has_survive = true;
+				break;
+			case 'B':
+				if ( !readRange(p, result.birth_min, result.birth_max) )
+					return false;
+				has_birth = true;
+				break;
+			case 'N':
+				if ( (*p == 'M') || (*p == 'm') )
+					result.neighbourhood = LIFE_NEIGHBOURHOOD_MOORE;
+				else if ( (*p == 'N') || (*p == 'n') )
+					result.neighbourhood = LIFE_NEIGHBOURHOOD_VON_NEUMANN;
+				else
+					return false;
+				++p;
+				break;
+			default:
+				return false;
+		}
+
+		if ( *p == ',' )
+			++p;
+		else if ( *p )
+			return false;
+	}
+
+	if ( (result.radius < 1) || !has_birth || !has_survive )
+		return false;
+
+	if ( !isLargerThanLife(result) )
+	{
+		// Сама клетка в окрестности: выживание при n соседях - это n + 1 клеток окрестности
+		int shift = result.middle ? 1 : 0;
+		for ( int n = 0; n <= 8; ++n )
+		{
+			if ( (n >= result.birth_min) && (n <= result.birth_max) )
+				result.birth |= 1 << n;
+			if ( (n + shift >= result.survive_min) && (n + shift <= result.survive_max) )
+				result.survive |= 1 << n;
+		}
+		result.middle = false;
+		result.birth_min = result.birth_max = result.survive_min = result.survive_max = 0;
+	}
+
+	rule = result;
+	return true;
+}
+
+}
+
+// Разбирает строку вида "B3/S23"(регистр букв и порядок частей не важны) или правило Larger than Life вида "R5,C0,M1,S34..58,B34..45,NM"
+bool parseLifeRule(const char* str, LifeRule& rule)
+{
+	if ( str == nullptr )
+		return false;
+
+	if ( ((str[0] == 'R') || (str[0] == 'r')) && (str[1] >= '0') && (str[1] <= '9') )
+		return parseLargerThanLife(str, rule);
+
+	LifeRule result { 0, 0, 1, LIFE_NEIGHBOURHOOD_MOORE, false, 0, 0, 0, 0 };
+	unsigned short* target = nullptr;
+	bool has_birth = false;
+	bool has_survive = false;
+
+	for ( const char* p = str; *p; ++p )
+	{
+		if ( (*p == 'B') || (*p == 'b') )
+		{
+			target = &result.birth;
+			has_birth = true;
+		}
+		else if ( (*p == 'S') || (*p == 's') )
+		{
+			target = &result.survive;
+			has_survive = true;
+		}
+		else if ( (*p >= '0') && (*p <= '8') && target )
+		{
+			*target |= 1 << (*p - '0');
+		}
+		else if ( *p != '/' )
+		{
+			return false;
+		}
+	}
+
+	if ( !has_birth || !has_survive )
+		return false;
+
+	rule = result;
+	return true;
+}
+
+std::string lifeRuleToString(const LifeRule& rule)
+{
+	if ( isLargerThanLife(rule) )
+	{
+		return "R" + std::to_string(rule.radius) + ",C0,M" + (rule.middle ? "1" : "0")
+			+ ",S" + std::to_string(rule.survive_min) + ".." + std::to_string(rule.survive_max)
+			+ ",B" + std::to_string(rule.birth_min) + ".." + std::to_string(rule.birth_max)
+			+ ((rule.neighbourhood == LIFE_NEIGHBOURHOOD_VON_NEUMANN) ? ",NN" : ",NM");
+	}
+
+	std::string result = "B";
+
+	for ( int n = 0; n <= 8; ++n )
+		if ( rule.birth & (1 << n) )
+			result.push_back(char('0' + n));
+
+	result.append("/S");
+
+	for ( int n = 0; n <= 8; ++n )
+		if ( rule.survive & (1 << n) )
+			result.push_back(char('0' + n));
+
+	return result;
+}
+
+namespace
+{
+
+// Буфер поля: большие страницы только по просьбе, иначе обычный выровненный блок
+uint64_t* allocGridBuffer(size_t bytes, bool huge, int& kind)
+{
+	if ( !huge )
+	{
+		kind = PAGES_HEAP;
+		return static_cast<uint64_t*>(allocAligned(bytes, GRID_ALIGNMENT));
+	}
+
+	return static_cast<uint64_t*>(allocPages(bytes, true, kind));
+}
+
+// Боковой ореол строки тора: левый - последняя клетка строки, правый(бит width) - первая
+inline void prepareRowHalo(uint64_t* row, int width)
+{
+	int last_word = (width - 1) / GRID_WORD_BITS;
+	int last_bit = (width - 1) % GRID_WORD_BITS;
+	int halo_word = width / GRID_WORD_BITS;
+	uint64_t halo_bit = uint64_t(1) << (width % GRID_WORD_BITS);
+
+	row[-1] = ((row[last_word] >> last_bit) & 1) << (GRID_WORD_BITS - 1);
+	row[halo_word] = (row[0] & 1) ? (row[halo_word] | halo_bit) : (row[halo_word] & ~halo_bit);
+}
+
+// 64 бита строки начиная с бита pos; слова за пределами [0, words) читаются как нулевые
+uint64_t loadBits(const uint64_t* row, int words, long pos)
+{
+	long word = (pos >= 0) ? pos / GRID_WORD_BITS : -((-pos + GRID_WORD_BITS - 1) / GRID_WORD_BITS);
+	int shift = int(pos - word * GRID_WORD_BITS);
+
+	uint64_t lo = ((word >= 0) && (word < words)) ? row[word] : 0;
+	if ( shift == 0 )
+		return lo;
+
+	uint64_t hi = ((word + 1 >= 0) && (word + 1 < words)) ? row[word + 1] : 0;
+	return (lo >> shift) | (hi << (GRID_WORD_BITS - shift));
+}
+
+/*
+ * Расширяет box до живых клеток строк [row_begin, row_end), просматриваются слова [word_begin, word_end).
+ * Строка просматривается с краёв до первого живого слова: на плотном поле это пара слов на строку
+ */
+void scanLiveBox(const uint64_t* rows, int stride, const uint64_t* mask, int row_begin, int row_end, int word_begin, int word_end, GridBox& box)
+{
+	for ( int y = row_begin; y < row_end; ++y )
+	{
+		const uint64_t* row = rows + size_t(y) * stride;
+		int first = word_begin;
+		while ( (first < word_end) && !(row[first] & mask[first]) )
+			++first;
+		if ( first == word_end )
+			continue;
+
+		int last = word_end - 1;
+		while ( !(row[last] & mask[last]) )
+			--last;
+
+		int x0 = first * GRID_WORD_BITS + ctz64(row[first] & mask[first]);
+		int x1 = last * GRID_WORD_BITS + GRID_WORD_BITS - clz64(row[last] & mask[last]);
+		GridBox found = { x0, y, x1, y + 1 };
+		box = uniteBoxes(box, found);
+	}
+}
+
+const char* const anchor_names[] = { "top-left", "top-right", "bottom-left", "bottom-right", "center" };
+
+/*
+ * Переносит прямоугольник w x h битовой плоскости(строки по src_stride слов, ширина src_width бит)
+ * в другую плоскость: заменяя биты приёмника или объединяя с ними. Каждое слово приёмника собирается
+ * из двух слов источника сдвигами, поэтому строки переносятся целыми словами, а не по клетке
+ */
+void blitBitBlock(const uint64_t* src, size_t src_stride, int src_width, int src_x, int src_y,
+		uint64_t* dst, size_t dst_stride, int dst_x, int dst_y, int w, int h, bool merge)
+{
+	if ( (w <= 0) || (h <= 0) )
+		return;
+
+	int src_words = (src_width + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	int first_word = dst_x / GRID_WORD_BITS;
+	int last_word = (dst_x + w - 1) / GRID_WORD_BITS;
+
+	for ( int y = 0; y < h; ++y )
+	{
+		const uint64_t* in = src + (src_y + y) * src_stride;
+		uint64_t* out = dst + (dst_y + y) * dst_stride;
+
+		for ( int i = first_word; i <= last_word; ++i )
+		{
+			int lo = (i == first_word) ? dst_x % GRID_WORD_BITS : 0;
+			int hi = (i == last_word) ? (dst_x + w - 1) % GRID_WORD_BITS + 1 : GRID_WORD_BITS;
+			uint64_t mask = ((hi == GRID_WORD_BITS) ? ~uint64_t(0) : ((uint64_t(1) << hi) - 1)) & (~uint64_t(0) << lo);
+
+			uint64_t bits = loadBits(in, src_words, long(src_x) + long(i) * GRID_WORD_BITS - dst_x);
+			out[i] = merge ? (out[i] | (bits & mask)) : ((out[i] & ~mask) | (bits & mask));
+		}
+	}
+}
+
+}
+
+void copyBitBlock(const uint64_t* src, size_t src_stride, int src_width, int src_x, int src_y,
+		uint64_t* dst, size_t dst_stride, int dst_x, int dst_y, int w, int h)
+{
+	blitBitBlock(src, src_stride, src_width, src_x, src_y, dst, dst_stride, dst_x, dst_y, w, h, false);
+}
+
+void orBitBlock(const uint64_t* src, size_t src_stride, int src_width, int src_x, int src_y,
+		uint64_t* dst, size_t dst_stride, int dst_x, int dst_y, int w, int h)
+{
+	blitBitBlock(src, src_stride, src_width, src_x, src_y, dst, dst_stride, dst_x, dst_y, w, h, true);
+}
+
+GridBox uniteBoxes(const GridBox& a, const GridBox& b)
+{
+	if ( isBoxEmpty(a) )
+		return b;
+	if ( isBoxEmpty(b) )
+		return a;
+
+	GridBox box = { std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1) };
+
+	return box;
+}
+
+// Смещение старого поля внутри нового, при котором точка anchor остаётся на месте
+void getAnchorOffset(int anchor, int old_w, int old_h, int new_w, int new_h, int& dx, int& dy)
+{
+	dx = 0;
+	dy = 0;
+
+	if ( (anchor == GRID_ANCHOR_TOP_RIGHT) || (anchor == GRID_ANCHOR_BOTTOM_RIGHT) )
+		dx = new_w - old_w;
+	if ( (anchor == GRID_ANCHOR_BOTTOM_LEFT) || (anchor == GRID_ANCHOR_BOTTOM_RIGHT) )
+		dy = new_h - old_h;
+	if ( anchor == GRID_ANCHOR_CENTER )
+	{
+		dx = (new_w - old_w) / 2;
+		dy = (new_h - old_h) / 2;
+	}
+}
+
+int findAnchorByName(const char* name)
+{
+	for ( int i = 0; i < int(sizeof(anchor_names) / sizeof(anchor_names[0])); ++i )
+		if ( strcmp(anchor_names[i], name) == 0 )
+			return i;
+
+	return -1;
+}
+
+
+
+
+
+
+
+
+Grid::Grid(int w, int h, bool tor)
+{
+	toroidal = tor;
+	current = 0;
+	huge_pages = false;
+	age = nullptr;
+	heat = nullptr;
+	bounded = true;
+	tile_buffer_bytes = 0;
+	tile_buffer_stride = 0;
+	Allocate(w, h);
+}
+
+Grid::~Grid()
+{
+	EnableActivity(false);
+	ReleaseTileBuffers();
+	Release();
+}
+
+/*
+ * Включает слой активности: по байту возраста и тепла на клетку, строки длиной vec_words * 64 байт.
+ * Слой обновляют сами ядра в том же проходе, что и шаг, поэтому лишнего обхода памяти нет
+ */
+void Grid::EnableActivity(bool enable)
+{
+	if ( enable && (age == nullptr) )
+	{
+		size_t size = size_t(height) * GetActivityStride();
+		age = static_cast<unsigned char*>(allocAligned(size, GRID_ALIGNMENT));
+		heat = static_cast<unsigned char*>(allocAligned(size, GRID_ALIGNMENT));
+	}
+	else if ( !enable && (age != nullptr) )
+	{
+		freeAligned(age);
+		freeAligned(heat);
+		age = nullptr;
+		heat = nullptr;
+	}
+}
+
+void Grid::Allocate(int w, int h)
+{
+	width = w;
+	height = h;
+
+	// Одно слово сверх данных всегда остаётся под правый ореол
+	row_words = (width + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	vec_words = (row_words + 1 + GRID_VECTOR_WORDS - 1) / GRID_VECTOR_WORDS * GRID_VECTOR_WORDS;
+	stride = GRID_GUARD_WORDS + vec_words;
+
+	// Лишние слова в конце нужны невыровненному чтению правого соседа в нижней строке-ореоле
+	buffer_bytes = (size_t(height + 2) * stride + GRID_GUARD_WORDS) * sizeof(uint64_t);
+	for ( int b = 0; b < 2; ++b )
+		buffers[b] = allocGridBuffer(buffer_bytes, huge_pages, pages_kind[b]);
+	tail_mask = static_cast<uint64_t*>(allocAligned(vec_words * sizeof(uint64_t), GRID_ALIGNMENT));
+
+	for ( int i = 0; i < row_words; ++i )
+		tail_mask[i] = ~uint64_t(0);
+
+	if ( width % GRID_WORD_BITS )
+		tail_mask[row_words - 1] = (uint64_t(1) << (width % GRID_WORD_BITS)) - 1;
+
+	bounds_valid = false;
+}
+
+void Grid::Release(void)
+{
+	for ( int b = 0; b < 2; ++b )
+		freePages(buffers[b], buffer_bytes, pages_kind[b]);
+	freeAligned(tail_mask);
+}
+
+void Grid::ReleaseTileBuffers(void)
+{
+	for ( uint64_t* buffer : tile_buffers )
+		freeAligned(buffer);
+	tile_buffers.clear();
+	tile_buffer_bytes = 0;
+	tile_buffer_stride = 0;
+}
+
+/*
+ * Переносит оба буфера поля в новую память: с huge - на большие страницы, если они доступны.
+ * Каждую полосу строк копирует исполнитель, который считает её в Step, поэтому на машине
+ * с несколькими узлами NUMA страницы полосы оказываются в памяти узла этого исполнителя
+ */
+bool Grid::PlaceBuffers(bool huge, WorkerPool* workers)
+{
+	uint64_t* old_buffers[2] = { buffers[0], buffers[1] };
+	int old_kinds[2] = { pages_kind[0], pages_kind[1] };
+	uint64_t* new_buffers[2] = { nullptr, nullptr };
+	int new_kinds[2] = { PAGES_HEAP, PAGES_HEAP };
+
+	for ( int b = 0; b < 2; ++b )
+	{
+		new_buffers[b] = allocGridBuffer(buffer_bytes, huge, new_kinds[b]);
+		if ( new_buffers[b] == nullptr )
+		{
+			std::cout << "[Grid::PlaceBuffers](" << this << "): Unable to allocate " << buffer_bytes << " bytes!" << std::endl;
+			if ( b == 1 )
+				freePages(new_buffers[0], buffer_bytes, new_kinds[0]);
+			return false;
+		}
+	}
+
+	// Первая и последняя полосы забирают ещё строки-ореолы и охранные слова в начале и конце буфера
+	int count = workers ? workers->GetWorkersCount() : 1;
+	size_t total_words = buffer_bytes / sizeof(uint64_t);
+	auto touch = [&](int worker)
+	{
+		int row_begin = int((long long)height * worker / count);
+		int row_end = int((long long)height * (worker + 1) / count);
+		size_t begin = (worker == 0) ? 0 : size_t(row_begin + 1) * stride;
+		size_t end = (worker == count - 1) ? total_words : size_t(row_end + 1) * stride;
+		for ( int b = 0; b < 2; ++b )
+			memcpy(new_buffers[b] + begin, old_buffers[b] + begin, (end - begin) * sizeof(uint64_t));
+	};
+
+	if ( workers && (count > 1) )
+		workers->Run(touch);
+	else
+		touch(0);
+
+	for ( int b = 0; b < 2; ++b )
+	{
+		freePages(old_buffers[b], buffer_bytes, old_kinds[b]);
+		buffers[b] = new_buffers[b];
+		pages_kind[b] = new_kinds[b];
+	}
+	huge_pages = huge;
+
+	return true;
+}
+
+void Grid::SetCell(int x, int y, bool alive)
+{
+	if ( (x < 0) || (x >= width) || (y < 0) || (y >= height) )
+		return;
+
+	uint64_t bit = uint64_t(1) << (x % GRID_WORD_BITS);
+	uint64_t& word = GetRow(y)[x / GRID_WORD_BITS];
+
+	word = alive ? (word | bit) : (word & ~bit);
+
+	// Погибшая клетка рамку не сужает: рамка лишь должна содержать все живые клетки
+	if ( alive && bounds_valid )
+	{
+		GridBox cell = { x, y, x + 1, y + 1 };
+		live_box = uniteBoxes(live_box, cell);
+		dirty_box[current] = uniteBoxes(dirty_box[current], cell);
+	}
+}
+
+void Grid::Clear(void)
+{
+	for ( int y = 0; y < height; ++y )
+		memset(GetRow(y), 0, vec_words * sizeof(uint64_t));
+
+	if ( bounds_valid )
+	{
+		live_box = GridBox { 0, 0, 0, 0 };
+		dirty_box[current] = live_box;
+	}
+}
+
+void Grid::Randomize(double density, unsigned int seed)
+{
+	std::mt19937 gen(seed);
+	std::bernoulli_distribution dist(density);
+
+	Clear();
+	for ( int y = 0; y < height; ++y )
+		for ( int x = 0; x < width; ++x )
+			if ( dist(gen) )
+				SetCell(x, y, true);
+}
+
+void Grid::CopyFrom(const Grid& other)
+{
+	if ( (other.width != width) || (other.height != height) )
+		return;
+
+	for ( int y = 0; y < height; ++y )
+		for ( int i = 0; i < vec_words; ++i )
+			GetRow(y)[i] = other.GetRow(y)[i] & tail_mask[i];
+
+	bounds_valid = false;
+}
+
+bool Grid::IsEqual(const Grid& other) const
+{
+	if ( (other.width != width) || (other.height != height) )
+		return false;
+
+	for ( int y = 0; y < height; ++y )
+		for ( int i = 0; i < row_words; ++i )
+			if ( (GetRow(y)[i] ^ other.GetRow(y)[i]) & tail_mask[i] )
+				return false;
+
+	return true;
+}
+
+// Рамка живых клеток; если она неизвестна(поле менялось мимо методов), всё поле
+GridBox Grid::GetLiveBox(void) const
+{
+	if ( bounded && bounds_valid )
+		return live_box;
+
+	GridBox full = { 0, 0, width, height };
+
+	return full;
+}
+
+// Считаются только слова внутри рамки живых клеток
+long long Grid::CountPopulation(void) const
+{
+	long long population = 0;
+	GridBox box = GetLiveBox();
+	if ( isBoxEmpty(box) )
+		return 0;
+
+	for ( int y = box.y0; y < box.y1; ++y )
+	{
+		const uint64_t* row = GetRow(y);
+		for ( int i = box.x0 / GRID_WORD_BITS; i < (box.x1 + GRID_WORD_BITS - 1) / GRID_WORD_BITS; ++i )
+		{
+			uint64_t word = row[i] & tail_mask[i];
+#if defined(__GNUC__)
+			population += __builtin_popcountll(word);
+#else
+			for ( ; word; word &= word - 1 )
+				++population;
+#endif
+		}
+	}
+
+	return population;
+}
+
+void Grid::PrepareHalo(void)
+{
+	if ( !toroidal )
+		return;
+
+	for ( int y = 0; y < height; ++y )
+		prepareRowHalo(GetRow(y), width);
+
+	// Строки-ореолы копируются целиком, вместе с боковым ореолом, чтобы углы тоже замыкались
+	memcpy(GetRow(-1) - GRID_GUARD_WORDS, GetRow(height - 1) - GRID_GUARD_WORDS, stride * sizeof(uint64_t));
+	memcpy(GetRow(height) - GRID_GUARD_WORDS, GetRow(0) - GRID_GUARD_WORDS, stride * sizeof(uint64_t));
+}
+
+/*
+ * Шаг одного поколения. С пулом потоков поле режется на горизонтальные полосы, по одной на исполнителя.
+ * Правила Larger than Life считаются своим ядром: их окрестность шире ореола в одну клетку.
+ * Если включена рамка живых клеток, считается только она(кроме Larger than Life, правил с B0, где рождаются
+ * и пустые клетки вдали от живых, и слоя активности, которому нужно затухание тепла по всему полю)
+ */
+bool Grid::Step(const LifeRule& rule, StepKernel kernel, WorkerPool* workers)
+{
+	if ( bounded && !age && !isLargerThanLife(rule) && !(rule.birth & 1) )
+		return StepBounded(rule, kernel, workers);
+
+	bounds_valid = false;
+	PrepareHalo();
+	if ( isLargerThanLife(rule) )
+		kernel = stepKernelLargerThanLife;
+
+	StepArgs args;
+	args.src = GetRow(0);
+	args.dst = GetNextRow(0);
+	args.mask = tail_mask;
+	args.stride = stride;
+	args.vec_words = vec_words;
+	args.row_begin = 0;
+	args.row_end = height;
+	args.rule = rule;
+	args.age = age;
+	args.heat = heat;
+	args.activity_stride = GetActivityStride();
+	args.width = width;
+	args.height = height;
+	args.toroidal = toroidal;
+
+	bool changed = false;
+	if ( (workers == nullptr) || (workers->GetWorkersCount() == 1) )
+	{
+		changed = kernel(args);
+	}
+	else
+	{
+		int count = workers->GetWorkersCount();
+		std::vector<char> stripe_changed(count, 0);
+
+		workers->Run([&](int worker)
+		{
+			TRACE_ZONE("StepStripe");
+			StepArgs stripe = args;
+			stripe.row_begin = int((long long)height * worker / count);
+			stripe.row_end = int((long long)height * (worker + 1) / count);
+			stripe_changed[worker] = kernel(stripe);
+		});
+
+		for ( int i = 0; i < count; ++i )
+			changed = changed || stripe_changed[i];
+	}
+	Swap();
+
+	return changed;
+}
+
+/*
+ * Шаг внутри рамки живых клеток, расширенной на клетку(там возможны рождения); на торе рамка у края
+ * расширяется на всю ширину(высоту). По ширине область выравнивается до векторов ядра, ядрам передаются
+ * указатели на её первое слово, поэтому сами ядра не меняются. Вне области следующий буфер обнуляется там,
+ * где в нём могли остаться живые клетки. После каждого куска строк ищется рамка нового поколения
+ */
+bool Grid::StepBounded(const LifeRule& rule, StepKernel kernel, WorkerPool* workers)
+{
+	GridBox full = { 0, 0, width, height };
+	if ( !bounds_valid )
+	{
+		live_box = full;
+		dirty_box[0] = full;
+		dirty_box[1] = full;
+		bounds_valid = true;
+	}
+
+	GridBox region = { 0, 0, 0, 0 };
+	if ( !isBoxEmpty(live_box) )
+	{
+		region = GridBox { live_box.x0 - 1, live_box.y0 - 1, live_box.x1 + 1, live_box.y1 + 1 };
+		if ( toroidal && ((region.x0 < 0) || (region.x1 > width)) )
+		{
+			region.x0 = 0;
+			region.x1 = width;
+		}
+		if ( toroidal && ((region.y0 < 0) || (region.y1 > height)) )
+		{
+			region.y0 = 0;
+			region.y1 = height;
+		}
+		region.x0 = std::max(region.x0, 0);
+		region.y0 = std::max(region.y0, 0);
+		region.x1 = std::min(region.x1, width);
+		region.y1 = std::min(region.y1, height);
+	}
+
+	int word_begin = 0;
+	int word_end = 0;
+	if ( !isBoxEmpty(region) )
+	{
+		word_begin = region.x0 / GRID_WORD_BITS / GRID_VECTOR_WORDS * GRID_VECTOR_WORDS;
+		word_end = std::min((region.x1 + GRID_WORD_BITS * GRID_VECTOR_WORDS - 1) / (GRID_WORD_BITS * GRID_VECTOR_WORDS) * GRID_VECTOR_WORDS, vec_words);
+	}
+
+	int next = current ^ 1;
+	ClearOutside(next, region, word_begin, word_end);
+
+	bool changed = false;
+	GridBox found = { 0, 0, 0, 0 };
+	if ( !isBoxEmpty(region) )
+	{
+		PrepareHalo();
+
+		StepArgs args;
+		args.src = GetRow(0) + word_begin;
+		args.dst = GetNextRow(0) + word_begin;
+		args.mask = tail_mask + word_begin;
+		args.stride = stride;
+		args.vec_words = word_end - word_begin;
+		args.rule = rule;
+		args.age = nullptr;
+		args.heat = nullptr;
+		args.activity_stride = GetActivityStride();
+		args.width = width;
+		args.height = height;
+		args.toroidal = toroidal;
+
+		const uint64_t* next_rows = GetNextRow(0);
+		auto stripe = [&](int row_begin, int row_end, GridBox& box) -> bool
+		{
+			bool stripe_changed = false;
+			StepArgs chunk = args;
+			for ( int y = row_begin; y < row_end; y += GRID_BOUNDS_CHUNK_ROWS )
+			{
+				chunk.row_begin = y;
+				chunk.row_end = std::min(y + GRID_BOUNDS_CHUNK_ROWS, row_end);
+				stripe_changed = kernel(chunk) || stripe_changed;
+				scanLiveBox(next_rows, stride, tail_mask, chunk.row_begin, chunk.row_end, word_begin, word_end, box);
+			}
+			return stripe_changed;
+		};
+
+		int count = workers ? workers->GetWorkersCount() : 1;
+		if ( count <= 1 )
+		{
+			changed = stripe(region.y0, region.y1, found);
+		}
+		else
+		{
+			std::vector<char> stripe_changed(count, 0);
+			std::vector<GridBox> stripe_boxes(count, GridBox { 0, 0, 0, 0 });
+
+			// Полосы те же, что в Step и PlaceBuffers, обрезанные по области: исполнитель работает со страницами своего узла NUMA
+			workers->Run([&](int worker)
+			{
+				int row_begin = std::max(region.y0, int((long long)height * worker / count));
+				int row_end = std::min(region.y1, int((long long)height * (worker + 1) / count));
+				if ( row_begin >= row_end )
+					return;
+				TRACE_ZONE("StepStripe");
+				stripe_changed[worker] = stripe(row_begin, row_end, stripe_boxes[worker]);
+			});
+
+			for ( int i = 0; i < count; ++i )
+			{
+				changed = changed || stripe_changed[i];
+				found = uniteBoxes(found, stripe_boxes[i]);
+			}
+		}
+	}
+	Swap();
+
+	live_box = found;
+	dirty_box[current] = GridBox { word_begin * GRID_WORD_BITS, region.y0, std::min(word_end * GRID_WORD_BITS, width), region.y1 };
+
+	return changed;
+}
+
+// Обнуляет слова буфера, которые могли остаться живыми с прошлого поколения в нём, вне области шага
+void Grid::ClearOutside(int buffer, const GridBox& region, int word_begin, int word_end)
+{
+	const GridBox& dirty = dirty_box[buffer];
+	if ( isBoxEmpty(dirty) )
+		return;
+
+	int dirty_begin = dirty.x0 / GRID_WORD_BITS;
+	int dirty_end = (dirty.x1 + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	uint64_t* rows = buffers[buffer] + stride + GRID_GUARD_WORDS;
+	for ( int y = dirty.y0; y < dirty.y1; ++y )
+	{
+		uint64_t* row = rows + size_t(y) * stride;
+		if ( (y < region.y0) || (y >= region.y1) )
+		{
+			memset(row + dirty_begin, 0, (dirty_end - dirty_begin) * sizeof(uint64_t));
+			continue;
+		}
+
+		for ( int i = dirty_begin; i < std::min(dirty_end, word_begin); ++i )
+			row[i] = 0;
+		for ( int i = std::max(dirty_begin, word_end); i < dirty_end; ++i )
+			row[i] = 0;
+	}
+}
+
+/*
+ * Несколько поколений за один проход по памяти(временное блокирование). Поле режется на полосы
+ * по tile_rows строк; полоса вместе с generations строками сверху и снизу копируется в свой буфер,
+ * который помещается в кэш, и считается generations поколений подряд. С каждым поколением верные строки
+ * буфера сужаются на строку с каждой стороны(трапеция), после последнего остаются ровно строки полосы,
+ * они пишутся во второй буфер поля. Соседние полосы считают перекрытия заново, зато поле читается
+ * и пишется один раз за generations поколений. Результат совпадает с generations вызовами Step.
+ * Правила Larger than Life и слой активности(его нельзя обновлять дважды в перекрытиях) считаются обычными шагами.
+ * tile_rows = 0 - высота полосы по GRID_TEMPORAL_TILE_BYTES. Возвращает true, если в последнем поколении что-то изменилось
+ */
+bool Grid::StepBlocked(const LifeRule& rule, StepKernel kernel, int generations, WorkerPool* workers, int tile_rows)
+{
+	if ( (generations <= 1) || isLargerThanLife(rule) || age )
+	{
+		bool changed = false;
+		for ( int g = 0; g < generations; ++g )
+			changed = Step(rule, kernel, workers);
+		return changed;
+	}
+
+	bounds_valid = false;
+	int depth = generations;
+	int row_bytes = stride * int(sizeof(uint64_t));
+	if ( tile_rows <= 0 )
+		tile_rows = std::max(GRID_TEMPORAL_TILE_BYTES / (2 * row_bytes) - 2 * depth, 4 * depth);
+	tile_rows = std::min(tile_rows, height);
+	int tiles = (height + tile_rows - 1) / tile_rows;
+	int local_rows = tile_rows + 2 * depth;
+	size_t local_size = (size_t(local_rows + 2) * stride + GRID_GUARD_WORDS) * sizeof(uint64_t);
+
+	int count = workers ? workers->GetWorkersCount() : 1;
+	std::vector<char> tile_changed(tiles, 0);
+	const uint64_t* src_rows = GetRow(0);
+	uint64_t* dst_rows = GetNextRow(0);
+
+	// Буферы полос живут между вызовами; после смены размера полосы или строки поля выделяются заново
+	if ( (local_size != tile_buffer_bytes) || (stride != tile_buffer_stride) )
+		ReleaseTileBuffers();
+	tile_buffer_bytes = local_size;
+	tile_buffer_stride = stride;
+	if ( tile_buffers.size() < size_t(2 * count) )
+		tile_buffers.resize(2 * count, nullptr);
+
+	auto run = [&](int worker)
+	{
+		TRACE_ZONE("StepTiles");
+		uint64_t** local = tile_buffers.data() + 2 * worker;
+		for ( int b = 0; b < 2; ++b )
+			if ( local[b] == nullptr )
+			{
+				local[b] = static_cast<uint64_t*>(allocAligned(local_size, GRID_ALIGNMENT));
+				memset(local[b], 0, local_size);
+			}
+		auto local_row = [&](int b, int r) { return local[b] + (r + 1) * stride + GRID_GUARD_WORDS; };
+
+		for ( int tile = worker; tile < tiles; tile += count )
+		{
+			int y0 = tile * tile_rows;
+			int y1 = std::min(y0 + tile_rows, height);
+			int first = y0 - depth;
+			int rows = (y1 - y0) + 2 * depth;
+
+			// Строки за краем поля с границами остаются нулевыми во всех поколениях
+			int valid_begin = toroidal ? 0 : std::max(-first, 0);
+			int valid_end = toroidal ? rows : std::min(height - first, rows);
+
+			for ( int r = 0; r < rows; ++r )
+			{
+				int y = first + r;
+				if ( (r < valid_begin) || (r >= valid_end) )
+				{
+					// Буферы переиспользуются между полосами, нулевыми должны быть оба
+					memset(local_row(0, r) - 1, 0, (vec_words + 1) * sizeof(uint64_t));
+					memset(local_row(1, r) - 1, 0, (vec_words + 1) * sizeof(uint64_t));
+					continue;
+				}
+				if ( toroidal )
+					y = ((y % height) + height) % height;
+				memcpy(local_row(0, r), src_rows + size_t(y) * stride, vec_words * sizeof(uint64_t));
+			}
+
+			int b = 0;
+			bool changed = false;
+			for ( int g = 1; g <= depth; ++g )
+			{
+				if ( toroidal )
+					for ( int r = g - 1; r < rows - g + 1; ++r )
+						prepareRowHalo(local_row(b, r), width);
+
+				StepArgs args;
+				args.src = local_row(b, 0);
+				args.dst = local_row(b ^ 1, 0);
+				args.mask = tail_mask;
+				args.stride = stride;
+				args.vec_words = vec_words;
+				args.row_begin = std::max(g, valid_begin);
+				args.row_end = std::min(rows - g, valid_end);
+				args.rule = rule;
+				args.age = nullptr;
+				args.heat = nullptr;
+				args.activity_stride = 0;
+				args.width = width;
+				args.height = height;
+				args.toroidal = toroidal;
+				changed = (args.row_begin < args.row_end) && kernel(args);
+				b ^= 1;
+			}
+
+			for ( int y = y0; y < y1; ++y )
+				memcpy(dst_rows + size_t(y) * stride, local_row(b, y - first), vec_words * sizeof(uint64_t));
+			tile_changed[tile] = changed;
+		}
+	};
+
+	if ( workers && (count > 1) )
+		workers->Run(run);
+	else
+		run(0);
+	Swap();
+
+	bool changed = false;
+	for ( int i = 0; i < tiles; ++i )
+		changed = changed || tile_changed[i];
+
+	return changed;
+}
+
+/*
+ * Меняет размер поля, сохраняя живые клетки: точка anchor старого поля совпадает с той же точкой нового.
+ * Клетки, вышедшие за новые границы, теряются. Новые буферы выделяются в вызывающем потоке:
+ * размещение полос по исполнителям(PlaceBuffers) после этого нужно повторить
+ */
+bool Grid::Resize(int w, int h, int anchor)
+{
+	if ( (w < 1) || (h < 1) )
+		return false;
+
+	if ( (w == width) && (h == height) )
+		return true;
+
+	int old_width = width;
+	int old_height = height;
+	int old_stride = stride;
+	uint64_t* old_buffers[2] = { buffers[0], buffers[1] };
+	int old_kinds[2] = { pages_kind[0], pages_kind[1] };
+	size_t old_bytes = buffer_bytes;
+	uint64_t* old_tail_mask = tail_mask;
+	const uint64_t* old_rows = buffers[current] + old_stride + GRID_GUARD_WORDS;
+
+	Allocate(w, h);
+
+	int dx, dy;
+	getAnchorOffset(anchor, old_width, old_height, w, h, dx, dy);
+
+	// Пересечение старого поля, сдвинутого на (dx, dy), с новым
+	int src_x = (dx < 0) ? -dx : 0;
+	int src_y = (dy < 0) ? -dy : 0;
+	int dst_x = (dx > 0) ? dx : 0;
+	int dst_y = (dy > 0) ? dy : 0;
+	int copy_w = std::min(old_width - src_x, w - dst_x);
+	int copy_h = std::min(old_height - src_y, h - dst_y);
+
+	// Биты за шириной старого поля(ореол, остатки шага) в копируемый прямоугольник не попадают
+	copyBitBlock(old_rows, old_stride, old_width, src_x, src_y, GetRow(0), stride, dst_x, dst_y, copy_w, copy_h);
+
+	for ( int b = 0; b < 2; ++b )
+		freePages(old_buffers[b], old_bytes, old_kinds[b]);
+	freeAligned(old_tail_mask);
+
+	// Возраст и тепло после изменения размера отсчитываются заново
+	if ( age )
+	{
+		EnableActivity(false);
+		EnableActivity(true);
+	}
+
+	return true;
+}
+
+/*
+ * Объединяет с полем битовый шаблон w x h(строки по src_row_words слов), левый верхний угол в (x, y).
+ * Строки переносятся словами, цена - O(площади шаблона). На торе части шаблона за краем
+ * переносятся на противоположную сторону, на поле с границами отсекаются
+ */
+void Grid::Stamp(const uint64_t* bits, int src_row_words, int w, int h, int x, int y)
+{
+	int offsets_x[2] = { x, x };
+	int offsets_y[2] = { y, y };
+	int count = 1;
+	if ( toroidal )
+	{
+		offsets_x[0] = ((x % width) + width) % width;
+		offsets_y[0] = ((y % height) + height) % height;
+		offsets_x[1] = offsets_x[0] - width;
+		offsets_y[1] = offsets_y[0] - height;
+		count = 2;
+	}
+
+	for ( int j = 0; j < count; ++j )
+		for ( int i = 0; i < count; ++i )
+		{
+			int ox = offsets_x[i];
+			int oy = offsets_y[j];
+			int src_x = (ox < 0) ? -ox : 0;
+			int src_y = (oy < 0) ? -oy : 0;
+			int dst_x = (ox > 0) ? ox : 0;
+			int dst_y = (oy > 0) ? oy : 0;
+
+			orBitBlock(bits, src_row_words, w, src_x, src_y, GetRow(0), stride, dst_x, dst_y,
+					std::min(w - src_x, width - dst_x), std::min(h - src_y, height - dst_y));
+		}
+
+	bounds_valid = false;
+}
+
+#endif
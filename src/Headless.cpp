@@ -0,0 +1,385 @@
+#ifndef HEADLESS_CPP
+#define HEADLESS_CPP
+
+
+#include "../includes/Headless.hpp"
+#include "../includes/Grid.hpp"
+#include "../includes/Patterns.hpp"
+#include "../includes/Workers.hpp"
+#include "../includes/Trace.hpp"
+#include "../includes/Census.hpp"
+#include "../includes/Regions.hpp"
+#include "../includes/Morton.hpp"
+#include "../includes/Lenia.hpp"
+#include "../includes/services.hpp"
+#include "../includes/SharedFrames.hpp"
+#include "../includes/Stream.hpp"
+#include "../includes/Replay.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+
+namespace
+{
+
+bool seedGrid(const HeadlessParams& hparams, Grid& grid)
+{
+	if ( hparams.pattern.empty() )
+	{
+		grid.Randomize(hparams.density, hparams.seed);
+		return true;
+	}
+
+	Pattern pattern;
+	if ( !getBuiltinPattern(hparams.pattern.c_str(), pattern) && !loadPatternFile(hparams.pattern.c_str(), pattern) )
+	{
+		std::cout << "Pattern " << hparams.pattern << " is neither builtin nor a readable RLE file!" << std::endl;
+		return false;
+	}
+
+	int left = (grid.GetWidth() - pattern.width) / 2;
+	int top = (grid.GetHeight() - pattern.height) / 2;
+	for ( int y = 0; y < pattern.height; ++y )
+		for ( int x = 0; x < pattern.width; ++x )
+			if ( pattern.cells[size_t(y) * pattern.width + x] )
+				grid.SetCell(left + x, top + y, true);
+
+	return true;
+}
+
+// Численность и плотность заданных прямоугольников поколения generation
+void printRegions(const HeadlessParams& hparams, const RegionIndex& index, long long generation)
+{
+	for ( auto& region : hparams.regions )
+		std::cout << "Generation " << generation << ", region " << region.x << "," << region.y << " " << region.w << "x" << region.h
+				  << ": population " << index.Count(region.x, region.y, region.w, region.h)
+				  << ", density " << index.GetDensity(region.x, region.y, region.w, region.h) << std::endl;
+
+	if ( hparams.block_stats )
+	{
+		std::cout << "Generation " << generation << ", ";
+		index.PrintBlockStats(std::cout);
+	}
+}
+
+/*
+ * Отложенная перепись нашла устоявшийся "суп" с опозданием: пропущенные поколения прогоняются заново
+ * от поля последнего полного пересчёта с переписью каждое поколение. Возвращает, сколько поколений
+ * подряд к концу прогона объекты уже известны
+ */
+int replayCensus(Census& census, Grid& checkpoint, long long generations, const LifeRule& rule, StepKernel kernel, WorkerPool* workers)
+{
+	int settled = 0;
+	for ( long long g = 0; g < generations; ++g )
+	{
+		checkpoint.Step(rule, kernel, workers);
+		census.Update(checkpoint, true);
+		settled = census.IsSettled() ? settled + 1 : 0;
+	}
+
+	return settled;
+}
+
+// Непрерывный режим: поле Lenia на торе, начальное состояние - случайный "суп"
+int runHeadlessLenia(const HeadlessParams& hparams, const EngineParams& eparams)
+{
+	if ( !hparams.pattern.empty() || hparams.census || !hparams.regions.empty() || hparams.block_stats || (hparams.capture.format != CAPTURE_FORMAT_NONE)
+			|| !eparams.publish_name.empty() || !eparams.serve_spec.empty() )
+		std::cout << "Patterns, census, region queries, capture, publishing and streaming work with cells only and are ignored in the continuous mode" << std::endl;
+
+	LeniaField lenia(hparams.cells_x, hparams.cells_y, eparams.lenia);
+	lenia.Randomize(hparams.density, hparams.seed);
+	WorkerPool workers(eparams.threads);
+
+	std::cout << "Headless Lenia run: " << hparams.cells_x << "x" << hparams.cells_y << " torus, " << leniaParamsToString(eparams.lenia)
+			  << ", " << hparams.generations << " generations, threads: " << workers.GetWorkersCount() << std::endl;
+
+	auto start = std::chrono::steady_clock::now();
+
+	long long generation = 0;
+	bool stable = false;
+	while ( generation < hparams.generations )
+	{
+		bool changed = false;
+		{
+			TRACE_ZONE("Step");
+			changed = lenia.Step(&workers);
+		}
+		++generation;
+
+		if ( !changed || (lenia.GetMass() == 0) )
+		{
+			stable = true;
+			break;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if ( stable )
+		std::cout << "The field has become stable at generation " << generation << std::endl;
+
+	double cells = double(hparams.cells_x) * hparams.cells_y * generation;
+	std::cout << "Generations: " << generation << ", time: " << seconds << " s";
+	if ( seconds > 0 )
+		std::cout << ", " << generation / seconds << " gen/s, " << cells / seconds / 1e6 << " Mcells/s";
+	std::cout << std::endl;
+	std::cout << "Mass: " << lenia.GetMass() << std::endl;
+
+	return 0;
+}
+
+}
+
+
+/*
+ * Считает заданное число поколений без SDL-окна и печатает скорость.
+ * Если включена запись, каждое поколение(включая начальное) отправляется в FrameCapture.
+ * С --lenia считается непрерывное поле вместо клеток
+ */
+int runHeadless(const HeadlessParams& hparams, const EngineParams& eparams)
+{
+	if ( eparams.lenia.enabled )
+		return runHeadlessLenia(hparams, eparams);
+
+	Grid grid(hparams.cells_x, hparams.cells_y, eparams.toroidal);
+	WorkerPool workers(eparams.threads);
+	if ( eparams.pin_threads )
+		workers.PinThreads();
+
+	// Страницы полос достаются узлам NUMA их исполнителей, поэтому поле размещается до заполнения
+	if ( eparams.huge_pages || (workers.GetWorkersCount() > 1) )
+		grid.PlaceBuffers(eparams.huge_pages, &workers);
+
+	if ( !seedGrid(hparams, grid) )
+		return 1;
+	grid.EnableActivity(eparams.activity);
+	grid.EnableBounds(eparams.bounded);
+
+	StepKernel kernel = getStepKernel(selectStepKernel(eparams, hparams.cells_x, hparams.cells_y));
+
+	std::cout << "Headless run: " << hparams.cells_x << "x" << hparams.cells_y << (eparams.toroidal ? " torus" : " bordered")
+			  << ", " << hparams.generations << " generations, threads: " << workers.GetWorkersCount()
+			  << (eparams.activity ? ", activity layer" : "") << ", " << getPagesKindName(grid.GetPagesKind())
+			  << (eparams.pin_threads ? ", pinned" : "") << std::endl;
+
+	FramePublisher* publisher = nullptr;
+	if ( !eparams.publish_name.empty() )
+	{
+		publisher = new FramePublisher(eparams.publish_name.c_str());
+		if ( !publisher->Publish(grid, 0) )
+		{
+			delete publisher;
+			return 1;
+		}
+	}
+
+	StreamServer* server = nullptr;
+	if ( !eparams.serve_spec.empty() )
+	{
+		StreamAddress address;
+		parseStreamSpec(eparams.serve_spec.c_str(), address);
+		server = new StreamServer(address);
+		if ( !server->Start() )
+		{
+			delete server;
+			if ( publisher )
+				delete publisher;
+			return 1;
+		}
+		server->Submit(grid, 0);
+	}
+
+	FrameCapture* capture = nullptr;
+	if ( hparams.capture.format != CAPTURE_FORMAT_NONE )
+	{
+		capture = new FrameCapture(hparams.capture, hparams.cells_x, hparams.cells_y);
+		if ( !capture->Start() )
+		{
+			delete capture;
+			if ( server )
+				delete server;
+			if ( publisher )
+				delete publisher;
+			return 1;
+		}
+		capture->Submit(grid);
+	}
+
+	Census* census = nullptr;
+	Grid* checkpoint = nullptr;				// поле последнего полного пересчёта переписи перед отложенными
+	long long census_generation = 0;
+	if ( hparams.census )
+	{
+		census = new Census(hparams.cells_x, hparams.cells_y, eparams.toroidal);
+		census->Update(grid);
+		checkpoint = new Grid(hparams.cells_x, hparams.cells_y, eparams.toroidal);
+		checkpoint->CopyFrom(grid);
+	}
+
+	// Индекс обновляется только к отчётам: между ними он поправляет лишь слова, изменившиеся за всё это время
+	RegionIndex* regions = nullptr;
+	long long next_report = -1;
+	if ( !hparams.regions.empty() || hparams.block_stats )
+	{
+		regions = new RegionIndex(hparams.cells_x, hparams.cells_y);
+		if ( hparams.region_interval > 0 )
+		{
+			regions->Update(grid);
+			printRegions(hparams, *regions, 0);
+			next_report = hparams.region_interval;
+		}
+	}
+
+	// Перепись и запись смотрят каждое поколение, поэтому с ними поле считается по одному поколению
+	int depth = hparams.temporal_depth;
+	if ( (depth > 1) && (census || capture) )
+	{
+		std::cout << "Temporal blocking needs every generation to be skipped and is disabled with census and capture" << std::endl;
+		depth = 1;
+	}
+	else if ( depth > 1 )
+		std::cout << "Temporal blocking: " << depth << " generations per pass" << std::endl;
+
+	// Плитки Мортона считают поле сами и переносятся в строки только в конце, поэтому всё, что смотрит на поле по ходу, их отключает
+	MortonGrid* tiles = nullptr;
+	if ( eparams.layout == GRID_LAYOUT_MORTON )
+	{
+		if ( !isMortonLayoutSupported(hparams.cells_x, hparams.cells_y, eparams.toroidal, eparams.rule) )
+			std::cout << "Morton layout needs a B/S rule and torus sides divisible by " << MORTON_TILE_SIZE << ", rows are used" << std::endl;
+		else if ( census || capture || publisher || server || (next_report > 0) || (depth > 1) || eparams.activity )
+			std::cout << "Morton layout is not used with census, capture, publishing, streaming, region reports, temporal blocking and the activity layer" << std::endl;
+		else
+		{
+			tiles = new MortonGrid(hparams.cells_x, hparams.cells_y, eparams.toroidal);
+			tiles->Load(grid);
+			std::cout << "Morton layout: " << tiles->GetTilesCount() << " tiles " << MORTON_TILE_SIZE << "x" << MORTON_TILE_SIZE << std::endl;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	long long generation = 0;
+	bool stable = false;
+	int settled = 0;
+	while ( generation < hparams.generations )
+	{
+		// Правки клиентов потока применяются на границе поколений(прохода временного блокирования)
+		if ( server )
+		{
+			EditCommand cmd;
+			while ( server->GetEdits()->Pop(cmd) )
+				applyEditToGrid(cmd, grid);
+		}
+
+		bool changed = false;
+		int count = int(std::min<long long>(depth, hparams.generations - generation));
+		{
+			TRACE_ZONE("Step");
+			if ( tiles )
+				changed = tiles->Step(eparams.rule, &workers);
+			else if ( count > 1 )
+				changed = grid.StepBlocked(eparams.rule, kernel, count, &workers);
+			else
+				changed = grid.Step(eparams.rule, kernel, &workers);
+		}
+		generation += count;
+
+		if ( capture )
+			capture->Submit(grid);
+		if ( publisher )
+			publisher->Publish(grid, generation);
+		if ( server )
+			server->Submit(grid, generation);
+		if ( regions && (next_report > 0) && (generation >= next_report) && (generation < hparams.generations) )
+		{
+			TRACE_ZONE("Regions");
+			regions->Update(grid);
+			printRegions(hparams, *regions, generation);
+			next_report = (generation / hparams.region_interval + 1) * hparams.region_interval;
+		}
+
+		if ( !changed )
+		{
+			stable = true;
+			break;
+		}
+
+		// "Суп" устоялся, когда все объекты поля известны несколько поколений подряд
+		// Правки клиентов потока не повторить, поэтому с сервером перепись не откладывается
+		if ( census )
+		{
+			TRACE_ZONE("Census");
+			census->Update(grid, server != nullptr);
+			if ( !census->IsStale() )
+			{
+				if ( census->IsSettled() && (generation - census_generation > 1) )
+					settled = replayCensus(*census, *checkpoint, generation - census_generation, eparams.rule, kernel, &workers);
+				else
+					settled = census->IsSettled() ? settled + 1 : 0;
+
+				census_generation = generation;
+				if ( census->GetDeferredCount() > 0 )
+					checkpoint->CopyFrom(grid);
+			}
+			else
+				settled = 0;
+			if ( settled >= CENSUS_STABLE_GENERATIONS )
+				break;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if ( tiles )
+	{
+		tiles->Store(grid);
+		delete tiles;
+	}
+
+	if ( capture )
+	{
+		capture->Stop();
+		delete capture;
+	}
+
+	if ( publisher )
+		delete publisher;
+
+	if ( server )
+		delete server;
+
+	if ( stable )
+		std::cout << "The field has become stable at generation " << generation << std::endl;
+
+	double cells = double(hparams.cells_x) * hparams.cells_y * generation;
+	std::cout << "Generations: " << generation << ", time: " << seconds << " s";
+	if ( seconds > 0 )
+		std::cout << ", " << generation / seconds << " gen/s, " << cells / seconds / 1e6 << " Mcells/s";
+	std::cout << std::endl;
+	std::cout << "Population: " << grid.CountPopulation() << std::endl;
+
+	if ( regions )
+	{
+		regions->Update(grid);
+		printRegions(hparams, *regions, generation);
+		delete regions;
+	}
+
+	if ( census )
+	{
+		// Отложенная перепись досчитывается до последнего поколения
+		if ( census->IsStale() )
+			census->Update(grid, true);
+		if ( settled >= CENSUS_STABLE_GENERATIONS )
+			std::cout << "The soup has stabilised at generation " << generation - settled << std::endl;
+		census->Print(std::cout);
+		delete census;
+		delete checkpoint;
+	}
+
+	return 0;
+}
+
+#endif
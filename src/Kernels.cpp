@@ -0,0 +1,320 @@
+#ifndef KERNELS_CPP
+#define KERNELS_CPP
+
+
+#include "../includes/Kernels.hpp"
+#include "../includes/KernelImpl.hpp"
+#include "../includes/Autotune.hpp"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(GOL_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(GOL_X86)
+#include <cpuid.h>
+#endif
+
+
+namespace
+{
+
+struct VecSwar64
+{
+	typedef uint64_t type;
+	enum { WORDS = 1 };
+	static type load(const uint64_t* p) { return *p; }
+	static type loadu(const uint64_t* p) { return *p; }
+	static void store(uint64_t* p, type v) { *p = v; }
+	static type and_(type a, type b) { return a & b; }
+	static type or_(type a, type b) { return a | b; }
+	static type xor_(type a, type b) { return a ^ b; }
+	static type andnot(type a, type b) { return ~a & b; }
+	static type shl1(type a) { return a << 1; }
+	static type shr1(type a) { return a >> 1; }
+	static type shl63(type a) { return a << 63; }
+	static type shr63(type a) { return a >> 63; }
+	static type zero(void) { return 0; }
+	static type ones(void) { return ~uint64_t(0); }
+	static bool any(type a) { return a != 0; }
+};
+
+// Байты 0/1 для каждого значения байта слова, по возрастанию номера бита
+struct ByteExpandTable
+{
+	uint64_t bytes[256];
+	ByteExpandTable()
+	{
+		for ( int v = 0; v < 256; ++v )
+		{
+			unsigned char expanded[8];
+			for ( int b = 0; b < 8; ++b )
+				expanded[b] = (v >> b) & 1;
+			memcpy(&bytes[v], expanded, sizeof(expanded));
+		}
+	}
+};
+
+const ByteExpandTable byte_expand_table;
+
+// Распаковывает строку из vec_words слов вместе с ореолом в массив байт длиной vec_words * 64 + 2
+void unpackRow(const uint64_t* row, int vec_words, unsigned char* bytes)
+{
+	bytes[0] = (row[-1] >> (GRID_WORD_BITS - 1)) & 1;
+	for ( int i = 0; i < vec_words; ++i )
+	{
+		uint64_t word = row[i];
+		for ( int b = 0; b < GRID_WORD_BITS / 8; ++b )
+			memcpy(bytes + 1 + i * GRID_WORD_BITS + b * 8, &byte_expand_table.bytes[(word >> (b * 8)) & 0xFF], 8);
+	}
+	bytes[1 + vec_words * GRID_WORD_BITS] = row[vec_words] & 1;
+}
+
+}
+
+
+/*
+ * Простейшее ядро: строки распаковываются по байту на клетку, число соседей считается
+ * через суммы по столбцам, а следующее состояние берётся из таблицы правила
+ */
+bool stepKernelScalarByte(const StepArgs& args)
+{
+	int line_size = args.vec_words * GRID_WORD_BITS + 2;
+	std::vector<unsigned char> lines(line_size * 3);
+	std::vector<unsigned char> column_sums(line_size);
+	unsigned char* up = lines.data();
+	unsigned char* mid = up + line_size;
+	unsigned char* down = mid + line_size;
+
+	unsigned char table[2][9];
+	for ( int n = 0; n <= 8; ++n )
+	{
+		table[0][n] = (args.rule.birth >> n) & 1;
+		table[1][n] = (args.rule.survive >> n) & 1;
+	}
+
+	uint64_t diff = 0;
+
+	for ( int y = args.row_begin; y < args.row_end; ++y )
+	{
+		unpackRow(args.src + (y - 1) * args.stride, args.vec_words, up);
+		unpackRow(args.src + y * args.stride, args.vec_words, mid);
+		unpackRow(args.src + (y + 1) * args.stride, args.vec_words, down);
+
+		for ( int x = 0; x < line_size; ++x )
+			column_sums[x] = up[x] + mid[x] + down[x];
+
+		const uint64_t* in = args.src + y * args.stride;
+		uint64_t* out = args.dst + y * args.stride;
+		for ( int i = 0; i < args.vec_words; ++i )
+		{
+			uint64_t word = 0;
+			for ( int b = 0; b < GRID_WORD_BITS; ++b )
+			{
+				int x = 1 + i * GRID_WORD_BITS + b;
+				int count = column_sums[x - 1] + column_sums[x] + column_sums[x + 1] - mid[x];
+				word |= uint64_t(table[mid[x]][count]) << b;
+			}
+
+			word &= args.mask[i];
+			diff |= word ^ (in[i] & args.mask[i]);
+			out[i] = word;
+		}
+
+		if ( args.age )
+			updateActivity(out, in, args.mask, args.vec_words, args.age + size_t(y) * args.activity_stride, args.heat + size_t(y) * args.activity_stride);
+	}
+
+	return diff != 0;
+}
+
+// Битово-параллельное ядро на обычных 64-битных словах(SWAR): 64 клетки за операцию
+bool stepKernelSwar64(const StepArgs& args)
+{
+	return stepKernelBitsliced<VecSwar64>(args);
+}
+
+
+
+
+
+
+
+
+namespace
+{
+
+struct CpuFeatures
+{
+	bool sse2;
+	bool avx2;
+	bool avx512f;
+};
+
+#ifdef GOL_X86
+void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, int(leaf), int(subleaf));
+	for ( int i = 0; i < 4; ++i )
+		regs[i] = static_cast<unsigned int>(r[i]);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Какие части регистрового состояния сохраняет ОС(XCR0)
+unsigned long long readXcr0(void)
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile ( "xgetbv" : "=a"(eax), "=d"(edx) : "c"(0) );
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures detectCpuFeatures(void)
+{
+	CpuFeatures features { false, false, false };
+
+#ifdef GOL_X86
+	unsigned int regs[4];
+	cpuid(0, 0, regs);
+	unsigned int max_leaf = regs[0];
+	if ( max_leaf < 1 )
+		return features;
+
+	cpuid(1, 0, regs);
+	features.sse2 = (regs[3] >> 26) & 1;
+	bool osxsave = (regs[2] >> 27) & 1;
+	if ( !osxsave || (max_leaf < 7) )
+		return features;
+
+	unsigned long long xcr0 = readXcr0();
+	bool ymm_state = (xcr0 & 0x6) == 0x6;
+	bool zmm_state = (xcr0 & 0xE6) == 0xE6;
+
+	cpuid(7, 0, regs);
+	features.avx2 = ymm_state && ((regs[1] >> 5) & 1);
+	features.avx512f = zmm_state && ((regs[1] >> 16) & 1);
+#endif
+
+	return features;
+}
+
+const CpuFeatures& getCpuFeatures(void)
+{
+	static const CpuFeatures features = detectCpuFeatures();
+	return features;
+}
+
+const char* const step_kernel_names[STEP_KERNELS_COUNT] =
+{
+	"scalar",
+	"swar64",
+	"sse2",
+	"avx2",
+	"avx512"
+};
+
+}
+
+
+StepKernel getStepKernel(int kernel_id)
+{
+	switch ( kernel_id )
+	{
+		case STEP_KERNEL_SCALAR_BYTE:
+			return stepKernelScalarByte;
+		case STEP_KERNEL_SWAR64:
+			return stepKernelSwar64;
+#ifdef GOL_X86
+		case STEP_KERNEL_SSE2:
+			return stepKernelSSE2;
+		case STEP_KERNEL_AVX2:
+			return stepKernelAVX2;
+		case STEP_KERNEL_AVX512:
+			return stepKernelAVX512;
+#endif
+	}
+
+	return nullptr;
+}
+
+const char* getStepKernelName(int kernel_id)
+{
+	if ( (kernel_id < 0) || (kernel_id >= STEP_KERNELS_COUNT) )
+		return "unknown";
+
+	return step_kernel_names[kernel_id];
+}
+
+int findStepKernelByName(const char* name)
+{
+	for ( int i = 0; i < STEP_KERNELS_COUNT; ++i )
+		if ( strcmp(step_kernel_names[i], name) == 0 )
+			return i;
+
+	return -1;
+}
+
+bool isStepKernelSupported(int kernel_id)
+{
+	const CpuFeatures& features = getCpuFeatures();
+
+	switch ( kernel_id )
+	{
+		case STEP_KERNEL_SCALAR_BYTE:
+		case STEP_KERNEL_SWAR64:
+			return true;
+		case STEP_KERNEL_SSE2:
+			return features.sse2;
+		case STEP_KERNEL_AVX2:
+			return features.avx2;
+		case STEP_KERNEL_AVX512:
+			return features.avx512f;
+	}
+
+	return false;
+}
+
+// Самое широкое ядро, которое поддерживает текущий процессор
+int detectBestStepKernel(void)
+{
+	for ( int i = STEP_KERNELS_COUNT - 1; i >= 0; --i )
+		if ( isStepKernelSupported(i) && getStepKernel(i) )
+			return i;
+
+	return STEP_KERNEL_SWAR64;
+}
+
+// Ядро шага: заданное явно, лучшее по замеру на размерах поля или лучшее по CPUID
+int selectStepKernel(const EngineParams& eparams, int cells_x, int cells_y)
+{
+	int kernel_id = eparams.step_kernel;
+
+	if ( (kernel_id >= 0) && (!isStepKernelSupported(kernel_id) || !getStepKernel(kernel_id)) )
+	{
+		std::cout << "Step kernel " << getStepKernelName(kernel_id) << " is not supported by this CPU!" << std::endl;
+		kernel_id = -1;
+	}
+
+	if ( kernel_id < 0 )
+	{
+		if ( eparams.autotune )
+			kernel_id = autotuneStepKernel(cells_x, cells_y, eparams.toroidal, eparams.rule, eparams.autotune_cache.c_str());
+		else
+			kernel_id = detectBestStepKernel();
+	}
+
+	std::cout << "Step kernel: " << getStepKernelName(kernel_id) << std::endl;
+	std::cout << "Rule: " << lifeRuleToString(eparams.rule) << std::endl;
+
+	return kernel_id;
+}
+
+#endif
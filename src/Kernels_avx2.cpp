@@ -0,0 +1,50 @@
+#ifndef KERNELS_AVX2_CPP
+#define KERNELS_AVX2_CPP
+
+
+#include "../includes/Kernels.hpp"
+
+#ifdef GOL_X86
+
+#include "../includes/KernelImpl.hpp"
+#include <immintrin.h>
+
+
+namespace
+{
+
+struct VecAVX2
+{
+	typedef __m256i type;
+	enum { WORDS = 4 };
+	static type load(const uint64_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+	static type loadu(const uint64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	static void store(uint64_t* p, type v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+	static type and_(type a, type b) { return _mm256_and_si256(a, b); }
+	static type or_(type a, type b) { return _mm256_or_si256(a, b); }
+	static type xor_(type a, type b) { return _mm256_xor_si256(a, b); }
+	static type andnot(type a, type b) { return _mm256_andnot_si256(a, b); }
+	static type shl1(type a) { return _mm256_slli_epi64(a, 1); }
+	static type shr1(type a) { return _mm256_srli_epi64(a, 1); }
+	static type shl63(type a) { return _mm256_slli_epi64(a, 63); }
+	static type shr63(type a) { return _mm256_srli_epi64(a, 63); }
+	static type zero(void) { return _mm256_setzero_si256(); }
+	static type ones(void) { return _mm256_set1_epi32(-1); }
+	static bool any(type a) { return !_mm256_testz_si256(a, a); }
+};
+
+}
+
+
+// 256 клеток за операцию
+bool stepKernelAVX2(const StepArgs& args)
+{
+	bool changed = stepKernelBitsliced<VecAVX2>(args);
+	_mm256_zeroupper();
+
+	return changed;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef KERNELS_AVX512_CPP
+#define KERNELS_AVX512_CPP
+
+
+#include "../includes/Kernels.hpp"
+
+#ifdef GOL_X86
+
+#include "../includes/KernelImpl.hpp"
+
+// Ложные предупреждения GCC о _mm512_undefined_epi32 внутри сдвигов и andnot
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include <immintrin.h>
+
+
+namespace
+{
+
+// Достаточно AVX-512F: все операции выполняются над 64-битными словами
+struct VecAVX512
+{
+	typedef __m512i type;
+	enum { WORDS = 8 };
+	static type load(const uint64_t* p) { return _mm512_load_si512(p); }
+	static type loadu(const uint64_t* p) { return _mm512_loadu_si512(p); }
+	static void store(uint64_t* p, type v) { _mm512_store_si512(p, v); }
+	static type and_(type a, type b) { return _mm512_and_si512(a, b); }
+	static type or_(type a, type b) { return _mm512_or_si512(a, b); }
+	static type xor_(type a, type b) { return _mm512_xor_si512(a, b); }
+	static type andnot(type a, type b) { return _mm512_andnot_si512(a, b); }
+	static type shl1(type a) { return _mm512_slli_epi64(a, 1); }
+	static type shr1(type a) { return _mm512_srli_epi64(a, 1); }
+	static type shl63(type a) { return _mm512_slli_epi64(a, 63); }
+	static type shr63(type a) { return _mm512_srli_epi64(a, 63); }
+	static type zero(void) { return _mm512_setzero_si512(); }
+	static type ones(void) { return _mm512_set1_epi32(-1); }
+	static bool any(type a) { return _mm512_test_epi64_mask(a, a) != 0; }
+};
+
+}
+
+
+// 512 клеток за операцию
+bool stepKernelAVX512(const StepArgs& args)
+{
+	bool changed = stepKernelBitsliced<VecAVX512>(args);
+	_mm256_zeroupper();
+
+	return changed;
+}
+
+#endif
+
+#endif
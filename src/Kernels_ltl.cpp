@@ -0,0 +1,260 @@
+#ifndef KERNELS_LTL_CPP
+#define KERNELS_LTL_CPP
+
+
+#include "../includes/Kernels.hpp"
+#include "../includes/KernelImpl.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+
+namespace
+{
+
+int wrapIndex(int v, int size)
+{
+	v %= size;
+	return (v < 0) ? v + size : v;
+}
+
+/*
+ * Кольцо распакованных строк(по байту на клетку) с полями по pad клеток слева и справа.
+ * Строки и столбцы за краем поля берутся с другой стороны на торе и пустыми иначе
+ */
+class RowRing
+{
+	const StepArgs& args;
+	int pad;
+	int slots;
+	std::vector<unsigned char> cells;
+public:
+	int line_size;
+
+	RowRing(const StepArgs& a, int p, int count)
+		: args(a), pad(p), slots(count), cells(size_t(count) * (a.width + 2 * p)), line_size(a.width + 2 * p) {}
+
+	int Slot(int y) const { return wrapIndex(y, slots); }
+	const unsigned char* Row(int y) const { return cells.data() + size_t(Slot(y)) * line_size; }
+
+	const unsigned char* Load(int y)
+	{
+		unsigned char* line = cells.data() + size_t(Slot(y)) * line_size;
+		if ( args.toroidal )
+			y = wrapIndex(y, args.height);
+		else if ( (y < 0) || (y >= args.height) )
+		{
+			std::fill(line, line + line_size, 0);
+			return line;
+		}
+
+		const uint64_t* row = args.src + y * args.stride;
+		for ( int x = 0; x < args.width; ++x )
+			line[pad + x] = (row[x / GRID_WORD_BITS] >> (x % GRID_WORD_BITS)) & 1;
+
+		for ( int p = 0; p < pad; ++p )
+		{
+			int left = p - pad;
+			int right = args.width + p;
+			line[p] = args.toroidal ? line[pad + wrapIndex(left, args.width)] : 0;
+			line[pad + right] = args.toroidal ? line[pad + wrapIndex(right, args.width)] : 0;
+		}
+
+		return line;
+	}
+};
+
+// Следующее состояние клетки по числу живых клеток окрестности
+inline uint64_t ltlNext(const LifeRule& rule, int alive, int count)
+{
+	if ( !rule.middle )
+		count -= alive;
+
+	if ( alive )
+		return (count >= rule.survive_min) && (count <= rule.survive_max);
+
+	return (count >= rule.birth_min) && (count <= rule.birth_max);
+}
+
+// Упаковывает строку следующего поколения в слова, возвращает отличия от текущей
+uint64_t storeRow(const StepArgs& args, int y, const unsigned char* next)
+{
+	const uint64_t* in = args.src + y * args.stride;
+	uint64_t* out = args.dst + y * args.stride;
+	uint64_t diff = 0;
+
+	for ( int i = 0; i < args.vec_words; ++i )
+	{
+		uint64_t word = 0;
+		int bits = std::min(int(GRID_WORD_BITS), args.width - i * GRID_WORD_BITS);
+		for ( int b = 0; b < bits; ++b )
+			word |= uint64_t(next[i * GRID_WORD_BITS + b]) << b;
+
+		word &= args.mask[i];
+		diff |= word ^ (in[i] & args.mask[i]);
+		out[i] = word;
+	}
+
+	if ( args.age )
+		updateActivity(out, in, args.mask, args.vec_words, args.age + size_t(y) * args.activity_stride, args.heat + size_t(y) * args.activity_stride);
+
+	return diff;
+}
+
+/*
+ * Окрестность Мура: суммы по столбцам квадрата 2R+1 строк обновляются при переходе на следующую строку
+ * добавлением входящей и вычитанием уходящей строки, сумма квадрата - скользящим окном по суммам столбцов.
+ * Цена клетки не зависит от радиуса
+ */
+uint64_t stepMoore(const StepArgs& args)
+{
+	int radius = args.rule.radius;
+	int pad = radius + 1;
+	RowRing ring(args, pad, 2 * radius + 2);
+	std::vector<int> columns(ring.line_size, 0);
+	std::vector<unsigned char> next(args.vec_words * GRID_WORD_BITS, 0);
+	uint64_t diff = 0;
+
+	for ( int y = args.row_begin - radius; y <= args.row_begin + radius; ++y )
+	{
+		const unsigned char* line = ring.Load(y);
+		for ( int p = 0; p < ring.line_size; ++p )
+			columns[p] += line[p];
+	}
+
+	for ( int y = args.row_begin; y < args.row_end; ++y )
+	{
+		if ( y > args.row_begin )
+		{
+			const unsigned char* gone = ring.Row(y - radius - 1);
+			for ( int p = 0; p < ring.line_size; ++p )
+				columns[p] -= gone[p];
+
+			const unsigned char* line = ring.Load(y + radius);
+			for ( int p = 0; p < ring.line_size; ++p )
+				columns[p] += line[p];
+		}
+
+		const unsigned char* mid = ring.Row(y);
+		int sum = 0;
+		for ( int p = pad - radius; p <= pad + radius; ++p )
+			sum += columns[p];
+
+		for ( int x = 0; x < args.width; ++x )
+		{
+			int p = pad + x;
+			if ( x > 0 )
+				sum += columns[p + radius] - columns[p - radius - 1];
+			next[x] = static_cast<unsigned char>(ltlNext(args.rule, mid[p], sum));
+		}
+
+		diff |= storeRow(args, y, next.data());
+	}
+
+	return diff;
+}
+
+/*
+ * Окрестность фон Неймана(ромб |dx| + |dy| <= R). При сдвиге ромба на клетку вправо добавляются
+ * клетки двух диагоналей его правой границы и убираются две диагонали левой. Суммы по диагоналям
+ * берутся разностью диагональных префиксных сумм:
+ * A[y][p] = c[y][p] + A[y - 1][p + 1], B[y][p] = c[y][p] + B[y - 1][p - 1],
+ * поэтому цена клетки тоже не зависит от радиуса. Первый ромб строки считается напрямую
+ */
+uint64_t stepVonNeumann(const StepArgs& args)
+{
+	int radius = args.rule.radius;
+	int pad = radius + 1;
+	int slots = 2 * radius + 2;
+	RowRing ring(args, pad, slots);
+	int line_size = ring.line_size;
+	std::vector<int> diag_a(size_t(slots) * line_size, 0);
+	std::vector<int> diag_b(size_t(slots) * line_size, 0);
+	std::vector<unsigned char> next(args.vec_words * GRID_WORD_BITS, 0);
+	uint64_t diff = 0;
+
+	auto a = [&](int y) { return diag_a.data() + size_t(ring.Slot(y)) * line_size; };
+	auto b = [&](int y) { return diag_b.data() + size_t(ring.Slot(y)) * line_size; };
+
+	// Первая строка кольца начинает префиксные суммы с нуля: используются только их разности
+	int first = args.row_begin - radius - 1;
+	auto load = [&](int y)
+	{
+		const unsigned char* line = ring.Load(y);
+		int* a_row = a(y);
+		int* b_row = b(y);
+		if ( y == first )
+		{
+			std::copy(line, line + line_size, a_row);
+			std::copy(line, line + line_size, b_row);
+			return;
+		}
+
+		const int* a_up = a(y - 1);
+		const int* b_up = b(y - 1);
+		a_row[line_size - 1] = line[line_size - 1];
+		b_row[0] = line[0];
+		for ( int p = 0; p < line_size - 1; ++p )
+		{
+			a_row[p] = line[p] + a_up[p + 1];
+			b_row[p + 1] = line[p + 1] + b_up[p];
+		}
+	};
+
+	for ( int y = first; y < args.row_begin + radius; ++y )
+		load(y);
+
+	for ( int y = args.row_begin; y < args.row_end; ++y )
+	{
+		load(y + radius);
+
+		int sum = 0;
+		for ( int dy = -radius; dy <= radius; ++dy )
+		{
+			const unsigned char* line = ring.Row(y + dy);
+			int span = radius - std::abs(dy);
+			for ( int p = pad - span; p <= pad + span; ++p )
+				sum += line[p];
+		}
+
+		// Разности диагоналей для ромба в столбце p: строки y - R - 1, y и y + R
+		const int* a_top = a(y - radius - 1);
+		const int* a_mid = a(y);
+		const int* a_bottom = a(y + radius);
+		const int* b_top = b(y - radius - 1);
+		const int* b_mid = b(y);
+		const int* b_bottom = b(y + radius);
+		const unsigned char* mid = ring.Row(y);
+		next[0] = static_cast<unsigned char>(ltlNext(args.rule, mid[pad], sum));
+		for ( int x = 1; x < args.width; ++x )
+		{
+			int p = pad + x;
+			int added = b_mid[p + radius] - b_top[p - 1] + a_bottom[p] - a_mid[p + radius];
+			int removed = a_mid[p - radius - 1] - a_top[p] + b_bottom[p - 1] - b_mid[p - radius - 1];
+			sum += added - removed;
+			next[x] = static_cast<unsigned char>(ltlNext(args.rule, mid[p], sum));
+		}
+
+		diff |= storeRow(args, y, next.data());
+	}
+
+	return diff;
+}
+
+}
+
+
+/*
+ * Ядро правил Larger than Life: окрестность радиуса до LIFE_MAX_RADIUS выходит за ореол поля,
+ * поэтому строки читаются напрямую из поля(с переходом через край на торе), а число живых клеток
+ * считается скользящими суммами за O(1) на клетку при любом радиусе
+ */
+bool stepKernelLargerThanLife(const StepArgs& args)
+{
+	if ( args.rule.neighbourhood == LIFE_NEIGHBOURHOOD_VON_NEUMANN )
+		return stepVonNeumann(args) != 0;
+
+	return stepMoore(args) != 0;
+}
+
+#endif
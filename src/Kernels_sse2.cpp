@@ -0,0 +1,47 @@
+#ifndef KERNELS_SSE2_CPP
+#define KERNELS_SSE2_CPP
+
+
+#include "../includes/Kernels.hpp"
+
+#ifdef GOL_X86
+
+#include "../includes/KernelImpl.hpp"
+#include <emmintrin.h>
+
+
+namespace
+{
+
+struct VecSSE2
+{
+	typedef __m128i type;
+	enum { WORDS = 2 };
+	static type load(const uint64_t* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+	static type loadu(const uint64_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	static void store(uint64_t* p, type v) { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+	static type and_(type a, type b) { return _mm_and_si128(a, b); }
+	static type or_(type a, type b) { return _mm_or_si128(a, b); }
+	static type xor_(type a, type b) { return _mm_xor_si128(a, b); }
+	static type andnot(type a, type b) { return _mm_andnot_si128(a, b); }
+	static type shl1(type a) { return _mm_slli_epi64(a, 1); }
+	static type shr1(type a) { return _mm_srli_epi64(a, 1); }
+	static type shl63(type a) { return _mm_slli_epi64(a, 63); }
+	static type shr63(type a) { return _mm_srli_epi64(a, 63); }
+	static type zero(void) { return _mm_setzero_si128(); }
+	static type ones(void) { return _mm_set1_epi32(-1); }
+	static bool any(type a) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) != 0xFFFF; }
+};
+
+}
+
+
+// 128 клеток за операцию
+bool stepKernelSSE2(const StepArgs& args)
+{
+	return stepKernelBitsliced<VecSSE2>(args);
+}
+
+#endif
+
+#endif
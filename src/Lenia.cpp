@@ -0,0 +1,676 @@
+#ifndef LENIA_CPP
+#define LENIA_CPP
+
+
+#include "../includes/Lenia.hpp"
+#include "../includes/Grid.hpp"
+#include "../includes/Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+
+
+namespace
+{
+
+const double pi = 3.14159265358979323846;
+
+// Умножение без проверок на NaN и бесконечности, которые делает operator* для std::complex
+inline FFTComplex cmul(FFTComplex a, FFTComplex b)
+{
+	return FFTComplex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+bool isPowerOfTwo(int n)
+{
+	return (n > 0) && ((n & (n - 1)) == 0);
+}
+
+// Диапазон [begin, end) части part из parts частей
+void splitRange(int count, int part, int parts, int& begin, int& end)
+{
+	begin = int((long long)count * part / parts);
+	end = int((long long)count * (part + 1) / parts);
+}
+
+}
+
+
+LeniaParams defaultLeniaParams(void)
+{
+	LeniaParams params;
+	params.enabled = false;
+	params.radius = LENIA_DEFAULT_RADIUS;
+	params.mu = lenia_default_mu;
+	params.sigma = lenia_default_sigma;
+	params.dt = lenia_default_dt;
+	params.rings_count = 1;
+	for ( int i = 0; i < LENIA_MAX_RINGS; ++i )
+		params.rings[i] = (i == 0) ? 1.0 : 0.0;
+
+	return params;
+}
+
+/*
+ * Разбирает параметры вида "R=13,mu=0.15,sigma=0.015,dt=0.1,b=1/0.5"(любые части можно опустить).
+ * T=10 - то же, что dt=0.1, b - высоты колец ядра от центра к краю
+ */
+bool parseLeniaParams(const char* str, LeniaParams& params)
+{
+	LeniaParams result = defaultLeniaParams();
+	result.enabled = true;
+
+	std::string s = str ? str : "";
+	std::istringstream parts(s);
+	std::string part;
+	while ( std::getline(parts, part, ',') )
+	{
+		size_t eq = part.find('=');
+		if ( eq == std::string::npos )
+			return false;
+
+		std::string key = part.substr(0, eq);
+		const char* value = part.c_str() + eq + 1;
+		char* end = nullptr;
+
+		if ( key == "b" )
+		{
+			result.rings_count = 0;
+			std::istringstream rings(value);
+			std::string ring;
+			while ( std::getline(rings, ring, '/') )
+			{
+				if ( result.rings_count >= LENIA_MAX_RINGS )
+					return false;
+				double height = strtod(ring.c_str(), &end);
+				if ( (end == ring.c_str()) || *end || (height < 0) )
+					return false;
+				result.rings[result.rings_count++] = height;
+			}
+			if ( result.rings_count == 0 )
+				return false;
+			continue;
+		}
+
+		double v = strtod(value, &end);
+		if ( (end == value) || *end )
+			return false;
+
+		if ( key == "R" )
+			result.radius = int(v);
+		else if ( key == "T" )
+			result.dt = (v > 0) ? 1.0 / v : -1.0;
+		else if ( key == "dt" )
+			result.dt = v;
+		else if ( key == "mu" )
+			result.mu = v;
+		else if ( key == "sigma" )
+			result.sigma = v;
+		else
+			return false;
+	}
+
+	if ( (result.radius < 1) || (result.radius > LENIA_MAX_RADIUS) || (result.dt <= 0) || (result.dt > 1) || (result.sigma <= 0) )
+		return false;
+
+	params = result;
+	return true;
+}
+
+std::string leniaParamsToString(const LeniaParams& params)
+{
+	std::ostringstream out;
+	out << "R=" << params.radius << ",mu=" << params.mu << ",sigma=" << params.sigma << ",dt=" << params.dt << ",b=";
+	for ( int i = 0; i < params.rings_count; ++i )
+		out << (i ? "/" : "") << params.rings[i];
+
+	return out.str();
+}
+
+// Ядро на расстоянии distance клеток от центра, без нормировки
+float leniaKernelValue(const LeniaParams& params, double distance)
+{
+	double r = distance / params.radius * params.rings_count;
+	int ring = int(r);
+	if ( (ring >= params.rings_count) || (params.rings_count == 0) )
+		return 0;
+
+	double t = r - ring;
+	if ( (t <= 0) || (t >= 1) )
+		return 0;
+
+	return float(params.rings[ring] * exp(4.0 - 1.0 / (t * (1.0 - t))));
+}
+
+float leniaGrowth(const LeniaParams& params, float potential)
+{
+	float d = potential - float(params.mu);
+	return 2.0f * expf(-d * d / float(2.0 * params.sigma * params.sigma)) - 1.0f;
+}
+
+
+
+
+
+
+
+
+FFTPlan::FFTPlan()
+{
+}
+
+FFTPlan::FFTPlan(const FFTPlan& p)
+{
+}
+
+FFTPlan::FFTPlan(FFTPlan&& p)
+{
+}
+
+FFTPlan::FFTPlan(int size)
+{
+	n = size;
+
+	if ( isPowerOfTwo(n) )
+	{
+		int bits = 0;
+		while ( (1 << bits) < n )
+			++bits;
+
+		bit_reverse.resize(n);
+		for ( int i = 0; i < n; ++i )
+		{
+			int r = 0;
+			for ( int b = 0; b < bits; ++b )
+				r |= ((i >> b) & 1) << (bits - 1 - b);
+			bit_reverse[i] = r;
+		}
+
+		// Множители каждого этапа лежат подряд(этап длины len - с индекса len / 2 - 1), внутренний цикл читает их без шага
+		twiddles.resize(std::max(n - 1, 1));
+		for ( int len = 2; len <= n; len <<= 1 )
+			for ( int j = 0; j < len / 2; ++j )
+				twiddles[len / 2 - 1 + j] = FFTComplex(float(cos(-2 * pi * j / len)), float(sin(-2 * pi * j / len)));
+
+		return;
+	}
+
+	// Блюстейн: nk = (k^2 + n^2 - (k - n)^2) / 2 сводит БПФ длины n к свёртке длины m
+	int m = 1;
+	while ( m < 2 * n - 1 )
+		m <<= 1;
+	inner = getFFTPlan(m);
+
+	chirp.resize(n);
+	for ( int k = 0; k < n; ++k )
+	{
+		double angle = -pi * double((long long)k * k % (2LL * n)) / n;
+		chirp[k] = FFTComplex(float(cos(angle)), float(sin(angle)));
+	}
+
+	chirp_spectrum.assign(m, FFTComplex(0, 0));
+	chirp_spectrum[0] = std::conj(chirp[0]);
+	for ( int k = 1; k < n; ++k )
+		chirp_spectrum[k] = chirp_spectrum[m - k] = std::conj(chirp[k]);
+	inner->Forward(chirp_spectrum.data(), nullptr);
+}
+
+void FFTPlan::Radix2(FFTComplex* data) const
+{
+	for ( int i = 0; i < n; ++i )
+		if ( i < bit_reverse[i] )
+			std::swap(data[i], data[bit_reverse[i]]);
+
+	for ( int len = 2; len <= n; len <<= 1 )
+	{
+		int half = len >> 1;
+		const FFTComplex* w = twiddles.data() + half - 1;
+		for ( int i = 0; i < n; i += len )
+		{
+			for ( int j = 0; j < half; ++j )
+			{
+				FFTComplex u = data[i + j];
+				FFTComplex v = cmul(data[i + j + half], w[j]);
+				data[i + j] = u + v;
+				data[i + j + half] = u - v;
+			}
+		}
+	}
+}
+
+// Прямое преобразование без нормировки. scratch - не меньше GetScratchSize() элементов
+void FFTPlan::Forward(FFTComplex* data, FFTComplex* scratch) const
+{
+	if ( !inner )
+	{
+		Radix2(data);
+		return;
+	}
+
+	int m = inner->GetSize();
+	FFTComplex* a = scratch;
+	for ( int k = 0; k < n; ++k )
+		a[k] = cmul(data[k], chirp[k]);
+	std::fill(a + n, a + m, FFTComplex(0, 0));
+
+	inner->Forward(a, scratch + m);
+	for ( int k = 0; k < m; ++k )
+		a[k] = cmul(a[k], chirp_spectrum[k]);
+	inner->Inverse(a, scratch + m);
+
+	float scale = 1.0f / m;
+	for ( int k = 0; k < n; ++k )
+		data[k] = cmul(a[k], chirp[k]) * scale;
+}
+
+// Обратное преобразование без деления на n: сопряжение, прямое преобразование, сопряжение
+void FFTPlan::Inverse(FFTComplex* data, FFTComplex* scratch) const
+{
+	for ( int k = 0; k < n; ++k )
+		data[k] = std::conj(data[k]);
+	Forward(data, scratch);
+	for ( int k = 0; k < n; ++k )
+		data[k] = std::conj(data[k]);
+}
+
+/*
+ * Планы кэшируются по длине: поля одного размера и вложенные планы Блюстейна используют один план.
+ * План строится вне блокировки, потому что построение плана Блюстейна само запрашивает план
+ */
+std::shared_ptr<const FFTPlan> getFFTPlan(int n)
+{
+	static std::mutex plans_mutex;
+	static std::map<int, std::shared_ptr<const FFTPlan>> plans;
+
+	{
+		std::lock_guard<std::mutex> lock(plans_mutex);
+		auto it = plans.find(n);
+		if ( it != plans.end() )
+			return it->second;
+	}
+
+	std::shared_ptr<const FFTPlan> plan(new FFTPlan(n));
+
+	std::lock_guard<std::mutex> lock(plans_mutex);
+	auto it = plans.emplace(n, plan).first;
+
+	return it->second;
+}
+
+
+
+
+
+
+
+
+LeniaField::LeniaField()
+{
+}
+
+LeniaField::LeniaField(const LeniaField& lf)
+{
+}
+
+LeniaField::LeniaField(LeniaField&& lf)
+{
+}
+
+LeniaField::LeniaField(int w, int h, const LeniaParams& lparams)
+{
+	width = std::max(w, 1);
+	height = std::max(h, 1);
+	params = lparams;
+	cells.assign(size_t(width) * height, 0.0f);
+	mass = 0;
+	BuildKernel();
+}
+
+/*
+ * Ядро раскладывается на торе с центром в клетке (0, 0), нормируется на сумму 1
+ * и переводится в спектр тем же прямым проходом, что и поле
+ */
+void LeniaField::BuildKernel(void)
+{
+	spectrum_width = width / 2 + 1;
+	row_plan = getFFTPlan(width);
+	column_plan = getFFTPlan(height);
+	spectrum.assign(size_t(height) * spectrum_width, FFTComplex(0, 0));
+	scratch.clear();
+
+	std::vector<float> image(size_t(width) * height, 0.0f);
+	double sum = 0;
+	int r = params.radius;
+	for ( int dy = -r; dy <= r; ++dy )
+	{
+		for ( int dx = -r; dx <= r; ++dx )
+		{
+			float k = leniaKernelValue(params, sqrt(double(dx * dx + dy * dy)));
+			int x = ((dx % width) + width) % width;
+			int y = ((dy % height) + height) % height;
+			image[size_t(y) * width + x] += k;
+			sum += k;
+		}
+	}
+
+	std::vector<FFTComplex> buffer(std::max(width, height) + std::max(row_plan->GetScratchSize(), column_plan->GetScratchSize()));
+	ForwardRows(image.data(), 0, (height + 1) / 2, buffer.data());
+
+	// Делитель обратного преобразования width * height сразу входит в спектр ядра
+	float scale = float(1.0 / (sum * width * height));
+	kernel_spectrum.resize(spectrum.size());
+	for ( int k = 0; k < spectrum_width; ++k )
+	{
+		for ( int y = 0; y < height; ++y )
+			buffer[y] = spectrum[size_t(y) * spectrum_width + k];
+		column_plan->Forward(buffer.data(), buffer.data() + height);
+		for ( int y = 0; y < height; ++y )
+			kernel_spectrum[size_t(y) * spectrum_width + k] = buffer[y] * scale;
+	}
+}
+
+void LeniaField::SetCell(int x, int y, float value)
+{
+	if ( (x < 0) || (x >= width) || (y < 0) || (y >= height) )
+		return;
+
+	cells[size_t(y) * width + x] = std::min(std::max(value, 0.0f), 1.0f);
+}
+
+// Круглая кисть радиуса brush с переносом через края тора
+void LeniaField::Paint(int x, int y, int brush, float value)
+{
+	x = (x % width + width) % width;
+	y = (y % height + height) % height;
+	for ( int dy = -brush; dy <= brush; ++dy )
+		for ( int dx = -brush; dx <= brush; ++dx )
+			if ( dx * dx + dy * dy <= brush * brush )
+				SetCell(((x + dx) % width + width) % width, ((y + dy) % height + height) % height, value);
+}
+
+void LeniaField::Fill(int x, int y, int w, int h, float value)
+{
+	int x0 = std::max(x, 0);
+	int y0 = std::max(y, 0);
+	int x1 = int(std::min((long long)x + w, (long long)width));
+	int y1 = int(std::min((long long)y + h, (long long)height));
+	if ( x0 >= x1 )
+		return;
+	for ( int cy = y0; cy < y1; ++cy )
+		std::fill(cells.begin() + size_t(cy) * width + x0, cells.begin() + size_t(cy) * width + x1, value);
+}
+
+void LeniaField::Clear(void)
+{
+	std::fill(cells.begin(), cells.end(), 0.0f);
+	mass = 0;
+}
+
+// Случайный "суп": доля density клеток получает равномерное значение из [0, 1)
+void LeniaField::Randomize(double density, unsigned int seed)
+{
+	std::mt19937 gen(seed);
+	std::bernoulli_distribution alive(density);
+	std::uniform_real_distribution<float> value(0.0f, 1.0f);
+	for ( auto& c : cells )
+		c = alive(gen) ? value(gen) : 0.0f;
+
+	UpdateMass();
+}
+
+// Новый размер: состояние переносится с сохранением точки anchor, спектр ядра строится заново
+bool LeniaField::Resize(int new_width, int new_height, int anchor)
+{
+	if ( (new_width < 1) || (new_height < 1) )
+		return false;
+
+	int dx, dy;
+	getAnchorOffset(anchor, width, height, new_width, new_height, dx, dy);
+
+	std::vector<float> resized(size_t(new_width) * new_height, 0.0f);
+	for ( int y = 0; y < new_height; ++y )
+	{
+		int sy = y - dy;
+		if ( (sy < 0) || (sy >= height) )
+			continue;
+		for ( int x = 0; x < new_width; ++x )
+		{
+			int sx = x - dx;
+			if ( (sx >= 0) && (sx < width) )
+				resized[size_t(y) * new_width + x] = cells[size_t(sy) * width + sx];
+		}
+	}
+
+	cells.swap(resized);
+	width = new_width;
+	height = new_height;
+	BuildKernel();
+	UpdateMass();
+
+	return true;
+}
+
+void LeniaField::UpdateMass(void)
+{
+	double sum = 0;
+	for ( float c : cells )
+		sum += c;
+	mass = sum;
+}
+
+/*
+ * Прямой проход по парам строк [begin, end): строки y = 2p и 2p + 1 - вещественная и мнимая части
+ * одного комплексного БПФ, спектры строк разделяются по симметрии X[W - k] = conj(X[k])
+ */
+void LeniaField::ForwardRows(const float* src, int begin, int end, FFTComplex* buffer)
+{
+	FFTComplex* z = buffer;
+	FFTComplex* plan_scratch = buffer + std::max(width, height);
+
+	for ( int p = begin; p < end; ++p )
+	{
+		int y0 = 2 * p;
+		int y1 = y0 + 1;
+		const float* re = src + size_t(y0) * width;
+		const float* im = (y1 < height) ? src + size_t(y1) * width : nullptr;
+		for ( int x = 0; x < width; ++x )
+			z[x] = FFTComplex(re[x], im ? im[x] : 0.0f);
+
+		row_plan->Forward(z, plan_scratch);
+
+		FFTComplex* out0 = spectrum.data() + size_t(y0) * spectrum_width;
+		FFTComplex* out1 = (y1 < height) ? spectrum.data() + size_t(y1) * spectrum_width : nullptr;
+		for ( int k = 0; k < spectrum_width; ++k )
+		{
+			FFTComplex a = z[k];
+			FFTComplex b = std::conj(z[(width - k) % width]);
+			FFTComplex sum = a + b;
+			FFTComplex diff = a - b;
+			out0[k] = FFTComplex(0.5f * sum.real(), 0.5f * sum.imag());
+			if ( out1 )
+				out1[k] = FFTComplex(0.5f * diff.imag(), -0.5f * diff.real());
+		}
+	}
+}
+
+/*
+ * Столбцы [begin, end) половины спектра: прямое БПФ, умножение на спектр ядра, обратное БПФ.
+ * Столбцы собираются блоками по LENIA_COLUMN_BLOCK, чтобы читать строки спектра целыми кэш-линиями
+ */
+void LeniaField::FilterColumns(int begin, int end, FFTComplex* buffer)
+{
+	FFTComplex* plan_scratch = buffer + size_t(LENIA_COLUMN_BLOCK) * height;
+
+	for ( int k0 = begin; k0 < end; k0 += LENIA_COLUMN_BLOCK )
+	{
+		int count = std::min(int(LENIA_COLUMN_BLOCK), end - k0);
+		for ( int y = 0; y < height; ++y )
+		{
+			const FFTComplex* row = spectrum.data() + size_t(y) * spectrum_width + k0;
+			for ( int j = 0; j < count; ++j )
+				buffer[size_t(j) * height + y] = row[j];
+		}
+
+		for ( int j = 0; j < count; ++j )
+		{
+			FFTComplex* column = buffer + size_t(j) * height;
+			column_plan->Forward(column, plan_scratch);
+			for ( int y = 0; y < height; ++y )
+				column[y] = cmul(column[y], kernel_spectrum[size_t(y) * spectrum_width + k0 + j]);
+			column_plan->Inverse(column, plan_scratch);
+		}
+
+		for ( int y = 0; y < height; ++y )
+		{
+			FFTComplex* row = spectrum.data() + size_t(y) * spectrum_width + k0;
+			for ( int j = 0; j < count; ++j )
+				row[j] = buffer[size_t(j) * height + y];
+		}
+	}
+}
+
+/*
+ * Обратный проход по парам строк: полный спектр строки восстанавливается из половины,
+ * спектры двух строк складываются как X0 + i X1, после БПФ строки - вещественная и мнимая части.
+ * store(y, values) получает строку свёртки: значение клетки x - values[2 * x](вещественная или мнимая часть z)
+ */
+template <typename F>
+void LeniaField::InverseRows(int begin, int end, FFTComplex* buffer, F store)
+{
+	FFTComplex* z = buffer;
+	FFTComplex* plan_scratch = buffer + std::max(width, height);
+
+	for ( int p = begin; p < end; ++p )
+	{
+		int y0 = 2 * p;
+		int y1 = y0 + 1;
+		const FFTComplex* in0 = spectrum.data() + size_t(y0) * spectrum_width;
+		const FFTComplex* in1 = (y1 < height) ? spectrum.data() + size_t(y1) * spectrum_width : nullptr;
+		for ( int k = 0; k < width; ++k )
+		{
+			bool mirrored = k >= spectrum_width;
+			int idx = mirrored ? width - k : k;
+			FFTComplex a = mirrored ? std::conj(in0[idx]) : in0[idx];
+			FFTComplex b = in1 ? (mirrored ? std::conj(in1[idx]) : in1[idx]) : FFTComplex(0, 0);
+			z[k] = FFTComplex(a.real() - b.imag(), a.imag() + b.real());
+		}
+
+		row_plan->Inverse(z, plan_scratch);
+
+		// std::complex хранится как пара float: вещественная часть, затем мнимая
+		const float* values = reinterpret_cast<const float*>(z);
+		store(y0, values);
+		if ( in1 )
+			store(y1, values + 1);
+	}
+}
+
+// Три фазы свёртки, каждая делится между исполнителями; store(worker, y, values) получает строки результата
+template <typename F>
+void LeniaField::RunConvolution(WorkerPool* workers, F store)
+{
+	int parts = workers ? workers->GetWorkersCount() : 1;
+	size_t buffer_size = std::max(width, int(LENIA_COLUMN_BLOCK) * height) + std::max(row_plan->GetScratchSize(), column_plan->GetScratchSize());
+	if ( int(scratch.size()) < parts )
+		scratch.resize(parts);
+	for ( auto& s : scratch )
+		if ( s.size() < buffer_size )
+			s.resize(buffer_size);
+
+	int pairs = (height + 1) / 2;
+	auto run = [&](const std::function<void(int)>& fn)
+	{
+		if ( workers )
+			workers->Run(fn);
+		else
+			fn(0);
+	};
+
+	{
+		TRACE_ZONE("LeniaRows");
+		run([&](int worker)
+		{
+			int begin, end;
+			splitRange(pairs, worker, parts, begin, end);
+			ForwardRows(cells.data(), begin, end, scratch[worker].data());
+		});
+	}
+	{
+		TRACE_ZONE("LeniaColumns");
+		run([&](int worker)
+		{
+			int begin, end;
+			splitRange(spectrum_width, worker, parts, begin, end);
+			FilterColumns(begin, end, scratch[worker].data());
+		});
+	}
+	{
+		TRACE_ZONE("LeniaGrowth");
+		run([&](int worker)
+		{
+			int begin, end;
+			splitRange(pairs, worker, parts, begin, end);
+			InverseRows(begin, end, scratch[worker].data(), [&](int y, const float* values) { store(worker, y, values); });
+		});
+	}
+}
+
+// Только свёртка поля с нормированным ядром(потенциал), поле не меняется
+void LeniaField::Convolve(std::vector<float>& potential, WorkerPool* workers)
+{
+	potential.resize(cells.size());
+	RunConvolution(workers, [&](int, int y, const float* values)
+	{
+		float* out = potential.data() + size_t(y) * width;
+		for ( int x = 0; x < width; ++x )
+			out[x] = values[2 * x];
+	});
+}
+
+/*
+ * Шаг: A = clip(A + dt * G(K * A), 0, 1). Рост применяется в обратном проходе по строкам,
+ * отдельного обхода поля нет. Возвращает true, если хоть одна клетка изменилась
+ */
+bool LeniaField::Step(WorkerPool* workers)
+{
+	int parts = workers ? workers->GetWorkersCount() : 1;
+	std::vector<double> masses(parts, 0.0);
+	std::vector<char> changed(parts, 0);
+	float dt = float(params.dt);
+	LeniaParams p = params;
+
+	// Масса и изменения строки копятся в локальных переменных: счётчики соседних исполнителей лежат в одной линии кэша
+	RunConvolution(workers, [&](int worker, int y, const float* values)
+	{
+		float* row = cells.data() + size_t(y) * width;
+		double row_mass = 0;
+		bool row_changed = false;
+		for ( int x = 0; x < width; ++x )
+		{
+			float next = std::min(std::max(row[x] + dt * leniaGrowth(p, values[2 * x]), 0.0f), 1.0f);
+			row_changed |= (next != row[x]);
+			row[x] = next;
+			row_mass += next;
+		}
+		masses[worker] += row_mass;
+		changed[worker] |= row_changed;
+	});
+
+	mass = 0;
+	bool any = false;
+	for ( int i = 0; i < parts; ++i )
+	{
+		mass += masses[i];
+		any = any || changed[i];
+	}
+
+	return any;
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef MINIMAP_CPP
+#define MINIMAP_CPP
+
+
+#include "../includes/Minimap.hpp"
+#include <algorithm>
+
+
+Minimap::Minimap()
+{
+}
+
+Minimap::Minimap(SDL_Rect max_area)
+{
+	texture = nullptr;
+	bounds = max_area;
+	area = max_area;
+	area.w = area.h = 0;
+	cells_x = cells_y = 0;
+	scale = 1;
+	width = height = 0;
+	row_words = 0;
+	dirty.x = dirty.y = dirty.w = dirty.h = 0;
+}
+
+Minimap::Minimap(const Minimap& m)
+{
+}
+
+Minimap::Minimap(Minimap&& m)
+{
+}
+
+Minimap::~Minimap()
+{
+	if ( texture )
+		cleanup(texture);
+}
+
+/*
+ * Создаёт текстуру под поле w x h клеток. Масштаб выбирается так, чтобы поле целиком уместилось в bounds;
+ * маленькое поле растягивается целым числом экранных пикселей на пиксель текстуры
+ */
+bool Minimap::Reset(int w, int h, SDL_Renderer* ren)
+{
+	if ( texture )
+	{
+		cleanup(texture);
+		texture = nullptr;
+	}
+
+	cells_x = w;
+	cells_y = h;
+	scale = std::max(std::max((w + bounds.w - 1) / bounds.w, (h + bounds.h - 1) / bounds.h), 1);
+	width = (w + scale - 1) / scale;
+	height = (h + scale - 1) / scale;
+	row_words = (w + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+
+	int zoom = std::max(std::min(bounds.w / width, bounds.h / height), 1);
+	area.x = bounds.x;
+	area.y = bounds.y;
+	area.w = width * zoom;
+	area.h = height * zoom;
+
+	texture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+	if ( texture == nullptr )
+	{
+		logSDLError(std::cout, "[Minimap::Reset] SDL_CreateTexture: ");
+		area.w = area.h = 0;
+		return false;
+	}
+
+	previous.assign(size_t(row_words) * h, 0);
+	counts.assign(size_t(width) * height, 0);
+	pixels.assign(size_t(width) * height, minimap_background_color);
+	dirty.x = dirty.y = 0;
+	dirty.w = width;
+	dirty.h = height;
+
+	return true;
+}
+
+bool Minimap::IsPointInside(SDL_Point p) const
+{
+	return (p.x >= area.x) && (p.x < area.x + area.w) && (p.y >= area.y) && (p.y < area.y + area.h);
+}
+
+SDL_Point Minimap::PointToCell(SDL_Point p) const
+{
+	SDL_Point cell;
+	cell.x = std::min(std::max(int((long long)(p.x - area.x) * width * scale / std::max(area.w, 1)), 0), cells_x - 1);
+	cell.y = std::min(std::max(int((long long)(p.y - area.y) * height * scale / std::max(area.h, 1)), 0), cells_y - 1);
+
+	return cell;
+}
+
+void Minimap::MarkDirty(int px, int py)
+{
+	if ( dirty.w == 0 )
+	{
+		dirty.x = px;
+		dirty.y = py;
+		dirty.w = dirty.h = 1;
+		return;
+	}
+
+	int x1 = std::max(dirty.x + dirty.w, px + 1);
+	int y1 = std::max(dirty.y + dirty.h, py + 1);
+	dirty.x = std::min(dirty.x, px);
+	dirty.y = std::min(dirty.y, py);
+	dirty.w = x1 - dirty.x;
+	dirty.h = y1 - dirty.y;
+}
+
+// Учитывает клетки, изменившиеся с прошлого вызова. Размер grid должен совпадать с размером из Reset
+void Minimap::Update(const Grid& grid)
+{
+	if ( (texture == nullptr) || (grid.GetWidth() != cells_x) || (grid.GetHeight() != cells_y) )
+		return;
+
+	const uint64_t* mask = grid.GetTailMask();
+	int block = scale * scale;
+	for ( int y = 0; y < cells_y; ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		uint64_t* prev = previous.data() + size_t(y) * row_words;
+		int py = y / scale;
+
+		for ( int i = 0; i < row_words; ++i )
+		{
+			uint64_t cur = row[i] & mask[i];
+			uint64_t diff = cur ^ prev[i];
+			if ( diff == 0 )
+				continue;
+			prev[i] = cur;
+
+			while ( diff )
+			{
+				int b = ctz64(diff);
+				diff &= diff - 1;
+
+				int px = (i * GRID_WORD_BITS + b) / scale;
+				size_t idx = size_t(py) * width + px;
+				counts[idx] += ((cur >> b) & 1) ? 1 : -1;
+
+				uint32_t level = (counts[idx] == 0) ? 0 : MINIMAP_MIN_BRIGHTNESS + (255 - MINIMAP_MIN_BRIGHTNESS) * counts[idx] / block;
+				pixels[idx] = (counts[idx] == 0) ? minimap_background_color : (0xFF000000u | (level / 4) << 16 | level << 8 | (level / 4));
+				MarkDirty(px, py);
+			}
+		}
+	}
+}
+
+// Загружает в текстуру изменившиеся пиксели, рисует миникарту и рамку видимой части поля
+void Minimap::Draw(SDL_Renderer* ren, SDL_Rect view)
+{
+	if ( texture == nullptr )
+		return;
+
+	if ( dirty.w > 0 )
+	{
+		SDL_UpdateTexture(texture, &dirty, &pixels[size_t(dirty.y) * width + dirty.x], width * int(sizeof(uint32_t)));
+		dirty.w = dirty.h = 0;
+	}
+
+	SDL_RenderCopy(ren, texture, nullptr, &area);
+
+	SDL_Rect frame;
+	frame.x = area.x + int((long long)view.x * area.w / (width * scale));
+	frame.y = area.y + int((long long)view.y * area.h / (height * scale));
+	frame.w = std::max(int((long long)view.w * area.w / (width * scale)), 2);
+	frame.h = std::max(int((long long)view.h * area.h / (height * scale)), 2);
+	SDL_SetRenderDrawColor(ren, 255, 220, 0, 255);
+	SDL_RenderDrawRect(ren, &frame);
+	SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+}
+
+#endif
@@ -0,0 +1,392 @@
+#ifndef MORTON_CPP
+#define MORTON_CPP
+
+
+#include "../includes/Morton.hpp"
+#include "../includes/KernelImpl.hpp"
+#include "../includes/Workers.hpp"
+#include "../includes/Trace.hpp"
+#include <cstring>
+#include <iostream>
+
+
+namespace
+{
+
+const char* const layout_names[GRID_LAYOUTS_COUNT] = { "rows", "morton" };
+
+const uint64_t first_column = 0x0101010101010101ULL;
+const uint64_t last_column = 0x8080808080808080ULL;
+
+// Плитка - одно слово: сумматоры из KernelImpl.hpp над uint64_t
+struct VecTile
+{
+	typedef uint64_t type;
+	static type and_(type a, type b) { return a & b; }
+	static type or_(type a, type b) { return a | b; }
+	static type xor_(type a, type b) { return a ^ b; }
+	static type andnot(type a, type b) { return ~a & b; }
+	static type ones(void) { return ~uint64_t(0); }
+};
+
+// Между битами v вставляются нули: 16 младших бит -> чётные биты
+inline uint32_t spreadBits(uint32_t v)
+{
+	v &= 0x0000FFFF;
+	v = (v | (v << 8)) & 0x00FF00FF;
+	v = (v | (v << 4)) & 0x0F0F0F0F;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+// Обратно к spreadBits: чётные биты v -> 16 младших
+inline uint32_t compactBits(uint32_t v)
+{
+	v &= 0x55555555;
+	v = (v | (v >> 1)) & 0x33333333;
+	v = (v | (v >> 2)) & 0x0F0F0F0F;
+	v = (v | (v >> 4)) & 0x00FF00FF;
+	v = (v | (v >> 8)) & 0x0000FFFF;
+	return v;
+}
+
+int ceilLog2(int n)
+{
+	int bits = 0;
+	while ( (1 << bits) < n )
+		++bits;
+	return bits;
+}
+
+// Клетки, сдвинутые на столбец: в столбце c - соседи из столбца c - 1(west) или c + 1(east), через край - из соседней плитки
+inline uint64_t westCells(uint64_t tile, uint64_t west)
+{
+	return ((tile << 1) & ~first_column) | ((west >> 7) & first_column);
+}
+
+inline uint64_t eastCells(uint64_t tile, uint64_t east)
+{
+	return ((tile >> 1) & ~last_column) | ((east << 7) & last_column);
+}
+
+// То же на строку: в строке r - соседи из строки r - 1(north) или r + 1(south)
+inline uint64_t northCells(uint64_t tile, uint64_t north)
+{
+	return (tile << 8) | (north >> 56);
+}
+
+inline uint64_t southCells(uint64_t tile, uint64_t south)
+{
+	return (tile >> 8) | (south << 56);
+}
+
+/*
+ * Следующее поколение плитки t по восьми соседним. Соседи каждой клетки собираются сдвигами в восемь слов,
+ * дальше - те же суммы, что в stepRowsBitsliced
+ */
+template <bool Conway>
+inline uint64_t stepTile(const LifeRule& rule, uint64_t t, uint64_t n, uint64_t s, uint64_t w, uint64_t e,
+		uint64_t nw, uint64_t ne, uint64_t sw, uint64_t se)
+{
+	uint64_t mw = westCells(t, w);
+	uint64_t me = eastCells(t, e);
+	uint64_t uw = northCells(mw, westCells(n, nw));
+	uint64_t uc = northCells(t, n);
+	uint64_t ue = northCells(me, eastCells(n, ne));
+	uint64_t dw = southCells(mw, westCells(s, sw));
+	uint64_t dc = southCells(t, s);
+	uint64_t de = southCells(me, eastCells(s, se));
+
+	uint64_t u0, u1, d0, d1;
+	fullAdder<VecTile>(uw, uc, ue, u0, u1);
+	fullAdder<VecTile>(dw, dc, de, d0, d1);
+	uint64_t m0 = mw ^ me;
+	uint64_t m1 = mw & me;
+
+	uint64_t s0, c0, r, rc;
+	fullAdder<VecTile>(u0, m0, d0, s0, c0);
+	fullAdder<VecTile>(u1, m1, d1, r, rc);
+	uint64_t s1 = r ^ c0;
+	uint64_t rc2 = r & c0;
+	uint64_t s2 = rc ^ rc2;
+	uint64_t s3 = rc & rc2;
+
+	if ( Conway )
+		return ~s3 & ~s2 & s1 & (s0 | t);
+
+	uint64_t next = 0;
+	for ( int k = 0; k <= 8; ++k )
+	{
+		bool birth = (rule.birth >> k) & 1;
+		bool survive = (rule.survive >> k) & 1;
+		if ( !birth && !survive )
+			continue;
+
+		uint64_t m = countMatch<VecTile>(k, s0, s1, s2, s3);
+		if ( !birth )
+			m &= t;
+		else if ( !survive )
+			m &= ~t;
+		next |= m;
+	}
+
+	return next;
+}
+
+}
+
+
+int findGridLayoutByName(const char* name)
+{
+	for ( int i = 0; i < GRID_LAYOUTS_COUNT; ++i )
+		if ( strcmp(layout_names[i], name) == 0 )
+			return i;
+
+	return -1;
+}
+
+const char* getGridLayoutName(int layout)
+{
+	return ((layout >= 0) && (layout < GRID_LAYOUTS_COUNT)) ? layout_names[layout] : "unknown";
+}
+
+// Плитки считают только правила B/S радиуса 1, тор не может резать плитку, код плитки умещается в 32 бита
+bool isMortonLayoutSupported(int w, int h, bool tor, const LifeRule& rule)
+{
+	if ( (w <= 0) || (h <= 0) || isLargerThanLife(rule) )
+		return false;
+
+	if ( tor && ((w % MORTON_TILE_SIZE != 0) || (h % MORTON_TILE_SIZE != 0)) )
+		return false;
+
+	int bits = ceilLog2((w + MORTON_TILE_SIZE - 1) / MORTON_TILE_SIZE) + ceilLog2((h + MORTON_TILE_SIZE - 1) / MORTON_TILE_SIZE);
+
+	return bits <= 30;
+}
+
+
+MortonGrid::MortonGrid(int w, int h, bool tor)
+{
+	width = w;
+	height = h;
+	toroidal = tor;
+	tiles_x = (w + MORTON_TILE_SIZE - 1) / MORTON_TILE_SIZE;
+	tiles_y = (h + MORTON_TILE_SIZE - 1) / MORTON_TILE_SIZE;
+	bits_x = ceilLog2(tiles_x);
+	bits_y = ceilLog2(tiles_y);
+	codes_count = size_t(1) << (bits_x + bits_y);
+	current = 0;
+
+	// Код плитки = code_x[x] | code_y[y]: младшие биты координат чередуются, старшие биты длинной стороны - над ними
+	int common = std::min(bits_x, bits_y);
+	uint32_t low_mask = (uint32_t(1) << common) - 1;
+	code_x.assign(tiles_x + 2, uint32_t(codes_count));
+	code_y.assign(tiles_y + 2, uint32_t(codes_count));
+	for ( int tx = 0; tx < tiles_x; ++tx )
+		code_x[tx + 1] = spreadBits(tx & low_mask) | ((bits_x > bits_y) ? (uint32_t(tx) >> common) << (2 * common) : 0);
+	for ( int ty = 0; ty < tiles_y; ++ty )
+		code_y[ty + 1] = (spreadBits(ty & low_mask) << 1) | ((bits_y > bits_x) ? (uint32_t(ty) >> common) << (2 * common) : 0);
+
+	// За краем тора - плитки противоположного края, у поля с границами - всегда пустая плитка codes_count
+	if ( toroidal )
+	{
+		code_x[0] = code_x[tiles_x];
+		code_x[tiles_x + 1] = code_x[1];
+		code_y[0] = code_y[tiles_y];
+		code_y[tiles_y + 1] = code_y[1];
+	}
+
+	buffers[0].assign(codes_count + 1, 0);
+	buffers[1].assign(codes_count + 1, 0);
+
+	int columns = w - (tiles_x - 1) * MORTON_TILE_SIZE;
+	int rows = h - (tiles_y - 1) * MORTON_TILE_SIZE;
+	last_column_mask = ((uint64_t(1) << columns) - 1) * first_column;
+	last_row_mask = (rows == MORTON_TILE_SIZE) ? ~uint64_t(0) : (uint64_t(1) << (rows * MORTON_TILE_SIZE)) - 1;
+}
+
+MortonGrid::MortonGrid()
+{
+}
+
+MortonGrid::MortonGrid(const MortonGrid& mg)
+{
+}
+
+MortonGrid::MortonGrid(MortonGrid&& mg)
+{
+}
+
+bool MortonGrid::GetCell(int x, int y) const
+{
+	if ( (x < 0) || (x >= width) || (y < 0) || (y >= height) )
+		return false;
+
+	uint64_t tile = buffers[current][GetIndex(x / MORTON_TILE_SIZE, y / MORTON_TILE_SIZE)];
+
+	return (tile >> ((y % MORTON_TILE_SIZE) * MORTON_TILE_SIZE + x % MORTON_TILE_SIZE)) & 1;
+}
+
+void MortonGrid::SetCell(int x, int y, bool alive)
+{
+	if ( (x < 0) || (x >= width) || (y < 0) || (y >= height) )
+		return;
+
+	uint64_t& tile = buffers[current][GetIndex(x / MORTON_TILE_SIZE, y / MORTON_TILE_SIZE)];
+	uint64_t bit = uint64_t(1) << ((y % MORTON_TILE_SIZE) * MORTON_TILE_SIZE + x % MORTON_TILE_SIZE);
+	tile = alive ? (tile | bit) : (tile & ~bit);
+}
+
+// Байт строки r плитки tx - байт tx % 8 слова tx / 8 строки поля, поэтому строки переносятся по байтам, а не по клеткам
+void MortonGrid::Load(const Grid& grid)
+{
+	if ( (grid.GetWidth() != width) || (grid.GetHeight() != height) )
+	{
+		std::cout << "[MortonGrid::Load](" << this << "): The grid is " << grid.GetWidth() << "x" << grid.GetHeight()
+				  << ", expected " << width << "x" << height << std::endl;
+		return;
+	}
+
+	std::vector<uint64_t>& tiles = buffers[current];
+	std::fill(tiles.begin(), tiles.end(), 0);
+	const uint64_t* mask = grid.GetTailMask();
+
+	for ( int y = 0; y < height; ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		int shift = (y % MORTON_TILE_SIZE) * MORTON_TILE_SIZE;
+		for ( int tx = 0; tx < tiles_x; ++tx )
+		{
+			int i = tx / MORTON_TILE_SIZE;
+			uint64_t byte = ((row[i] & mask[i]) >> ((tx % MORTON_TILE_SIZE) * MORTON_TILE_SIZE)) & 0xFF;
+			tiles[GetIndex(tx, y / MORTON_TILE_SIZE)] |= byte << shift;
+		}
+	}
+}
+
+void MortonGrid::Store(Grid& grid) const
+{
+	if ( (grid.GetWidth() != width) || (grid.GetHeight() != height) )
+	{
+		std::cout << "[MortonGrid::Store](" << this << "): The grid is " << grid.GetWidth() << "x" << grid.GetHeight()
+				  << ", expected " << width << "x" << height << std::endl;
+		return;
+	}
+
+	const std::vector<uint64_t>& tiles = buffers[current];
+	const uint64_t* mask = grid.GetTailMask();
+	int row_words = grid.GetRowWords();
+
+	for ( int y = 0; y < height; ++y )
+	{
+		uint64_t* row = grid.GetRow(y);
+		int shift = (y % MORTON_TILE_SIZE) * MORTON_TILE_SIZE;
+		for ( int i = 0; i < row_words; ++i )
+		{
+			uint64_t word = 0;
+			for ( int k = 0; k < MORTON_TILE_SIZE; ++k )
+			{
+				int tx = i * MORTON_TILE_SIZE + k;
+				if ( tx < tiles_x )
+					word |= ((tiles[GetIndex(tx, y / MORTON_TILE_SIZE)] >> shift) & 0xFF) << (k * MORTON_TILE_SIZE);
+			}
+			row[i] = word & mask[i];
+		}
+	}
+	grid.InvalidateBounds();
+}
+
+long long MortonGrid::CountPopulation(void) const
+{
+	long long population = 0;
+	for ( uint64_t tile : buffers[current] )
+	{
+#if defined(__GNUC__)
+		population += __builtin_popcountll(tile);
+#else
+		for ( ; tile; tile &= tile - 1 )
+			++population;
+#endif
+	}
+
+	return population;
+}
+
+/*
+ * Плитки с кодами [code_begin, code_end) в порядке кривой: координаты восстанавливаются из кода,
+ * коды за пределами поля(кривая покрывает степени двойки) пропускаются
+ */
+bool MortonGrid::StepCodes(const LifeRule& rule, size_t code_begin, size_t code_end)
+{
+	const uint64_t* src = buffers[current].data();
+	uint64_t* dst = buffers[current ^ 1].data();
+	bool conway = isConwayRule(rule);
+	int common = std::min(bits_x, bits_y);
+	uint32_t low_mask = (uint32_t(1) << (2 * common)) - 1;
+	uint64_t diff = 0;
+
+	for ( size_t code = code_begin; code < code_end; ++code )
+	{
+		uint32_t low = uint32_t(code) & low_mask;
+		uint32_t high = uint32_t(code >> (2 * common));
+		int tx = int(compactBits(low));
+		int ty = int(compactBits(low >> 1));
+		if ( bits_x > bits_y )
+			tx |= int(high << common);
+		else
+			ty |= int(high << common);
+		if ( (tx >= tiles_x) || (ty >= tiles_y) )
+			continue;
+
+		uint64_t t = src[code];
+		uint64_t n = src[GetIndex(tx, ty - 1)];
+		uint64_t s = src[GetIndex(tx, ty + 1)];
+		uint64_t w = src[GetIndex(tx - 1, ty)];
+		uint64_t e = src[GetIndex(tx + 1, ty)];
+		uint64_t nw = src[GetIndex(tx - 1, ty - 1)];
+		uint64_t ne = src[GetIndex(tx + 1, ty - 1)];
+		uint64_t sw = src[GetIndex(tx - 1, ty + 1)];
+		uint64_t se = src[GetIndex(tx + 1, ty + 1)];
+
+		uint64_t next = conway ? stepTile<true>(rule, t, n, s, w, e, nw, ne, sw, se) : stepTile<false>(rule, t, n, s, w, e, nw, ne, sw, se);
+		if ( tx == tiles_x - 1 )
+			next &= last_column_mask;
+		if ( ty == tiles_y - 1 )
+			next &= last_row_mask;
+
+		dst[code] = next;
+		diff |= next ^ t;
+	}
+
+	return diff != 0;
+}
+
+// С пулом потоков кривая режется на отрезки: отрезок кривой Мортона - компактная область поля
+bool MortonGrid::Step(const LifeRule& rule, WorkerPool* workers)
+{
+	bool changed = false;
+	if ( (workers == nullptr) || (workers->GetWorkersCount() == 1) )
+	{
+		changed = StepCodes(rule, 0, codes_count);
+	}
+	else
+	{
+		int count = workers->GetWorkersCount();
+		std::vector<char> part_changed(count, 0);
+
+		workers->Run([&](int worker)
+		{
+			TRACE_ZONE("StepTiles");
+			part_changed[worker] = StepCodes(rule, codes_count * worker / count, codes_count * (worker + 1) / count);
+		});
+
+		for ( int i = 0; i < count; ++i )
+			changed = changed || part_changed[i];
+	}
+	current ^= 1;
+
+	return changed;
+}
+
+#endif
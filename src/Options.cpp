@@ -0,0 +1,240 @@
+#ifndef OPTIONS_CPP
+#define OPTIONS_CPP
+
+
+#include "../includes/Options.hpp"
+#include "../includes/Autotune.hpp"
+#include "../includes/Morton.hpp"
+#include "../includes/Stream.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+void initEngineParams(EngineParams& eparams)
+{
+	eparams.rule = conwayRule();
+	eparams.step_kernel = -1;
+	eparams.threads = 1;
+	eparams.toroidal = false;
+	eparams.activity = false;
+	eparams.bounded = true;
+	eparams.layout = GRID_LAYOUT_ROWS;
+	eparams.lenia = defaultLeniaParams();
+	eparams.huge_pages = false;
+	eparams.pin_threads = false;
+	eparams.autotune = false;
+	eparams.autotune_cache = default_autotune_cache_path;
+	eparams.publish_name.clear();
+	eparams.serve_spec.clear();
+}
+
+void initHeadlessParams(HeadlessParams& hparams)
+{
+	hparams.cells_x = HEADLESS_DEFAULT_CELLS_X;
+	hparams.cells_y = HEADLESS_DEFAULT_CELLS_Y;
+	hparams.board_set = false;
+	hparams.generations = HEADLESS_DEFAULT_GENERATIONS;
+	hparams.density = headless_default_density;
+	hparams.seed = HEADLESS_DEFAULT_SEED;
+	hparams.census = false;
+	hparams.regions.clear();
+	hparams.region_interval = 0;
+	hparams.block_stats = false;
+	hparams.temporal_depth = 1;
+	hparams.capture.format = CAPTURE_FORMAT_NONE;
+	hparams.capture.cell_pixels = CAPTURE_DEFAULT_CELL_PIXELS;
+	hparams.capture.lossless = false;
+}
+
+/*
+ * Разбирает один ключ вида --name[=value]. Неверное значение заменяется значением по умолчанию
+ * с сообщением. Возвращает false, если ключ не относится к движку и прогону без окна
+ */
+bool parseEngineOption(const char* arg, EngineParams& eparams, HeadlessParams& hparams)
+{
+	if ( strncmp(arg, "--rule=", 7) == 0 )
+	{
+		if ( !parseLifeRule(arg + 7, eparams.rule) )
+			std::cout << "Rule " << arg + 7 << " is invalid! Set default value!" << std::endl;
+	}
+	else if ( strncmp(arg, "--kernel=", 9) == 0 )
+	{
+		eparams.step_kernel = findStepKernelByName(arg + 9);
+		if ( eparams.step_kernel < 0 )
+			std::cout << "Unknown step kernel " << arg + 9 << "! It will be detected automatically" << std::endl;
+	}
+	else if ( strncmp(arg, "--threads=", 10) == 0 )
+	{
+		eparams.threads = atoi(arg + 10);
+		if ( eparams.threads < 1 )
+		{
+			std::cout << "Threads count " << arg + 10 << " is invalid! Set default value!" << std::endl;
+			eparams.threads = 1;
+		}
+	}
+	else if ( strncmp(arg, "--board=", 8) == 0 )
+	{
+		int w = 0, h = 0;
+		if ( (sscanf(arg + 8, "%dx%d", &w, &h) == 2) && (w > 0) && (h > 0) )
+		{
+			hparams.cells_x = w;
+			hparams.cells_y = h;
+			hparams.board_set = true;
+		}
+		else
+		{
+			std::cout << "Board size " << arg + 8 << " is invalid! Set default value!" << std::endl;
+		}
+	}
+	else if ( strncmp(arg, "--generations=", 14) == 0 )
+	{
+		hparams.generations = atoll(arg + 14);
+		if ( hparams.generations < 0 )
+			hparams.generations = HEADLESS_DEFAULT_GENERATIONS;
+	}
+	else if ( strncmp(arg, "--pattern=", 10) == 0 )
+	{
+		hparams.pattern = arg + 10;
+	}
+	else if ( strncmp(arg, "--soup=", 7) == 0 )
+	{
+		hparams.density = atof(arg + 7);
+		if ( (hparams.density <= 0) || (hparams.density > 1) )
+		{
+			std::cout << "Soup density " << arg + 7 << " is invalid! Set default value!" << std::endl;
+			hparams.density = headless_default_density;
+		}
+	}
+	else if ( strncmp(arg, "--seed=", 7) == 0 )
+	{
+		hparams.seed = static_cast<unsigned int>(strtoul(arg + 7, nullptr, 10));
+	}
+	else if ( strcmp(arg, "--census") == 0 )
+	{
+		hparams.census = true;
+	}
+	else if ( strncmp(arg, "--region=", 9) == 0 )
+	{
+		HeadlessRegion region;
+		if ( (sscanf(arg + 9, "%d,%d,%d,%d", &region.x, &region.y, &region.w, &region.h) == 4) && (region.w > 0) && (region.h > 0) )
+			hparams.regions.push_back(region);
+		else
+			std::cout << "Region " << arg + 9 << " is invalid! It must be x,y,w,h" << std::endl;
+	}
+	else if ( strncmp(arg, "--region-interval=", 18) == 0 )
+	{
+		hparams.region_interval = atoll(arg + 18);
+		if ( hparams.region_interval < 0 )
+		{
+			std::cout << "Region interval " << arg + 18 << " is invalid! Set default value!" << std::endl;
+			hparams.region_interval = 0;
+		}
+	}
+	else if ( strcmp(arg, "--block-stats") == 0 )
+	{
+		hparams.block_stats = true;
+	}
+	else if ( strncmp(arg, "--temporal-blocking=", 20) == 0 )
+	{
+		hparams.temporal_depth = atoi(arg + 20);
+		if ( (hparams.temporal_depth < 1) || (hparams.temporal_depth > GRID_TEMPORAL_MAX_DEPTH) )
+		{
+			std::cout << "Temporal blocking depth " << arg + 20 << " is invalid! Set default value!" << std::endl;
+			hparams.temporal_depth = 1;
+		}
+	}
+	else if ( strcmp(arg, "--torus") == 0 )
+	{
+		eparams.toroidal = true;
+	}
+	else if ( strcmp(arg, "--activity") == 0 )
+	{
+		eparams.activity = true;
+	}
+	else if ( strcmp(arg, "--no-bounding-box") == 0 )
+	{
+		eparams.bounded = false;
+	}
+	else if ( strncmp(arg, "--layout=", 9) == 0 )
+	{
+		eparams.layout = findGridLayoutByName(arg + 9);
+		if ( eparams.layout < 0 )
+		{
+			std::cout << "Grid layout " << arg + 9 << " is unknown! Set default value!" << std::endl;
+			eparams.layout = GRID_LAYOUT_ROWS;
+		}
+	}
+	else if ( strcmp(arg, "--huge-pages") == 0 )
+	{
+		eparams.huge_pages = true;
+	}
+	else if ( strcmp(arg, "--pin-threads") == 0 )
+	{
+		eparams.pin_threads = true;
+	}
+	else if ( strncmp(arg, "--publish=", 10) == 0 )
+	{
+		eparams.publish_name = arg + 10;
+		if ( (eparams.publish_name.empty()) || (eparams.publish_name.find('/', 1) != std::string::npos) )
+		{
+			std::cout << "Shared memory name " << arg + 10 << " is invalid! Publishing is disabled" << std::endl;
+			eparams.publish_name.clear();
+		}
+	}
+	else if ( strncmp(arg, "--serve=", 8) == 0 )
+	{
+		StreamAddress address;
+		if ( parseStreamSpec(arg + 8, address) )
+			eparams.serve_spec = arg + 8;
+		else
+		{
+			std::cout << "Stream address " << arg + 8 << " is invalid(unix:path or tcp:port)! Streaming is disabled" << std::endl;
+			eparams.serve_spec.clear();
+		}
+	}
+	else if ( (strcmp(arg, "--lenia") == 0) || (strncmp(arg, "--lenia=", 8) == 0) )
+	{
+		if ( !parseLeniaParams((arg[7] == '=') ? arg + 8 : "", eparams.lenia) )
+		{
+			std::cout << "Lenia parameters " << arg + 7 << " are invalid! Set default values!" << std::endl;
+			parseLeniaParams("", eparams.lenia);
+		}
+	}
+	else if ( strncmp(arg, "--capture=", 10) == 0 )
+	{
+		if ( !parseCaptureSpec(arg + 10, hparams.capture) )
+			std::cout << "Capture target " << arg + 10 << " is invalid! Capture is disabled" << std::endl;
+	}
+	else if ( strcmp(arg, "--capture-lossless") == 0 )
+	{
+		hparams.capture.lossless = true;
+	}
+	else if ( strncmp(arg, "--capture-scale=", 16) == 0 )
+	{
+		hparams.capture.cell_pixels = atoi(arg + 16);
+		if ( (hparams.capture.cell_pixels < 1) || (hparams.capture.cell_pixels > CAPTURE_MAX_CELL_PIXELS) )
+		{
+			std::cout << "Capture scale " << arg + 16 << " is invalid! Set default value!" << std::endl;
+			hparams.capture.cell_pixels = CAPTURE_DEFAULT_CELL_PIXELS;
+		}
+	}
+	else if ( strcmp(arg, "--autotune") == 0 )
+	{
+		eparams.autotune = true;
+	}
+	else if ( strncmp(arg, "--autotune-cache=", 17) == 0 )
+	{
+		eparams.autotune = true;
+		eparams.autotune_cache = arg + 17;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef PATTERNS_CPP
+#define PATTERNS_CPP
+
+
+#include "../includes/Patterns.hpp"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+
+namespace
+{
+
+struct BuiltinPattern
+{
+	const char* name;
+	const char* rle;
+};
+
+const BuiltinPattern builtin_patterns[] =
+{
+	// Осцилляторы
+	{ "blinker",		"3o!" },
+	{ "pulsar",			"2b3o3b3o2b2$o4bobo4bo$o4bobo4bo$o4bobo4bo$2b3o3b3o2b2$2b3o3b3o2b$o4bobo4bo$o4bobo4bo$o4bobo4bo2$2b3o3b3o!" },
+	// Корабли
+	{ "glider",			"bo$2bo$3o!" },
+	{ "lwss",			"bo2bo$o4b$o3bo$4o!" },
+	{ "mwss",			"3bo2b$bo3bo$o5b$o4bo$5o!" },
+	{ "hwss",			"3b2o2b$bo4bo$o6b$o5bo$6o!" },
+	// Долгоживущие
+	{ "r-pentomino",	"b2o$2o$bo!" },
+	{ "acorn",			"bo5b$3bo3b$2o2b3o!" },
+	{ "diehard",		"6bob$2o6b$bo3b3o!" },
+	// Ружья и паровозы
+	{ "gosper-gun",		"24bo11b$22bobo11b$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o14b$2o8bo3bob2o4bobo11b$10bo5bo7bo11b$11bo3bo20b$12b2o!" },
+	{ "simkin-gun",		"2o5b2o$2o5b2o2$4b2o$4b2o5$22b2ob2o$21bo5bo$21bo6bo2b2o$21b3o3bo3b2o$26bo4$20b2o$20bo$21b3o$23bo!" },
+	{ "puffer",			"b3o11b3o$o2bo10bo2bo$3bo4b3o6bo$3bo4bo2bo5bo$2bo4bo8bobo!" }
+};
+
+}
+
+
+/*
+ * Разбирает шаблон в формате RLE: строки-комментарии(#) и заголовок(x = ...) пропускаются,
+ * размер шаблона определяется по самим данным
+ */
+bool parseRle(const std::string& text, Pattern& pattern)
+{
+	std::istringstream in(text);
+	std::string line;
+	std::string data;
+
+	while ( std::getline(in, line) )
+	{
+		size_t start = line.find_first_not_of(" \t\r");
+		if ( start == std::string::npos )
+			continue;
+		if ( (line[start] == '#') || (line[start] == 'x') )
+			continue;
+		data.append(line, start, std::string::npos);
+	}
+
+	std::vector<std::pair<int, int>> alive;
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int count = 0;
+	bool finished = false;
+
+	for ( size_t i = 0; (i < data.size()) && !finished; ++i )
+	{
+		char c = data[i];
+
+		if ( (c >= '0') && (c <= '9') )
+		{
+			count = count * 10 + (c - '0');
+			continue;
+		}
+
+		int run = (count > 0) ? count : 1;
+		count = 0;
+
+		switch ( c )
+		{
+			case 'b':
+			case '.':
+				x += run;
+				break;
+			case '$':
+				y += run;
+				x = 0;
+				break;
+			case '!':
+				finished = true;
+				break;
+			case ' ':
+			case '\t':
+			case '\r':
+			case '\n':
+				break;
+			default:
+				if ( !(((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'))) )
+					return false;
+				for ( int k = 0; k < run; ++k )
+					alive.push_back(std::make_pair(x++, y));
+		}
+
+		if ( x > width )
+			width = x;
+	}
+
+	int height = 0;
+	for ( auto& p : alive )
+		if ( p.second + 1 > height )
+			height = p.second + 1;
+
+	if ( (width == 0) || (height == 0) )
+		return false;
+
+	pattern.width = width;
+	pattern.height = height;
+	pattern.cells.assign(size_t(width) * height, 0);
+	for ( auto& p : alive )
+		pattern.cells[p.second * width + p.first] = 1;
+
+	return true;
+}
+
+bool getBuiltinPattern(const char* name, Pattern& pattern)
+{
+	for ( auto& bp : builtin_patterns )
+	{
+		if ( strcmp(bp.name, name) == 0 )
+		{
+			pattern.name = bp.name;
+			return parseRle(bp.rle, pattern);
+		}
+	}
+
+	return false;
+}
+
+int getBuiltinPatternsCount(void)
+{
+	return int(sizeof(builtin_patterns) / sizeof(builtin_patterns[0]));
+}
+
+const char* getBuiltinPatternName(int idx)
+{
+	if ( (idx < 0) || (idx >= getBuiltinPatternsCount()) )
+		return nullptr;
+
+	return builtin_patterns[idx].name;
+}
+
+// Читает шаблон из RLE-файла, имя шаблона - путь к файлу
+bool loadPatternFile(const char* path, Pattern& pattern)
+{
+	std::ifstream in(path);
+	if ( !in )
+		return false;
+
+	std::stringstream text;
+	text << in.rdbuf();
+
+	pattern.name = path;
+	return parseRle(text.str(), pattern);
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef PNG_CPP
+#define PNG_CPP
+
+
+#include "../includes/Png.hpp"
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+
+const int length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const int length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const int distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+		1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const int distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Биты deflate пишутся с младшего, коды Хаффмана - со старшего
+class BitWriter
+{
+	std::vector<unsigned char>& out;
+	uint32_t bits;
+	int count;
+public:
+	BitWriter(std::vector<unsigned char>& o) : out(o), bits(0), count(0) {}
+
+	void Put(uint32_t value, int n)
+	{
+		bits |= value << count;
+		count += n;
+		while ( count >= 8 )
+		{
+			out.push_back(static_cast<unsigned char>(bits));
+			bits >>= 8;
+			count -= 8;
+		}
+	}
+
+	void PutCode(uint32_t code, int n)
+	{
+		uint32_t reversed = 0;
+		for ( int i = 0; i < n; ++i )
+			reversed |= ((code >> i) & 1) << (n - 1 - i);
+		Put(reversed, n);
+	}
+
+	void Flush(void)
+	{
+		if ( count > 0 )
+			out.push_back(static_cast<unsigned char>(bits));
+		bits = 0;
+		count = 0;
+	}
+};
+
+// Фиксированные коды литералов и длин(RFC 1951, 3.2.6)
+void putSymbol(BitWriter& w, int symbol)
+{
+	if ( symbol < 144 )
+		w.PutCode(0x30 + symbol, 8);
+	else if ( symbol < 256 )
+		w.PutCode(0x190 + symbol - 144, 9);
+	else if ( symbol < 280 )
+		w.PutCode(symbol - 256, 7);
+	else
+		w.PutCode(0xC0 + symbol - 280, 8);
+}
+
+void putMatch(BitWriter& w, int length, int distance)
+{
+	int l = 28;
+	while ( length_base[l] > length )
+		--l;
+	putSymbol(w, 257 + l);
+	w.Put(length - length_base[l], length_extra[l]);
+
+	int d = 29;
+	while ( distance_base[d] > distance )
+		--d;
+	w.PutCode(d, 5);
+	w.Put(distance - distance_base[d], distance_extra[d]);
+}
+
+size_t matchLength(const unsigned char* data, size_t pos, size_t size, size_t distance)
+{
+	size_t limit = std::min(size - pos, size_t(PNG_MAX_MATCH));
+	size_t length = 0;
+	while ( (length < limit) && (data[pos + length] == data[pos + length - distance]) )
+		++length;
+
+	return length;
+}
+
+// Поток zlib: заголовок, один блок deflate с фиксированными кодами, Adler-32
+void deflateRows(const unsigned char* data, size_t size, size_t row_size, std::vector<unsigned char>& out)
+{
+	out.push_back(0x78);
+	out.push_back(0x01);
+
+	BitWriter w(out);
+	w.Put(1, 1);
+	w.Put(1, 2);
+
+	size_t pos = 0;
+	while ( pos < size )
+	{
+		size_t best = 0;
+		size_t best_distance = 0;
+		for ( size_t distance : { size_t(1), row_size } )
+		{
+			if ( (distance > pos) || (distance > PNG_MAX_DISTANCE) )
+				continue;
+			size_t length = matchLength(data, pos, size, distance);
+			if ( length > best )
+			{
+				best = length;
+				best_distance = distance;
+			}
+		}
+
+		if ( best >= 3 )
+		{
+			putMatch(w, int(best), int(best_distance));
+			pos += best;
+		}
+		else
+		{
+			putSymbol(w, data[pos]);
+			++pos;
+		}
+	}
+
+	putSymbol(w, 256);
+	w.Flush();
+
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for ( size_t i = 0; i < size; ++i )
+	{
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	uint32_t adler = (b << 16) | a;
+	for ( int shift = 24; shift >= 0; shift -= 8 )
+		out.push_back(static_cast<unsigned char>(adler >> shift));
+}
+
+std::vector<uint32_t> makeCrcTable(void)
+{
+	std::vector<uint32_t> table(256);
+	for ( uint32_t n = 0; n < 256; ++n )
+	{
+		uint32_t c = n;
+		for ( int k = 0; k < 8; ++k )
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		table[n] = c;
+	}
+
+	return table;
+}
+
+void putUint32(std::vector<unsigned char>& out, uint32_t value)
+{
+	for ( int shift = 24; shift >= 0; shift -= 8 )
+		out.push_back(static_cast<unsigned char>(value >> shift));
+}
+
+// Блок PNG: длина, тип, данные и CRC-32 типа и данных
+void putChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+{
+	static const std::vector<uint32_t> crc_table = makeCrcTable();
+
+	putUint32(png, uint32_t(data.size()));
+	size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+
+	uint32_t crc = 0xFFFFFFFFu;
+	for ( size_t i = start; i < png.size(); ++i )
+		crc = crc_table[(crc ^ png[i]) & 0xFF] ^ (crc >> 8);
+	putUint32(png, crc ^ 0xFFFFFFFFu);
+}
+
+}
+
+
+bool encodePngIndexed(const unsigned char* indices, int width, int height, const unsigned char* palette, int colors,
+		std::vector<unsigned char>& png)
+{
+	if ( (width < 1) || (height < 1) || (colors < 1) || (colors > PNG_MAX_COLORS) )
+		return false;
+
+	// Перед каждой строкой - байт фильтра 0(без фильтра)
+	size_t row_size = size_t(width) + 1;
+	std::vector<unsigned char> raw(row_size * height);
+	for ( int y = 0; y < height; ++y )
+	{
+		raw[y * row_size] = 0;
+		memcpy(raw.data() + y * row_size + 1, indices + size_t(y) * width, width);
+	}
+
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	png.assign(signature, signature + 8);
+
+	std::vector<unsigned char> header;
+	putUint32(header, uint32_t(width));
+	putUint32(header, uint32_t(height));
+	header.push_back(8);		// бит на индекс
+	header.push_back(3);		// изображение с палитрой
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	putChunk(png, "IHDR", header);
+
+	std::vector<unsigned char> plte;
+	std::vector<unsigned char> trns;
+	bool transparent = false;
+	for ( int i = 0; i < colors; ++i )
+	{
+		plte.insert(plte.end(), palette + i * 4, palette + i * 4 + 3);
+		trns.push_back(palette[i * 4 + 3]);
+		transparent = transparent || (palette[i * 4 + 3] != 255);
+	}
+	putChunk(png, "PLTE", plte);
+	if ( transparent )
+		putChunk(png, "tRNS", trns);
+
+	std::vector<unsigned char> idat;
+	deflateRows(raw.data(), raw.size(), row_size, idat);
+	putChunk(png, "IDAT", idat);
+	putChunk(png, "IEND", std::vector<unsigned char>());
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef REGIONS_CPP
+#define REGIONS_CPP
+
+
+#include "../includes/Regions.hpp"
+#include <algorithm>
+
+
+namespace
+{
+
+inline int popcountWord(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(word);
+#else
+	int count = 0;
+	for ( ; word; word &= word - 1 )
+		++count;
+	return count;
+#endif
+}
+
+// Биты [lo, hi) слова, 0 <= lo < hi <= 64
+inline uint64_t bitRange(int lo, int hi)
+{
+	uint64_t high = (hi == GRID_WORD_BITS) ? ~uint64_t(0) : ((uint64_t(1) << hi) - 1);
+	return high & (~uint64_t(0) << lo);
+}
+
+}
+
+
+RegionIndex::RegionIndex(int w, int h)
+{
+	Reset(w, h);
+}
+
+RegionIndex::RegionIndex()
+{
+}
+
+RegionIndex::RegionIndex(const RegionIndex& ri)
+{
+}
+
+RegionIndex::RegionIndex(RegionIndex&& ri)
+{
+}
+
+void RegionIndex::Reset(int w, int h)
+{
+	width = w;
+	height = h;
+	row_words = (w + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	blocks_x = row_words;
+	blocks_y = (h + REGION_BLOCK_SIZE - 1) / REGION_BLOCK_SIZE;
+	previous.assign(size_t(row_words) * h, 0);
+	previous_box = GridBox { 0, 0, 0, 0 };
+	blocks.assign(size_t(blocks_x) * blocks_y, 0);
+	sums.assign(size_t(blocks_x + 1) * (blocks_y + 1), 0);
+	sums_valid = true;
+	population = 0;
+	changed_words = 0;
+}
+
+/*
+ * Вне старой и новой рамок живых клеток и поле, и копия пустые, поэтому сравниваются только слова внутри них.
+ * Счётчик блока меняется на разницу численностей старого и нового слова
+ */
+void RegionIndex::Update(const Grid& grid)
+{
+	if ( (grid.GetWidth() != width) || (grid.GetHeight() != height) )
+		Reset(grid.GetWidth(), grid.GetHeight());
+
+	GridBox live = grid.GetLiveBox();
+	GridBox box = uniteBoxes(live, previous_box);
+	changed_words = 0;
+	if ( isBoxEmpty(box) )
+		return;
+
+	const uint64_t* mask = grid.GetTailMask();
+	int word_begin = box.x0 / GRID_WORD_BITS;
+	int word_end = (box.x1 + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	for ( int y = box.y0; y < box.y1; ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		uint64_t* prev = previous.data() + size_t(y) * row_words;
+		int* block_row = blocks.data() + size_t(y / REGION_BLOCK_SIZE) * blocks_x;
+
+		// Без ветвлений: в плотном супе меняется почти каждое слово, и переход не угадывается
+		int row_delta = 0;
+		for ( int i = word_begin; i < word_end; ++i )
+		{
+			uint64_t cur = row[i] & mask[i];
+			int delta = popcountWord(cur) - popcountWord(prev[i]);
+			changed_words += (cur != prev[i]);
+			block_row[i] += delta;
+			row_delta += delta;
+			prev[i] = cur;
+		}
+		population += row_delta;
+	}
+
+	previous_box = live;
+	if ( changed_words > 0 )
+		sums_valid = false;
+}
+
+void RegionIndex::PrepareSums(void) const
+{
+	if ( sums_valid )
+		return;
+
+	for ( int by = 0; by < blocks_y; ++by )
+	{
+		const int* block_row = blocks.data() + size_t(by) * blocks_x;
+		const long long* above = sums.data() + size_t(by) * (blocks_x + 1);
+		long long* out = sums.data() + size_t(by + 1) * (blocks_x + 1);
+		long long row_sum = 0;
+		for ( int bx = 0; bx < blocks_x; ++bx )
+		{
+			row_sum += block_row[bx];
+			out[bx + 1] = above[bx + 1] + row_sum;
+		}
+	}
+	sums_valid = true;
+}
+
+// Живых клеток в блоках [bx0, bx1) x [by0, by1)
+long long RegionIndex::SumBlocks(int bx0, int by0, int bx1, int by1) const
+{
+	size_t line = blocks_x + 1;
+
+	return sums[by1 * line + bx1] - sums[by0 * line + bx1] - sums[by1 * line + bx0] + sums[by0 * line + bx0];
+}
+
+// Живых клеток в [x0, x1) x [y0, y1) по копии поля, словами строк
+long long RegionIndex::CountCells(int x0, int y0, int x1, int y1) const
+{
+	if ( (x0 >= x1) || (y0 >= y1) )
+		return 0;
+
+	int first = x0 / GRID_WORD_BITS;
+	int last = (x1 - 1) / GRID_WORD_BITS;
+	uint64_t first_mask = bitRange(x0 % GRID_WORD_BITS, (first == last) ? (x1 - 1) % GRID_WORD_BITS + 1 : GRID_WORD_BITS);
+	uint64_t last_mask = bitRange(0, (x1 - 1) % GRID_WORD_BITS + 1);
+
+	long long count = 0;
+	for ( int y = y0; y < y1; ++y )
+	{
+		const uint64_t* row = previous.data() + size_t(y) * row_words;
+		count += popcountWord(row[first] & first_mask);
+		if ( first == last )
+			continue;
+		for ( int i = first + 1; i < last; ++i )
+			count += popcountWord(row[i]);
+		count += popcountWord(row[last] & last_mask);
+	}
+
+	return count;
+}
+
+/*
+ * Живых клеток в прямоугольнике(x, y, w, h), обрезанном по полю. Целые блоки внутри - по префиксным суммам,
+ * полосы неполных блоков сверху, снизу, слева и справа - по клеткам
+ */
+long long RegionIndex::Count(int x, int y, int w, int h) const
+{
+	int x0 = std::max(x, 0);
+	int y0 = std::max(y, 0);
+	int x1 = std::min(x + w, width);
+	int y1 = std::min(y + h, height);
+	if ( (x0 >= x1) || (y0 >= y1) )
+		return 0;
+
+	int bx0 = (x0 + REGION_BLOCK_SIZE - 1) / REGION_BLOCK_SIZE;
+	int by0 = (y0 + REGION_BLOCK_SIZE - 1) / REGION_BLOCK_SIZE;
+	int bx1 = x1 / REGION_BLOCK_SIZE;
+	int by1 = y1 / REGION_BLOCK_SIZE;
+	if ( (bx0 >= bx1) || (by0 >= by1) )
+		return CountCells(x0, y0, x1, y1);
+
+	PrepareSums();
+	int ix0 = bx0 * REGION_BLOCK_SIZE;
+	int iy0 = by0 * REGION_BLOCK_SIZE;
+	int ix1 = bx1 * REGION_BLOCK_SIZE;
+	int iy1 = by1 * REGION_BLOCK_SIZE;
+
+	return SumBlocks(bx0, by0, bx1, by1) + CountCells(x0, y0, x1, iy0) + CountCells(x0, iy1, x1, y1)
+		+ CountCells(x0, iy0, ix0, iy1) + CountCells(ix1, iy0, x1, iy1);
+}
+
+double RegionIndex::GetDensity(int x, int y, int w, int h) const
+{
+	int cells_w = std::min(x + w, width) - std::max(x, 0);
+	int cells_h = std::min(y + h, height) - std::max(y, 0);
+	if ( (cells_w <= 0) || (cells_h <= 0) )
+		return 0.0;
+
+	return double(Count(x, y, w, h)) / (double(cells_w) * cells_h);
+}
+
+// Блоки у правого и нижнего края поля могут быть неполными
+int RegionIndex::GetBlockArea(int bx, int by) const
+{
+	int w = std::min(width - bx * REGION_BLOCK_SIZE, int(REGION_BLOCK_SIZE));
+	int h = std::min(height - by * REGION_BLOCK_SIZE, int(REGION_BLOCK_SIZE));
+
+	return w * h;
+}
+
+// Сводка по блокам: сколько заняты, самый плотный блок и средняя плотность занятых
+void RegionIndex::PrintBlockStats(std::ostream& out) const
+{
+	long long occupied = 0;
+	int densest = -1;
+	double densest_density = 0;
+	double density_sum = 0;
+
+	for ( int by = 0; by < blocks_y; ++by )
+		for ( int bx = 0; bx < blocks_x; ++bx )
+		{
+			int count = GetBlockCount(bx, by);
+			if ( count == 0 )
+				continue;
+
+			double density = double(count) / GetBlockArea(bx, by);
+			++occupied;
+			density_sum += density;
+			if ( density > densest_density )
+			{
+				densest_density = density;
+				densest = by * blocks_x + bx;
+			}
+		}
+
+	out << "Blocks " << REGION_BLOCK_SIZE << "x" << REGION_BLOCK_SIZE << ": " << occupied << " of " << (long long)blocks_x * blocks_y << " occupied";
+	if ( densest >= 0 )
+		out << ", densest at " << densest % blocks_x * REGION_BLOCK_SIZE << "," << densest / blocks_x * REGION_BLOCK_SIZE
+			<< " with density " << densest_density << ", mean density of occupied " << density_sum / occupied;
+	out << std::endl;
+}
+
+#endif
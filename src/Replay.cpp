@@ -0,0 +1,587 @@
+#ifndef REPLAY_CPP
+#define REPLAY_CPP
+
+
+#include "../includes/Replay.hpp"
+#include "../includes/Workers.hpp"
+#include "../includes/Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+
+namespace
+{
+
+const char replay_magic[] = "GOLRPL";
+const size_t replay_magic_size = 6;
+const uint64_t replay_max_cells = uint64_t(1) << 32;		// размер поля из записи не больше 512 МБ на буфер
+
+// Размер поля из заголовка или изменения размера: испорченная запись не должна приводить к огромному выделению
+bool isReplayBoardSizeValid(uint64_t w, uint64_t h)
+{
+	return (w >= 1) && (h >= 1) && (w <= uint64_t(INT_MAX)) && (h <= uint64_t(INT_MAX)) && (w * h <= replay_max_cells);
+}
+
+void putVarint(std::vector<unsigned char>& out, uint64_t value)
+{
+	while ( value >= 0x80 )
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+void putSigned(std::vector<unsigned char>& out, long long value)
+{
+	putVarint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+void putDouble(std::vector<unsigned char>& out, double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	for ( int i = 0; i < 8; ++i )
+		out.push_back((unsigned char)(bits >> (i * 8)));
+}
+
+// Чтение записи: при выходе за конец данных failed становится true, дальше читаются нули
+struct ReplayReader
+{
+	const std::vector<unsigned char>& data;
+	size_t pos;
+	bool failed;
+
+	ReplayReader(const std::vector<unsigned char>& d) : data(d), pos(0), failed(false) {}
+
+	bool AtEnd(void) const { return pos >= data.size(); }
+	size_t GetRemaining(void) const { return (pos < data.size()) ? data.size() - pos : 0; }
+
+	unsigned char Byte(void)
+	{
+		if ( pos >= data.size() )
+		{
+			failed = true;
+			return 0;
+		}
+		return data[pos++];
+	}
+
+	uint64_t Varint(void)
+	{
+		uint64_t value = 0;
+		for ( int shift = 0; shift < 64; shift += 7 )
+		{
+			unsigned char b = Byte();
+			value |= uint64_t(b & 0x7f) << shift;
+			if ( !(b & 0x80) )
+				return value;
+		}
+		failed = true;
+		return 0;
+	}
+
+	long long Signed(void)
+	{
+		uint64_t v = Varint();
+		return (long long)(v >> 1) ^ -(long long)(v & 1);
+	}
+
+	double Double(void)
+	{
+		uint64_t bits = 0;
+		for ( int i = 0; i < 8; ++i )
+			bits |= uint64_t(Byte()) << (i * 8);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+};
+
+const char* replayEventName(int type)
+{
+	switch ( type )
+	{
+		case REPLAY_EVENT_START:	return "start";
+		case REPLAY_EVENT_PAUSE:	return "pause";
+		case REPLAY_EVENT_SPEED:	return "speed";
+	}
+
+	return "event";
+}
+
+}
+
+
+// FNV-1a по упакованным строкам поля(биты за шириной не учитываются)
+uint64_t hashGrid(const Grid& grid)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	const uint64_t* mask = grid.GetTailMask();
+	for ( int y = 0; y < grid.GetHeight(); ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		for ( int i = 0; i < grid.GetRowWords(); ++i )
+		{
+			hash ^= row[i] & mask[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	return hash;
+}
+
+// Правка живых клеток. Окно дополнительно обновляет историю погибших клеток и перерисовывает область
+void applyEditToGrid(const EditCommand& cmd, Grid& grid)
+{
+	switch ( cmd.type )
+	{
+		case EDIT_SET_CELL:
+		case EDIT_CLEAR_CELL:
+			if ( (cmd.x >= 0) && (cmd.x < grid.GetWidth()) && (cmd.y >= 0) && (cmd.y < grid.GetHeight()) )
+				grid.SetCell(cmd.x, cmd.y, cmd.type == EDIT_SET_CELL);
+			break;
+		case EDIT_STAMP:
+			if ( cmd.stamp )
+				grid.Stamp(cmd.stamp->bits.data(), cmd.stamp->row_words, cmd.stamp->width, cmd.stamp->height, cmd.x, cmd.y);
+			break;
+		case EDIT_FILL:
+		{
+			// Поле могло уменьшиться после постановки команды в очередь; конец области - в long long, координаты приходят и из сети
+			int x0 = std::max(cmd.x, 0);
+			int y0 = std::max(cmd.y, 0);
+			int x1 = int(std::min((long long)cmd.x + cmd.w, (long long)grid.GetWidth()));
+			int y1 = int(std::min((long long)cmd.y + cmd.h, (long long)grid.GetHeight()));
+			for ( int y = y0; y < y1; ++y )
+				for ( int x = x0; x < x1; ++x )
+					grid.SetCell(x, y, cmd.alive);
+			break;
+		}
+		case EDIT_RANDOMIZE:
+			grid.Randomize(cmd.density, cmd.seed);
+			break;
+	}
+}
+
+
+ReplayRecorder::ReplayRecorder()
+{
+	output = nullptr;
+	last_generation = 0;
+	events = 0;
+}
+
+ReplayRecorder::ReplayRecorder(const ReplayRecorder& rr)
+{
+}
+
+ReplayRecorder::ReplayRecorder(ReplayRecorder&& rr)
+{
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+	if ( output )
+	{
+		Flush();
+		fclose(output);
+	}
+}
+
+bool ReplayRecorder::Open(const char* path, const ReplayHeader& header)
+{
+	output = fopen(path, "wb");
+	if ( output == nullptr )
+	{
+		std::cout << "[ReplayRecorder::Open](" << this << "): " << "Unable to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	buffer.insert(buffer.end(), replay_magic, replay_magic + replay_magic_size);
+	putVarint(buffer, REPLAY_VERSION);
+	putVarint(buffer, header.cells_x);
+	putVarint(buffer, header.cells_y);
+	putVarint(buffer, header.toroidal ? 1 : 0);
+	putVarint(buffer, header.rule.birth);
+	putVarint(buffer, header.rule.survive);
+	putVarint(buffer, header.rule.radius);
+	putVarint(buffer, header.rule.neighbourhood);
+	putVarint(buffer, header.rule.middle ? 1 : 0);
+	putVarint(buffer, header.rule.birth_min);
+	putVarint(buffer, header.rule.birth_max);
+	putVarint(buffer, header.rule.survive_min);
+	putVarint(buffer, header.rule.survive_max);
+	putVarint(buffer, header.timeline.keyframe_interval);
+	putVarint(buffer, header.timeline.budget);
+
+	std::cout << "Recording the session to " << path << std::endl;
+
+	return true;
+}
+
+void ReplayRecorder::BeginEvent(long long generation, int type)
+{
+	buffer.push_back((unsigned char)type);
+	putSigned(buffer, generation - last_generation);
+	last_generation = generation;
+	++events;
+}
+
+void ReplayRecorder::RecordEdit(long long generation, const EditCommand& cmd)
+{
+	if ( !output )
+		return;
+
+	BeginEvent(generation, REPLAY_EVENT_EDIT);
+	buffer.push_back((unsigned char)cmd.type);
+	putSigned(buffer, cmd.x);
+	putSigned(buffer, cmd.y);
+	putSigned(buffer, cmd.w);
+	putSigned(buffer, cmd.h);
+	buffer.push_back(cmd.alive ? 1 : 0);
+
+	if ( cmd.type == EDIT_STAMP )
+	{
+		const Stamp* stamp = cmd.stamp;
+		putVarint(buffer, stamp ? stamp->width : 0);
+		putVarint(buffer, stamp ? stamp->height : 0);
+		if ( stamp )
+			for ( uint64_t word : stamp->bits )
+				putVarint(buffer, word);
+	}
+	else if ( cmd.type == EDIT_RANDOMIZE )
+	{
+		putVarint(buffer, cmd.seed);
+		putDouble(buffer, cmd.density);
+	}
+
+	if ( buffer.size() >= REPLAY_FLUSH_BYTES )
+		Flush();
+}
+
+void ReplayRecorder::RecordEvent(long long generation, int type, long long value)
+{
+	if ( !output )
+		return;
+
+	BeginEvent(generation, type);
+	putSigned(buffer, value);
+
+	if ( buffer.size() >= REPLAY_FLUSH_BYTES )
+		Flush();
+}
+
+void ReplayRecorder::RecordResize(long long generation, int w, int h, int anchor)
+{
+	if ( !output )
+		return;
+
+	BeginEvent(generation, REPLAY_EVENT_RESIZE);
+	putVarint(buffer, w);
+	putVarint(buffer, h);
+	putVarint(buffer, anchor);
+}
+
+// Последнее событие хранит итоговое поле, по которому воспроизведение проверяет себя
+void ReplayRecorder::Close(long long generation, const Grid& grid)
+{
+	if ( !output )
+		return;
+
+	BeginEvent(generation, REPLAY_EVENT_END);
+	putVarint(buffer, grid.CountPopulation());
+	putVarint(buffer, hashGrid(grid));
+	Flush();
+
+	long size = ftell(output);
+	fclose(output);
+	output = nullptr;
+
+	std::cout << "Recorded " << events << " events, " << size << " bytes" << std::endl;
+}
+
+void ReplayRecorder::Flush(void)
+{
+	if ( buffer.empty() )
+		return;
+
+	if ( fwrite(buffer.data(), 1, buffer.size(), output) != buffer.size() )
+		std::cout << "[ReplayRecorder::Flush](" << this << "): " << "Unable to write the replay log" << std::endl;
+	buffer.clear();
+}
+
+
+/*
+ * Воспроизводит запись без окна с максимальной скоростью: поколения считаются подряд, события
+ * применяются на тех же границах поколений, что и в записанной сессии. Печатает время шагов
+ * и самое медленное поколение, в конце сверяет итоговое поле с записанным
+ */
+int runReplay(const char* path, const EngineParams& eparams)
+{
+	std::ifstream in(path, std::ios::binary);
+	if ( !in )
+	{
+		std::cout << "Unable to open replay log " << path << std::endl;
+		return 1;
+	}
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	if ( (data.size() < replay_magic_size) || (memcmp(data.data(), replay_magic, replay_magic_size) != 0) )
+	{
+		std::cout << "File " << path << " is not a replay log" << std::endl;
+		return 1;
+	}
+
+	ReplayReader reader(data);
+	reader.pos = replay_magic_size;
+	uint64_t version = reader.Varint();
+	if ( (version < 1) || (version > REPLAY_VERSION) )
+	{
+		std::cout << "Replay log " << path << " has an unsupported version" << std::endl;
+		return 1;
+	}
+
+	ReplayHeader header;
+	uint64_t cells_x = reader.Varint();
+	uint64_t cells_y = reader.Varint();
+	bool size_valid = isReplayBoardSizeValid(cells_x, cells_y);
+	header.cells_x = size_valid ? int(cells_x) : 0;
+	header.cells_y = size_valid ? int(cells_y) : 0;
+	header.toroidal = reader.Varint() != 0;
+	header.rule.birth = (unsigned short)reader.Varint();
+	header.rule.survive = (unsigned short)reader.Varint();
+	if ( version >= 2 )
+	{
+		header.rule.radius = int(reader.Varint());
+		header.rule.neighbourhood = int(reader.Varint());
+		header.rule.middle = reader.Varint() != 0;
+		header.rule.birth_min = int(reader.Varint());
+		header.rule.birth_max = int(reader.Varint());
+		header.rule.survive_min = int(reader.Varint());
+		header.rule.survive_max = int(reader.Varint());
+	}
+	else
+	{
+		LifeRule classic = conwayRule();
+		header.rule.radius = classic.radius;
+		header.rule.neighbourhood = classic.neighbourhood;
+		header.rule.middle = classic.middle;
+		header.rule.birth_min = header.rule.birth_max = header.rule.survive_min = header.rule.survive_max = 0;
+	}
+	header.timeline.keyframe_interval = int(reader.Varint());
+	header.timeline.budget = size_t(reader.Varint());
+	if ( reader.failed || (header.cells_x < 1) || (header.cells_y < 1)
+		|| (header.rule.radius < 1) || (header.rule.radius > LIFE_MAX_RADIUS) )
+	{
+		std::cout << "Replay log " << path << " has a corrupted header" << std::endl;
+		return 1;
+	}
+
+	EngineParams params = eparams;
+	params.rule = header.rule;
+	params.toroidal = header.toroidal;
+
+	Grid grid(header.cells_x, header.cells_y, header.toroidal);
+	StepKernel kernel = getStepKernel(selectStepKernel(params, header.cells_x, header.cells_y));
+	WorkerPool workers(params.threads);
+
+	// История нужна, чтобы повторить перемотки: с теми же параметрами она отбрасывает те же поколения
+	Timeline* timeline = (header.timeline.budget > 0) ? new Timeline(header.timeline, header.cells_x, header.cells_y) : nullptr;
+	if ( timeline )
+		timeline->Record(grid, 0);
+
+	std::cout << "Replaying " << path << ": " << header.cells_x << "x" << header.cells_y << (header.toroidal ? " torus" : " bordered")
+			  << ", rule " << lifeRuleToString(header.rule) << ", threads: " << workers.GetWorkersCount() << std::endl;
+
+	std::deque<Stamp> stamps;
+	long long generation = 0;
+	long long event_generation = 0;
+	long long events = 0;
+	bool dirty = false;
+	bool finished = false;
+	double step_seconds = 0;
+	double slowest_step = 0;
+	long long slowest_generation = 0;
+	int result = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	while ( !finished && !reader.AtEnd() )
+	{
+		int type = reader.Byte();
+		event_generation += reader.Signed();
+		if ( reader.failed )
+			break;
+
+		// Поколения до события считаются так же, как в окне: после правки или перемотки текущее поколение переписывается в историю
+		while ( generation < event_generation )
+		{
+			if ( timeline && dirty )
+				timeline->Record(grid, generation);
+			dirty = false;
+
+			auto step_start = std::chrono::steady_clock::now();
+			{
+				TRACE_ZONE("Step");
+				grid.Step(params.rule, kernel, &workers);
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - step_start).count();
+			step_seconds += seconds;
+			++generation;
+			if ( seconds > slowest_step )
+			{
+				slowest_step = seconds;
+				slowest_generation = generation;
+			}
+
+			if ( timeline )
+			{
+				TRACE_ZONE("RecordTimeline");
+				timeline->Record(grid, generation);
+			}
+		}
+
+		if ( event_generation < generation )
+		{
+			std::cout << "Replay log " << path << " has events out of order" << std::endl;
+			result = 1;
+			break;
+		}
+
+		TRACE_ZONE("ApplyEvent");
+		++events;
+		switch ( type )
+		{
+			case REPLAY_EVENT_EDIT:
+			{
+				EditCommand cmd;
+				cmd.type = reader.Byte();
+				cmd.x = int(reader.Signed());
+				cmd.y = int(reader.Signed());
+				cmd.w = int(reader.Signed());
+				cmd.h = int(reader.Signed());
+				cmd.alive = reader.Byte() != 0;
+				cmd.stamp = nullptr;
+				cmd.seed = 0;
+				cmd.density = 0;
+
+				if ( cmd.type == EDIT_STAMP )
+				{
+					uint64_t width = reader.Varint();
+					uint64_t height = reader.Varint();
+					// Каждое слово шаблона занимает в записи хотя бы байт: размер из испорченной записи не приводит к огромному выделению
+					if ( reader.failed || (width > uint64_t(INT_MAX)) || (height > uint64_t(INT_MAX))
+						|| ((width + GRID_WORD_BITS - 1) / GRID_WORD_BITS * height > reader.GetRemaining()) )
+					{
+						reader.failed = true;
+						break;
+					}
+					stamps.emplace_back();
+					Stamp& stamp = stamps.back();
+					stamp.width = int(width);
+					stamp.height = int(height);
+					stamp.row_words = (stamp.width + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+					stamp.bits.resize(size_t(stamp.row_words) * stamp.height);
+					for ( auto& word : stamp.bits )
+						word = reader.Varint();
+					cmd.stamp = &stamp;
+				}
+				else if ( cmd.type == EDIT_RANDOMIZE )
+				{
+					cmd.seed = (unsigned int)reader.Varint();
+					cmd.density = reader.Double();
+				}
+
+				applyEditToGrid(cmd, grid);
+				dirty = true;
+				break;
+			}
+			case REPLAY_EVENT_SEEK:
+			{
+				long long target = reader.Signed();
+				if ( !timeline || !timeline->Seek(target, grid) )
+				{
+					std::cout << "Generation " << target << " of the replay log is not in the history" << std::endl;
+					result = 1;
+					finished = true;
+					break;
+				}
+				// Номера следующих событий отсчитываются от поколения перемотки, а не от показанного после неё
+				generation = target;
+				dirty = true;
+				break;
+			}
+			case REPLAY_EVENT_RESIZE:
+			{
+				uint64_t w = reader.Varint();
+				uint64_t h = reader.Varint();
+				int anchor = int(reader.Varint());
+				if ( reader.failed || !isReplayBoardSizeValid(w, h) )
+				{
+					reader.failed = true;
+					break;
+				}
+				grid.Resize(int(w), int(h), anchor);
+				if ( timeline )
+					timeline->Record(grid, generation);
+				break;
+			}
+			case REPLAY_EVENT_START:
+			case REPLAY_EVENT_PAUSE:
+			case REPLAY_EVENT_SPEED:
+			{
+				// На поколения не влияют, показываются для сопоставления с записанной сессией
+				long long value = reader.Signed();
+				std::cout << "Generation " << generation << ": " << replayEventName(type);
+				if ( type == REPLAY_EVENT_SPEED )
+					std::cout << " x" << value;
+				std::cout << std::endl;
+				break;
+			}
+			case REPLAY_EVENT_END:
+			{
+				long long population = (long long)reader.Varint();
+				uint64_t hash = reader.Varint();
+				bool match = (population == grid.CountPopulation()) && (hash == hashGrid(grid));
+				std::cout << (match ? "Replay matches the recording" : "Replay DIVERGED from the recording") << " at generation " << generation
+						  << ", population " << grid.CountPopulation() << " (recorded " << population << ")" << std::endl;
+				if ( !match )
+					result = 1;
+				finished = true;
+				break;
+			}
+			default:
+				reader.failed = true;
+		}
+
+		if ( reader.failed )
+			break;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if ( reader.failed || !finished )
+	{
+		std::cout << "Replay log " << path << " is truncated or corrupted after " << events << " events" << std::endl;
+		result = 1;
+	}
+
+	std::cout << "Generations: " << generation << ", events: " << events << ", time: " << seconds << " s, steps: " << step_seconds << " s";
+	if ( generation > 0 )
+		std::cout << ", " << step_seconds / generation * 1e6 << " us/gen, slowest: generation " << slowest_generation
+				  << " (" << slowest_step * 1e6 << " us)";
+	std::cout << std::endl;
+
+	if ( timeline )
+		delete timeline;
+
+	return result;
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef RESOURCES_CPP
+#define RESOURCES_CPP
+
+
+#include "../includes/Resources.hpp"
+#include "../includes/services.hpp"
+#include <cstring>
+
+
+// Массивы создаются при сборке в Resources_data.cpp
+#define DECLARE_EMBEDDED_RESOURCE(symbol)	\
+	extern const unsigned char symbol[];	\
+	extern const unsigned int symbol##_size;
+
+DECLARE_EMBEDDED_RESOURCE(embedded_background_frame_png)
+DECLARE_EMBEDDED_RESOURCE(embedded_control_panel_frame_png)
+DECLARE_EMBEDDED_RESOURCE(embedded_control_panel_png)
+DECLARE_EMBEDDED_RESOURCE(embedded_cell_png)
+DECLARE_EMBEDDED_RESOURCE(embedded_alive_cell_png)
+DECLARE_EMBEDDED_RESOURCE(embedded_dead_cell_png)
+DECLARE_EMBEDDED_RESOURCE(embedded_sample_ttf)
+
+
+namespace
+{
+
+const EmbeddedResource embedded_resources[] =
+{
+	{ "background_frame.png",		embedded_background_frame_png,		embedded_background_frame_png_size },
+	{ "control_panel_frame.png",	embedded_control_panel_frame_png,	embedded_control_panel_frame_png_size },
+	{ "control_panel.png",			embedded_control_panel_png,			embedded_control_panel_png_size },
+	{ "cell.png",					embedded_cell_png,					embedded_cell_png_size },
+	{ "alive_cell.png",				embedded_alive_cell_png,			embedded_alive_cell_png_size },
+	{ "dead_cell.png",				embedded_dead_cell_png,				embedded_dead_cell_png_size },
+	{ "sample.ttf",					embedded_sample_ttf,				embedded_sample_ttf_size }
+};
+
+}
+
+
+const EmbeddedResource* findEmbeddedResource(const char* name)
+{
+	for ( auto& res : embedded_resources )
+		if ( strcmp(res.name, name) == 0 )
+			return &res;
+
+	return nullptr;
+}
+
+/**
+ * Открывает ресурс для чтения средствами SDL
+ * @param override_path Каталог, файлы которого заменяют встроенные. nullptr - только встроенные ресурсы
+ * @param name Имя файла ресурса
+ * @return Поток SDL_RWops(закрывается функцией, которая его читает), либо nullptr, если ресурса нет
+ */
+SDL_RWops* openResource(const char* override_path, const char* name)
+{
+	if ( override_path )
+	{
+		std::string path = getResourcePath(override_path) + name;
+		SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+		if ( file )
+			return file;
+
+		std::cout << "Resource " << path << " is not found, the built-in one is used" << std::endl;
+	}
+
+	const EmbeddedResource* res = findEmbeddedResource(name);
+	if ( res == nullptr )
+	{
+		std::cout << "Resource " << name << " is not embedded into the program!" << std::endl;
+		return nullptr;
+	}
+
+	return SDL_RWFromConstMem(res->data, int(res->size));
+}
+
+#endif
@@ -28,6 +28,81 @@ SDL_Texture* loadTexture(const std::string& file, SDL_Renderer* ren)
 }
 
 
+/**
+ * Загружает изображение из потока(файла или памяти) в текстуру для рендерера
+ * @param src Поток с изображением, закрывается после чтения
+ * @param ren Рендерер, на который эту текстуру можно будет отрисовать
+ * @return Возвращает текстуру, либо nullptr в случае ошибки.
+ */
+SDL_Texture* loadTexture(SDL_RWops* src, SDL_Renderer* ren)
+{
+	if ( src == nullptr )
+		return nullptr;
+
+	SDL_Texture* texture = IMG_LoadTexture_RW(ren, src, 1);
+	if ( !texture )
+	{
+		std::cout << IMG_GetError() << std::endl;
+	}
+
+	return texture;
+}
+
+
+/**
+ * Собирает несколько изображений в одну текстуру-атлас, раскладывая их в ряд
+ * Между изображениями остаётся пиксель зазора, чтобы при масштабировании не подмешивались соседи
+ * @param surfaces Изображения
+ * @param count Число изображений
+ * @param ren Рендерер
+ * @param clips Массив из count прямоугольников, куда записываются области изображений в атласе
+ * @return Текстура-атлас, либо nullptr в случае ошибки
+ */
+SDL_Texture* packTextureAtlas(SDL_Surface** surfaces, int count, SDL_Renderer* ren, SDL_Rect* clips)
+{
+	int atlas_w = 0;
+	int atlas_h = 0;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		if ( surfaces[i] == nullptr )
+			return nullptr;
+
+		atlas_w += surfaces[i]->w + ((i > 0) ? 1 : 0);
+		if ( surfaces[i]->h > atlas_h )
+			atlas_h = surfaces[i]->h;
+	}
+
+	SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, atlas_w, atlas_h, 32, SDL_PIXELFORMAT_RGBA32);
+	if ( atlas == nullptr )
+	{
+		logSDLError(std::cout, "SDL_CreateRGBSurfaceWithFormat: ");
+		return nullptr;
+	}
+
+	int x = 0;
+	for ( int i = 0; i < count; ++i )
+	{
+		SDL_Rect dst { x, 0, surfaces[i]->w, surfaces[i]->h };
+
+		// Пиксели копируются как есть, вместе с прозрачностью
+		SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+		SDL_BlitSurface(surfaces[i], nullptr, atlas, &dst);
+
+		clips[i] = SDL_Rect { x, 0, surfaces[i]->w, surfaces[i]->h };
+		x += surfaces[i]->w + 1;
+	}
+
+	SDL_Texture* texture = SDL_CreateTextureFromSurface(ren, atlas);
+	if ( texture == nullptr )
+		logSDLError(std::cout, "SDL_CreateTextureFromSurface: ");
+
+	cleanup(atlas);
+
+	return texture;
+}
+
+
 /**
  * Отобразить SDL_Texture на SDL_Renderer на координатах x, y с масштабированием
  * @param tex Текстура для отображения
@@ -97,6 +172,36 @@ void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, SDL_Rect*
 }
 
 
+// Отображает текст уже открытым шрифтом и закрывает его
+static SDL_Texture* renderTextWithFont(const std::string& message, TTF_Font* font, SDL_Color color, SDL_Renderer* renderer)
+{
+	// Сначала нужно отобразить на поверхность с помощью TTF_RenderText, т.к как SDL_ttf умеет
+	// только отображать на поверхность
+	// Затем загрузить поверхность в текстуру
+	SDL_Surface* surf = TTF_RenderText_Blended(font, message.c_str(), color);
+	if ( surf == nullptr )
+	{
+		TTF_CloseFont(font);
+		logSDLError(std::cout, "TTF_RenderText");
+		return nullptr;
+	}
+
+	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surf);
+	if ( texture == nullptr )
+	{
+		TTF_CloseFont(font);
+		logSDLError(std::cout, "CreateTexture");
+		return nullptr;
+	}
+
+	// Очистка поверхности и шрифта
+	cleanup(surf);
+	TTF_CloseFont(font);
+
+	return texture;
+}
+
+
 /**
  * Отображает текст в текстуру для отрисовки
  * @param message Сообщение, которое хотим отобразить
@@ -117,30 +222,28 @@ SDL_Texture* renderText(const std::string& message, const std::string& fontFile,
 		return nullptr;
 	}
 
-	// Сначала нужно отобразить на поверхность с помощью TTF_RenderText, т.к как SDL_ttf умеет
-	// только отображать на поверхность
-	// Затем загрузить поверхность в текстуру
-	SDL_Surface* surf = TTF_RenderText_Blended(font, message.c_str(), color);
-	if ( surf == nullptr )
-	{
-		TTF_CloseFont(font);
-		logSDLError(std::cout, "TTF_RenderText");
+	return renderTextWithFont(message, font, color, renderer);
+}
+
+
+/**
+ * То же, но шрифт читается из потока(например, встроенного в программу ресурса)
+ * @param fontSrc Поток со шрифтом, закрывается вместе со шрифтом
+ */
+SDL_Texture* renderText(const std::string& message, SDL_RWops* fontSrc,
+		SDL_Color color, int fontSize, SDL_Renderer* renderer)
+{
+	if ( fontSrc == nullptr )
 		return nullptr;
-	}
 
-	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surf);
-	if ( texture == nullptr )
+	TTF_Font* font = TTF_OpenFontRW(fontSrc, 1, fontSize);
+	if ( font == nullptr )
 	{
-		TTF_CloseFont(font);
-		logSDLError(std::cout, "CreateTexture");
+		logSDLError(std::cout, "TTF_OpenFontRW");
 		return nullptr;
 	}
 
-	// Очистка поверхности и шрифта
-	cleanup(surf);
-	TTF_CloseFont(font);
-
-	return texture;
+	return renderTextWithFont(message, font, color, renderer);
 }
 
 
@@ -0,0 +1,333 @@
+#ifndef SHARED_FRAMES_CPP
+#define SHARED_FRAMES_CPP
+
+
+#include "../includes/SharedFrames.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+
+size_t alignSize(size_t size)
+{
+	return (size + GRID_ALIGNMENT - 1) / GRID_ALIGNMENT * GRID_ALIGNMENT;
+}
+
+size_t slotBytes(int row_words, int height)
+{
+	return alignSize(sizeof(SharedFrameSlot) + size_t(row_words) * height * sizeof(uint64_t));
+}
+
+inline long long popcountWord(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(word);
+#else
+	long long count = 0;
+	for ( ; word; word &= word - 1 )
+		++count;
+	return count;
+#endif
+}
+
+}
+
+
+FramePublisher::FramePublisher(const char* shm_name)
+{
+	// Имя сегмента POSIX начинается с '/'
+	name = (shm_name[0] == '/') ? shm_name : std::string("/") + shm_name;
+	width = 0;
+	height = 0;
+	row_words = 0;
+	segment_bytes = 0;
+	segment = nullptr;
+	header = nullptr;
+}
+
+FramePublisher::FramePublisher()
+{
+}
+
+FramePublisher::FramePublisher(const FramePublisher& fp)
+{
+}
+
+FramePublisher::FramePublisher(FramePublisher&& fp)
+{
+}
+
+FramePublisher::~FramePublisher()
+{
+	Close();
+}
+
+bool FramePublisher::Create(int w, int h)
+{
+#if defined(_WIN32)
+	std::cout << "[FramePublisher::Create](" << this << "): Shared frames need POSIX shared memory!" << std::endl;
+	return false;
+#else
+	int words = (w + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	size_t bytes = alignSize(sizeof(SharedFramesHeader)) + slotBytes(words, h) * SHARED_FRAMES_SLOTS;
+
+	// Читатели старого сегмента держат своё отображение, новый создаётся с нуля
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if ( fd < 0 )
+	{
+		std::cout << "[FramePublisher::Create](" << this << "): Unable to create shared memory " << name << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	void* ptr = MAP_FAILED;
+	if ( ftruncate(fd, off_t(bytes)) == 0 )
+		ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if ( ptr == MAP_FAILED )
+	{
+		std::cout << "[FramePublisher::Create](" << this << "): Unable to map " << bytes << " bytes of " << name << ": " << strerror(errno) << std::endl;
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	// Новые страницы сегмента нулевые: счётчики слотов и published начинаются с нуля
+	segment = static_cast<unsigned char*>(ptr);
+	segment_bytes = bytes;
+	width = w;
+	height = h;
+	row_words = words;
+
+	header = reinterpret_cast<SharedFramesHeader*>(segment);
+	header->width = uint32_t(w);
+	header->height = uint32_t(h);
+	header->row_words = uint32_t(words);
+	header->slots_count = SHARED_FRAMES_SLOTS;
+	header->slot_bytes = slotBytes(words, h);
+	header->version = SHARED_FRAMES_VERSION;
+	header->magic.store(SHARED_FRAMES_MAGIC, std::memory_order_release);
+
+	std::cout << "Publishing frames to shared memory " << name << ": " << w << "x" << h << ", " << SHARED_FRAMES_SLOTS << " slots, "
+			  << bytes / 1024 << " KB" << std::endl;
+
+	return true;
+#endif
+}
+
+void FramePublisher::Close(void)
+{
+#if !defined(_WIN32)
+	if ( !segment )
+		return;
+
+	header->closed.store(1, std::memory_order_release);
+	munmap(segment, segment_bytes);
+	shm_unlink(name.c_str());
+	segment = nullptr;
+	header = nullptr;
+#endif
+}
+
+/*
+ * Копирует поле в следующий слот кольца. Счётчик слота нечётный на время записи,
+ * после неё published указывает на этот слот. Никогда не ждёт читателей
+ */
+bool FramePublisher::Publish(const Grid& grid, long long generation)
+{
+	if ( (grid.GetWidth() != width) || (grid.GetHeight() != height) )
+	{
+		Close();
+		if ( !Create(grid.GetWidth(), grid.GetHeight()) )
+			return false;
+	}
+
+	uint64_t index = header->published.load(std::memory_order_relaxed);
+	unsigned char* slot_base = segment + alignSize(sizeof(SharedFramesHeader)) + size_t(index % SHARED_FRAMES_SLOTS) * header->slot_bytes;
+	SharedFrameSlot* slot = reinterpret_cast<SharedFrameSlot*>(slot_base);
+	uint64_t* bits = reinterpret_cast<uint64_t*>(slot_base + sizeof(SharedFrameSlot));
+
+	uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	// Биты за шириной поля(ореол тора) в кадр не попадают
+	const uint64_t* mask = grid.GetTailMask();
+	long long population = 0;
+	for ( int y = 0; y < height; ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		uint64_t* out = bits + size_t(y) * row_words;
+		for ( int i = 0; i < row_words; ++i )
+		{
+			out[i] = row[i] & mask[i];
+			population += popcountWord(out[i]);
+		}
+	}
+	slot->generation = generation;
+	slot->population = population;
+
+	slot->sequence.store(sequence + 2, std::memory_order_release);
+	header->published.store(index + 1, std::memory_order_release);
+
+	return true;
+}
+
+
+FrameSubscriber::FrameSubscriber(const char* shm_name)
+{
+	name = (shm_name[0] == '/') ? shm_name : std::string("/") + shm_name;
+	segment_bytes = 0;
+	segment = nullptr;
+	header = nullptr;
+}
+
+FrameSubscriber::FrameSubscriber()
+{
+}
+
+FrameSubscriber::FrameSubscriber(const FrameSubscriber& fs)
+{
+}
+
+FrameSubscriber::FrameSubscriber(FrameSubscriber&& fs)
+{
+}
+
+FrameSubscriber::~FrameSubscriber()
+{
+	Unmap();
+}
+
+void FrameSubscriber::Unmap(void)
+{
+#if !defined(_WIN32)
+	if ( segment )
+		munmap(const_cast<unsigned char*>(segment), segment_bytes);
+#endif
+	segment = nullptr;
+	header = nullptr;
+}
+
+// Отображает сегмент только для чтения. Повторный вызов открывает сегмент заново(после смены размера поля)
+bool FrameSubscriber::Open(void)
+{
+	Unmap();
+
+#if defined(_WIN32)
+	std::cout << "[FrameSubscriber::Open](" << this << "): Shared frames need POSIX shared memory!" << std::endl;
+	return false;
+#else
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if ( fd < 0 )
+		return false;
+
+	struct stat st;
+	void* ptr = MAP_FAILED;
+	if ( (fstat(fd, &st) == 0) && (size_t(st.st_size) >= sizeof(SharedFramesHeader)) )
+		ptr = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if ( ptr == MAP_FAILED )
+		return false;
+
+	segment = static_cast<const unsigned char*>(ptr);
+	segment_bytes = size_t(st.st_size);
+	const SharedFramesHeader* h = reinterpret_cast<const SharedFramesHeader*>(segment);
+
+	// Писатель мог ещё не заполнить заголовок. Чужой или испорченный заголовок не должен выводить чтение кадра за слот и сегмент
+	uint32_t magic = h->magic.load(std::memory_order_acquire);
+	bool valid = (magic == SHARED_FRAMES_MAGIC) && (h->version == SHARED_FRAMES_VERSION) && (h->width > 0) && (h->height > 0)
+		&& (h->row_words == (uint64_t(h->width) + GRID_WORD_BITS - 1) / GRID_WORD_BITS) && (h->slots_count > 0);
+	if ( valid )
+	{
+		uint64_t frame_bytes = uint64_t(h->row_words) * h->height * sizeof(uint64_t);
+		uint64_t rings_bytes = segment_bytes - alignSize(sizeof(SharedFramesHeader));
+		valid = (segment_bytes >= alignSize(sizeof(SharedFramesHeader))) && (h->slot_bytes >= sizeof(SharedFrameSlot) + frame_bytes)
+			&& (h->slot_bytes <= rings_bytes) && (h->slots_count <= rings_bytes / h->slot_bytes);
+	}
+	if ( !valid )
+	{
+		Unmap();
+		return false;
+	}
+
+	header = h;
+
+	return true;
+#endif
+}
+
+const SharedFrameSlot* FrameSubscriber::GetSlot(int slot) const
+{
+	return reinterpret_cast<const SharedFrameSlot*>(segment + alignSize(sizeof(SharedFramesHeader)) + size_t(slot) * header->slot_bytes);
+}
+
+// Последний опубликованный кадр, если его слот сейчас не переписывается
+bool FrameSubscriber::Acquire(SharedFrameView& view) const
+{
+	if ( !header )
+		return false;
+
+	uint64_t published = header->published.load(std::memory_order_acquire);
+	if ( published == 0 )
+		return false;
+
+	int slot = int((published - 1) % header->slots_count);
+	const SharedFrameSlot* s = GetSlot(slot);
+	uint64_t sequence = s->sequence.load(std::memory_order_acquire);
+	if ( sequence & 1 )
+		return false;
+
+	view.bits = reinterpret_cast<const uint64_t*>(reinterpret_cast<const unsigned char*>(s) + sizeof(SharedFrameSlot));
+	view.generation = s->generation;
+	view.population = s->population;
+	view.slot = slot;
+	view.sequence = sequence;
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	return Validate(view);
+}
+
+// Кадр не переписан с момента Acquire: всё прочитанное из view до этого вызова целое
+bool FrameSubscriber::Validate(const SharedFrameView& view) const
+{
+	if ( !header )
+		return false;
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	return GetSlot(view.slot)->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
+
+bool FrameSubscriber::Read(std::vector<uint64_t>& bits, SharedFrameView& view) const
+{
+	if ( !header )
+		return false;
+
+	size_t words = size_t(header->row_words) * header->height;
+	bits.resize(words);
+
+	for ( int attempt = 0; attempt < SHARED_FRAMES_READ_RETRIES; ++attempt )
+	{
+		if ( !Acquire(view) )
+			continue;
+
+		memcpy(bits.data(), view.bits, words * sizeof(uint64_t));
+		if ( Validate(view) )
+			return true;
+	}
+
+	return false;
+}
+
+#endif
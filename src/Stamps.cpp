@@ -0,0 +1,119 @@
+#ifndef STAMPS_CPP
+#define STAMPS_CPP
+
+
+#include "../includes/Stamps.hpp"
+#include "../includes/Grid.hpp"
+#include "../includes/services.hpp"
+#include <utility>
+
+
+// Упаковывает шаблон в заданной ориентации: сначала зеркало, затем поворот по часовой стрелке
+void buildStamp(const Pattern& pattern, int orientation, Stamp& stamp)
+{
+	int rotation = orientation % STAMP_ROTATIONS;
+	bool flip = (orientation & STAMP_FLIP) != 0;
+
+	stamp.width = (rotation % 2) ? pattern.height : pattern.width;
+	stamp.height = (rotation % 2) ? pattern.width : pattern.height;
+	stamp.row_words = (stamp.width + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	stamp.bits.assign(size_t(stamp.row_words) * stamp.height, 0);
+	stamp.cells.assign(size_t(stamp.width) * stamp.height, 0);
+
+	for ( int y = 0; y < pattern.height; ++y )
+		for ( int x = 0; x < pattern.width; ++x )
+		{
+			if ( !pattern.cells[size_t(y) * pattern.width + x] )
+				continue;
+
+			int fx = flip ? pattern.width - 1 - x : x;
+			int fy = y;
+			int w = pattern.width;
+			int h = pattern.height;
+			for ( int r = 0; r < rotation; ++r )
+			{
+				int t = fx;
+				fx = h - 1 - fy;
+				fy = t;
+				std::swap(w, h);
+			}
+
+			stamp.bits[size_t(fy) * stamp.row_words + fx / GRID_WORD_BITS] |= uint64_t(1) << (fx % GRID_WORD_BITS);
+			stamp.cells[size_t(fy) * stamp.width + fx] = 1;
+		}
+}
+
+int rotateOrientation(int orientation)
+{
+	return (orientation & STAMP_FLIP) | ((orientation + 1) % STAMP_ROTATIONS);
+}
+
+// Зеркало после поворота на r равно повороту на -r после зеркала
+int flipOrientation(int orientation)
+{
+	return ((orientation & STAMP_FLIP) ^ STAMP_FLIP) | ((STAMP_ROTATIONS - orientation % STAMP_ROTATIONS) % STAMP_ROTATIONS);
+}
+
+
+void StampLibrary::Add(const std::string& name, const Pattern& pattern)
+{
+	patterns.emplace_back();
+	StampPattern& sp = patterns.back();
+	sp.name = name;
+	for ( int o = 0; o < STAMP_ORIENTATIONS; ++o )
+		buildStamp(pattern, o, sp.orientations[o]);
+}
+
+int StampLibrary::LoadBuiltins(void)
+{
+	int loaded = 0;
+	for ( int i = 0; i < getBuiltinPatternsCount(); ++i )
+	{
+		Pattern pattern;
+		if ( getBuiltinPattern(getBuiltinPatternName(i), pattern) )
+		{
+			Add(pattern.name, pattern);
+			++loaded;
+		}
+	}
+
+	return loaded;
+}
+
+// Загружает все *.rle из каталога, имя шаблона - имя файла без расширения. Возвращает число загруженных шаблонов
+int StampLibrary::LoadDirectory(const char* path)
+{
+	std::vector<std::string> names;
+	if ( !listDirectory(path, ".rle", names) )
+	{
+		std::cout << "[StampLibrary::LoadDirectory](" << this << "): " << "Unable to read patterns directory " << path << std::endl;
+		return 0;
+	}
+
+	int loaded = 0;
+	for ( auto& name : names )
+	{
+		Pattern pattern;
+		std::string file = getResourcePath(path) + name;
+		if ( !loadPatternFile(file.c_str(), pattern) )
+		{
+			std::cout << "[StampLibrary::LoadDirectory](" << this << "): " << "Unable to parse pattern " << file << std::endl;
+			continue;
+		}
+
+		Add(name.substr(0, name.size() - 4), pattern);
+		++loaded;
+	}
+
+	return loaded;
+}
+
+const Stamp* StampLibrary::GetStamp(int idx, int orientation) const
+{
+	if ( (idx < 0) || (idx >= GetCount()) )
+		return nullptr;
+
+	return &patterns[idx].orientations[orientation % STAMP_ORIENTATIONS];
+}
+
+#endif
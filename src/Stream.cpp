@@ -0,0 +1,969 @@
+#ifndef STREAM_CPP
+#define STREAM_CPP
+
+
+#include "../includes/Stream.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+
+namespace
+{
+
+void putUint32(std::vector<unsigned char>& out, uint32_t value)
+{
+	for ( int shift = 0; shift < 32; shift += 8 )
+		out.push_back(static_cast<unsigned char>(value >> shift));
+}
+
+void putInt64(std::vector<unsigned char>& out, long long value)
+{
+	for ( int shift = 0; shift < 64; shift += 8 )
+		out.push_back(static_cast<unsigned char>(uint64_t(value) >> shift));
+}
+
+uint32_t getUint32(const unsigned char* data)
+{
+	return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+}
+
+long long getInt64(const unsigned char* data)
+{
+	return (long long)(uint64_t(getUint32(data)) | (uint64_t(getUint32(data + 4)) << 32));
+}
+
+void putVarint(std::vector<unsigned char>& out, uint64_t value)
+{
+	while ( value >= 0x80 )
+	{
+		out.push_back(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<unsigned char>(value));
+}
+
+bool getVarint(const unsigned char*& data, const unsigned char* end, uint64_t& value)
+{
+	value = 0;
+	for ( int shift = 0; (shift < 64) && (data < end); shift += 7 )
+	{
+		unsigned char byte = *data++;
+		value |= uint64_t(byte & 0x7F) << shift;
+		if ( !(byte & 0x80) )
+			return true;
+	}
+
+	return false;
+}
+
+// Заголовок с длиной 0, длина дописывается в finishMessage
+void beginMessage(std::vector<unsigned char>& out, uint32_t type, long long generation)
+{
+	out.clear();
+	putUint32(out, type);
+	putUint32(out, 0);
+	putInt64(out, generation);
+}
+
+void finishMessage(std::vector<unsigned char>& out)
+{
+	uint32_t length = uint32_t(out.size() - STREAM_HEADER_BYTES);
+	for ( int i = 0; i < 4; ++i )
+		out[4 + i] = static_cast<unsigned char>(length >> (8 * i));
+}
+
+/*
+ * Длины серий одинаковых битов поля(или его разности с base), начиная с нулевых. Серия обрывается
+ * только на границе смены значения, поэтому слова без смен проходятся одной проверкой
+ */
+void encodeRuns(const uint64_t* base, const uint64_t* bits, int row_words, int width, int height, std::vector<unsigned char>& out)
+{
+	uint64_t run_start = 0;
+	uint64_t state = 0;
+	for ( int y = 0; y < height; ++y )
+	{
+		for ( int i = 0; i < row_words; ++i )
+		{
+			size_t idx = size_t(y) * row_words + i;
+			uint64_t word = base ? (bits[idx] ^ base[idx]) : bits[idx];
+			int valid = std::min<int>(GRID_WORD_BITS, width - i * GRID_WORD_BITS);
+			uint64_t valid_mask = (valid == GRID_WORD_BITS) ? ~uint64_t(0) : ((uint64_t(1) << valid) - 1);
+			uint64_t diff = (word ^ state) & valid_mask;
+			while ( diff )
+			{
+				int t = ctz64(diff);
+				uint64_t pos = uint64_t(y) * width + uint64_t(i) * GRID_WORD_BITS + t;
+				putVarint(out, pos - run_start);
+				run_start = pos;
+				state = ~state;
+				diff = (word ^ state) & valid_mask & (~uint64_t(0) << t);
+			}
+		}
+	}
+	putVarint(out, uint64_t(width) * height - run_start);
+}
+
+// Инвертирует count клеток поля подряд(построчно) с клетки pos
+void toggleCells(uint64_t* bits, int row_words, int width, uint64_t pos, uint64_t count)
+{
+	while ( count > 0 )
+	{
+		int x = int(pos % width);
+		int end = x + int(std::min<uint64_t>(count, uint64_t(width - x)));
+		uint64_t* row = bits + size_t(pos / width) * row_words;
+		count -= end - x;
+		pos += end - x;
+		while ( x < end )
+		{
+			int bit = x % GRID_WORD_BITS;
+			int take = std::min<int>(GRID_WORD_BITS - bit, end - x);
+			uint64_t mask = (take == GRID_WORD_BITS) ? ~uint64_t(0) : (((uint64_t(1) << take) - 1) << bit);
+			row[x / GRID_WORD_BITS] ^= mask;
+			x += take;
+		}
+	}
+}
+
+// Серии с нечётными номерами инвертируются; сумма длин должна совпасть с числом клеток
+bool applyRuns(const unsigned char* data, const unsigned char* end, uint64_t* bits, int row_words, int width, int height)
+{
+	uint64_t total = uint64_t(width) * height;
+	uint64_t pos = 0;
+	bool toggle = false;
+	while ( data < end )
+	{
+		uint64_t length;
+		if ( !getVarint(data, end, length) || (length > total - pos) )
+			return false;
+		if ( toggle )
+			toggleCells(bits, row_words, width, pos, length);
+		pos += length;
+		toggle = !toggle;
+	}
+
+	return pos == total;
+}
+
+#if !defined(_WIN32)
+bool setNonBlocking(int fd)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+
+	return (flags >= 0) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+void setNoSigPipe(int fd)
+{
+#if defined(SO_NOSIGPIPE)
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+	(void)fd;
+#endif
+}
+
+// Сокет, привязанный к адресу(для сервера) или соединённый с ним(для клиента)
+int openStreamSocket(const StreamAddress& address, bool listening)
+{
+	int fd = socket(address.unix_socket ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+	if ( fd < 0 )
+		return -1;
+
+	int result;
+	if ( address.unix_socket )
+	{
+		sockaddr_un sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		strncpy(sa.sun_path, address.path.c_str(), sizeof(sa.sun_path) - 1);
+		if ( listening )
+			result = bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+		else
+			result = connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+	}
+	else
+	{
+		int on = 1;
+		if ( listening )
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_port = htons(uint16_t(address.port));
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if ( listening )
+			result = bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+		else
+			result = connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+	}
+
+	if ( result != 0 )
+	{
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+	setNoSigPipe(fd);
+
+	return fd;
+}
+#endif
+
+}
+
+
+bool parseStreamSpec(const char* spec, StreamAddress& address)
+{
+	if ( strncmp(spec, "unix:", 5) == 0 )
+	{
+		address.unix_socket = true;
+		address.path = spec + 5;
+		address.port = 0;
+#if !defined(_WIN32)
+		if ( address.path.size() >= sizeof(sockaddr_un().sun_path) )
+			return false;
+#endif
+		return !address.path.empty();
+	}
+
+	if ( strncmp(spec, "tcp:", 4) == 0 )
+	{
+		char* end = nullptr;
+		long port = strtol(spec + 4, &end, 10);
+		address.unix_socket = false;
+		address.path.clear();
+		address.port = int(port);
+		return (end != spec + 4) && (*end == '\0') && (port > 0) && (port < 65536);
+	}
+
+	return false;
+}
+
+std::string getStreamAddressName(const StreamAddress& address)
+{
+	return address.unix_socket ? "unix:" + address.path : "tcp:127.0.0.1:" + std::to_string(address.port);
+}
+
+void readStreamHeader(const unsigned char* data, StreamHeader& header)
+{
+	header.type = getUint32(data);
+	header.length = getUint32(data + 4);
+	header.generation = getInt64(data + 8);
+}
+
+void encodeStreamKeyframe(const uint64_t* bits, int row_words, int width, int height, long long generation, std::vector<unsigned char>& out)
+{
+	beginMessage(out, STREAM_MESSAGE_KEYFRAME, generation);
+	putUint32(out, uint32_t(width));
+	putUint32(out, uint32_t(height));
+	encodeRuns(nullptr, bits, row_words, width, height, out);
+	finishMessage(out);
+}
+
+void encodeStreamDelta(const uint64_t* base, const uint64_t* bits, int row_words, int width, int height, long long base_generation,
+		long long generation, std::vector<unsigned char>& out)
+{
+	beginMessage(out, STREAM_MESSAGE_DELTA, generation);
+	putInt64(out, base_generation);
+	encodeRuns(base, bits, row_words, width, height, out);
+	finishMessage(out);
+}
+
+void encodeStreamEdits(const EditCommand* cmds, int count, std::vector<unsigned char>& out)
+{
+	beginMessage(out, STREAM_MESSAGE_EDITS, 0);
+	for ( int i = 0; i < count; ++i )
+	{
+		putUint32(out, uint32_t(cmds[i].type));
+		putUint32(out, uint32_t(cmds[i].x));
+		putUint32(out, uint32_t(cmds[i].y));
+		putUint32(out, uint32_t(cmds[i].w));
+		putUint32(out, uint32_t(cmds[i].h));
+		putUint32(out, cmds[i].alive ? 1 : 0);
+		putUint32(out, cmds[i].seed);
+		putUint32(out, uint32_t(cmds[i].density * 1000000.0 + 0.5));
+	}
+	finishMessage(out);
+}
+
+
+StreamDecoder::StreamDecoder(void)
+{
+	width = 0;
+	height = 0;
+	row_words = 0;
+	generation = 0;
+	synced = false;
+}
+
+StreamDecoder::StreamDecoder(const StreamDecoder& sd)
+{
+}
+
+StreamDecoder::StreamDecoder(StreamDecoder&& sd)
+{
+}
+
+/*
+ * Применяет сообщение с данными payload(header.length байт). Дельта применяется только к поколению,
+ * от которого она отсчитана; после ошибки поле ждёт следующий ключевой кадр
+ */
+bool StreamDecoder::Apply(const StreamHeader& header, const unsigned char* payload)
+{
+	const unsigned char* end = payload + header.length;
+
+	if ( header.type == STREAM_MESSAGE_KEYFRAME )
+	{
+		synced = false;
+		if ( header.length < 8 )
+			return false;
+
+		int w = int(getUint32(payload));
+		int h = int(getUint32(payload + 4));
+		if ( (w < 1) || (h < 1) || (uint64_t(w) * h > (uint64_t(1) << 40)) )
+			return false;
+
+		width = w;
+		height = h;
+		row_words = (w + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+		bits.assign(size_t(row_words) * h, 0);
+		if ( !applyRuns(payload + 8, end, bits.data(), row_words, width, height) )
+			return false;
+	}
+	else if ( header.type == STREAM_MESSAGE_DELTA )
+	{
+		if ( !synced || (header.length < 8) || (getInt64(payload) != generation) )
+		{
+			synced = false;
+			return false;
+		}
+
+		if ( !applyRuns(payload + 8, end, bits.data(), row_words, width, height) )
+		{
+			synced = false;
+			return false;
+		}
+	}
+	else
+		return false;
+
+	generation = header.generation;
+	synced = true;
+
+	return true;
+}
+
+long long StreamDecoder::CountPopulation(void) const
+{
+	long long population = 0;
+	for ( uint64_t word : bits )
+		population += popcount64(word);
+
+	return population;
+}
+
+
+StreamServer::StreamServer(const StreamAddress& sa)
+{
+	address = sa;
+	listen_fd = -1;
+	wake_pipe[0] = -1;
+	wake_pipe[1] = -1;
+	edits = new EditQueue(STREAM_EDIT_QUEUE_SIZE);
+	pending_width = 0;
+	pending_height = 0;
+	pending_generation = 0;
+	has_pending = false;
+	stopping = false;
+	frame_width = 0;
+	frame_height = 0;
+	frame_generation = 0;
+	has_frame = false;
+	clients_count.store(0, std::memory_order_relaxed);
+	frame_wanted.store(true, std::memory_order_relaxed);
+	deltas_sent = 0;
+	keyframes_sent = 0;
+	fallbacks = 0;
+}
+
+StreamServer::StreamServer()
+{
+}
+
+StreamServer::StreamServer(const StreamServer& ss)
+{
+}
+
+StreamServer::StreamServer(StreamServer&& ss)
+{
+}
+
+StreamServer::~StreamServer()
+{
+	Stop();
+	delete edits;
+}
+
+bool StreamServer::Start(void)
+{
+#if defined(_WIN32)
+	std::cout << "[StreamServer::Start](" << this << "): Streaming needs POSIX sockets!" << std::endl;
+	return false;
+#else
+	if ( pipe(wake_pipe) != 0 )
+	{
+		std::cout << "[StreamServer::Start](" << this << "): Unable to create a pipe: " << strerror(errno) << std::endl;
+		wake_pipe[0] = wake_pipe[1] = -1;
+		return false;
+	}
+	setNonBlocking(wake_pipe[0]);
+	setNonBlocking(wake_pipe[1]);
+
+	// Сокет, оставшийся от прошлого запуска, мешает bind; обычные файлы не трогаются
+	struct stat st;
+	if ( address.unix_socket && (stat(address.path.c_str(), &st) == 0) && S_ISSOCK(st.st_mode) )
+		unlink(address.path.c_str());
+
+	listen_fd = openStreamSocket(address, true);
+	if ( (listen_fd < 0) || (listen(listen_fd, STREAM_LISTEN_BACKLOG) != 0) || !setNonBlocking(listen_fd) )
+	{
+		std::cout << "[StreamServer::Start](" << this << "): Unable to listen on " << getStreamAddressName(address) << ": " << strerror(errno) << std::endl;
+		CloseSockets();
+		return false;
+	}
+
+	thread = std::thread(&StreamServer::ServerLoop, this);
+
+	std::cout << "Streaming generations on " << getStreamAddressName(address) << std::endl;
+
+	return true;
+#endif
+}
+
+/*
+ * Вызывается из потока симуляции. Поле копируется в свой буфер без блокировки, под мьютексом буферы
+ * только меняются местами; непрочитанный сервером кадр заменяется новым. Без клиентов поле не копируется:
+ * подключившийся клиент получает последний переданный кадр, а следующий Submit даёт дельту от него
+ */
+void StreamServer::Submit(const Grid& grid, long long generation)
+{
+#if !defined(_WIN32)
+	if ( (listen_fd < 0) || ((clients_count.load(std::memory_order_relaxed) == 0) && !frame_wanted.load(std::memory_order_relaxed)) )
+		return;
+	frame_wanted.store(false, std::memory_order_relaxed);
+
+	int words = grid.GetRowWords();
+	const uint64_t* mask = grid.GetTailMask();
+	staging.resize(size_t(words) * grid.GetHeight());
+	for ( int y = 0; y < grid.GetHeight(); ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		uint64_t* out = staging.data() + size_t(y) * words;
+		for ( int i = 0; i < words; ++i )
+			out[i] = row[i] & mask[i];
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.swap(staging);
+		pending_width = grid.GetWidth();
+		pending_height = grid.GetHeight();
+		pending_generation = generation;
+		has_pending = true;
+	}
+
+	// Полный канал значит, что сервер и так разбужен
+	char byte = 1;
+	ssize_t written = write(wake_pipe[1], &byte, 1);
+	(void)written;
+#endif
+}
+
+void StreamServer::Stop(void)
+{
+#if !defined(_WIN32)
+	if ( !thread.joinable() )
+	{
+		CloseSockets();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	char byte = 0;
+	ssize_t written = write(wake_pipe[1], &byte, 1);
+	(void)written;
+	thread.join();
+	CloseSockets();
+
+	std::cout << "Stream server stopped: " << keyframes_sent << " keyframes, " << deltas_sent << " deltas sent, "
+			  << fallbacks << " times clients fell behind" << std::endl;
+#endif
+}
+
+void StreamServer::CloseSockets(void)
+{
+#if !defined(_WIN32)
+	for ( StreamPeer& peer : peers )
+		close(peer.fd);
+	peers.clear();
+	clients_count.store(0, std::memory_order_relaxed);
+
+	if ( listen_fd >= 0 )
+	{
+		close(listen_fd);
+		listen_fd = -1;
+		if ( address.unix_socket )
+			unlink(address.path.c_str());
+	}
+	for ( int i = 0; i < 2; ++i )
+		if ( wake_pipe[i] >= 0 )
+		{
+			close(wake_pipe[i]);
+			wake_pipe[i] = -1;
+		}
+#endif
+}
+
+void StreamServer::ServerLoop(void)
+{
+#if !defined(_WIN32)
+	std::vector<pollfd> fds;
+	for ( ;; )
+	{
+		fds.clear();
+		fds.push_back({ wake_pipe[0], POLLIN, 0 });
+		fds.push_back({ listen_fd, POLLIN, 0 });
+		for ( const StreamPeer& peer : peers )
+			fds.push_back({ peer.fd, short(POLLIN | (peer.queue.empty() ? 0 : POLLOUT)), 0 });
+
+		if ( poll(fds.data(), fds.size(), -1) < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			std::cout << "[StreamServer::ServerLoop](" << this << "): poll failed: " << strerror(errno) << std::endl;
+			break;
+		}
+
+		if ( fds[0].revents & POLLIN )
+		{
+			char buffer[64];
+			while ( read(wake_pipe[0], buffer, sizeof(buffer)) > 0 )
+				;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if ( stopping )
+					break;
+			}
+			TakeFrame();
+		}
+
+		// Новые клиенты добавляются в конец и в этом проходе не опрашиваются
+		size_t polled = fds.size() - 2;
+		if ( fds[1].revents & POLLIN )
+			AcceptClients();
+
+		for ( size_t i = polled; i-- > 0; )
+		{
+			short revents = fds[i + 2].revents;
+			bool alive = !(revents & (POLLERR | POLLNVAL));
+			if ( alive && (revents & POLLIN) )
+				alive = ReadClient(peers[i]);
+			else if ( revents & POLLHUP )
+				alive = false;
+			if ( alive && (revents & POLLOUT) )
+				alive = WriteClient(peers[i]);
+
+			if ( !alive )
+			{
+				close(peers[i].fd);
+				peers.erase(peers.begin() + i);
+				clients_count.store(int(peers.size()), std::memory_order_relaxed);
+				std::cout << "Stream client disconnected, clients: " << peers.size() << std::endl;
+			}
+		}
+	}
+#endif
+}
+
+void StreamServer::AcceptClients(void)
+{
+#if !defined(_WIN32)
+	for ( ;; )
+	{
+		int fd = accept(listen_fd, nullptr, nullptr);
+		if ( fd < 0 )
+		{
+			if ( (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) )
+				std::cout << "[StreamServer::AcceptClients](" << this << "): accept failed: " << strerror(errno) << std::endl;
+			if ( errno != EINTR )
+				return;
+			continue;
+		}
+
+		if ( (peers.size() >= STREAM_MAX_CLIENTS) || !setNonBlocking(fd) )
+		{
+			std::cout << "[StreamServer::AcceptClients](" << this << "): Too many clients, the connection is closed" << std::endl;
+			close(fd);
+			continue;
+		}
+		setNoSigPipe(fd);
+		if ( !address.unix_socket )
+		{
+			int on = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		}
+
+		peers.push_back(StreamPeer());
+		StreamPeer& peer = peers.back();
+		peer.fd = fd;
+		peer.sent = 0;
+		peer.queued_bytes = 0;
+		peer.synced = false;
+
+		// Клиент сразу получает последний кадр, даже если симуляция стоит на паузе
+		if ( has_frame )
+		{
+			Enqueue(peer, GetKeyframe());
+			peer.synced = true;
+			++keyframes_sent;
+		}
+
+		clients_count.store(int(peers.size()), std::memory_order_relaxed);
+		frame_wanted.store(true, std::memory_order_relaxed);
+		std::cout << "Stream client connected, clients: " << peers.size() << std::endl;
+	}
+#endif
+}
+
+// Забирает последний кадр симуляции, предыдущий остаётся основой дельты
+bool StreamServer::TakeFrame(void)
+{
+	int w;
+	int h;
+	long long generation;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if ( !has_pending )
+			return false;
+		previous.swap(frame);
+		frame.swap(pending);
+		w = pending_width;
+		h = pending_height;
+		generation = pending_generation;
+		has_pending = false;
+	}
+
+	bool resized = !has_frame || (w != frame_width) || (h != frame_height);
+	long long base_generation = frame_generation;
+	frame_width = w;
+	frame_height = h;
+	frame_generation = generation;
+	has_frame = true;
+	keyframe.reset();
+
+	BroadcastFrame(resized, base_generation);
+
+	return true;
+}
+
+void StreamServer::BroadcastFrame(bool resized, long long base_generation)
+{
+	StreamMessage delta;
+	for ( StreamPeer& peer : peers )
+	{
+		if ( resized )
+			peer.synced = false;
+
+		// Отстающий клиент теряет неотправленные дельты; начатое сообщение дописывается
+		if ( peer.synced && (peer.queued_bytes > STREAM_CLIENT_BUFFER_BYTES) )
+		{
+			while ( peer.queue.size() > ((peer.sent > 0) ? 1 : 0) )
+				peer.queue.pop_back();
+			peer.queued_bytes = peer.queue.empty() ? 0 : peer.queue.front()->size() - peer.sent;
+			peer.synced = false;
+			++fallbacks;
+		}
+
+		if ( peer.synced )
+		{
+			if ( !delta )
+			{
+				std::vector<unsigned char>* message = new std::vector<unsigned char>();
+				encodeStreamDelta(previous.data(), frame.data(), (frame_width + GRID_WORD_BITS - 1) / GRID_WORD_BITS, frame_width, frame_height,
+						base_generation, frame_generation, *message);
+				delta.reset(message);
+			}
+			Enqueue(peer, delta);
+			++deltas_sent;
+		}
+		else if ( peer.queue.size() <= 1 )
+		{
+			Enqueue(peer, GetKeyframe());
+			peer.synced = true;
+			++keyframes_sent;
+		}
+	}
+}
+
+StreamServer::StreamMessage StreamServer::GetKeyframe(void)
+{
+	if ( !keyframe )
+	{
+		std::vector<unsigned char>* message = new std::vector<unsigned char>();
+		encodeStreamKeyframe(frame.data(), (frame_width + GRID_WORD_BITS - 1) / GRID_WORD_BITS, frame_width, frame_height, frame_generation, *message);
+		keyframe.reset(message);
+	}
+
+	return keyframe;
+}
+
+void StreamServer::Enqueue(StreamPeer& peer, const StreamMessage& message)
+{
+	peer.queue.push_back(message);
+	peer.queued_bytes += message->size();
+}
+
+// Разбирает пришедшие правки. Возвращает false, если клиент отключился или нарушил протокол
+bool StreamServer::ReadClient(StreamPeer& peer)
+{
+#if defined(_WIN32)
+	return false;
+#else
+	unsigned char buffer[STREAM_READ_CHUNK];
+	for ( ;; )
+	{
+		ssize_t n = recv(peer.fd, buffer, sizeof(buffer), 0);
+		if ( n == 0 )
+			return false;
+		if ( n < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			if ( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+				break;
+			return false;
+		}
+		peer.input.insert(peer.input.end(), buffer, buffer + n);
+		if ( peer.input.size() > STREAM_HEADER_BYTES + STREAM_MAX_INPUT_BYTES )
+			break;
+	}
+
+	size_t pos = 0;
+	while ( peer.input.size() - pos >= STREAM_HEADER_BYTES )
+	{
+		StreamHeader header;
+		readStreamHeader(peer.input.data() + pos, header);
+		if ( (header.type != STREAM_MESSAGE_EDITS) || (header.length % STREAM_EDIT_BYTES != 0) || (header.length > STREAM_MAX_INPUT_BYTES) )
+		{
+			std::cout << "[StreamServer::ReadClient](" << this << "): Unexpected message from a client, the connection is closed" << std::endl;
+			return false;
+		}
+		if ( peer.input.size() - pos < STREAM_HEADER_BYTES + header.length )
+			break;
+
+		const unsigned char* record = peer.input.data() + pos + STREAM_HEADER_BYTES;
+		for ( uint32_t i = 0; i < header.length / STREAM_EDIT_BYTES; ++i, record += STREAM_EDIT_BYTES )
+		{
+			EditCommand cmd;
+			cmd.type = int(getUint32(record));
+			cmd.x = int(getUint32(record + 4));
+			cmd.y = int(getUint32(record + 8));
+			cmd.w = int(getUint32(record + 12));
+			cmd.h = int(getUint32(record + 16));
+			cmd.alive = getUint32(record + 20) != 0;
+			cmd.stamp = nullptr;
+			cmd.seed = getUint32(record + 24);
+			cmd.density = std::min(getUint32(record + 28), 1000000u) / 1000000.0;
+
+			// Шаблоны живут только в процессе игры
+			if ( (cmd.type < EDIT_SET_CELL) || (cmd.type > EDIT_RANDOMIZE) || (cmd.type == EDIT_STAMP) )
+				continue;
+			if ( (cmd.w < 0) || (cmd.h < 0) )
+				continue;
+			if ( !edits->Push(cmd) )
+				break;
+		}
+		pos += STREAM_HEADER_BYTES + header.length;
+	}
+	peer.input.erase(peer.input.begin(), peer.input.begin() + pos);
+
+	return true;
+#endif
+}
+
+// Отправляет очередь, пока сокет принимает данные
+bool StreamServer::WriteClient(StreamPeer& peer)
+{
+#if defined(_WIN32)
+	return false;
+#else
+	while ( !peer.queue.empty() )
+	{
+		const std::vector<unsigned char>& message = *peer.queue.front();
+		ssize_t n = send(peer.fd, message.data() + peer.sent, message.size() - peer.sent, MSG_NOSIGNAL);
+		if ( n < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+
+			return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+		}
+
+		peer.sent += size_t(n);
+		peer.queued_bytes -= size_t(n);
+		if ( peer.sent == message.size() )
+		{
+			peer.queue.pop_front();
+			peer.sent = 0;
+		}
+	}
+
+	return true;
+#endif
+}
+
+
+StreamClient::StreamClient(void)
+{
+	fd = -1;
+}
+
+StreamClient::StreamClient(const StreamClient& sc)
+{
+}
+
+StreamClient::StreamClient(StreamClient&& sc)
+{
+}
+
+StreamClient::~StreamClient()
+{
+	Disconnect();
+}
+
+bool StreamClient::Connect(const StreamAddress& address)
+{
+	Disconnect();
+
+#if defined(_WIN32)
+	std::cout << "[StreamClient::Connect](" << this << "): Streaming needs POSIX sockets!" << std::endl;
+	return false;
+#else
+	fd = openStreamSocket(address, false);
+	if ( fd < 0 )
+	{
+		std::cout << "[StreamClient::Connect](" << this << "): Unable to connect to " << getStreamAddressName(address) << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+void StreamClient::Disconnect(void)
+{
+#if !defined(_WIN32)
+	if ( fd >= 0 )
+		close(fd);
+#endif
+	fd = -1;
+	input.clear();
+}
+
+/*
+ * Ждёт и применяет одно сообщение сервера. Возвращает его тип, 0 - если за timeout_ms ничего не пришло,
+ * -1 - если соединение закрыто или сообщение не применилось
+ */
+int StreamClient::Receive(int timeout_ms)
+{
+#if defined(_WIN32)
+	return -1;
+#else
+	if ( fd < 0 )
+		return -1;
+
+	for ( ;; )
+	{
+		if ( input.size() >= STREAM_HEADER_BYTES )
+		{
+			StreamHeader header;
+			readStreamHeader(input.data(), header);
+			if ( input.size() >= STREAM_HEADER_BYTES + size_t(header.length) )
+			{
+				bool applied = decoder.Apply(header, input.data() + STREAM_HEADER_BYTES);
+				input.erase(input.begin(), input.begin() + STREAM_HEADER_BYTES + header.length);
+
+				return applied ? int(header.type) : -1;
+			}
+		}
+
+		pollfd pfd = { fd, POLLIN, 0 };
+		int ready = poll(&pfd, 1, timeout_ms);
+		if ( (ready < 0) && (errno == EINTR) )
+			continue;
+		if ( ready == 0 )
+			return 0;
+
+		unsigned char buffer[STREAM_READ_CHUNK];
+		ssize_t n = (ready > 0) ? recv(fd, buffer, sizeof(buffer), 0) : -1;
+		if ( n <= 0 )
+		{
+			Disconnect();
+			return -1;
+		}
+		input.insert(input.end(), buffer, buffer + n);
+	}
+#endif
+}
+
+bool StreamClient::SendEdits(const EditCommand* cmds, int count)
+{
+#if defined(_WIN32)
+	return false;
+#else
+	if ( fd < 0 )
+		return false;
+
+	std::vector<unsigned char> message;
+	encodeStreamEdits(cmds, count, message);
+
+	size_t sent = 0;
+	while ( sent < message.size() )
+	{
+		ssize_t n = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+		if ( (n < 0) && (errno == EINTR) )
+			continue;
+		if ( n <= 0 )
+			return false;
+		sent += size_t(n);
+	}
+
+	return true;
+#endif
+}
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef TIMELINE_CPP
+#define TIMELINE_CPP
+
+
+#include "../includes/Timeline.hpp"
+#include <cstring>
+#include <utility>
+
+
+namespace
+{
+
+// XOR двух поколений, сжатый по сериям: [нулевых слов, слов данных, данные...]
+void encodeDelta(const std::vector<uint64_t>& prev, const std::vector<uint64_t>& cur, std::vector<uint64_t>& data)
+{
+	size_t count = cur.size();
+	size_t i = 0;
+	data.clear();
+
+	while ( i < count )
+	{
+		size_t zeros = 0;
+		while ( (i < count) && (cur[i] == prev[i]) )
+		{
+			++zeros;
+			++i;
+		}
+		if ( i == count )
+			break;
+
+		// Короткие промежутки без изменений дешевле оставить внутри данных, чем начинать новую серию
+		size_t start = i;
+		size_t end = i;
+		while ( (i < count) && (i - end <= TIMELINE_MAX_LITERAL_GAP) )
+		{
+			if ( cur[i] != prev[i] )
+				end = i + 1;
+			++i;
+		}
+		i = end;
+
+		data.push_back(zeros);
+		data.push_back(i - start);
+		for ( size_t k = start; k < i; ++k )
+			data.push_back(cur[k] ^ prev[k]);
+	}
+
+	data.shrink_to_fit();
+}
+
+void applyDelta(const std::vector<uint64_t>& data, std::vector<uint64_t>& state)
+{
+	size_t pos = 0;
+	size_t p = 0;
+	while ( p < data.size() )
+	{
+		pos += data[p++];
+		size_t literals = data[p++];
+		for ( size_t k = 0; k < literals; ++k )
+			state[pos++] ^= data[p++];
+	}
+}
+
+}
+
+
+Timeline::Timeline(const TimelineParams& tp, int w, int h)
+{
+	params = tp;
+	if ( params.keyframe_interval < 1 )
+		params.keyframe_interval = 1;
+
+	Reset(w, h);
+}
+
+Timeline::Timeline(const Timeline& t)
+{
+}
+
+Timeline::Timeline(Timeline&& t)
+{
+}
+
+void Timeline::Reset(int w, int h)
+{
+	width = w;
+	height = h;
+	row_words = (w + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+	first_generation = 0;
+	entries.clear();
+	last_state.assign(size_t(row_words) * height, 0);
+	since_keyframe = 0;
+	bytes = 0;
+}
+
+/*
+ * Записывает поколение generation. Если оно уже есть в истории(после перемотки или правки),
+ * история от него и дальше заменяется новой веткой
+ */
+void Timeline::Record(const Grid& grid, long long generation)
+{
+	if ( !IsEnabled() )
+		return;
+
+	if ( (grid.GetWidth() != width) || (grid.GetHeight() != height) )
+		Reset(grid.GetWidth(), grid.GetHeight());
+
+	if ( !entries.empty() && (generation <= GetLastGeneration()) )
+		Truncate(generation);
+
+	// Пропуск поколений дельтой не описать, история начинается заново
+	if ( !entries.empty() && (generation != GetLastGeneration() + 1) )
+		Reset(width, height);
+
+	const uint64_t* mask = grid.GetTailMask();
+	scratch.resize(last_state.size());
+	for ( int y = 0; y < height; ++y )
+	{
+		const uint64_t* row = grid.GetRow(y);
+		uint64_t* out = scratch.data() + size_t(y) * row_words;
+		for ( int i = 0; i < row_words; ++i )
+			out[i] = row[i] & mask[i];
+	}
+
+	TimelineEntry entry;
+	if ( entries.empty() || (since_keyframe + 1 >= params.keyframe_interval) )
+	{
+		entry.keyframe = true;
+		entry.data = scratch;
+		since_keyframe = 0;
+	}
+	else
+	{
+		entry.keyframe = false;
+		encodeDelta(last_state, scratch, entry.data);
+		++since_keyframe;
+
+		// Хаотичное поле дельта не сжимает, тогда дешевле полный снимок
+		if ( entry.data.size() >= scratch.size() )
+		{
+			entry.keyframe = true;
+			entry.data = scratch;
+			since_keyframe = 0;
+		}
+	}
+
+	if ( entries.empty() )
+		first_generation = generation;
+
+	bytes += EntryBytes(entry);
+	entries.push_back(std::move(entry));
+	last_state.swap(scratch);
+
+	EnforceBudget();
+}
+
+// Восстанавливает поколение generation в поле. Возвращает false, если поколения нет в истории
+bool Timeline::Seek(long long generation, Grid& grid) const
+{
+	if ( entries.empty() || (generation < first_generation) || (generation > GetLastGeneration()) )
+		return false;
+
+	if ( (grid.GetWidth() != width) || (grid.GetHeight() != height) )
+		return false;
+
+	std::vector<uint64_t> state;
+	if ( !Decode(generation, state) )
+		return false;
+
+	for ( int y = 0; y < height; ++y )
+		memcpy(grid.GetRow(y), state.data() + size_t(y) * row_words, row_words * sizeof(uint64_t));
+	grid.InvalidateBounds();
+
+	return true;
+}
+
+bool Timeline::Decode(long long generation, std::vector<uint64_t>& state) const
+{
+	long long idx = generation - first_generation;
+	if ( (idx < 0) || (idx >= (long long)(entries.size())) )
+		return false;
+
+	long long key = idx;
+	while ( !entries[key].keyframe )
+		--key;
+
+	state = entries[key].data;
+	for ( long long i = key + 1; i <= idx; ++i )
+		applyDelta(entries[i].data, state);
+
+	return true;
+}
+
+// Отбрасывает поколения начиная с generation, последним записанным становится generation - 1
+void Timeline::Truncate(long long generation)
+{
+	while ( !entries.empty() && (GetLastGeneration() >= generation) )
+	{
+		bytes -= EntryBytes(entries.back());
+		entries.pop_back();
+	}
+
+	if ( entries.empty() )
+	{
+		Reset(width, height);
+		return;
+	}
+
+	Decode(GetLastGeneration(), last_state);
+
+	since_keyframe = 0;
+	for ( long long i = (long long)(entries.size()) - 1; !entries[i].keyframe; --i )
+		++since_keyframe;
+}
+
+// Убирает самое старое поколение. Если следующее - дельта, оно становится полным снимком
+void Timeline::DropFront(void)
+{
+	if ( (entries.size() > 1) && !entries[1].keyframe )
+	{
+		std::vector<uint64_t> state = entries[0].data;
+		applyDelta(entries[1].data, state);
+
+		bytes -= EntryBytes(entries[1]);
+		entries[1].keyframe = true;
+		entries[1].data.swap(state);
+		bytes += EntryBytes(entries[1]);
+	}
+
+	bytes -= EntryBytes(entries.front());
+	entries.pop_front();
+	++first_generation;
+}
+
+// Пока история больше бюджета, отбрасываются целые отрезки от снимка до снимка, последнее поколение остаётся всегда
+void Timeline::EnforceBudget(void)
+{
+	while ( (bytes > params.budget) && (entries.size() > 1) )
+	{
+		size_t next_key = 1;
+		while ( (next_key < entries.size()) && !entries[next_key].keyframe )
+			++next_key;
+
+		if ( next_key < entries.size() )
+		{
+			for ( size_t i = 0; i < next_key; ++i )
+			{
+				bytes -= EntryBytes(entries.front());
+				entries.pop_front();
+				++first_generation;
+			}
+		}
+		else
+		{
+			DropFront();
+		}
+	}
+}
+
+#endif
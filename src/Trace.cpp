@@ -0,0 +1,153 @@
+#ifndef TRACE_CPP
+#define TRACE_CPP
+
+
+#include "../includes/Trace.hpp"
+#include <iostream>
+
+#ifdef GOL_TRACE
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+std::atomic<bool> trace_enabled(false);
+
+
+namespace
+{
+
+struct TraceEvent
+{
+	const char* name;
+	double start;
+	double duration;
+};
+
+// Каждый поток пишет в свой буфер, буферы живут до конца записи даже после завершения потока
+struct ThreadTrace
+{
+	int tid;
+	std::string name;
+	std::vector<TraceEvent> events;
+};
+
+std::mutex trace_mutex;
+std::vector<std::unique_ptr<ThreadTrace>> thread_traces;
+std::string trace_path;
+std::chrono::steady_clock::time_point trace_origin;
+
+ThreadTrace* currentThreadTrace(void)
+{
+	thread_local ThreadTrace* trace = nullptr;
+
+	if ( trace == nullptr )
+	{
+		std::lock_guard<std::mutex> lock(trace_mutex);
+		thread_traces.emplace_back(new ThreadTrace());
+		trace = thread_traces.back().get();
+		trace->tid = int(thread_traces.size());
+		trace->name = (trace->tid == 1) ? "main" : "thread " + std::to_string(trace->tid);
+		trace->events.reserve(1 << 16);
+	}
+
+	return trace;
+}
+
+// Микросекунды от начала записи
+double traceNow(void)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - trace_origin).count();
+}
+
+}
+
+
+TraceZone::TraceZone(const char* zone_name)
+{
+	name = trace_enabled.load(std::memory_order_relaxed) ? zone_name : nullptr;
+	start = name ? traceNow() : 0.0;
+}
+
+TraceZone::~TraceZone()
+{
+	if ( name == nullptr )
+		return;
+
+	TraceEvent e { name, start, traceNow() - start };
+	currentThreadTrace()->events.push_back(e);
+}
+
+void traceSetThreadName(const char* name, int index)
+{
+	ThreadTrace* trace = currentThreadTrace();
+	trace->name = (index < 0) ? std::string(name) : std::string(name) + " " + std::to_string(index);
+}
+
+bool traceStart(const char* path)
+{
+	std::ofstream probe(path);
+	if ( !probe )
+	{
+		std::cout << "[traceStart]: " << "Unable to open trace file " << path << std::endl;
+		return false;
+	}
+
+	trace_path = path;
+	trace_origin = std::chrono::steady_clock::now();
+	currentThreadTrace();
+	trace_enabled = true;
+
+	return true;
+}
+
+// Записывает собранные зоны. Вызывается, когда рабочие потоки уже не исполняют шаг
+void traceStop(void)
+{
+	if ( !trace_enabled )
+		return;
+
+	trace_enabled = false;
+
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	std::ofstream out(trace_path);
+	out << std::fixed;
+	out.precision(3);
+	out << "{\"traceEvents\":[\n";
+
+	bool first = true;
+	for ( auto& t : thread_traces )
+	{
+		out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->tid
+			<< ",\"args\":{\"name\":\"" << t->name << "\"}}";
+		first = false;
+
+		for ( auto& e : t->events )
+			out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->tid
+				<< ",\"ts\":" << e.start << ",\"dur\":" << e.duration << "}";
+		t->events.clear();
+	}
+
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	std::cout << "Trace has been written to " << trace_path << std::endl;
+}
+
+#else
+
+bool traceStart(const char* path)
+{
+	std::cout << "[traceStart]: " << "Tracing is not compiled in(build with GOL_TRACE)" << std::endl;
+	return false;
+}
+
+void traceStop(void)
+{
+}
+
+#endif
+
+#endif
@@ -0,0 +1,672 @@
+#ifndef VERIFY_CPP
+#define VERIFY_CPP
+
+
+#include "../includes/Verify.hpp"
+#include "../includes/Grid.hpp"
+#include "../includes/Kernels.hpp"
+#include "../includes/Lenia.hpp"
+#include "../includes/Morton.hpp"
+#include "../includes/Patterns.hpp"
+#include "../includes/Regions.hpp"
+#include "../includes/Stream.hpp"
+#include "../includes/Workers.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+// Эталон: по байту на клетку с рамкой в одну клетку, два буфера, соседи считаются в лоб
+struct ReferenceField
+{
+	int width;
+	int height;
+	bool toroidal;
+	std::vector<unsigned char> cells;
+	std::vector<unsigned char> next;
+	unsigned char& At(int x, int y) { return cells[(y + 1) * (width + 2) + x + 1]; }
+	unsigned char At(int x, int y) const { return cells[(y + 1) * (width + 2) + x + 1]; }
+};
+
+// Larger than Life: окрестность радиуса R перебирается целиком, O(R^2) на клетку
+void referenceStepLargerThanLife(ReferenceField& f, const LifeRule& rule)
+{
+	int row = f.width + 2;
+	for ( int y = 0; y < f.height; ++y )
+	{
+		for ( int x = 0; x < f.width; ++x )
+		{
+			int count = 0;
+			for ( int dy = -rule.radius; dy <= rule.radius; ++dy )
+			{
+				for ( int dx = -rule.radius; dx <= rule.radius; ++dx )
+				{
+					if ( (rule.neighbourhood == LIFE_NEIGHBOURHOOD_VON_NEUMANN) && (std::abs(dx) + std::abs(dy) > rule.radius) )
+						continue;
+					if ( (dx == 0) && (dy == 0) && !rule.middle )
+						continue;
+
+					int nx = x + dx;
+					int ny = y + dy;
+					if ( f.toroidal )
+					{
+						nx = ((nx % f.width) + f.width) % f.width;
+						ny = ((ny % f.height) + f.height) % f.height;
+					}
+					else if ( (nx < 0) || (nx >= f.width) || (ny < 0) || (ny >= f.height) )
+						continue;
+
+					count += f.At(nx, ny);
+				}
+			}
+
+			bool alive = f.At(x, y) != 0;
+			bool next = alive ? (count >= rule.survive_min) && (count <= rule.survive_max)
+							  : (count >= rule.birth_min) && (count <= rule.birth_max);
+			f.next[(y + 1) * row + x + 1] = next ? 1 : 0;
+		}
+	}
+
+	f.cells.swap(f.next);
+}
+
+void referenceStep(ReferenceField& f, const LifeRule& rule)
+{
+	if ( isLargerThanLife(rule) )
+	{
+		referenceStepLargerThanLife(f, rule);
+		return;
+	}
+
+	// Рамка: копии противоположных краёв для тора, пустые клетки для поля с границами
+	for ( int y = 0; y < f.height; ++y )
+	{
+		f.At(-1, y) = f.toroidal ? f.At(f.width - 1, y) : 0;
+		f.At(f.width, y) = f.toroidal ? f.At(0, y) : 0;
+	}
+	for ( int x = -1; x <= f.width; ++x )
+	{
+		f.At(x, -1) = f.toroidal ? f.At(x, f.height - 1) : 0;
+		f.At(x, f.height) = f.toroidal ? f.At(x, 0) : 0;
+	}
+
+	int row = f.width + 2;
+	for ( int y = 0; y < f.height; ++y )
+	{
+		for ( int x = 0; x < f.width; ++x )
+		{
+			const unsigned char* c = &f.cells[(y + 1) * row + x + 1];
+			int count = c[-row - 1] + c[-row] + c[-row + 1] + c[-1] + c[1] + c[row - 1] + c[row] + c[row + 1];
+			unsigned short mask = *c ? rule.survive : rule.birth;
+			f.next[(y + 1) * row + x + 1] = (mask >> count) & 1;
+		}
+	}
+
+	f.cells.swap(f.next);
+}
+
+void referenceToGrid(const ReferenceField& f, Grid& grid)
+{
+	for ( int y = 0; y < f.height; ++y )
+		for ( int x = 0; x < f.width; ++x )
+			grid.SetCell(x, y, f.At(x, y) != 0);
+}
+
+/*
+ * Слой активности после referenceStep(f.next - прошлое поколение): возраст живой клетки растёт до ACTIVITY_MAX,
+ * у мёртвой сбрасывается; тепло изменившейся клетки - ACTIVITY_MAX, иначе теряет 1/2^ACTIVITY_HEAT_DECAY_SHIFT
+ * с округлением вверх, чтобы дойти до нуля
+ */
+void referenceActivityStep(const ReferenceField& f, std::vector<unsigned char>& age, std::vector<unsigned char>& heat)
+{
+	int row = f.width + 2;
+	int divisor = 1 << ACTIVITY_HEAT_DECAY_SHIFT;
+	for ( int y = 0; y < f.height; ++y )
+		for ( int x = 0; x < f.width; ++x )
+		{
+			size_t i = size_t(y) * f.width + x;
+			unsigned char alive = f.cells[(y + 1) * row + x + 1];
+			unsigned char was_alive = f.next[(y + 1) * row + x + 1];
+			age[i] = alive ? (unsigned char)std::min(age[i] + 1, int(ACTIVITY_MAX)) : 0;
+			heat[i] = (alive != was_alive) ? (unsigned char)ACTIVITY_MAX : (unsigned char)(heat[i] - (heat[i] + divisor - 1) / divisor);
+		}
+}
+
+bool isActivityEqual(const Grid& grid, const std::vector<unsigned char>& age, const std::vector<unsigned char>& heat)
+{
+	int w = grid.GetWidth();
+	for ( int y = 0; y < grid.GetHeight(); ++y )
+		if ( memcmp(grid.GetAgeRow(y), age.data() + size_t(y) * w, w) || memcmp(grid.GetHeatRow(y), heat.data() + size_t(y) * w, w) )
+			return false;
+
+	return true;
+}
+
+long long referencePopulation(const ReferenceField& f)
+{
+	long long population = 0;
+	for ( int y = 0; y < f.height; ++y )
+		for ( int x = 0; x < f.width; ++x )
+			population += f.At(x, y);
+	return population;
+}
+
+/*
+ * Сценарий проверки: шаблон в центре поля либо случайный суп.
+ * period - через сколько поколений тороидальное поле обязано вернуться в исходное состояние,
+ * expected_population - известная численность в последнем поколении(-1, если не проверяется)
+ */
+struct Scenario
+{
+	const char* name;
+	const char* pattern;
+	int width;
+	int height;
+	int generations;
+	const char* rule;
+	double density;
+	unsigned int seed;
+	int period;
+	long long expected_population;
+};
+
+const Scenario scenarios[] =
+{
+	{ "blinker",		"blinker",		16,		16,		 20,	"B3/S23",		0.0,	0,		2,		 -1 },
+	{ "glider",			"glider",		32,		32,		128,	"B3/S23",		0.0,	0,	  128,		 -1 },
+	{ "gosper-gun",		"gosper-gun",	120,	80,		300,	"B3/S23",		0.0,	0,		0,		 -1 },
+	{ "r-pentomino",	"r-pentomino",	640,	640,   1103,	"B3/S23",		0.0,	0,		0,		116 },
+	{ "acorn",			"acorn",		256,	256,   1000,	"B3/S23",		0.0,	0,		0,		 -1 },
+	{ "soup",			nullptr,		97,		61,		300,	"B3/S23",		0.35,	1,		0,		 -1 },
+	{ "soup-dense",		nullptr,		200,	150,	200,	"B3/S23",		0.5,	2,		0,		 -1 },
+	{ "soup-highlife",	nullptr,		131,	67,		200,	"B36/S23",		0.3,	3,		0,		 -1 },
+	{ "soup-daynight",	nullptr,		70,		129,	200,	"B3678/S34678",	0.5,	4,		0,		 -1 },
+	{ "soup-b0",		nullptr,		64,		64,		 20,	"B0/S8",		1.0,	8,		0,		 -1 },
+	{ "soup-bosco",		nullptr,		90,		70,		120,	"R5,C0,M1,S34..58,B34..45,NM",	0.5,	5,		0,		 -1 },
+	{ "soup-ltl-r10",	nullptr,		100,	80,		 40,	"R10,C0,M1,S100..200,B75..170,NM",	0.4,	6,		0,		 -1 },
+	{ "soup-vonneumann",nullptr,		73,		50,		100,	"R3,C0,M0,S4..9,B6..8,NN",	0.4,	7,		0,		 -1 },
+	{ "ltl-r1-life",	"glider",		32,		32,		128,	"R1,C0,M1,S3..4,B3..3,NM",	0.0,	0,	  128,		 -1 }
+};
+
+/*
+ * depth > 1 - поле считается временным блокированием по depth поколений на полосах по tile_rows строк
+ * и сверяется с эталоном в конце каждого прохода
+ */
+struct Backend
+{
+	int kernel_id;
+	int threads;
+	int depth;
+	int tile_rows;
+	bool bounded;
+	bool activity;							// со слоем активности: возраст и тепло сверяются с эталоном
+	long long generation;
+	std::unique_ptr<Grid> grid;
+	std::unique_ptr<MortonGrid> tiles;		// поле считается плитками Мортона, grid - их копия строками для сравнения
+	bool failed;
+};
+
+bool initScenario(const Scenario& sc, ReferenceField& ref)
+{
+	ref.cells.assign(size_t(ref.width + 2) * (ref.height + 2), 0);
+	ref.next.assign(ref.cells.size(), 0);
+
+	if ( sc.pattern == nullptr )
+	{
+		std::mt19937 gen(sc.seed);
+		std::bernoulli_distribution dist(sc.density);
+		for ( int y = 0; y < ref.height; ++y )
+			for ( int x = 0; x < ref.width; ++x )
+				ref.At(x, y) = dist(gen) ? 1 : 0;
+		return true;
+	}
+
+	Pattern pattern;
+	if ( !getBuiltinPattern(sc.pattern, pattern) )
+		return false;
+
+	int left = (ref.width - pattern.width) / 2;
+	int top = (ref.height - pattern.height) / 2;
+	for ( int y = 0; y < pattern.height; ++y )
+		for ( int x = 0; x < pattern.width; ++x )
+			ref.At(left + x, top + y) = pattern.cells[y * pattern.width + x];
+
+	return true;
+}
+
+int verifyScenario(const Scenario& sc, bool toroidal, WorkerPool& workers, std::ostream& out)
+{
+	const char* mode = toroidal ? "torus" : "bordered";
+	LifeRule rule;
+	parseLifeRule(sc.rule, rule);
+
+	ReferenceField ref;
+	ref.width = sc.width;
+	ref.height = sc.height;
+	ref.toroidal = toroidal;
+	if ( !initScenario(sc, ref) )
+	{
+		out << sc.name << " [" << mode << "]: unknown pattern " << sc.pattern << std::endl;
+		return 1;
+	}
+	Grid initial(sc.width, sc.height, toroidal);
+	referenceToGrid(ref, initial);
+
+	Grid expected(sc.width, sc.height, toroidal);
+	referenceToGrid(ref, expected);
+
+	// Каждое ядро проверяется в одном потоке и с разбиением на полосы
+	std::vector<Backend> backends;
+	for ( int kernel_id = 0; kernel_id < STEP_KERNELS_COUNT; ++kernel_id )
+	{
+		if ( !isStepKernelSupported(kernel_id) || !getStepKernel(kernel_id) )
+			continue;
+
+		for ( int threads : { 1, int(VERIFY_THREADS) } )
+		{
+			Backend b;
+			b.kernel_id = kernel_id;
+			b.threads = threads;
+			b.depth = 1;
+			b.tile_rows = 0;
+			b.bounded = true;
+			b.activity = false;
+			b.generation = 0;
+			b.grid.reset(new Grid(sc.width, sc.height, toroidal));
+			b.grid->CopyFrom(expected);
+			b.failed = false;
+			backends.push_back(std::move(b));
+		}
+	}
+
+	// Временное блокирование лучшим ядром: полосы мельче поля, чтобы перекрытия и переход через край тора участвовали
+	for ( int depth : { 2, 7 } )
+	{
+		for ( int threads : { 1, int(VERIFY_THREADS) } )
+		{
+			Backend b;
+			b.kernel_id = detectBestStepKernel();
+			b.threads = threads;
+			b.depth = depth;
+			b.tile_rows = std::max(sc.height / 5, 1);
+			b.bounded = true;
+			b.activity = false;
+			b.generation = 0;
+			b.grid.reset(new Grid(sc.width, sc.height, toroidal));
+			b.grid->CopyFrom(expected);
+			b.failed = false;
+			backends.push_back(std::move(b));
+		}
+	}
+
+	// Лучшее ядро по всему полю, без рамки живых клеток
+	for ( int threads : { 1, int(VERIFY_THREADS) } )
+	{
+		Backend b;
+		b.kernel_id = detectBestStepKernel();
+		b.threads = threads;
+		b.depth = 1;
+		b.tile_rows = 0;
+		b.bounded = false;
+		b.activity = false;
+		b.generation = 0;
+		b.grid.reset(new Grid(sc.width, sc.height, toroidal));
+		b.grid->EnableBounds(false);
+		b.grid->CopyFrom(expected);
+		b.failed = false;
+		backends.push_back(std::move(b));
+	}
+
+	// Каждое ядро со слоем активности(его вариант ядра с Activity), на полосах
+	for ( int kernel_id = 0; kernel_id < STEP_KERNELS_COUNT; ++kernel_id )
+	{
+		if ( !isStepKernelSupported(kernel_id) || !getStepKernel(kernel_id) )
+			continue;
+
+		Backend b;
+		b.kernel_id = kernel_id;
+		b.threads = VERIFY_THREADS;
+		b.depth = 1;
+		b.tile_rows = 0;
+		b.bounded = false;
+		b.activity = true;
+		b.generation = 0;
+		b.grid.reset(new Grid(sc.width, sc.height, toroidal));
+		b.grid->EnableActivity(true);
+		b.grid->CopyFrom(expected);
+		b.failed = false;
+		backends.push_back(std::move(b));
+	}
+
+	// Плитки Мортона, если правило и размер тора их допускают
+	for ( int threads : { 1, int(VERIFY_THREADS) } )
+	{
+		if ( !isMortonLayoutSupported(sc.width, sc.height, toroidal, rule) )
+			break;
+
+		Backend b;
+		b.kernel_id = -1;
+		b.threads = threads;
+		b.depth = 1;
+		b.tile_rows = 0;
+		b.bounded = false;
+		b.activity = false;
+		b.generation = 0;
+		b.grid.reset(new Grid(sc.width, sc.height, toroidal));
+		b.tiles.reset(new MortonGrid(sc.width, sc.height, toroidal));
+		b.tiles->Load(expected);
+		b.failed = false;
+		backends.push_back(std::move(b));
+	}
+
+	int failures = 0;
+	std::vector<unsigned char> age(size_t(sc.width) * sc.height, 0);
+	std::vector<unsigned char> heat(age.size(), 0);
+
+	for ( int gen = 1; gen <= sc.generations; ++gen )
+	{
+		referenceStep(ref, rule);
+		referenceActivityStep(ref, age, heat);
+		referenceToGrid(ref, expected);
+		long long population = referencePopulation(ref);
+
+		for ( auto& b : backends )
+		{
+			if ( b.failed )
+				continue;
+
+			if ( b.tiles )
+			{
+				b.tiles->Step(rule, (b.threads > 1) ? &workers : nullptr);
+				b.tiles->Store(*b.grid);
+			}
+			else if ( b.depth > 1 )
+			{
+				if ( (gen % b.depth != 0) && (gen != sc.generations) )
+					continue;
+				b.grid->StepBlocked(rule, getStepKernel(b.kernel_id), int(gen - b.generation), (b.threads > 1) ? &workers : nullptr, b.tile_rows);
+				b.generation = gen;
+			}
+			else
+				b.grid->Step(rule, getStepKernel(b.kernel_id), (b.threads > 1) ? &workers : nullptr);
+
+			// Численность считается только внутри рамки: она должна накрывать все живые клетки
+			if ( !b.grid->IsEqual(expected) || (b.grid->CountPopulation() != population) || (b.activity && !isActivityEqual(*b.grid, age, heat)) )
+			{
+				out << sc.name << " [" << mode << "]: " << (b.tiles ? "morton" : getStepKernelName(b.kernel_id)) << "/threads:" << b.threads;
+				if ( b.depth > 1 )
+					out << "/blocked:" << b.depth;
+				if ( b.activity )
+					out << "/activity";
+				else if ( !b.bounded )
+					out << "/full";
+				out << " differs from reference at generation " << gen << std::endl;
+				b.failed = true;
+				++failures;
+			}
+		}
+
+		if ( toroidal && (sc.period > 0) && (gen % sc.period == 0) && !expected.IsEqual(initial) )
+		{
+			out << sc.name << " [" << mode << "]: reference does not repeat after " << gen << " generations" << std::endl;
+			++failures;
+		}
+	}
+
+	if ( (sc.expected_population >= 0) && (referencePopulation(ref) != sc.expected_population) )
+	{
+		out << sc.name << " [" << mode << "]: population " << referencePopulation(ref)
+			<< " at generation " << sc.generations << ", expected " << sc.expected_population << std::endl;
+		++failures;
+	}
+
+	if ( failures == 0 )
+		out << sc.name << " [" << mode << "]: " << backends.size() << " backends match reference for "
+			<< sc.generations << " generations" << std::endl;
+
+	return failures;
+}
+
+/*
+ * Непрерывный режим: свёртка через БПФ и один шаг Lenia сверяются с прямым суммированием по ядру
+ * на торе. Размеры - степени двойки и произвольные(путь Блюстейна), в одном потоке и на полосах
+ */
+int verifyLenia(WorkerPool& workers, std::ostream& out)
+{
+	const int sizes[][2] = { { 64, 48 }, { 45, 37 } };
+	int failures = 0;
+
+	for ( auto& size : sizes )
+	{
+		int w = size[0];
+		int h = size[1];
+		LeniaParams params;
+		parseLeniaParams("R=9,mu=0.26,sigma=0.036,dt=0.2,b=1/0.5", params);
+
+		std::vector<float> kernel;
+		double kernel_sum = 0;
+		for ( int dy = -params.radius; dy <= params.radius; ++dy )
+			for ( int dx = -params.radius; dx <= params.radius; ++dx )
+			{
+				kernel.push_back(leniaKernelValue(params, sqrt(double(dx * dx + dy * dy))));
+				kernel_sum += kernel.back();
+			}
+
+		for ( int threads : { 1, int(VERIFY_THREADS) } )
+		{
+			LeniaField field(w, h, params);
+			field.Randomize(0.5, 7);
+
+			std::vector<float> expected(size_t(w) * h);
+			for ( int y = 0; y < h; ++y )
+				for ( int x = 0; x < w; ++x )
+				{
+					double sum = 0;
+					const float* k = kernel.data();
+					for ( int dy = -params.radius; dy <= params.radius; ++dy )
+						for ( int dx = -params.radius; dx <= params.radius; ++dx, ++k )
+							sum += *k * field.GetCell(((x + dx) % w + w) % w, ((y + dy) % h + h) % h);
+					expected[size_t(y) * w + x] = float(sum / kernel_sum);
+				}
+
+			std::vector<float> potential;
+			field.Convolve(potential, (threads > 1) ? &workers : nullptr);
+
+			std::vector<float> next(expected.size());
+			double max_error = 0;
+			for ( size_t i = 0; i < expected.size(); ++i )
+			{
+				max_error = std::max(max_error, double(std::fabs(potential[i] - expected[i])));
+				float c = field.GetCell(int(i % w), int(i / w));
+				next[i] = std::min(std::max(c + float(params.dt) * leniaGrowth(params, expected[i]), 0.0f), 1.0f);
+			}
+
+			field.Step((threads > 1) ? &workers : nullptr);
+			double step_error = 0;
+			for ( size_t i = 0; i < next.size(); ++i )
+				step_error = std::max(step_error, double(std::fabs(field.GetCell(int(i % w), int(i / w)) - next[i])));
+
+			// Потенциал ошибается на единицы 1e-7, после гауссианы роста шириной sigma - заметно больше
+			if ( (max_error > 1e-5) || (step_error > 1e-3) )
+			{
+				out << "lenia " << w << "x" << h << "/threads:" << threads << ": FFT convolution differs from the direct sum by "
+					<< max_error << ", step by " << step_error << std::endl;
+				++failures;
+			}
+			else
+				out << "lenia " << w << "x" << h << "/threads:" << threads << ": FFT convolution matches the direct sum (max error "
+					<< max_error << ")" << std::endl;
+		}
+	}
+
+	return failures;
+}
+
+/*
+ * Поток поколений(--serve): поле, собранное клиентом из ключевого кадра и дельт, сверяется с полем
+ * каждого поколения случайного супа. Ширины некратны 64, дельта от чужого поколения должна отвергаться
+ */
+int verifyStreamCodec(std::ostream& out)
+{
+	const int sizes[][2] = { { 64, 48 }, { 1000, 37 }, { 3, 5 } };
+	int failures = 0;
+
+	for ( auto& size : sizes )
+	{
+		int w = size[0];
+		int h = size[1];
+		Grid grid(w, h, true);
+		grid.Randomize(0.35, 11);
+		StepKernel kernel = getStepKernel(STEP_KERNEL_SWAR64);
+
+		int words = grid.GetRowWords();
+		std::vector<uint64_t> previous;
+		std::vector<uint64_t> current(size_t(words) * h);
+		std::vector<unsigned char> message;
+		StreamDecoder decoder;
+		int mismatches = 0;
+		size_t delta_bytes = 0;
+
+		for ( int generation = 0; generation <= VERIFY_STREAM_GENERATIONS; ++generation )
+		{
+			for ( int y = 0; y < h; ++y )
+				for ( int i = 0; i < words; ++i )
+					current[size_t(y) * words + i] = grid.GetRow(y)[i] & grid.GetTailMask()[i];
+
+			if ( generation % 32 == 0 )
+				encodeStreamKeyframe(current.data(), words, w, h, generation, message);
+			else
+			{
+				encodeStreamDelta(previous.data(), current.data(), words, w, h, generation - 1, generation, message);
+				delta_bytes += message.size();
+			}
+
+			StreamHeader header;
+			readStreamHeader(message.data(), header);
+			if ( (header.length + STREAM_HEADER_BYTES != message.size()) || !decoder.Apply(header, message.data() + STREAM_HEADER_BYTES)
+					|| (decoder.GetGeneration() != generation) || (decoder.GetBits() != current) )
+				++mismatches;
+
+			previous = current;
+			grid.Step(conwayRule(), kernel);
+		}
+
+		// Дельта от поколения, которого у клиента нет
+		encodeStreamDelta(previous.data(), current.data(), words, w, h, VERIFY_STREAM_GENERATIONS + 5, VERIFY_STREAM_GENERATIONS + 6, message);
+		StreamHeader header;
+		readStreamHeader(message.data(), header);
+		if ( decoder.Apply(header, message.data() + STREAM_HEADER_BYTES) )
+			++mismatches;
+
+		if ( mismatches )
+		{
+			out << "stream " << w << "x" << h << ": " << mismatches << " frames decoded differently" << std::endl;
+			++failures;
+		}
+		else
+			out << "stream " << w << "x" << h << ": keyframes and deltas decode to every generation ("
+				<< delta_bytes / (VERIFY_STREAM_GENERATIONS - VERIFY_STREAM_GENERATIONS / 32) << " bytes per delta)" << std::endl;
+	}
+
+	return failures;
+}
+
+/*
+ * Запросы численности по прямоугольникам: индекс обновляется через разное число поколений и после правок
+ * мимо рамки живых клеток, случайные прямоугольники(и выходящие за поле) сверяются с подсчётом по клеткам
+ */
+int verifyRegionQueries(std::ostream& out)
+{
+	const int sizes[][2] = { { 300, 200 }, { 1000, 37 }, { 3, 5 } };
+	int failures = 0;
+
+	for ( auto& size : sizes )
+	for ( bool toroidal : { false, true } )
+	{
+		int w = size[0];
+		int h = size[1];
+		Grid grid(w, h, toroidal);
+		grid.Randomize(0.35, 5);
+		RegionIndex index(w, h);
+		StepKernel kernel = getStepKernel(STEP_KERNEL_SWAR64);
+		std::mt19937 gen(17);
+		int mismatches = 0;
+
+		for ( int generation = 0; generation < VERIFY_REGION_GENERATIONS; )
+		{
+			if ( generation % 20 == 10 )
+				grid.SetCell(int(gen() % w), int(gen() % h), true);
+
+			index.Update(grid);
+			if ( (index.GetPopulation() != grid.CountPopulation()) || (index.Count(0, 0, w, h) != index.GetPopulation()) )
+				++mismatches;
+
+			for ( int q = 0; q < VERIFY_REGION_QUERIES / 10; ++q )
+			{
+				int x = int(gen() % (w + 20)) - 10;
+				int y = int(gen() % (h + 20)) - 10;
+				int rw = int(gen() % (w + 1)) + 1;
+				int rh = int(gen() % (h + 1)) + 1;
+
+				long long expected = 0;
+				for ( int cy = std::max(y, 0); cy < std::min(y + rh, h); ++cy )
+					for ( int cx = std::max(x, 0); cx < std::min(x + rw, w); ++cx )
+						expected += grid.GetCell(cx, cy);
+				if ( index.Count(x, y, rw, rh) != expected )
+					++mismatches;
+			}
+
+			int skip = 1 + int(gen() % 4);
+			for ( int s = 0; s < skip; ++s )
+				grid.Step(conwayRule(), kernel);
+			generation += skip;
+		}
+
+		const char* mode = toroidal ? "torus" : "bordered";
+		if ( mismatches )
+		{
+			out << "regions " << w << "x" << h << " [" << mode << "]: " << mismatches << " queries differ from the cell count" << std::endl;
+			++failures;
+		}
+		else
+			out << "regions " << w << "x" << h << " [" << mode << "]: rectangle queries match the cell count" << std::endl;
+	}
+
+	return failures;
+}
+
+}
+
+
+/*
+ * Прогоняет известные шаблоны и случайные супы через все ядра шага на поле с границами и на торе
+ * и сравнивает каждое поколение поклеточно с эталоном, затем проверяет свёртку непрерывного режима,
+ * кодирование потока поколений и запросы численности по прямоугольникам.
+ * Возвращает число расхождений
+ */
+int runStepVerification(std::ostream& out)
+{
+	WorkerPool workers(VERIFY_THREADS);
+	int failures = 0;
+
+	for ( auto& sc : scenarios )
+		for ( bool toroidal : { false, true } )
+			failures += verifyScenario(sc, toroidal, workers, out);
+	failures += verifyLenia(workers, out);
+	failures += verifyStreamCodec(out);
+	failures += verifyRegionQueries(out);
+
+	out << (failures ? "Verification FAILED: " : "Verification passed: ") << failures << " mismatches" << std::endl;
+
+	return failures;
+}
+
+#endif
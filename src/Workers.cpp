@@ -0,0 +1,212 @@
+#ifndef WORKERS_CPP
+#define WORKERS_CPP
+
+
+#include "../includes/Workers.hpp"
+#include "../includes/Trace.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace
+{
+
+#if defined(__linux__)
+int readTopologyValue(int cpu, const char* name)
+{
+	std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+	int value = 0;
+	if ( !(in >> value) )
+		return 0;
+
+	return value;
+}
+
+/*
+ * Доступные процессу логические процессоры по сокетам. Внутри сокета сначала идут ядра,
+ * затем их вторые потоки(SMT)
+ */
+std::vector<std::vector<int>> cpusBySocket(void)
+{
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if ( sched_getaffinity(0, sizeof(allowed), &allowed) != 0 )
+		return std::vector<std::vector<int>>();
+
+	struct CpuPlace
+	{
+		int package;
+		int sibling;
+		int core;
+		int cpu;
+	};
+	std::vector<CpuPlace> places;
+	for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+	{
+		if ( !CPU_ISSET(cpu, &allowed) )
+			continue;
+
+		CpuPlace p;
+		p.package = readTopologyValue(cpu, "physical_package_id");
+		p.core = readTopologyValue(cpu, "core_id");
+		p.cpu = cpu;
+		p.sibling = 0;
+		for ( auto& other : places )
+			if ( (other.package == p.package) && (other.core == p.core) )
+				++p.sibling;
+		places.push_back(p);
+	}
+
+	std::sort(places.begin(), places.end(), [](const CpuPlace& a, const CpuPlace& b)
+	{
+		if ( a.package != b.package )
+			return a.package < b.package;
+		if ( a.sibling != b.sibling )
+			return a.sibling < b.sibling;
+		if ( a.core != b.core )
+			return a.core < b.core;
+		return a.cpu < b.cpu;
+	});
+
+	std::vector<std::vector<int>> sockets;
+	for ( size_t i = 0; i < places.size(); ++i )
+	{
+		if ( (i == 0) || (places[i].package != places[i - 1].package) )
+			sockets.push_back(std::vector<int>());
+		sockets.back().push_back(places[i].cpu);
+	}
+
+	return sockets;
+}
+
+bool pinThread(pthread_t thread, int cpu)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+#endif
+
+}
+
+
+WorkerPool::WorkerPool(int count)
+{
+	workers_count = (count < 1) ? 1 : count;
+	task = nullptr;
+	generation = 0;
+	pending = 0;
+	stopping = false;
+
+	for ( int i = 1; i < workers_count; ++i )
+		threads.emplace_back(&WorkerPool::WorkerLoop, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	start_cv.notify_all();
+
+	for ( auto& t : threads )
+		t.join();
+}
+
+void WorkerPool::Run(const std::function<void(int)>& fn)
+{
+	if ( workers_count == 1 )
+	{
+		fn(0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = &fn;
+		pending = workers_count - 1;
+		++generation;
+	}
+	start_cv.notify_all();
+
+	fn(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done_cv.wait(lock, [this] { return pending == 0; });
+}
+
+/*
+ * Привязывает исполнителей к процессорам. Исполнители делятся между сокетами поровну подряд идущими
+ * группами, поэтому соседние полосы поля считаются на одном сокете; внутри сокета каждый получает
+ * своё ядро, пока они не кончатся. Исполнитель 0 - вызывающий поток, он и должен потом вызывать Run.
+ * Без Linux ничего не делает и возвращает false
+ */
+bool WorkerPool::PinThreads(void)
+{
+#if defined(__linux__)
+	std::vector<std::vector<int>> sockets = cpusBySocket();
+	if ( sockets.empty() )
+	{
+		std::cout << "[WorkerPool::PinThreads](" << this << "): Unable to read the CPU affinity mask!" << std::endl;
+		return false;
+	}
+
+	int sockets_count = int(sockets.size());
+	bool pinned = true;
+	for ( int worker = 0; worker < workers_count; ++worker )
+	{
+		int socket = int((long long)worker * sockets_count / workers_count);
+		int first = int(((long long)socket * workers_count + sockets_count - 1) / sockets_count);
+		const std::vector<int>& cpus = sockets[socket];
+		int cpu = cpus[(worker - first) % cpus.size()];
+		pthread_t thread = (worker == 0) ? pthread_self() : threads[worker - 1].native_handle();
+		if ( !pinThread(thread, cpu) )
+		{
+			std::cout << "[WorkerPool::PinThreads](" << this << "): Unable to pin worker " << worker << " to CPU " << cpu << "!" << std::endl;
+			pinned = false;
+		}
+	}
+
+	return pinned;
+#else
+	std::cout << "[WorkerPool::PinThreads](" << this << "): Thread pinning is supported on Linux only!" << std::endl;
+	return false;
+#endif
+}
+
+void WorkerPool::WorkerLoop(int worker)
+{
+	unsigned long long seen_generation = 0;
+	TRACE_THREAD_NAME("worker", worker);
+
+	for ( ;; )
+	{
+		const std::function<void(int)>* current_task = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start_cv.wait(lock, [this, seen_generation] { return stopping || (generation != seen_generation); });
+			if ( stopping )
+				return;
+			seen_generation = generation;
+			current_task = task;
+		}
+
+		(*current_task)(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--pending;
+		}
+		done_cv.notify_one();
+	}
+}
+
+#endif
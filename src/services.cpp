@@ -2,6 +2,18 @@
 #define SERVICES_CPP
 
 #include "../includes/services.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <dirent.h>
+#endif
 
 
 const std::string getResourcePath(const char* str)
@@ -14,4 +26,153 @@ const std::string getResourcePath(const char* str)
 	return result;
 }
 
+/*
+ * Выделяет обнулённый блок памяти, выровненный по границе alignment байт.
+ * Блок берётся через calloc: большие блоки система отдаёт уже нулевыми страницами, которые
+ * появляются при первом обращении, поэтому выделение не зависит от размера. Адрес исходного
+ * блока хранится прямо перед выровненным указателем
+ */
+void* allocAligned(size_t size, size_t alignment)
+{
+	void* raw = calloc(1, size + alignment + sizeof(void*));
+	if ( raw == nullptr )
+		return nullptr;
+
+	uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+	uintptr_t aligned = (start + alignment - 1) & ~uintptr_t(alignment - 1);
+	reinterpret_cast<void**>(aligned)[-1] = raw;
+
+	return reinterpret_cast<void*>(aligned);
+}
+
+void freeAligned(void* ptr)
+{
+	if ( !ptr )
+		return;
+
+	free(static_cast<void**>(ptr)[-1]);
+}
+
+/*
+ * Выделяет обнулённый блок целыми страницами под большие буферы. С huge сначала пробуются страницы
+ * по 2 МБ(MAP_HUGETLB, нужен резерв vm.nr_hugepages), затем обычные с просьбой к ядру собрать их
+ * в прозрачные большие(MADV_HUGEPAGE). Физические страницы появляются при первой записи и достаются
+ * узлу NUMA записавшего потока. В kind возвращается, какие страницы получены; без mmap - allocAligned
+ */
+void* allocPages(size_t size, bool huge, int& kind)
+{
+#if defined(__linux__)
+	size_t huge_size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	void* ptr = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+	if ( huge )
+	{
+		ptr = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if ( ptr != MAP_FAILED )
+		{
+			kind = PAGES_HUGE;
+			return ptr;
+		}
+	}
+#endif
+
+	ptr = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ( ptr == MAP_FAILED )
+		return nullptr;
+
+	kind = PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+	if ( huge && (madvise(ptr, huge_size, MADV_HUGEPAGE) == 0) )
+		kind = PAGES_TRANSPARENT_HUGE;
+#endif
+
+	return ptr;
+#else
+	kind = PAGES_HEAP;
+	return allocAligned(size, HUGE_PAGE_SIZE);
+#endif
+}
+
+// size и kind - те же, что при выделении
+void freePages(void* ptr, size_t size, int kind)
+{
+	if ( !ptr )
+		return;
+
+	if ( kind == PAGES_HEAP )
+	{
+		freeAligned(ptr);
+		return;
+	}
+
+#if defined(__linux__)
+	munmap(ptr, (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+#endif
+}
+
+const char* getPagesKindName(int kind)
+{
+	switch ( kind )
+	{
+		case PAGES_NORMAL:				return "normal pages";
+		case PAGES_TRANSPARENT_HUGE:	return "transparent huge pages";
+		case PAGES_HUGE:				return "2 MB huge pages";
+	}
+
+	return "heap";
+}
+
+// Создаёт каталог. Уже существующий каталог ошибкой не считается
+bool makeDirectory(const char* path)
+{
+#ifdef _WIN32
+	if ( _mkdir(path) == 0 )
+		return true;
+#else
+	if ( mkdir(path, 0755) == 0 )
+		return true;
+#endif
+
+	return errno == EEXIST;
+}
+
+// Имена файлов каталога с окончанием suffix(без путей), отсортированные по алфавиту
+bool listDirectory(const char* path, const char* suffix, std::vector<std::string>& names)
+{
+	std::string ext(suffix);
+	names.clear();
+
+#ifdef _WIN32
+	std::string mask = getResourcePath(path) + "*" + ext;
+	_finddata_t info;
+	intptr_t handle = _findfirst(mask.c_str(), &info);
+	if ( handle == -1 )
+		return errno == ENOENT;
+
+	do
+	{
+		if ( !(info.attrib & _A_SUBDIR) )
+			names.push_back(info.name);
+	} while ( _findnext(handle, &info) == 0 );
+	_findclose(handle);
+#else
+	DIR* dir = opendir(path);
+	if ( dir == nullptr )
+		return false;
+
+	while ( dirent* entry = readdir(dir) )
+	{
+		std::string name(entry->d_name);
+		if ( (name.size() > ext.size()) && (name.compare(name.size() - ext.size(), ext.size(), ext) == 0) )
+			names.push_back(name);
+	}
+	closedir(dir);
+#endif
+
+	std::sort(names.begin(), names.end());
+
+	return true;
+}
+
 #endif
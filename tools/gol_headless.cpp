@@ -0,0 +1,80 @@
+#include "../includes/Options.hpp"
+#include "../includes/Headless.hpp"
+#include "../includes/Replay.hpp"
+#include "../includes/Verify.hpp"
+#include "../includes/Trace.hpp"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+
+/*
+ * Программа без SDL поверх libgol: прогон без окна(как ./main --headless), --verify и --replay=file.rpl.
+ * Для вычислительных узлов, где нет SDL2, SDL2_image и SDL2_ttf
+ */
+int main(int argc, char* argv[])
+{
+	EngineParams eparams;
+	HeadlessParams hparams;
+	initEngineParams(eparams);
+	initHeadlessParams(hparams);
+
+	bool verify = false;
+	const char* replay_path = nullptr;
+	const char* trace_path = nullptr;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const char* arg = argv[i];
+
+		if ( parseEngineOption(arg, eparams, hparams) )
+			continue;
+
+		if ( strcmp(arg, "--verify") == 0 )
+		{
+			verify = true;
+		}
+		else if ( strcmp(arg, "--headless") == 0 )
+		{
+			// Без окна программа работает всегда
+		}
+		else if ( strncmp(arg, "--replay=", 9) == 0 )
+		{
+			replay_path = arg + 9;
+		}
+		else if ( strncmp(arg, "--trace=", 8) == 0 )
+		{
+			trace_path = arg + 8;
+		}
+		else
+		{
+			std::cout << "Unknown option " << arg << " is ignored" << std::endl;
+		}
+	}
+
+	// Стандартный вывод занят кадрами, поэтому сообщения уходят в поток ошибок
+	if ( isCaptureToStdout(hparams.capture) )
+		std::cout.rdbuf(std::cerr.rdbuf());
+
+	if ( verify )
+		return runStepVerification(std::cout) ? 1 : 0;
+
+	if ( replay_path )
+	{
+		std::string trace = trace_path ? trace_path : std::string(replay_path) + ".trace.json";
+		traceStart(trace.c_str());
+
+		int replay_result = runReplay(replay_path, eparams);
+		traceStop();
+
+		return replay_result;
+	}
+
+	if ( trace_path )
+		traceStart(trace_path);
+
+	int headless_result = runHeadless(hparams, eparams);
+	traceStop();
+
+	return headless_result;
+}
@@ -0,0 +1,195 @@
+#include "../includes/SharedFrames.hpp"
+#include "../includes/Stream.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+
+
+enum
+{
+			WATCH_DEFAULT_INTERVAL_MS		=								500,
+			WATCH_MAP_WIDTH					=								 64,
+			WATCH_MAP_HEIGHT				=								 32
+};
+
+
+// Уменьшенная карта поля: символ - доля живых клеток своего прямоугольника
+static std::string drawMap(const uint64_t* bits, int row_words, int width, int height)
+{
+	static const char shades[] = " .:*#";
+	int map_w = (width < WATCH_MAP_WIDTH) ? width : WATCH_MAP_WIDTH;
+	int map_h = (height < WATCH_MAP_HEIGHT) ? height : WATCH_MAP_HEIGHT;
+
+	std::string map;
+	for ( int my = 0; my < map_h; ++my )
+	{
+		int y0 = int((long long)height * my / map_h);
+		int y1 = int((long long)height * (my + 1) / map_h);
+		for ( int mx = 0; mx < map_w; ++mx )
+		{
+			int x0 = int((long long)width * mx / map_w);
+			int x1 = int((long long)width * (mx + 1) / map_w);
+			long long alive = 0;
+			for ( int y = y0; y < y1; ++y )
+				for ( int x = x0; x < x1; ++x )
+					alive += (bits[size_t(y) * row_words + x / 64] >> (x % 64)) & 1;
+			long long area = (long long)(y1 - y0) * (x1 - x0);
+			map += shades[(area > 0) ? int(alive * 4 / area) : 0];
+		}
+		map += '\n';
+	}
+
+	return map;
+}
+
+/*
+ * Клиент сервера потока(--serve): поле собирается из ключевых кадров и дельт, раз в interval печатается
+ * последнее поколение и число принятых сообщений. С randomize клиент после подключения засевает поле сервера
+ */
+static int watchStream(const StreamAddress& address, int interval, long long frames, bool show_map, double randomize)
+{
+	StreamClient client;
+	long long keyframes = 0;
+	long long deltas = 0;
+	auto next = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval);
+
+	while ( frames != 0 )
+	{
+		if ( !client.IsConnected() )
+		{
+			if ( !client.Connect(address) )
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+				continue;
+			}
+			std::cout << "Watching " << getStreamAddressName(address) << std::endl;
+
+			if ( randomize > 0 )
+			{
+				EditCommand cmd = { EDIT_RANDOMIZE, 0, 0, 0, 0, true, nullptr, (unsigned int)time(nullptr), randomize };
+				client.SendEdits(&cmd, 1);
+			}
+		}
+
+		int wait = int(std::chrono::duration_cast<std::chrono::milliseconds>(next - std::chrono::steady_clock::now()).count());
+		int type = client.Receive((wait > 0) ? wait : 0);
+		if ( type == STREAM_MESSAGE_KEYFRAME )
+			++keyframes;
+		else if ( type == STREAM_MESSAGE_DELTA )
+			++deltas;
+		else if ( (type < 0) && client.IsConnected() )
+			std::cout << "The stream is out of sync, waiting for a keyframe" << std::endl;
+
+		if ( std::chrono::steady_clock::now() < next )
+			continue;
+		next = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval);
+
+		const StreamDecoder& decoder = client.GetDecoder();
+		if ( !decoder.IsSynced() )
+			continue;
+
+		std::cout << "Generation " << decoder.GetGeneration() << ", population " << decoder.CountPopulation()
+				  << ", keyframes " << keyframes << ", deltas " << deltas << std::endl;
+		if ( show_map )
+			std::cout << drawMap(decoder.GetBits().data(), decoder.GetRowWords(), decoder.GetWidth(), decoder.GetHeight());
+		keyframes = 0;
+		deltas = 0;
+		if ( frames > 0 )
+			--frames;
+	}
+
+	return 0;
+}
+
+/*
+ * Внешний читатель кадров, которые публикует ./main или gol_headless с ключом --publish=name,
+ * или клиент сервера --serve=unix:путь|tcp:порт. Печатает поколение и численность последнего кадра
+ * каждые --interval=мс(с --map - и карту поля), --frames=N - остановиться после N отчётов.
+ * Симуляцию не тормозит: пропущенные поколения просто не видны
+ */
+int main(int argc, char* argv[])
+{
+	const char* name = nullptr;
+	int interval = WATCH_DEFAULT_INTERVAL_MS;
+	long long frames = -1;
+	bool show_map = false;
+	double randomize = 0.0;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const char* arg = argv[i];
+		if ( strncmp(arg, "--interval=", 11) == 0 )
+			interval = atoi(arg + 11);
+		else if ( strncmp(arg, "--frames=", 9) == 0 )
+			frames = atoll(arg + 9);
+		else if ( strcmp(arg, "--map") == 0 )
+			show_map = true;
+		else if ( strncmp(arg, "--randomize=", 12) == 0 )
+			randomize = atof(arg + 12);
+		else if ( strncmp(arg, "--", 2) == 0 )
+			std::cout << "Unknown option " << arg << " is ignored" << std::endl;
+		else
+			name = arg;
+	}
+
+	if ( name == nullptr )
+	{
+		std::cout << "Usage: gol_watch name|unix:path|tcp:port [--interval=ms] [--frames=N] [--map] [--randomize=density]" << std::endl;
+		return 1;
+	}
+	if ( interval < 1 )
+		interval = WATCH_DEFAULT_INTERVAL_MS;
+
+	StreamAddress address;
+	if ( parseStreamSpec(name, address) )
+		return watchStream(address, interval, frames, show_map, randomize);
+
+	FrameSubscriber subscriber(name);
+	long long last_generation = -1;
+	unsigned long long last_published = 0;
+
+	while ( frames != 0 )
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+
+		// Писатель ещё не запущен, завершился или сменил размер поля - сегмент открывается заново
+		if ( !subscriber.IsOpen() || subscriber.IsClosed() )
+		{
+			if ( !subscriber.Open() )
+				continue;
+			std::cout << "Watching " << name << ": " << subscriber.GetWidth() << "x" << subscriber.GetHeight() << std::endl;
+			last_published = 0;
+		}
+
+		SharedFrameView view;
+		if ( !subscriber.Acquire(view) || (view.generation == last_generation) )
+			continue;
+
+		unsigned long long published = subscriber.GetPublished();
+		std::cout << "Generation " << view.generation << ", population " << view.population;
+		if ( last_published > 0 )
+			std::cout << ", skipped " << published - last_published - 1;
+		std::cout << std::endl;
+
+		// Карта строится прямо по сегменту и печатается, только если писатель не переписал кадр
+		if ( show_map )
+		{
+			std::string map = drawMap(view.bits, subscriber.GetRowWords(), subscriber.GetWidth(), subscriber.GetHeight());
+			if ( subscriber.Validate(view) )
+				std::cout << map;
+			else
+				std::cout << "(the frame was overwritten while drawing)" << std::endl;
+		}
+
+		last_generation = view.generation;
+		last_published = published;
+		if ( frames > 0 )
+			--frames;
+	}
+
+	return 0;
+}